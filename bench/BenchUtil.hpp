@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+using namespace std;
+
+#if defined(_MSC_VER)
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+/**
+ * @brief Helpers shared by the micro benchmarks
+ */
+namespace Bench {
+    /**
+     * @brief Keep a value alive so the optimizer cannot drop its computation
+     */
+    template <typename T>
+    inline void doNotOptimize(T const& value)
+    {
+#if defined(_MSC_VER)
+        static volatile const void* sink;
+        sink = &value;
+#else
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif
+    }
+
+    inline uint64_t nowNs(void)
+    {
+        return chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Average nanoseconds per call of fn over the given iterations
+     *
+     * A tenth of the iterations is run first as warm-up.
+     */
+    template <typename F>
+    double nsPerOp(uint64_t iterations, F&& fn)
+    {
+        for (uint64_t i = 0; i < iterations / 10; ++i) {
+            fn();
+        }
+
+        uint64_t start = nowNs();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            fn();
+        }
+        return double(nowNs() - start) / double(iterations);
+    }
+}
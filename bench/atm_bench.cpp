@@ -0,0 +1,362 @@
+#include "Controller.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "BenchUtil.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Latency and throughput of Controller operations and sessions
+ *
+ * Each scenario puts a Controller in the state an operation needs (not
+ * timed), times the operation alone, then restores the state (not timed).
+ * Every repetition runs a warm-up of a tenth of the iterations first.
+ * Success and failure paths run against the test fakes, so the numbers
+ * are the controller's own overhead.
+ *
+ * Usage: atm_bench [--iterations N] [--repetitions N] [--json FILE]
+ */
+
+namespace {
+    struct Options {
+        uint64_t iterations = 20000;
+        uint64_t repetitions = 5;
+        const char* json = nullptr;
+    };
+
+    struct Summary {
+        string name;
+        string path;               // "success" or "failure"
+        uint64_t samples = 0;
+        double minNs = 0;
+        double p50Ns = 0;
+        double p90Ns = 0;
+        double p99Ns = 0;
+        double maxNs = 0;
+        double meanNs = 0;
+        double opsPerSec = 0;      // median over repetitions
+    };
+
+    /**
+     * @brief Cash bin whose dispenser jams after passing the pre-check
+     */
+    class JammedCashBin : public FakeCashBin {
+    public:
+        using FakeCashBin::FakeCashBin;
+
+        Status dispense(int) override
+        {
+            return Status::error(Err::HardwareError);
+        }
+    };
+
+    const Card kCard = "CARD-001";
+    const Pin kPin = "1234";
+    const AccountId kAccount = "ACCOUNT-001";
+    const AccountId kEmptyAccount = "ACCOUNT-002";
+
+    FakeBank makeBank(void)
+    {
+        return FakeBank({ {kCard, kPin} },
+                        { {kCard, {kAccount, kEmptyAccount}} },
+                        { {kAccount, 1000000000}, {kEmptyAccount, 0} });
+    }
+
+    /**
+     * @brief Fakes and a Controller wired together for one scenario
+     */
+    struct Fixture {
+        Card card = kCard;
+        FakeCardReader cardReader{ card };
+        FakeBank bank = makeBank();
+        FakeCashBin cashBin{ 1000000000 };
+        JammedCashBin jammedCashBin{ 1000000000 };
+        Controller atm;
+
+        explicit Fixture(bool jammed = false, ControllerMetrics* metrics = nullptr)
+         : atm(cardReader, bank, jammed ? static_cast<ICashBin&>(jammedCashBin) : cashBin, config(metrics))
+        {}
+
+        static Controller::Config config(ControllerMetrics* metrics)
+        {
+            Controller::Config cfg;
+            cfg.metrics = metrics;
+            return cfg;
+        }
+
+        void toAuthenticated(void)
+        {
+            (void)atm.insertCard();
+            (void)atm.enterPin(kPin);
+        }
+
+        void toSelected(const AccountId& account)
+        {
+            toAuthenticated();
+            (void)atm.selectAccount(account);
+        }
+    };
+
+    double percentile(const vector<uint64_t>& sorted, double p)
+    {
+        size_t index = size_t(p * double(sorted.size() - 1) + 0.5);
+        return double(sorted[index]);
+    }
+
+    /**
+     * @brief Time op() per call; setup/teardown run around it untimed
+     */
+    Summary measure(const Options& opt, const char* name, const char* path,
+                    const function<void()>& setup,
+                    const function<void()>& op,
+                    const function<void()>& teardown)
+    {
+        vector<uint64_t> samples;
+        samples.reserve(opt.iterations * opt.repetitions);
+        vector<double> throughput;
+
+        for (uint64_t rep = 0; rep < opt.repetitions; ++rep)
+        {
+            for (uint64_t i = 0; i < opt.iterations / 10; ++i)
+            {
+                setup();
+                op();
+                teardown();
+            }
+
+            uint64_t busy = 0;
+            for (uint64_t i = 0; i < opt.iterations; ++i)
+            {
+                setup();
+                uint64_t start = Bench::nowNs();
+                op();
+                uint64_t elapsed = Bench::nowNs() - start;
+                teardown();
+
+                samples.push_back(elapsed);
+                busy += elapsed;
+            }
+            throughput.push_back(busy ? double(opt.iterations) * 1e9 / double(busy) : 0.0);
+        }
+
+        sort(samples.begin(), samples.end());
+        sort(throughput.begin(), throughput.end());
+
+        Summary s;
+        s.name = name;
+        s.path = path;
+        s.samples = samples.size();
+        s.minNs = double(samples.front());
+        s.p50Ns = percentile(samples, 0.50);
+        s.p90Ns = percentile(samples, 0.90);
+        s.p99Ns = percentile(samples, 0.99);
+        s.maxNs = double(samples.back());
+        double total = 0;
+        for (auto v : samples) total += double(v);
+        s.meanNs = total / double(samples.size());
+        s.opsPerSec = throughput[throughput.size() / 2];
+        return s;
+    }
+
+    void printTable(const vector<Summary>& results)
+    {
+        printf("%-32s %-8s %9s %9s %9s %9s %9s %12s\n",
+               "scenario", "path", "min ns", "p50 ns", "p90 ns", "p99 ns", "max ns", "ops/s");
+        printf("%s\n", string(104, '=').c_str());
+        for (const auto& s : results)
+        {
+            printf("%-32s %-8s %9.0f %9.0f %9.0f %9.0f %9.0f %12.0f\n",
+                   s.name.c_str(), s.path.c_str(), s.minNs, s.p50Ns, s.p90Ns, s.p99Ns, s.maxNs, s.opsPerSec);
+        }
+    }
+
+    bool writeJson(const char* file, const Options& opt, const vector<Summary>& results)
+    {
+        FILE* out = fopen(file, "w");
+        if (!out)
+        {
+            return false;
+        }
+
+        fprintf(out, "{\n  \"benchmark\": \"atm_bench\",\n");
+        fprintf(out, "  \"iterations\": %llu,\n  \"repetitions\": %llu,\n",
+                (unsigned long long)opt.iterations, (unsigned long long)opt.repetitions);
+        fprintf(out, "  \"results\": [\n");
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const auto& s = results[i];
+            fprintf(out,
+                    "    {\"name\": \"%s\", \"path\": \"%s\", \"samples\": %llu, "
+                    "\"min_ns\": %.0f, \"p50_ns\": %.0f, \"p90_ns\": %.0f, \"p99_ns\": %.0f, "
+                    "\"max_ns\": %.0f, \"mean_ns\": %.1f, \"ops_per_sec\": %.0f}%s\n",
+                    s.name.c_str(), s.path.c_str(), (unsigned long long)s.samples,
+                    s.minNs, s.p50Ns, s.p90Ns, s.p99Ns, s.maxNs, s.meanNs, s.opsPerSec,
+                    i + 1 < results.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+        return fclose(out) == 0;
+    }
+
+    bool parseOptions(int argc, char** argv, Options& opt)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            bool hasValue = i + 1 < argc;
+            if (!strcmp(argv[i], "--iterations") && hasValue)
+            {
+                opt.iterations = strtoull(argv[++i], nullptr, 10);
+            }
+            else if (!strcmp(argv[i], "--repetitions") && hasValue)
+            {
+                opt.repetitions = strtoull(argv[++i], nullptr, 10);
+            }
+            else if (!strcmp(argv[i], "--json") && hasValue)
+            {
+                opt.json = argv[++i];
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return opt.iterations > 0 && opt.repetitions > 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseOptions(argc, argv, opt))
+    {
+        fprintf(stderr, "usage: %s [--iterations N] [--repetitions N] [--json FILE]\n", argv[0]);
+        return 2;
+    }
+
+    auto none = [] {};
+    vector<Summary> results;
+
+    {
+        Fixture f;
+        results.push_back(measure(opt, "insertCard", "success",
+            none, [&] { (void)f.atm.insertCard(); }, [&] { (void)f.atm.ejectCard(); }));
+        results.push_back(measure(opt, "enterPin", "success",
+            [&] { (void)f.atm.insertCard(); }, [&] { (void)f.atm.enterPin(kPin); }, [&] { (void)f.atm.ejectCard(); }));
+        results.push_back(measure(opt, "enterPin (wrong PIN)", "failure",
+            [&] { (void)f.atm.insertCard(); }, [&] { (void)f.atm.enterPin("0000"); }, [&] { (void)f.atm.ejectCard(); }));
+        results.push_back(measure(opt, "listAccounts", "success",
+            [&] { f.toAuthenticated(); }, [&] { Bench::doNotOptimize(f.atm.listAccounts()); }, [&] { (void)f.atm.ejectCard(); }));
+        results.push_back(measure(opt, "selectAccount", "success",
+            [&] { f.toAuthenticated(); }, [&] { (void)f.atm.selectAccount(kAccount); }, [&] { (void)f.atm.ejectCard(); }));
+        results.push_back(measure(opt, "ejectCard", "success",
+            [&] { (void)f.atm.insertCard(); }, [&] { (void)f.atm.ejectCard(); }, none));
+    }
+
+    {
+        // Operations that leave the controller in AccountSelected reuse one session
+        Fixture f;
+        f.toSelected(kAccount);
+        results.push_back(measure(opt, "getBalance", "success",
+            none, [&] { Bench::doNotOptimize(f.atm.getBalance()); }, none));
+        results.push_back(measure(opt, "deposit", "success",
+            none, [&] { (void)f.atm.deposit(10); }, none));
+        results.push_back(measure(opt, "withdraw", "success",
+            none, [&] { (void)f.atm.withdraw(10); }, none));
+    }
+
+    {
+        Fixture f;
+        f.toSelected(kEmptyAccount);
+        results.push_back(measure(opt, "withdraw (insufficient funds)", "failure",
+            none, [&] { (void)f.atm.withdraw(10); }, none));
+    }
+
+    {
+        Fixture f(true);
+        f.toSelected(kAccount);
+        results.push_back(measure(opt, "withdraw (dispense rollback)", "failure",
+            none, [&] { (void)f.atm.withdraw(10); }, none));
+    }
+
+    {
+        // Capturing a session for a restart, and resuming it
+        Fixture f;
+        f.toSelected(kAccount);
+        SessionKey key = {};
+        SessionRecord record = f.atm.snapshot(key).value();
+        results.push_back(measure(opt, "snapshot", "success",
+            none, [&] { Bench::doNotOptimize(f.atm.snapshot(key)); }, none));
+        results.push_back(measure(opt, "restore", "success",
+            [&] { (void)f.atm.ejectCard(); }, [&] { (void)f.atm.restore(record, key, chrono::seconds(3600)); }, none));
+    }
+
+    {
+        Fixture f;
+        results.push_back(measure(opt, "session (withdraw)", "success", none, [&] {
+            (void)f.atm.insertCard();
+            (void)f.atm.enterPin(kPin);
+            (void)f.atm.selectAccount(kAccount);
+            (void)f.atm.withdraw(10);
+            (void)f.atm.ejectCard();
+        }, none));
+        results.push_back(measure(opt, "session (PIN failure)", "failure", none, [&] {
+            (void)f.atm.insertCard();
+            (void)f.atm.enterPin("0000");
+            (void)f.atm.ejectCard();
+        }, none));
+    }
+
+    {
+        // Same flows with latency histograms on, to show their overhead
+        ControllerMetrics metrics;
+        Fixture f(false, &metrics);
+        f.toSelected(kAccount);
+        results.push_back(measure(opt, "withdraw (metrics on)", "success",
+            none, [&] { (void)f.atm.withdraw(10); }, none));
+        (void)f.atm.ejectCard();
+        results.push_back(measure(opt, "session (withdraw, metrics on)", "success", none, [&] {
+            (void)f.atm.insertCard();
+            (void)f.atm.enterPin(kPin);
+            (void)f.atm.selectAccount(kAccount);
+            (void)f.atm.withdraw(10);
+            (void)f.atm.ejectCard();
+        }, none));
+    }
+
+    {
+        ControllerMetrics metrics(false);
+        Fixture f(false, &metrics);
+        f.toSelected(kAccount);
+        results.push_back(measure(opt, "withdraw (metrics, ops only)", "success",
+            none, [&] { (void)f.atm.withdraw(10); }, none));
+        (void)f.atm.ejectCard();
+        results.push_back(measure(opt, "session (metrics, ops only)", "success", none, [&] {
+            (void)f.atm.insertCard();
+            (void)f.atm.enterPin(kPin);
+            (void)f.atm.selectAccount(kAccount);
+            (void)f.atm.withdraw(10);
+            (void)f.atm.ejectCard();
+        }, none));
+    }
+
+    printf("Controller benchmark (%llu iterations x %llu repetitions)\n\n",
+           (unsigned long long)opt.iterations, (unsigned long long)opt.repetitions);
+    printTable(results);
+
+    if (opt.json)
+    {
+        if (!writeJson(opt.json, opt, results))
+        {
+            fprintf(stderr, "cannot write %s\n", opt.json);
+            return 1;
+        }
+        printf("\nResults written to %s\n", opt.json);
+    }
+    return 0;
+}
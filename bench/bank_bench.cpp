@@ -0,0 +1,107 @@
+#include "ShardedBank.hpp"
+#include "BenchUtil.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Multithreaded stress benchmark for ShardedBank
+ *
+ * Runs a read-heavy mix (50% getBalance, 25% deposit, 25% withdraw) over
+ * many accounts, and a single hot account under pure withdraw contention,
+ * at increasing thread counts. Prints throughput and scaling relative to
+ * one thread.
+ */
+
+static const size_t kAccounts = 100000;
+static const uint64_t kOpsPerThread = 1000000;
+
+static uint64_t xorshift(uint64_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+template <typename Op>
+static double run(size_t threads, Op op)
+{
+    atomic<bool> go{ false };
+    vector<thread> workers;
+    for (size_t t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t] {
+            uint64_t rng = 0x9E3779B97F4A7C15ull * (t + 1);
+            while (!go.load()) {}
+            for (uint64_t i = 0; i < kOpsPerThread; ++i)
+            {
+                op(rng);
+            }
+        });
+    }
+
+    uint64_t start = Bench::nowNs();
+    go = true;
+    for (auto& w : workers) w.join();
+    double seconds = double(Bench::nowNs() - start) / 1e9;
+    return double(threads * kOpsPerThread) / seconds;
+}
+
+int main()
+{
+    ShardedBank bank(256);
+    vector<AccountId> ids;
+    ids.reserve(kAccounts);
+    for (size_t i = 0; i < kAccounts; ++i)
+    {
+        ids.push_back("ACCOUNT-" + to_string(i));
+        (void)bank.addAccount(ids.back(), 1000000);
+    }
+    AccountId hot = "HOT";
+    (void)bank.addAccount(hot, 2000000000);
+
+    size_t maxThreads = max<size_t>(1, thread::hardware_concurrency());
+    vector<size_t> counts;
+    for (size_t n = 1; n < maxThreads; n *= 2) counts.push_back(n);
+    counts.push_back(maxThreads);
+
+    printf("ShardedBank stress benchmark (%zu accounts, %llu ops/thread)\n",
+           kAccounts, (unsigned long long)kOpsPerThread);
+    printf("==============================================================\n");
+    printf("%-8s %16s %8s %16s %8s\n", "threads", "mixed ops/s", "scale", "hot CAS ops/s", "scale");
+
+    double mixedBase = 0.0;
+    double hotBase = 0.0;
+    for (size_t n : counts)
+    {
+        double mixed = run(n, [&](uint64_t& rng) {
+            uint64_t r = xorshift(rng);
+            const AccountId& id = ids[r % kAccounts];
+            switch ((r >> 32) & 3)
+            {
+            case 0:
+            case 1:
+                Bench::doNotOptimize(bank.getBalance(id));
+                break;
+            case 2:
+                Bench::doNotOptimize(bank.deposit(id, 1));
+                break;
+            default:
+                Bench::doNotOptimize(bank.withdraw(id, 1));
+                break;
+            }
+        });
+        double contended = run(n, [&](uint64_t&) {
+            Bench::doNotOptimize(bank.withdraw(hot, 1));
+        });
+
+        if (mixedBase == 0.0) mixedBase = mixed;
+        if (hotBase == 0.0) hotBase = contended;
+        printf("%-8zu %16.0f %7.2fx %16.0f %7.2fx\n", n, mixed, mixed / mixedBase, contended, contended / hotBase);
+    }
+    return 0;
+}
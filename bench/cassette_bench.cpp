@@ -0,0 +1,159 @@
+#include "CassetteCashBin.hpp"
+#include "BenchUtil.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <vector>
+
+/**
+ * @brief CassetteCashBin over realistic dispenser loadings
+ *
+ * For each loading, compares canDispense() served from the precomputed
+ * tables with solving the bounded change-making problem per request, then
+ * times plan() for both strategies and dispense() including the table
+ * updates while a machine is drained by random withdrawals. The fill
+ * spread shows how evenly each strategy empties the cassettes.
+ */
+
+namespace {
+    struct Loading {
+        const char* name;
+        vector<CassetteCashBin::Cassette> cassettes;
+        int maxDispense;
+        int step;       // Amounts requested are multiples of this
+    };
+
+    uint64_t xorshift(uint64_t& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    /**
+     * @brief Fewest notes for money, recomputed from scratch: what canDispense costs without tables
+     */
+    BENCH_NOINLINE bool solvePerRequest(const vector<CassetteCashBin::Cassette>& cassettes, int money)
+    {
+        int unit = 0;
+        for (const auto& c : cassettes) unit = gcd(unit, c.denomination);
+        if (money <= 0 || money % unit) return false;
+
+        size_t slots = size_t(money / unit) + 1;
+        vector<int> best(slots, INT_MAX);
+        best[0] = 0;
+        for (const auto& c : cassettes)
+        {
+            // Binary splitting turns the bounded count into 0/1 items
+            int left = min(c.count, money / c.denomination);
+            for (int chunk = 1; left > 0; chunk *= 2)
+            {
+                int take = min(chunk, left);
+                left -= take;
+                size_t width = size_t(take) * size_t(c.denomination / unit);
+                for (size_t a = slots; a-- > width;)
+                {
+                    if (best[a - width] != INT_MAX)
+                    {
+                        best[a] = min(best[a], best[a - width] + take);
+                    }
+                }
+            }
+        }
+        return best[slots - 1] != INT_MAX;
+    }
+
+    vector<int> amounts(const Loading& loading, size_t n)
+    {
+        uint64_t rng = 0x9E3779B97F4A7C15ull;
+        vector<int> out(n);
+        int choices = loading.maxDispense / loading.step;
+        for (auto& money : out)
+        {
+            money = (int(xorshift(rng) % uint64_t(choices)) + 1) * loading.step;
+        }
+        return out;
+    }
+
+    /**
+     * @brief Withdraw from a fresh machine until half its cash is gone; ns per dispense and fill spread
+     */
+    void drain(const Loading& loading, CassetteCashBin::Strategy strategy, const vector<int>& requests)
+    {
+        CassetteCashBin::Config cfg;
+        cfg.maxDispense = loading.maxDispense;
+        cfg.strategy = strategy;
+        CassetteCashBin bin(loading.cassettes, cfg);
+
+        int64_t half = bin.total() / 2;
+        size_t served = 0;
+        size_t tried = 0;
+        uint64_t start = Bench::nowNs();
+        while (bin.total() > half && tried < 100 * requests.size())
+        {
+            served += bin.dispense(requests[tried++ % requests.size()]).isOk();
+        }
+        double ns = double(Bench::nowNs() - start) / double(tried);
+
+        double lowest = 1.0;
+        double highest = 0.0;
+        for (size_t i = 0; i < loading.cassettes.size(); ++i)
+        {
+            double fill = double(bin.cassettes()[i].count) / double(loading.cassettes[i].count);
+            lowest = min(lowest, fill);
+            highest = max(highest, fill);
+        }
+        printf("  %-22s %10.1f ns  %zu withdrawals, cassettes %3.0f%%..%3.0f%% full\n",
+               strategy == CassetteCashBin::Strategy::Balanced ? "dispense (balanced)" : "dispense (fewest)",
+               ns, served, lowest * 100, highest * 100);
+    }
+}
+
+int main()
+{
+    const vector<Loading> loadings{
+        { "KRW 50000/10000/5000/1000", { {50000, 2000}, {10000, 2000}, {5000, 1000}, {1000, 2000} }, 1000000, 1000 },
+        { "USD 100/50/20/20",          { {100, 1500}, {50, 1000}, {20, 2500}, {20, 2500} },          1000,    10 },
+        { "EUR 50/20/10/5",            { {50, 2000}, {20, 2000}, {10, 2000}, {5, 1000} },             500,     5 },
+    };
+    const size_t kRequests = 4096;
+
+    printf("Cassette cash bin benchmark\n");
+    printf("===========================\n");
+    for (const auto& loading : loadings)
+    {
+        CassetteCashBin::Config cfg;
+        cfg.maxDispense = loading.maxDispense;
+        CassetteCashBin bin(loading.cassettes, cfg);
+        auto requests = amounts(loading, kRequests);
+
+        size_t i = 0;
+        double table = Bench::nsPerOp(1000000, [&] {
+            Bench::doNotOptimize(bin.canDispense(requests[i++ % kRequests]));
+        });
+        i = 0;
+        double solved = Bench::nsPerOp(2000, [&] {
+            Bench::doNotOptimize(solvePerRequest(loading.cassettes, requests[i++ % kRequests]));
+        });
+        i = 0;
+        double fewest = Bench::nsPerOp(100000, [&] {
+            Bench::doNotOptimize(bin.plan(requests[i++ % kRequests], CassetteCashBin::Strategy::FewestNotes));
+        });
+        i = 0;
+        double balanced = Bench::nsPerOp(100000, [&] {
+            Bench::doNotOptimize(bin.plan(requests[i++ % kRequests], CassetteCashBin::Strategy::Balanced));
+        });
+
+        printf("\n%s (limit %d)\n", loading.name, loading.maxDispense);
+        printf("  %-22s %10.1f ns\n", "canDispense (tables)", table);
+        printf("  %-22s %10.1f ns  (%.0fx)\n", "canDispense (solve)", solved, solved / table);
+        printf("  %-22s %10.1f ns\n", "plan (fewest)", fewest);
+        printf("  %-22s %10.1f ns\n", "plan (balanced)", balanced);
+        drain(loading, CassetteCashBin::Strategy::FewestNotes, requests);
+        drain(loading, CassetteCashBin::Strategy::Balanced, requests);
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "Controller.hpp"
+#include "DepositQueue.hpp"
+#include "ShardedBank.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/LatencyBank.hpp"
+#include "BenchUtil.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+/**
+ * @brief Deposit latency and bank round trips, synchronous vs queued
+ *
+ * Every bank call takes a fixed latency. Deposits are posted directly by
+ * the controller, then through a DepositQueue that syncs each deposit to
+ * its file and posts batches in the background. Prints the customer's
+ * deposit latency and the number of bank calls for each.
+ *
+ * Usage: deposit_bench [--deposits N] [--latency-us N]
+ */
+
+namespace {
+    struct Options {
+        size_t deposits = 2000;
+        chrono::microseconds latency{ 2000 };
+    };
+
+    const Card kCard = "CARD-001";
+    const Pin kPin = "1234";
+    const AccountId kAccount = "ACCOUNT-001";
+
+    void report(const char* name, vector<uint64_t> depositsNs, int bankCalls)
+    {
+        sort(depositsNs.begin(), depositsNs.end());
+        auto at = [&](double p) {
+            return double(depositsNs[size_t(p * double(depositsNs.size() - 1))]) / 1e3;
+        };
+        printf("%-22s %9.1f %9.1f %9.1f %11d\n", name, at(0.5), at(0.99), at(1.0), bankCalls);
+    }
+
+    vector<uint64_t> runDeposits(IBank& bank, DepositQueue* queue, const Options& opt)
+    {
+        Card card = kCard;
+        FakeCardReader cardReader(card);
+        FakeCashBin cashBin(0);
+        Controller::Config cfg;
+        cfg.depositQueue = queue;
+        Controller atm(cardReader, bank, cashBin, cfg);
+
+        (void)atm.insertCard();
+        (void)atm.enterPin(kPin);
+        (void)atm.selectAccount(kAccount);
+
+        vector<uint64_t> depositsNs;
+        depositsNs.reserve(opt.deposits);
+        for (size_t i = 0; i < opt.deposits; ++i)
+        {
+            uint64_t start = Bench::nowNs();
+            (void)atm.deposit(10);
+            depositsNs.push_back(Bench::nowNs() - start);
+        }
+        (void)atm.ejectCard();
+        return depositsNs;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--deposits") && hasValue)
+        {
+            opt.deposits = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--latency-us") && hasValue)
+        {
+            opt.latency = chrono::microseconds(strtoll(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--deposits N] [--latency-us N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    ShardedBank backend;
+    (void)backend.addAccount(kAccount, 0);
+    (void)backend.addCard(kCard, kPin, { kAccount });
+
+    LatencyBank slow(backend);
+    slow.setLatency(opt.latency);
+
+    printf("Deposit latency, bank calls %lld us (%zu deposits)\n",
+           (long long)opt.latency.count(), opt.deposits);
+    printf("%-22s %9s %9s %9s %11s\n", "deposits", "p50 us", "p99 us", "max us", "bank calls");
+
+    int before = slow.calls;
+    auto direct = runDeposits(slow, nullptr, opt);
+    report("direct", direct, slow.calls - before);
+
+    auto path = filesystem::temp_directory_path() / "atm_deposit_bench.deposits";
+    filesystem::remove(path);
+    DepositQueue::Config cfg;
+    cfg.capacity = opt.deposits;
+    DepositQueue queue(slow);
+    if (!queue.open(path.string(), cfg).isOk())
+    {
+        fprintf(stderr, "cannot open %s\n", path.string().c_str());
+        return 1;
+    }
+
+    before = slow.calls;
+    auto queued = runDeposits(slow, &queue, opt);
+    (void)queue.drain(chrono::milliseconds(60000));
+    report("queued", queued, slow.calls - before);
+
+    queue.close();
+    filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include "Controller.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/FaultModel.hpp"
+#include "fakes/FaultyDevices.hpp"
+#include "BenchUtil.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief Withdraw outcomes and latency over production-like faulty backends
+ *
+ * Runs the same sessions (card, PIN, account, one withdrawal, eject) under
+ * three fault profiles: lognormal latencies only; latencies with bank
+ * errors, exceptions and lost replies plus cash bin jams; and the same with
+ * a one second bank outage every ten seconds. Customers arrive every half
+ * second. The virtual clock is used by default, so a run takes milliseconds
+ * and is repeatable for a seed.
+ *
+ * Prints per profile the withdraw outcomes, simulated withdraw latency
+ * percentiles, and the books afterwards: funds debited at the bank, cash
+ * handed out and holds left open. Lost replies show up as the difference
+ * between the two.
+ *
+ * Usage: fault_bench [--sessions N] [--seed N] [--real]
+ */
+
+namespace {
+    using ms = chrono::milliseconds;
+
+    struct Options {
+        size_t sessions = 20000;
+        uint64_t seed = 1;
+        bool real = false;
+    };
+
+    const Card kCard = "CARD-001";
+    const Pin kPin = "1234";
+    const AccountId kAccount = "ACCOUNT-001";
+    const int kAmount = 20;
+    const chrono::nanoseconds kArrival = chrono::milliseconds(500);   // A new customer every half second
+
+    enum class Profile { Latency, Flaky, Outages };
+
+    const char* profileName(Profile profile)
+    {
+        switch (profile)
+        {
+        case Profile::Latency: return "latency only";
+        case Profile::Flaky:   return "flaky";
+        case Profile::Outages: return "flaky + outages";
+        default:               return "unknown";
+        }
+    }
+
+    struct Tally {
+        size_t ok = 0;
+        size_t bankRefused = 0;     // hold not placed
+        size_t cashFailed = 0;      // dispense failed, hold released
+        size_t linkFailed = 0;      // NetworkError: exception on the way
+        size_t aborted = 0;         // session ended before the withdrawal
+        vector<int64_t> withdrawNs;
+    };
+
+    void configure(FaultInjector& bankLink, FaultInjector& devices, Profile profile, size_t sessions)
+    {
+        FaultModel bank;
+        bank.latency = LatencyModel::lognormal(ms(3), 0.6);
+        FaultModel device;
+        device.latency = LatencyModel::lognormal(ms(1), 0.2);
+        FaultModel dispense;
+        dispense.latency = LatencyModel::lognormal(ms(400), 0.1);
+
+        if (profile != Profile::Latency)
+        {
+            bank.errorRate = 0.01;
+            bank.throwRate = 0.005;
+            FaultModel money = bank;
+            money.lostReplyRate = 0.005;
+            bankLink.setModel("placeHold", money);
+            bankLink.setModel("captureHold", money);
+            bankLink.setModel("releaseHold", money);
+
+            dispense.errorRate = 0.005;
+            dispense.error = Err::HardwareError;
+            dispense.lostReplyRate = 0.001;
+        }
+        bankLink.setModel(bank);
+        devices.setModel(device);
+        devices.setModel("dispense", dispense);
+
+        if (profile == Profile::Outages)
+        {
+            chrono::nanoseconds end = kArrival * int64_t(sessions + 1);
+            for (chrono::nanoseconds from = chrono::seconds(10); from < end; from += chrono::seconds(10))
+            {
+                bankLink.addOutage({ from, from + ms(1000) });
+            }
+        }
+    }
+
+    void run(Profile profile, const Options& opt)
+    {
+        const int balance = int(opt.sessions) * kAmount;
+        FakeBank fake({{kCard, kPin}}, {{kCard, {kAccount}}}, {{kAccount, balance}});
+        FakeCashBin fakeCash(balance);
+        Card card = kCard;
+        FakeCardReader fakeReader(card);
+
+        VirtualClock virtualClock;
+        RealClock realClock;
+        FaultClock& clock = opt.real ? static_cast<FaultClock&>(realClock) : virtualClock;
+        FaultInjector bankLink(clock, opt.seed);
+        FaultInjector devices(clock, opt.seed + 1);
+        configure(bankLink, devices, profile, opt.sessions);
+
+        FaultyBank bank(fake, bankLink);
+        FaultyCashBin cashBin(fakeCash, devices);
+        FaultyCardReader cardReader(fakeReader, devices);
+        Controller atm(cardReader, bank, cashBin);
+
+        Tally tally;
+        tally.withdrawNs.reserve(opt.sessions);
+        uint64_t wallStart = Bench::nowNs();
+        for (size_t i = 0; i < opt.sessions; ++i)
+        {
+            chrono::nanoseconds arrival = kArrival * int64_t(i);
+            if (clock.now() < arrival)
+            {
+                clock.sleep(arrival - clock.now());
+            }
+
+            if (!atm.insertCard().isOk())
+            {
+                ++tally.aborted;
+                continue;
+            }
+            if (!atm.enterPin(kPin).isOk() || !atm.selectAccount(kAccount).isOk())
+            {
+                ++tally.aborted;
+                (void)atm.ejectCard();
+                continue;
+            }
+
+            chrono::nanoseconds start = clock.now();
+            Status status = atm.withdraw(kAmount);
+            tally.withdrawNs.push_back((clock.now() - start).count());
+            switch (status.code)
+            {
+            case Err::None:             ++tally.ok; break;
+            case Err::InsufficientBank: ++tally.bankRefused; break;
+            case Err::NetworkError:     ++tally.linkFailed; break;
+            default:                    ++tally.cashFailed; break;
+            }
+            (void)atm.ejectCard();
+        }
+        double wallMs = double(Bench::nowNs() - wallStart) / 1e6;
+
+        sort(tally.withdrawNs.begin(), tally.withdrawNs.end());
+        auto at = [&](double p) {
+            return tally.withdrawNs.empty() ? 0.0
+                : double(tally.withdrawNs[size_t(p * double(tally.withdrawNs.size() - 1))]) / 1e6;
+        };
+
+        long long debited = balance - fake.balanceMap[kAccount];
+        long long cashOut = balance - fakeCash.capacity;
+        long long held = 0;
+        for (const auto& hold : fake.holds)
+        {
+            held += hold.second.second;
+        }
+
+        printf("%-16s %7zu %7zu %7zu %7zu %7zu %8.1f %8.1f %8.1f %9lld %9lld %6zu/%-7lld %8.0f\n",
+               profileName(profile), tally.ok, tally.bankRefused, tally.cashFailed, tally.linkFailed,
+               tally.aborted, at(0.5), at(0.99), at(1.0), debited, cashOut, fake.holds.size(), held,
+               wallMs);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--sessions") && hasValue)
+        {
+            opt.sessions = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--seed") && hasValue)
+        {
+            opt.seed = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--real"))
+        {
+            opt.real = true;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--sessions N] [--seed N] [--real]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("Withdrawals over faulty backends, %zu sessions, %s clock, seed %llu\n",
+           opt.sessions, opt.real ? "real" : "virtual", (unsigned long long)opt.seed);
+    printf("%-16s %7s %7s %7s %7s %7s %8s %8s %8s %9s %9s %14s %8s\n",
+           "profile", "ok", "no hold", "no cash", "link", "aborted", "p50 ms", "p99 ms", "max ms",
+           "debited", "cash out", "open holds", "wall ms");
+    for (Profile profile : { Profile::Latency, Profile::Flaky, Profile::Outages })
+    {
+        run(profile, opt);
+    }
+    return 0;
+}
@@ -0,0 +1,196 @@
+#include "LedgerBank.hpp"
+#include "BenchUtil.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Startup and write costs of LedgerBank
+ *
+ * Builds a ledger of N accounts, snapshots it, writes a log tail of
+ * deposits and closes it. Then times open() (map the snapshot, replay the
+ * tail) against filling an unordered_map with the same accounts, as the
+ * in-memory fakes do, and times deposits from several threads with every
+ * write synced (group commit) and with syncing left to the OS.
+ *
+ * Usage: ledger_bench [--accounts N] [--tail N] [--threads N] [--writes N] [--path PREFIX]
+ */
+
+namespace {
+    struct Options {
+        size_t accounts = 1000000;
+        size_t tail = 100000;           // deposits after the last snapshot
+        size_t threads = 4;
+        size_t writes = 2000;           // deposits per thread
+        string path;
+    };
+
+    string accountName(size_t i)
+    {
+        return "LEDGER-" + to_string(i);
+    }
+
+    double msSince(uint64_t start)
+    {
+        return double(Bench::nowNs() - start) / 1e6;
+    }
+
+    void writes(LedgerBank& bank, const Options& opt, const char* label)
+    {
+        LedgerBank::Stats before = bank.stats();
+        atomic<size_t> failed{ 0 };
+        vector<thread> workers;
+        uint64_t start = Bench::nowNs();
+        for (size_t t = 0; t < opt.threads; ++t)
+        {
+            workers.emplace_back([&, t] {
+                AccountId account = accountName(t % opt.accounts);
+                for (size_t i = 0; i < opt.writes; ++i)
+                {
+                    failed += !bank.deposit(account, 1).isOk();
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+        double seconds = msSince(start) / 1e3;
+
+        LedgerBank::Stats after = bank.stats();
+        uint64_t records = after.records - before.records;
+        uint64_t syncs = after.syncs - before.syncs;
+        printf("%-20s %10.0f writes/s %8.1f us/write %10llu syncs %8.1f writes/sync %6zu failed\n",
+               label, double(records) / seconds, seconds * 1e6 / double(records ? records : 1),
+               (unsigned long long)syncs, syncs ? double(records) / double(syncs) : 0.0, failed.load());
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--accounts") && hasValue)
+        {
+            opt.accounts = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--tail") && hasValue)
+        {
+            opt.tail = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--threads") && hasValue)
+        {
+            opt.threads = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--writes") && hasValue)
+        {
+            opt.writes = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--path") && hasValue)
+        {
+            opt.path = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--accounts N] [--tail N] [--threads N] [--writes N] [--path PREFIX]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (opt.path.empty())
+    {
+        opt.path = (filesystem::temp_directory_path() / "atm_ledger_bench").string();
+    }
+    for (const char* suffix : { ".snap0", ".snap1", ".log" })
+    {
+        filesystem::remove(opt.path + suffix);
+    }
+
+    vector<AccountId> ids;
+    ids.reserve(opt.accounts);
+    for (size_t i = 0; i < opt.accounts; ++i)
+    {
+        ids.push_back(accountName(i));
+    }
+
+    LedgerBank::Config cfg;
+    cfg.capacity = opt.accounts;
+    cfg.logRecords = max(opt.accounts, opt.tail) + opt.threads * opt.writes + 1;
+    cfg.snapshotRecords = cfg.logRecords;
+    cfg.syncEachWrite = false;
+
+    printf("LedgerBank, %zu accounts, %zu-record log tail, %s\n", opt.accounts, opt.tail, opt.path.c_str());
+    {
+        LedgerBank bank;
+        if (!bank.open(opt.path, cfg).isOk())
+        {
+            fprintf(stderr, "cannot open %s\n", opt.path.c_str());
+            return 1;
+        }
+
+        uint64_t start = Bench::nowNs();
+        for (size_t i = 0; i < opt.accounts; ++i)
+        {
+            (void)bank.addAccount(ids[i], 1000);
+        }
+        printf("%-20s %10.1f ms\n", "create accounts", msSince(start));
+
+        start = Bench::nowNs();
+        (void)bank.snapshot();
+        printf("%-20s %10.1f ms\n", "snapshot", msSince(start));
+
+        for (size_t i = 0; i < opt.tail; ++i)
+        {
+            (void)bank.deposit(ids[(i * 7919) % opt.accounts], 1);
+        }
+    }
+
+    uint64_t start = Bench::nowNs();
+    unordered_map<AccountId, int> copyIn;
+    copyIn.reserve(opt.accounts);
+    for (size_t i = 0; i < opt.accounts; ++i)
+    {
+        copyIn.emplace(ids[i], 1000);
+    }
+    printf("%-20s %10.1f ms   (in-memory copy-in, no I/O)\n", "unordered_map fill", msSince(start));
+
+    LedgerBank bank;
+    start = Bench::nowNs();
+    if (!bank.open(opt.path, cfg).isOk())
+    {
+        fprintf(stderr, "cannot reopen %s\n", opt.path.c_str());
+        return 1;
+    }
+    double openMs = msSince(start);
+    printf("%-20s %10.1f ms   (%llu records replayed)\n", "open", openMs,
+           (unsigned long long)bank.stats().replayed);
+
+    start = Bench::nowNs();
+    volatile int sum = 0;
+    for (size_t i = 0; i < opt.accounts; i += 997)
+    {
+        sum += bank.getBalance(ids[i]).value();
+    }
+    printf("%-20s %10.1f ms   (every 997th account, faulting pages in)\n", "first reads", msSince(start));
+    bank.close();
+
+    cfg.syncEachWrite = true;
+    (void)bank.open(opt.path, cfg);
+    writes(bank, opt, "synced (group)");
+    bank.close();
+
+    cfg.syncEachWrite = false;
+    (void)bank.open(opt.path, cfg);
+    writes(bank, opt, "unsynced");
+    bank.close();
+
+    for (const char* suffix : { ".snap0", ".snap1", ".log" })
+    {
+        filesystem::remove(opt.path + suffix);
+    }
+    return 0;
+}
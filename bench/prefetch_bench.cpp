@@ -0,0 +1,145 @@
+#include "Controller.hpp"
+#include "ShardedBank.hpp"
+#include "ThreadPool.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/LatencyBank.hpp"
+#include "BenchUtil.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Wait between an accepted PIN and the balance on screen
+ *
+ * Every bank call takes a fixed latency. Each session enters the PIN, lets
+ * the customer think, then lists the accounts, selects one and reads its
+ * balance. Runs the sessions with every read going to the bank, with the
+ * session cache, and with the prefetch started by enterPin(), and prints
+ * the customer's wait after thinking and the bank calls per session.
+ *
+ * Usage: prefetch_bench [--sessions N] [--accounts N] [--latency-us N] [--think-us N]
+ */
+
+namespace {
+    struct Options {
+        size_t sessions = 200;
+        size_t accounts = 3;                    // accounts per card
+        chrono::microseconds latency{ 2000 };
+        chrono::microseconds think{ 1000 };     // customer looking at the menu
+    };
+
+    const Card kCard = "CARD-001";
+    const Pin kPin = "1234";
+
+    AccountId accountName(size_t i)
+    {
+        return AccountId("ACCOUNT-" + to_string(i));
+    }
+
+    void report(const char* name, vector<uint64_t> waitsNs, int bankCalls, size_t sessions)
+    {
+        sort(waitsNs.begin(), waitsNs.end());
+        auto at = [&](double p) {
+            return double(waitsNs[size_t(p * double(waitsNs.size() - 1))]) / 1e3;
+        };
+        printf("%-16s %9.1f %9.1f %9.1f %13.1f\n", name, at(0.5), at(0.99), at(1.0),
+               double(bankCalls) / double(sessions));
+    }
+
+    vector<uint64_t> runSessions(IBank& bank, const Controller::Config& cfg, const Options& opt)
+    {
+        Card card = kCard;
+        FakeCardReader cardReader(card);
+        FakeCashBin cashBin(0);
+        Controller atm(cardReader, bank, cashBin, cfg);
+
+        vector<uint64_t> waitsNs;
+        waitsNs.reserve(opt.sessions);
+        for (size_t i = 0; i < opt.sessions; ++i)
+        {
+            (void)atm.insertCard();
+            (void)atm.enterPin(kPin);
+            this_thread::sleep_for(opt.think);
+
+            uint64_t start = Bench::nowNs();
+            (void)atm.listAccounts();
+            (void)atm.selectAccount(accountName(i % opt.accounts));
+            (void)atm.getBalance();
+            waitsNs.push_back(Bench::nowNs() - start);
+            (void)atm.ejectCard();
+        }
+        return waitsNs;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--sessions") && hasValue)
+        {
+            opt.sessions = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--accounts") && hasValue)
+        {
+            opt.accounts = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--latency-us") && hasValue)
+        {
+            opt.latency = chrono::microseconds(strtoll(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--think-us") && hasValue)
+        {
+            opt.think = chrono::microseconds(strtoll(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--sessions N] [--accounts N] [--latency-us N] [--think-us N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    ShardedBank backend;
+    vector<AccountId> accounts;
+    for (size_t i = 0; i < opt.accounts; ++i)
+    {
+        accounts.push_back(accountName(i));
+        (void)backend.addAccount(accounts.back(), 1000);
+    }
+    (void)backend.addCard(kCard, kPin, accounts);
+
+    // One round trip per call: getBalances stands for a bulk endpoint of the bank
+    LatencyBank slow(backend);
+    slow.setLatency(opt.latency);
+    ThreadPool pool(1);
+
+    printf("PIN to balance, bank calls %lld us, customer thinks %lld us (%zu sessions, %zu accounts)\n",
+           (long long)opt.latency.count(), (long long)opt.think.count(), opt.sessions, opt.accounts);
+    printf("%-16s %9s %9s %9s %13s\n", "reads", "p50 us", "p99 us", "max us", "calls/session");
+
+    Controller::Config direct;
+    Controller::Config cached;
+    cached.sessionCache = true;
+    Controller::Config prefetched;
+    prefetched.prefetch = &pool;
+
+    struct Mode {
+        const char* name;
+        const Controller::Config* cfg;
+    };
+    for (const Mode& mode : { Mode{ "direct", &direct }, Mode{ "session cache", &cached },
+                              Mode{ "prefetch", &prefetched } })
+    {
+        int before = slow.calls;
+        auto waits = runSessions(slow, *mode.cfg, opt);
+        report(mode.name, waits, slow.calls - before, opt.sessions);
+    }
+    return 0;
+}
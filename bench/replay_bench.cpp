@@ -0,0 +1,186 @@
+#include "RecordingController.hpp"
+#include "SessionReplayer.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Replays a recorded session trace as a benchmark
+ *
+ * Replays the given trace (or a synthetic one recorded against the test
+ * fakes) single-threaded and across all cores, and prints throughput,
+ * result mismatches and per-operation latencies.
+ *
+ * Usage: replay_bench [TRACE] [--threads N] [--loops N]
+ *                     [--timing none|recorded|fixed] [--latency-ns N] [--record FILE]
+ */
+
+namespace {
+    struct Options {
+        const char* trace = nullptr;
+        const char* record = nullptr;
+        size_t threads = 0;                  // 0: one thread, then every core
+        size_t loops = 2000;
+        SessionReplayer::Timing timing = SessionReplayer::Timing::None;
+        uint64_t latencyNs = 0;
+    };
+
+    bool parseOptions(int argc, char** argv, Options& opt)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            bool hasValue = i + 1 < argc;
+            if (!strcmp(argv[i], "--threads") && hasValue)
+            {
+                opt.threads = strtoull(argv[++i], nullptr, 10);
+            }
+            else if (!strcmp(argv[i], "--loops") && hasValue)
+            {
+                opt.loops = strtoull(argv[++i], nullptr, 10);
+            }
+            else if (!strcmp(argv[i], "--latency-ns") && hasValue)
+            {
+                opt.latencyNs = strtoull(argv[++i], nullptr, 10);
+            }
+            else if (!strcmp(argv[i], "--record") && hasValue)
+            {
+                opt.record = argv[++i];
+            }
+            else if (!strcmp(argv[i], "--timing") && hasValue)
+            {
+                const char* mode = argv[++i];
+                if (!strcmp(mode, "none")) opt.timing = SessionReplayer::Timing::None;
+                else if (!strcmp(mode, "recorded")) opt.timing = SessionReplayer::Timing::Recorded;
+                else if (!strcmp(mode, "fixed")) opt.timing = SessionReplayer::Timing::Fixed;
+                else return false;
+            }
+            else if (argv[i][0] != '-' && !opt.trace)
+            {
+                opt.trace = argv[i];
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return opt.loops > 0;
+    }
+
+    /**
+     * @brief Sessions over the success and failure paths, recorded against the fakes
+     */
+    SessionTrace syntheticTrace(void)
+    {
+        Card card = "CARD-001";
+        Pin pin = "1234";
+        AccountId rich = "ACCOUNT-001";
+        AccountId poor = "ACCOUNT-002";
+
+        FakeCardReader cardReader(card);
+        FakeBank bank({ {card, pin} }, { {card, {rich, poor}} }, { {rich, 1000000}, {poor, 50} });
+        FakeCashBin cashBin(1000000);
+        RecordingController atm(cardReader, bank, cashBin);
+
+        for (int session = 0; session < 10; ++session)
+        {
+            (void)atm.insertCard();
+            if (session % 5 == 0)
+            {
+                (void)atm.enterPin("0000");
+            }
+            (void)atm.enterPin(pin);
+            (void)atm.listAccounts();
+            (void)atm.selectAccount(session % 3 == 0 ? poor : rich);
+            (void)atm.getBalance();
+            (void)atm.withdraw(100);
+            if (session % 2 == 0)
+            {
+                (void)atm.deposit(100);
+            }
+            (void)atm.ejectCard();
+        }
+        return atm.takeTrace();
+    }
+
+    void report(const SessionTrace& trace, const Options& opt, size_t threads)
+    {
+        SessionReplayer::Options options;
+        options.threads = threads;
+        options.loops = opt.loops;
+        options.timing = opt.timing;
+        options.fixedLatency = chrono::nanoseconds(opt.latencyNs);
+
+        auto r = SessionReplayer(trace).run(options);
+        printf("\n%zu thread(s): %llu ops in %.3f s, %.0f ops/s, %llu mismatches, %llu diverged calls\n",
+               threads, (unsigned long long)r.operations, r.seconds, r.operationsPerSecond,
+               (unsigned long long)r.mismatches, (unsigned long long)r.divergedCalls);
+        printf("  %-16s %10s %10s %10s %10s\n", "operation", "count", "mean ns", "p50 ns", "p99 ns");
+        for (size_t i = 0; i < ControllerMetrics::kOps; ++i)
+        {
+            auto op = ControllerMetrics::Op(i);
+            auto h = r.metrics.op(op);
+            if (!h.count) continue;
+            printf("  %-16s %10llu %10.0f %10llu %10llu\n", ControllerMetrics::name(op),
+                   (unsigned long long)h.count, h.meanNs(),
+                   (unsigned long long)h.percentileNs(0.5), (unsigned long long)h.percentileNs(0.99));
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseOptions(argc, argv, opt))
+    {
+        fprintf(stderr, "usage: %s [TRACE] [--threads N] [--loops N] "
+                        "[--timing none|recorded|fixed] [--latency-ns N] [--record FILE]\n", argv[0]);
+        return 2;
+    }
+
+    SessionTrace trace;
+    if (opt.trace)
+    {
+        auto loaded = SessionTrace::load(opt.trace);
+        if (!loaded.isOk())
+        {
+            fprintf(stderr, "cannot read trace %s\n", opt.trace);
+            return 1;
+        }
+        trace = loaded.take();
+    }
+    else
+    {
+        trace = syntheticTrace();
+    }
+
+    if (opt.record && !trace.save(opt.record).isOk())
+    {
+        fprintf(stderr, "cannot write %s\n", opt.record);
+        return 1;
+    }
+
+    printf("Session replay: %zu operations per loop, %zu loops per thread\n",
+           trace.ops.size(), opt.loops);
+
+    if (opt.threads)
+    {
+        report(trace, opt, opt.threads);
+    }
+    else
+    {
+        size_t cores = max<size_t>(1, thread::hardware_concurrency());
+        report(trace, opt, 1);
+        if (cores > 1)
+        {
+            report(trace, opt, cores);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "Controller.hpp"
+#include "OfflinePinVerifier.hpp"
+#include "ResilientBank.hpp"
+#include "ShardedBank.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/LatencyBank.hpp"
+#include "BenchUtil.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Session latency over a bank with a heavy latency tail
+ *
+ * Every bank call takes the base latency, and a few take the tail
+ * latency. Sessions (PIN, account list, two balance checks) run against
+ * the slow bank directly, through ResilientBank with deadlines and
+ * retries, and through ResilientBank with hedged reads. PINs are checked
+ * offline after the first session, so every remaining bank call is a
+ * read. Prints session latency percentiles for each.
+ *
+ * Usage: resilience_bench [--sessions N] [--tail-percent N]
+ */
+
+namespace {
+    struct Options {
+        size_t sessions = 300;
+        double tailPercent = 3.0;
+        chrono::microseconds base{ 1000 };
+        chrono::microseconds tail{ 40000 };
+    };
+
+    const Card kCard = "CARD-001";
+    const Pin kPin = "1234";
+    const AccountId kAccount = "ACCOUNT-001";
+
+    void report(const char* name, vector<uint64_t> sessionsNs)
+    {
+        sort(sessionsNs.begin(), sessionsNs.end());
+        auto at = [&](double p) {
+            return double(sessionsNs[size_t(p * double(sessionsNs.size() - 1))]) / 1e6;
+        };
+        printf("%-22s %9.2f %9.2f %9.2f %9.2f\n", name, at(0.5), at(0.9), at(0.99), at(1.0));
+    }
+
+    vector<uint64_t> runSessions(IBank& bank, const Options& opt)
+    {
+        Card card = kCard;
+        FakeCardReader cardReader(card);
+        FakeCashBin cashBin(1000000);
+        OfflinePinVerifier verifier;
+        Controller::Config cfg;
+        cfg.pinVerifier = &verifier;
+        Controller atm(cardReader, bank, cashBin, cfg);
+
+        vector<uint64_t> sessionsNs;
+        sessionsNs.reserve(opt.sessions);
+        for (size_t i = 0; i < opt.sessions; ++i)
+        {
+            uint64_t start = Bench::nowNs();
+            (void)atm.insertCard();
+            (void)atm.enterPin(kPin);
+            (void)atm.listAccounts();
+            (void)atm.selectAccount(kAccount);
+            (void)atm.getBalance();
+            (void)atm.getBalance();
+            (void)atm.ejectCard();
+            sessionsNs.push_back(Bench::nowNs() - start);
+        }
+        return sessionsNs;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--sessions") && hasValue)
+        {
+            opt.sessions = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--tail-percent") && hasValue)
+        {
+            opt.tailPercent = atof(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--sessions N] [--tail-percent N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    ShardedBank backend;
+    (void)backend.addAccount(kAccount, 1000000);
+    (void)backend.addCard(kCard, kPin, { kAccount });
+
+    LatencyBank slow(backend);
+    mt19937_64 random(42);
+    bernoulli_distribution inTail(opt.tailPercent / 100.0);
+    slow.setDistribution([&] { return inTail(random) ? opt.tail : opt.base; });
+
+    printf("Session latency, bank calls %lld us with %.1f%% at %lld us (%zu sessions)\n",
+           (long long)opt.base.count(), opt.tailPercent, (long long)opt.tail.count(), opt.sessions);
+    printf("%-22s %9s %9s %9s %9s\n", "bank", "p50 ms", "p90 ms", "p99 ms", "max ms");
+
+    report("direct", runSessions(slow, opt));
+
+    ThreadPool pool(8);
+    ResilientBank::Config cfg;
+    cfg.deadline = chrono::milliseconds(200);
+    cfg.attemptTimeout = chrono::milliseconds(100);
+    ResilientBank guarded(slow, pool, cfg);
+    report("deadlines + retries", runSessions(guarded, opt));
+
+    cfg.hedgeReads = true;
+    cfg.hedgeDelay = chrono::milliseconds(5);
+    ResilientBank hedged(slow, pool, cfg);
+    report("hedged reads", runSessions(hedged, opt));
+
+    auto stats = hedged.stats();
+    printf("\nhedged: %llu calls, %llu hedges, %llu won by the hedge, p95 hedge delay %.2f ms\n",
+           (unsigned long long)stats.calls, (unsigned long long)stats.hedges,
+           (unsigned long long)stats.hedgeWins,
+           double(hedged.hedgeDelay(ResilientBank::Read::GetBalance).count()) / 1e6);
+    return 0;
+}
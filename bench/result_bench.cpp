@@ -0,0 +1,154 @@
+#include "Interfaces.hpp"
+#include "BenchUtil.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Result<T> against the previous optional<T> + Err layout
+ *
+ * Prints the size and trivial-copyability of both layouts for the value
+ * types the ATM returns, then times the account-list path: a bank call
+ * returning Result<vector<AccountId>> that the caller either copies out
+ * (the only option before) or moves out / chains on.
+ */
+
+static atomic<uint64_t> allocations{ 0 };
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+/**
+ * @brief The previous Result layout, kept here only for comparison
+ */
+template <typename T>
+class LegacyResult {
+private:
+    optional<T> _v;
+    Err _e{ Err::None };
+public:
+    LegacyResult(const T& value): _v(value)
+    {}
+
+    LegacyResult(T&& value): _v(move(value))
+    {}
+
+    LegacyResult(Err error): _v(nullopt), _e(error)
+    {}
+
+    bool isOk() const
+    {
+        return _v.has_value();
+    }
+
+    const T& value() const
+    {
+        return *_v;
+    }
+
+    Err error() const
+    {
+        return _e;
+    }
+};
+
+template <typename T>
+static void reportLayout(const char* name)
+{
+    printf("%-26s %6zu %6zu   %-6s %-6s\n", name,
+           sizeof(LegacyResult<T>), sizeof(Result<T>),
+           is_trivially_copyable<LegacyResult<T>>::value ? "yes" : "no",
+           is_trivially_copyable<Result<T>>::value ? "yes" : "no");
+}
+
+static vector<AccountId> accounts;
+
+template <typename R>
+BENCH_NOINLINE static R fetchAccounts(bool fail)
+{
+    if (fail) return R(Err::NetworkError);
+    return R(accounts);
+}
+
+template <typename R>
+BENCH_NOINLINE static R fetchBalance(int value)
+{
+    if (value < 0) return R(Err::InvalidArg);
+    return R(value);
+}
+
+template <typename F>
+static void report(const char* name, F&& fn)
+{
+    const uint64_t iterations = 1000000;
+    uint64_t before = allocations.load();
+    double ns = Bench::nsPerOp(iterations, fn);
+    double allocs = double(allocations.load() - before) / double(iterations + iterations / 10);
+    printf("%-36s %8.2f ns/op %6.2f allocs/op\n", name, ns, allocs);
+}
+
+int main()
+{
+    for (int i = 0; i < 8; ++i) {
+        accounts.push_back("ACCOUNT-00" + to_string(i));
+    }
+
+    printf("%-26s %6s %6s   %s\n", "Result layout", "legacy", "new", "trivially copyable");
+    printf("============================================================\n");
+    reportLayout<int>("Result<int>");
+    reportLayout<HoldId>("Result<HoldId>");
+    reportLayout<AccountId>("Result<AccountId>");
+    reportLayout<vector<AccountId>>("Result<vector<AccountId>>");
+    printf("%-26s %6s %6zu\n", "Status", "", sizeof(Status));
+
+    printf("\nAccount list (8 accounts) through Result\n");
+    printf("========================================\n");
+    report("legacy: copy value out", [] {
+        auto r = fetchAccounts<LegacyResult<vector<AccountId>>>(false);
+        vector<AccountId> v = r.value();
+        Bench::doNotOptimize(v);
+    });
+    report("new: move value out (take)", [] {
+        auto r = fetchAccounts<Result<vector<AccountId>>>(false);
+        vector<AccountId> v = r.take();
+        Bench::doNotOptimize(v);
+    });
+    report("new: map(size) on rvalue", [] {
+        auto n = fetchAccounts<Result<vector<AccountId>>>(false)
+            .map([](vector<AccountId>&& v) { return v.size(); });
+        Bench::doNotOptimize(n);
+    });
+
+    printf("\nBalance through Result<int>\n");
+    printf("===========================\n");
+    int sum = 0;
+    report("legacy: Result<int>", [&] {
+        auto r = fetchBalance<LegacyResult<int>>(sum & 0xff);
+        sum += r.isOk() ? r.value() : 0;
+    });
+    report("new: Result<int>", [&] {
+        auto r = fetchBalance<Result<int>>(sum & 0xff);
+        sum += r.isOk() ? r.value() : 0;
+    });
+    Bench::doNotOptimize(sum);
+    return 0;
+}
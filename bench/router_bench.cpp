@@ -0,0 +1,175 @@
+#include "ShardedBank.hpp"
+#include "ShardedBankRouter.hpp"
+#include "ThreadPool.hpp"
+#include "fakes/LatencyBank.hpp"
+#include "BenchUtil.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Routing cost, listAccounts fan-out and key movement of the router
+ *
+ * Prints the cost of routing one getBalance to an in-memory partition, the
+ * listAccounts latency over partitions with a fixed link latency when the
+ * partitions are asked one after another and when they are asked at once,
+ * and the share of accounts that change shard when a partition is added.
+ *
+ * Usage: router_bench [--shards N] [--latency-us N] [--calls N]
+ */
+
+namespace {
+    struct Options {
+        size_t shards = 4;
+        chrono::microseconds latency{ 1000 };
+        size_t calls = 200;
+    };
+
+    const Card kCard = "CARD-001";
+
+    AccountId accountNo(size_t i)
+    {
+        return AccountId("ACCOUNT-" + to_string(i));
+    }
+
+    void report(const char* name, vector<uint64_t> ns)
+    {
+        sort(ns.begin(), ns.end());
+        auto at = [&](double p) {
+            return double(ns[size_t(p * double(ns.size() - 1))]) / 1e3;
+        };
+        printf("%-26s %9.1f %9.1f\n", name, at(0.5), at(0.99));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--shards") && hasValue)
+        {
+            opt.shards = min<size_t>(max<size_t>(2, strtoull(argv[++i], nullptr, 10)), 64);
+        }
+        else if (!strcmp(argv[i], "--latency-us") && hasValue)
+        {
+            opt.latency = chrono::microseconds(strtoll(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--calls") && hasValue)
+        {
+            opt.calls = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--shards N] [--latency-us N] [--calls N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    ThreadPool pool(opt.shards);
+
+    // Routing overhead against in-memory partitions
+    {
+        vector<unique_ptr<ShardedBank>> partitions;
+        ShardedBankRouter router(pool);
+        for (size_t i = 0; i < opt.shards; ++i)
+        {
+            partitions.push_back(make_unique<ShardedBank>());
+            (void)router.addShard("p" + to_string(i), *partitions[i]);
+        }
+        vector<AccountId> accounts;
+        for (size_t i = 0; i < 1024; ++i)
+        {
+            accounts.push_back(accountNo(i));
+            string shard = router.shardOf(accounts[i]).value();
+            (void)partitions[stoul(shard.substr(1))]->addAccount(accounts[i], 100);
+        }
+
+        size_t next = 0;
+        double direct = Bench::nsPerOp(1000000, [&] {
+            Bench::doNotOptimize(partitions[0]->getBalance(accounts[next++ & 1023]));
+        });
+        next = 0;
+        double routed = Bench::nsPerOp(1000000, [&] {
+            Bench::doNotOptimize(router.getBalance(accounts[next++ & 1023]));
+        });
+        printf("getBalance, %zu shards: direct %.1f ns, routed %.1f ns\n\n", opt.shards, direct, routed);
+    }
+
+    // listAccounts over slow partitions, one at a time vs fanned out
+    {
+        vector<unique_ptr<ShardedBank>> partitions;
+        vector<unique_ptr<LatencyBank>> links;
+        ShardedBankRouter router(pool);
+        for (size_t i = 0; i < opt.shards; ++i)
+        {
+            partitions.push_back(make_unique<ShardedBank>());
+            (void)partitions[i]->addAccount(accountNo(i), 100);
+            (void)partitions[i]->addCard(kCard, "1234", { accountNo(i) });
+            links.push_back(make_unique<LatencyBank>(*partitions[i]));
+            links[i]->setLatency(opt.latency);
+            (void)router.addShard("p" + to_string(i), *links[i]);
+        }
+
+        vector<uint64_t> sequential;
+        vector<uint64_t> fanned;
+        for (size_t call = 0; call < opt.calls; ++call)
+        {
+            uint64_t start = Bench::nowNs();
+            size_t found = 0;
+            for (auto& link : links)
+            {
+                found += link->listAccounts(kCard).size();
+            }
+            sequential.push_back(Bench::nowNs() - start);
+            Bench::doNotOptimize(found);
+
+            start = Bench::nowNs();
+            Bench::doNotOptimize(router.listAccounts(kCard));
+            fanned.push_back(Bench::nowNs() - start);
+        }
+
+        printf("listAccounts, %zu shards, link %lld us\n", opt.shards, (long long)opt.latency.count());
+        printf("%-26s %9s %9s\n", "", "p50 us", "p99 us");
+        report("one shard after another", sequential);
+        report("router fan-out", fanned);
+        printf("\n");
+    }
+
+    // Key movement when a partition joins
+    {
+        const size_t keys = 100000;
+        vector<unique_ptr<ShardedBank>> partitions;
+        ShardedBankRouter router(pool);
+        for (size_t i = 0; i <= opt.shards; ++i)
+        {
+            partitions.push_back(make_unique<ShardedBank>(1));
+        }
+        for (size_t i = 0; i < opt.shards; ++i)
+        {
+            (void)router.addShard("p" + to_string(i), *partitions[i]);
+        }
+
+        vector<string> before;
+        before.reserve(keys);
+        for (size_t i = 0; i < keys; ++i)
+        {
+            before.push_back(router.shardOf(accountNo(i)).value());
+        }
+        (void)router.addShard("p" + to_string(opt.shards), *partitions[opt.shards]);
+        size_t moved = 0;
+        for (size_t i = 0; i < keys; ++i)
+        {
+            moved += router.shardOf(accountNo(i)).value() != before[i];
+        }
+        printf("adding shard %zu moved %.1f%% of %zu accounts (ideal %.1f%%; modulo hashing ~%.1f%%)\n",
+               opt.shards + 1, 100.0 * double(moved) / double(keys), keys,
+               100.0 / double(opt.shards + 1), 100.0 * double(opt.shards) / double(opt.shards + 1));
+    }
+    return 0;
+}
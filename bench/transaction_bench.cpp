@@ -0,0 +1,145 @@
+#include "TransactionManager.hpp"
+#include "InlineTransactionManager.hpp"
+#include "TransactionJournal.hpp"
+#include "BenchUtil.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+
+/**
+ * @brief TransactionManager vs InlineTransactionManager on the withdraw shape
+ *
+ * Both run the two-step hold/dispense transaction used by
+ * Controller::withdraw. Global operator new is counted to show the
+ * allocations each variant costs per transaction. The journaled runs show
+ * the write-ahead overhead per withdrawal for each fsync policy.
+ */
+
+static atomic<uint64_t> allocations{ 0 };
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+struct WithdrawState {
+    int balance = 1000000;
+    int cash = 1000000;
+    uint64_t holdId = 0;
+    int money = 10;
+    bool failDispense = false;
+};
+
+template <typename Transaction>
+static void runWithdraw(WithdrawState& s)
+{
+    Transaction transaction;
+    (void)transaction.addOperation(
+        [&]() -> Status { s.balance -= s.money; s.holdId++; return Status::okStatus(); },
+        [&]() { s.balance += s.money; });
+    (void)transaction.addOperation(
+        [&]() -> Status {
+            if (s.failDispense) return Status::error(Err::HardwareError);
+            s.cash -= s.money;
+            return Status::okStatus();
+        },
+        [&]() {});
+
+    if (transaction.execute().isOk()) {
+        transaction.commit();
+    }
+}
+
+static void runJournaledWithdraw(WithdrawState& s, TransactionJournal& journal)
+{
+    static const AccountId account = "ACCOUNT-001";
+    InlineTransactionManager<2> transaction(&journal);
+    JournalStep hold{ 1, account, s.money, 0 };
+    JournalStep dispense{ 2, account, s.money, 0 };
+
+    (void)transaction.addOperation(
+        [&]() -> Status { s.balance -= s.money; hold.arg = (int64_t)++s.holdId; return Status::okStatus(); },
+        [&]() { s.balance += s.money; },
+        &hold);
+    (void)transaction.addOperation(
+        [&]() -> Status { s.cash -= s.money; return Status::okStatus(); },
+        [&]() {},
+        &dispense);
+
+    if (transaction.execute().isOk()) {
+        transaction.commit();
+    }
+}
+
+template <typename Transaction>
+static void report(const char* name, bool failDispense)
+{
+    const uint64_t iterations = 2000000;
+    WithdrawState s;
+    s.failDispense = failDispense;
+
+    uint64_t before = allocations.load();
+    double ns = Bench::nsPerOp(iterations, [&] { runWithdraw<Transaction>(s); });
+    double allocs = double(allocations.load() - before) / double(iterations + iterations / 10);
+    Bench::doNotOptimize(s);
+
+    printf("%-28s %-9s %8.2f ns/txn %6.2f allocs/txn\n",
+           name, failDispense ? "rollback" : "commit", ns, allocs);
+}
+
+static void reportJournal(const char* name, TransactionJournal::FsyncPolicy policy, uint64_t iterations)
+{
+    auto path = (filesystem::temp_directory_path() / "atm_transaction_bench.journal").string();
+    filesystem::remove(path);
+
+    TransactionJournal journal;
+    TransactionJournal::Config cfg;
+    cfg.fsync = policy;
+    if (!journal.open(path, cfg).isOk()) {
+        printf("%-28s cannot open %s\n", name, path.c_str());
+        return;
+    }
+
+    WithdrawState s;
+    double ns = Bench::nsPerOp(iterations, [&] { runJournaledWithdraw(s, journal); });
+    Bench::doNotOptimize(s);
+    auto stats = journal.stats();
+
+    printf("%-28s %-9s %8.2f ns/txn %6.3f syncs/txn\n",
+           name, "commit", ns, double(stats.syncs) / double(iterations + iterations / 10));
+
+    journal.close();
+    filesystem::remove(path);
+}
+
+int main()
+{
+    printf("Transaction manager benchmark (2-step withdraw)\n");
+    printf("===============================================\n");
+    report<TransactionManager>("TransactionManager", false);
+    report<InlineTransactionManager<2>>("InlineTransactionManager<2>", false);
+    report<TransactionManager>("TransactionManager", true);
+    report<InlineTransactionManager<2>>("InlineTransactionManager<2>", true);
+
+    printf("\nWrite-ahead journal (InlineTransactionManager<2>)\n");
+    printf("=================================================\n");
+    reportJournal("journal fsync=Never", TransactionJournal::FsyncPolicy::Never, 1000000);
+    reportJournal("journal fsync=Grouped", TransactionJournal::FsyncPolicy::Grouped, 200000);
+    reportJournal("journal fsync=EveryCommit", TransactionJournal::FsyncPolicy::EveryCommit, 2000);
+    return 0;
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include <future>
+#include "Interfaces.hpp"
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+/**
+ * @brief Asynchronous companion to IBank
+ *
+ * Every call returns immediately with a future. Errors reported by the
+ * backend arrive as the future's value; transport failures arrive as
+ * exceptions rethrown by future::get().
+ */
+class IAsyncBank {
+public:
+    virtual ~IAsyncBank() = default;
+
+    /**
+     * @brief Verify a PIN code for the given card
+     *
+     * @param card The card id to query
+     * @param pin The PIN code to check
+     */
+    virtual future<Status> verifyPin(const Card& card, const Pin& pin) = 0;
+
+    /**
+     * @brief Retrieve all accounts associated with a card
+     *
+     * @param card The card id to query
+     */
+    virtual future<vector<AccountId>> listAccounts(const Card& card) = 0;
+
+    /**
+     * @brief Get the current balance of an account
+     *
+     * @param accountId The account to check
+     */
+    virtual future<Result<int>> getBalance(const AccountId& accountId) = 0;
+
+    /**
+     * @brief Deposit money into an account
+     *
+     * @param accountId The account to deposit into
+     * @param money The amount to deposit
+     */
+    virtual future<Status> deposit(const AccountId& accountId, int money) = 0;
+
+    /**
+     * @brief Check if withdrawal is possible without executing it
+     *
+     * @param accountId The account to check
+     * @param money The amount to withdraw
+     */
+    virtual future<Status> canWithdraw(const AccountId& accountId, int money) = 0;
+
+    /**
+     * @brief Withdraw money from an account
+     *
+     * @param accountId The account to withdraw from
+     * @param money The amount to withdraw
+     */
+    virtual future<Status> withdraw(const AccountId& accountId, int money) = 0;
+
+    /**
+     * @brief Reserve funds for a withdrawal
+     *
+     * @param accountId The account to reserve funds on
+     * @param money The amount to reserve
+     */
+    virtual future<Result<HoldId>> placeHold(const AccountId& accountId, int money) = 0;
+
+    /**
+     * @brief Settle a hold, debiting the reserved funds
+     *
+     * @param holdId The hold returned by placeHold()
+     */
+    virtual future<Status> captureHold(HoldId holdId) = 0;
+
+    /**
+     * @brief Cancel a hold, making the reserved funds available again
+     *
+     * @param holdId The hold returned by placeHold()
+     */
+    virtual future<Status> releaseHold(HoldId holdId) = 0;
+};
+
+/**
+ * @brief Asynchronous companion to ICashBin
+ */
+class IAsyncCashBin {
+public:
+    virtual ~IAsyncCashBin() = default;
+
+    /**
+     * @brief Check if the requested amount can be dispensed
+     *
+     * @param money Amount to check
+     */
+    virtual future<Status> canDispense(int money) = 0;
+
+    /**
+     * @brief Dispense the requested amount of cash
+     *
+     * @param money Amount to dispense
+     */
+    virtual future<Status> dispense(int money) = 0;
+};
+
+/**
+ * @brief Exposes a blocking IBank through IAsyncBank
+ *
+ * Calls run on the given pool, so the wrapped bank must tolerate being
+ * called from a thread other than the Controller's. Arguments are copied
+ * into the task; the bank and pool must outlive any pending future.
+ */
+class AsyncBankAdapter : public IAsyncBank {
+private:
+    IBank& _bank;
+    ThreadPool& _pool;
+
+public:
+    AsyncBankAdapter(IBank& bank, ThreadPool& pool) : _bank(bank), _pool(pool)
+    {}
+
+    future<Status> verifyPin(const Card& card, const Pin& pin) override
+    {
+        return _pool.submit([this, card, pin] { return _bank.verifyPin(card, pin); });
+    }
+
+    future<vector<AccountId>> listAccounts(const Card& card) override
+    {
+        return _pool.submit([this, card] { return _bank.listAccounts(card); });
+    }
+
+    future<Result<int>> getBalance(const AccountId& accountId) override
+    {
+        return _pool.submit([this, accountId] { return _bank.getBalance(accountId); });
+    }
+
+    future<Status> deposit(const AccountId& accountId, int money) override
+    {
+        return _pool.submit([this, accountId, money] { return _bank.deposit(accountId, money); });
+    }
+
+    future<Status> canWithdraw(const AccountId& accountId, int money) override
+    {
+        return _pool.submit([this, accountId, money] { return _bank.canWithdraw(accountId, money); });
+    }
+
+    future<Status> withdraw(const AccountId& accountId, int money) override
+    {
+        return _pool.submit([this, accountId, money] { return _bank.withdraw(accountId, money); });
+    }
+
+    future<Result<HoldId>> placeHold(const AccountId& accountId, int money) override
+    {
+        return _pool.submit([this, accountId, money] { return _bank.placeHold(accountId, money); });
+    }
+
+    future<Status> captureHold(HoldId holdId) override
+    {
+        return _pool.submit([this, holdId] { return _bank.captureHold(holdId); });
+    }
+
+    future<Status> releaseHold(HoldId holdId) override
+    {
+        return _pool.submit([this, holdId] { return _bank.releaseHold(holdId); });
+    }
+};
+
+/**
+ * @brief Exposes a blocking ICashBin through IAsyncCashBin
+ */
+class AsyncCashBinAdapter : public IAsyncCashBin {
+private:
+    ICashBin& _cashBin;
+    ThreadPool& _pool;
+
+public:
+    AsyncCashBinAdapter(ICashBin& cashBin, ThreadPool& pool) : _cashBin(cashBin), _pool(pool)
+    {}
+
+    future<Status> canDispense(int money) override
+    {
+        return _pool.submit([this, money] { return _cashBin.canDispense(money); });
+    }
+
+    future<Status> dispense(int money) override
+    {
+        return _pool.submit([this, money] { return _cashBin.dispense(money); });
+    }
+};
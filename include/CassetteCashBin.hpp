@@ -0,0 +1,132 @@
+#pragma once
+#include "Interfaces.hpp"
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Cash bin with several cassettes of different note denominations
+ *
+ * Keeps, for every suffix of the cassettes sorted by ascending
+ * denomination, the fewest notes needed for each amount up to the
+ * per-dispense limit. canDispense() is a single table lookup, and a note
+ * mix is read off the tables one cassette at a time. A dispense only
+ * changes the tables when a cassette falls below the notes the limit could
+ * ever take from it, and then only the levels up to that cassette are
+ * rebuilt, each in linear time. Not thread-safe, like the hardware it
+ * models.
+ */
+class CassetteCashBin : public ICashBin {
+public:
+    /**
+     * @brief One cassette: note value and notes left
+     */
+    struct Cassette {
+        int denomination;
+        int count;
+    };
+
+    /**
+     * @brief How a note mix is chosen when several are possible
+     */
+    enum class Strategy {
+        FewestNotes,    ///< Fewest notes in total, large notes first
+        Balanced        ///< Draw from each cassette in proportion to the cash it holds
+    };
+
+    /**
+     * @brief Dispenser configuration
+     */
+    struct Config {
+        int maxDispense = 1000000;               ///< Largest amount of one dispense
+        int maxNotes = 0;                        ///< Most notes per dispense, 0 for no limit
+        Strategy strategy = Strategy::FewestNotes;
+    };
+
+    /**
+     * @brief Notes to take from each cassette, in cassette order
+     */
+    using Plan = vector<int>;
+
+private:
+    static constexpr uint32_t kUnreachable = UINT32_MAX;
+
+    vector<Cassette> _cassettes;
+    Config _cfg;
+    vector<size_t> _order;          // Cassette indices by ascending denomination
+    int _unit = 1;                  // Greatest common divisor of the denominations
+    size_t _slots = 1;              // Amounts 0, unit, ..., maxDispense
+    vector<int> _usable;            // Per level: notes the limit can take from the cassette
+    vector<uint32_t> _minNotes;     // [level * _slots + amount / unit], level == _order.size() is empty
+
+    uint32_t minNotes(size_t level, size_t slot) const
+    {
+        return _minNotes[level * _slots + slot];
+    }
+
+    int usable(const Cassette& cassette) const;
+
+    /**
+     * @brief Recompute levels [0, top] after the cassettes of those levels changed
+     */
+    void rebuild(size_t top);
+
+    /**
+     * @brief Rebuild the levels whose cassettes' usable notes changed
+     */
+    void refreshTables(void);
+
+    /**
+     * @brief Amount as a table slot, or _slots if no table covers it
+     */
+    size_t slotOf(int money) const;
+
+public:
+    /**
+     * @brief Load the cassettes
+     *
+     * Cassettes with a non-positive denomination are ignored and negative
+     * counts are taken as empty.
+     *
+     * @param cassettes Cassettes in slot order
+     */
+    explicit CassetteCashBin(vector<Cassette> cassettes);
+    CassetteCashBin(vector<Cassette> cassettes, const Config& cfg);
+
+    /**
+     * @brief Check the amount against the tables; O(1)
+     */
+    Status canDispense(int money) override;
+
+    /**
+     * @brief Dispense the configured strategy's note mix
+     */
+    Status dispense(int money) override;
+
+    /**
+     * @brief Compute a note mix without dispensing it
+     *
+     * @param money Amount to pay out
+     * @param strategy How to choose between possible mixes
+     */
+    Result<Plan> plan(int money, Strategy strategy) const;
+
+    /**
+     * @brief Add notes to a cassette
+     *
+     * @param cassette Index in the order given to the constructor
+     * @param notes Notes loaded
+     */
+    Status refill(size_t cassette, int notes);
+
+    const vector<Cassette>& cassettes(void) const
+    {
+        return _cassettes;
+    }
+
+    /**
+     * @brief Cash left in all cassettes
+     */
+    int64_t total(void) const;
+};
@@ -0,0 +1,154 @@
+#pragma once
+#include "Interfaces.hpp"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief IBank decorator that stops calling a failing bank
+ *
+ * Closed: calls pass through and their outcomes fill a sliding window of
+ * the last calls. A call fails if it throws or reports Err::NetworkError,
+ * and is slow if it takes longer than the slow-call threshold. When either
+ * rate crosses its threshold the circuit opens.
+ *
+ * Open: calls fail at once with Err::NetworkError (listAccounts,
+ * postDeposits and getBalances throw runtime_error) instead of waiting for
+ * the bank's timeout. Deposits are not queued here: put a DepositQueue
+ * behind the controller to accept them durably while the link is down.
+ * After the open duration the circuit is half-open: a few probe calls go
+ * through, and the circuit closes if they all succeed or opens again on
+ * the first failure.
+ *
+ * captureHold and releaseHold are never refused: they settle holds placed
+ * (and cash possibly dispensed) before the circuit opened, and failing
+ * them fast would leave those holds to expire. They are not probes either;
+ * their outcomes count only while the circuit is closed.
+ *
+ * Safe to share between controllers when the inner bank is.
+ */
+class CircuitBreakerBank : public IBank {
+public:
+    enum class State {
+        Closed,     ///< Calls pass through
+        Open,       ///< Calls fail fast
+        HalfOpen    ///< Probe calls decide whether to close
+    };
+
+    /**
+     * @brief Breaker thresholds
+     */
+    struct Config {
+        size_t window = 50;                          ///< Calls the rates are taken over
+        size_t minCalls = 10;                        ///< Calls needed before the circuit can open
+        double failureRate = 0.5;                    ///< Failed fraction that opens the circuit
+        double slowRate = 0.8;                       ///< Slow fraction that opens the circuit
+        chrono::milliseconds slowCall{ 1000 };       ///< Calls at least this long are slow
+        chrono::milliseconds openDuration{ 5000 };   ///< Time open before probing
+        size_t halfOpenProbes = 3;                   ///< Successful probes needed to close
+    };
+
+    /**
+     * @brief Counters since construction
+     */
+    struct Stats {
+        uint64_t calls = 0;
+        uint64_t rejected = 0;          ///< Calls failed fast while open
+        uint64_t opened = 0;            ///< Transitions to open
+    };
+
+private:
+    using Clock = chrono::steady_clock;
+
+    /**
+     * @brief Outcome class of one call
+     */
+    enum class Outcome { Ok, Failed, Slow };
+
+    IBank& _inner;
+    Config _cfg;
+
+    mutable mutex _mutex;
+    State _state = State::Closed;
+    Clock::time_point _openedAt;
+    vector<Outcome> _window;            // Ring buffer of the last calls
+    size_t _next = 0;
+    size_t _recorded = 0;
+    size_t _failures = 0;
+    size_t _slow = 0;
+    size_t _probesInFlight = 0;
+    size_t _probesPassed = 0;
+    Stats _stats;
+
+    /**
+     * @brief Admit a call; false if it must fail fast
+     *
+     * @param probe Set when the call is a half-open probe
+     */
+    bool admit(bool& probe);
+
+    /**
+     * @brief Record a call's outcome and update the state
+     */
+    void complete(bool probe, Outcome outcome);
+
+    void open(void);
+    void close(void);
+    void resetWindow(void);
+
+    template <typename T>
+    Outcome outcomeOf(const T& result, Clock::time_point start) const;
+
+    template <typename T, typename F>
+    T call(F&& fn);
+
+    /**
+     * @brief Pass a settlement call through without admission
+     */
+    template <typename F>
+    Status settle(F&& fn);
+
+public:
+    explicit CircuitBreakerBank(IBank& inner);
+    CircuitBreakerBank(IBank& inner, const Config& cfg);
+
+    CircuitBreakerBank(const CircuitBreakerBank&) = delete;
+    CircuitBreakerBank& operator=(const CircuitBreakerBank&) = delete;
+
+    Status verifyPin(const Card& card, const Pin& pin) override;
+    vector<AccountId> listAccounts(const Card& card) override;
+    Result<int> getBalance(const AccountId& accountId) override;
+    Status deposit(const AccountId& accountId, int money) override;
+    Status canWithdraw(const AccountId& accountId, int money) override;
+    Status withdraw(const AccountId& accountId, int money) override;
+    Result<HoldId> placeHold(const AccountId& accountId, int money) override;
+    Status captureHold(HoldId holdId) override;
+    Status releaseHold(HoldId holdId) override;
+    vector<Status> postDeposits(const vector<DepositPosting>& batch) override;
+    vector<AccountBalance> getBalances(const Card& card) override;
+
+    bool keyedDeposits(void) const override
+    {
+        return _inner.keyedDeposits();
+    }
+
+    /**
+     * @brief Current state; an expired open period reads as half-open
+     */
+    State state(void) const;
+
+    /**
+     * @brief True while calls fail fast
+     */
+    bool isOpen(void) const
+    {
+        return state() == State::Open;
+    }
+
+    Stats stats(void) const;
+
+    static const char* stateName(State state);
+};
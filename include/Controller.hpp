@@ -1,6 +1,21 @@
 #pragma once
 #include "Interfaces.hpp"
+#include "AsyncInterfaces.hpp"
 #include "TransactionManager.hpp"
+#include "InlineTransactionManager.hpp"
+#include "SessionCache.hpp"
+#include "ControllerMetrics.hpp"
+#include "EventTracer.hpp"
+#include "OfflinePinVerifier.hpp"
+#include "CircuitBreakerBank.hpp"
+#include "DepositQueue.hpp"
+#include "SessionSnapshot.hpp"
+#include "ThreadPool.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
 #include <optional>
 
 using namespace std;
@@ -20,11 +35,52 @@ public:
         AccountSelected  ///< Account selected, ready for transactions
     };
 
+    static constexpr size_t kStateCount = size_t(State::AccountSelected) + 1;  ///< Last state + 1
+
+    /**
+     * @brief What happened in a session; drives the state transitions
+     * 
+     * Each operation may run only in states where the table accepts its
+     * event, and dispatches the event once it succeeds.
+     */
+    enum class Event : uint8_t {
+        CardRead,        ///< insertCard() read a card
+        PinAccepted,     ///< enterPin() verified the PIN
+        PinRejected,     ///< enterPin() got a wrong PIN
+        AccountsListed,  ///< listAccounts() answered
+        AccountChosen,   ///< selectAccount() found the account
+        BalanceRead,     ///< getBalance() answered
+        Deposited,       ///< deposit() succeeded
+        Withdrawn,       ///< withdraw() succeeded
+        CardEjected,     ///< ejectCard(), or the PIN attempts ran out
+        Count
+    };
+
+    static constexpr size_t kEventCount = size_t(Event::Count);
+
+    using TransitionCounts = array<array<uint64_t, kEventCount>, kStateCount>;
+
+    /**
+     * @brief Journal operation codes of the withdrawal transaction
+     */
+    enum JournalOp : uint16_t {
+        WithdrawHold = 1,      ///< Funds hold; arg is the HoldId
+        WithdrawDispense = 2,  ///< Cash dispense
+        WithdrawCapture = 3    ///< Capture still owed after a dispense; arg is the HoldId
+    };
+
     /**
      * @brief Configuration parameters for ATM behavior
      */
     struct Config {
         int maxPinAttempts = 3;  ///< Maximum failed PIN attempts before card ejection
+        bool sessionCache = false;  ///< Memoize account list and balances per card session
+        TransactionJournal* journal = nullptr;  ///< Write-ahead journal for withdrawals (optional)
+        ControllerMetrics* metrics = nullptr;   ///< Latency histograms, one per controller (optional)
+        OfflinePinVerifier* pinVerifier = nullptr;  ///< Checks PINs locally before asking the bank (optional)
+        const CircuitBreakerBank* breaker = nullptr; ///< Bank link breaker; degrades service while open (optional)
+        DepositQueue* depositQueue = nullptr;   ///< Store-and-forward queue for deposits (optional)
+        ThreadPool* prefetch = nullptr;         ///< Fetches accounts and balances once the PIN is accepted (optional)
     };
 
 private:
@@ -34,12 +90,146 @@ private:
     IBank& _bank;                        // Banking service interface
     ICashBin& _cashBin;                  // Cash bin interface
 
+    IAsyncBank* _asyncBank = nullptr;        // Optional async banking interface
+    IAsyncCashBin* _asyncCashBin = nullptr;  // Optional async cash bin interface
+
     Config _cfg;                         // ATM configuration
 
     optional<Card> _card;                // Currently inserted card
     optional<AccountId> _account;        // Currently selected account
+    optional<PinReference> _pinReference;  // Issuer PIN reference of the card, if any
     
-    int _pinAttempts;                    // Failed PIN attempts
+    int _pinAttempts = 0;                // Failed PIN attempts
+
+    mutable SessionCache _cache;         // Per-card read cache (when enabled)
+
+    struct Prefetch {
+        future<vector<AccountBalance>> answer;
+        shared_ptr<atomic<bool>> cancelled;  // shared with the pool task
+    };
+    mutable optional<Prefetch> _prefetch;  // Fetch started by enterPin(), until read or cancelled
+
+    mutable TransitionCounts _transitions{};  // Dispatched events per state
+
+    /**
+     * @brief Fetch the account list of the current card, via the cache if enabled
+     */
+    vector<AccountId> fetchAccounts(void) const;
+
+    /**
+     * @brief True if reads go through the session cache
+     */
+    bool caching(void) const
+    {
+        return _cfg.sessionCache || _cfg.prefetch;
+    }
+
+    /**
+     * @brief Ask the bank for the card's accounts and balances on the prefetch pool
+     */
+    void startPrefetch(void);
+
+    /**
+     * @brief Wait for a started prefetch and move its answer into the cache
+     * 
+     * A failed prefetch is dropped; the reads then ask the bank themselves.
+     */
+    void absorbPrefetch(void) const;
+
+    /**
+     * @brief Drop a prefetch without waiting; a task not yet started skips the bank
+     */
+    void cancelPrefetch(void);
+
+    /**
+     * @brief True if the current state has a transition for the event
+     * 
+     * @param event Event the caller is about to cause
+     */
+    bool accepts(Event event) const;
+
+    /**
+     * @brief Take the transition for an event, tracing a change of state
+     * 
+     * Fails with InvalidState if the current state rejects the event.
+     * 
+     * @param event Event that happened
+     */
+    Status dispatch(Event event);
+
+    /**
+     * @brief Count an event that keeps the state, from a read-only operation
+     * 
+     * @param event Event that happened
+     */
+    Status dispatch(Event event) const;
+
+    /**
+     * @brief Forget the card and account and return to Idle
+     */
+    void endSession(void);
+
+    /**
+     * @brief Trace an exception translated to an error code
+     * 
+     * @param op Operation that caught the exception
+     * @param exception Exception type
+     * @param err Error code reported instead
+     */
+    static Err translated(const char* op, const char* exception, Err err)
+    {
+        ATM_TRACE(TraceKind::Error, op, exception, int64_t(err));
+        (void)op;
+        (void)exception;
+        return err;
+    }
+
+    /**
+     * @brief Run f, recording its duration and outcome when metrics are enabled
+     * 
+     * @param key Operation or dependency call being timed
+     * @param f Callable doing the work
+     */
+    template <typename Key, typename F>
+    auto timed(Key key, F&& f) const -> decltype(f())
+    {
+        ATM_TRACE_SCOPE(ControllerMetrics::name(key));
+        if (!_cfg.metrics || !_cfg.metrics->enabled(key))
+        {
+            return f();
+        }
+
+        ControllerMetrics::Scope scope(*_cfg.metrics, key);
+        auto result = f();
+        scope.done(ControllerMetrics::outcome(result));
+        return result;
+    }
+
+    // Bodies of the public operations; the public methods time them
+    Status insertCardImpl(void);
+    Status ejectCardImpl(void);
+    Status enterPinImpl(const Pin& pin);
+    Result<vector<AccountId>> listAccountsImpl() const;
+    Status selectAccountImpl(const AccountId& accountId);
+    Result<int> getBalanceImpl(void) const;
+    Status depositImpl(int money);
+    Status withdrawImpl(int money);
+
+    /**
+     * @brief Fail fast with a traced NetworkError while the bank link is down
+     * 
+     * @param op Operation refused
+     */
+    bool refusedWhileDegraded(const char* op) const
+    {
+        if (!degraded())
+        {
+            return false;
+        }
+        ATM_TRACE(TraceKind::Instant, op, "degraded", int64_t(Err::NetworkError));
+        (void)op;
+        return true;
+    }
 
     /**
      * @brief Validate amount
@@ -63,10 +253,77 @@ public:
      : _cardReader(cardReader), _bank(bank), _cashBin(cashBin)
     {}
 
+    /**
+     * @brief Construct ATM Controller with explicit configuration
+     * 
+     * @param cardReader Hardware interface for card operations
+     * @param bank Service interface for banking operations
+     * @param cashBin Hardware interface for cash dispensing
+     * @param cfg ATM configuration
+     */
+    Controller(ICardReader& cardReader, IBank& bank, ICashBin& cashBin, const Config& cfg)
+     : _cardReader(cardReader), _bank(bank), _cashBin(cashBin), _cfg(cfg)
+    {}
+
+    /**
+     * @brief Construct ATM Controller that overlaps independent pre-checks
+     * 
+     * The bank and cash bin pre-checks of withdraw() are issued through the
+     * async interfaces and awaited together; dependent steps stay blocking.
+     * 
+     * @param cardReader Hardware interface for card operations
+     * @param bank Service interface for banking operations
+     * @param cashBin Hardware interface for cash dispensing
+     * @param asyncBank Async view of the same banking service
+     * @param asyncCashBin Async view of the same cash bin
+     */
+    Controller(ICardReader& cardReader, IBank& bank, ICashBin& cashBin,
+               IAsyncBank& asyncBank, IAsyncCashBin& asyncCashBin)
+     : _cardReader(cardReader), _bank(bank), _cashBin(cashBin),
+       _asyncBank(&asyncBank), _asyncCashBin(&asyncCashBin)
+    {}
+
+    /**
+     * @brief Cancel a pending prefetch; a fetch already at the bank still completes
+     */
+    ~Controller();
+
     /**
      * @brief Get current ATM state
      */
     State state(void) const;
+
+    /**
+     * @brief True while the bank link breaker is open
+     * 
+     * Balance inquiries and withdrawals then fail at once with NetworkError.
+     * Deposits still go to Config::depositQueue, which posts them once the
+     * link is back; without one they fail at once as well.
+     */
+    bool degraded(void) const
+    {
+        return _cfg.breaker && _cfg.breaker->isOpen();
+    }
+
+    /**
+     * @brief Name of a state, for logs and traces
+     */
+    static const char* stateName(State state);
+
+    /**
+     * @brief Name of an event, for logs and traces
+     */
+    static const char* eventName(Event event);
+
+    /**
+     * @brief Times each event was dispatched in each state since construction
+     * 
+     * Indexed by [from state][event]; a rejected event is never counted.
+     */
+    const TransitionCounts& transitionCounts(void) const
+    {
+        return _transitions;
+    }
     
     /**
      * @brief Insert and read a card
@@ -81,6 +338,13 @@ public:
     /**
      * @brief Enter PIN for authentication
      * 
+     * With Config::prefetch, an accepted PIN also starts IBank::getBalances()
+     * for the card on that pool, and listAccounts(), selectAccount() and
+     * getBalance() take their answers from it, waiting if it is still
+     * running. Reads are then cached for the session as with
+     * Config::sessionCache. ejectCard() cancels the prefetch. The bank must
+     * be safe to call from the pool and outlive its tasks.
+     * 
      * @param pin The PIN code to verify
      */
     Status enterPin(const Pin& pin);
@@ -112,7 +376,55 @@ public:
     /**
      * @brief Withdraw money from currently selected account
      * 
+     * The cash bin is checked before the bank is asked for a hold, so when
+     * both are short the error is InsufficientCashBin, not InsufficientBank.
+     * 
      * @param money Amount to withdraw
      */
     Status withdraw(int money);
+
+    /**
+     * @brief Capture the session for a later restore()
+     * 
+     * Fails with InvalidArg if the card or account id does not fit a record.
+     * 
+     * @param key Host secret the record is sealed with
+     */
+    Result<SessionRecord> snapshot(const SessionKey& key) const;
+
+    /**
+     * @brief Resume a session captured by snapshot(), e.g. after a restart
+     * 
+     * Only an idle controller can be restored, and only from a record
+     * younger than maxAge whose MAC checks out under key. The PIN is not
+     * asked again, so the card is read again first and must be the one
+     * recorded; otherwise the restore fails with InvalidArg (or the
+     * reader's error) and the controller stays idle. Cached reads are not
+     * part of the record and are fetched again.
+     * 
+     * @param record Record from snapshot()
+     * @param key Host secret the record was sealed with
+     * @param maxAge Oldest record accepted
+     */
+    Status restore(const SessionRecord& record, const SessionKey& key, chrono::seconds maxAge);
+
+    /**
+     * @brief Settle withdrawals left unfinished by a crash
+     * 
+     * Run at startup, before any Controller uses the journal. Holds whose
+     * cash was dispensed are captured; all others are released. This also
+     * settles withdrawals whose capture failed at the time, which were
+     * deferred in the journal. A withdrawal the bank cannot settle now
+     * (transport failure) stays in the journal for the next run; the
+     * return value counts only settled ones.
+     * 
+     * @param journal Journal the Controllers were configured with
+     * @param bank Banking service the holds were placed on
+     */
+    static size_t recoverWithdrawals(TransactionJournal& journal, IBank& bank);
+
+    /**
+     * @brief Hit/miss counters of the session cache
+     */
+    SessionCache::Stats cacheStats(void) const;
 };
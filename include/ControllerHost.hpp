@@ -0,0 +1,185 @@
+#pragma once
+#include "Controller.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Runs many Controller sessions on a fixed worker pool
+ *
+ * Each session is pinned to a home worker by id. Commands for one session
+ * run in submission order and never concurrently; idle workers steal
+ * whole sessions from busy ones, so ordering is kept across steals.
+ */
+class ControllerHost {
+public:
+    using SessionId = size_t;
+    using Command = function<void(Controller&)>;
+
+    /**
+     * @brief Aggregate throughput counters
+     */
+    struct Stats {
+        size_t sessions = 0;           ///< Registered sessions
+        uint64_t commands = 0;         ///< Commands executed since last reset
+        uint64_t steals = 0;           ///< Sessions taken from another worker's queue
+        double elapsedSeconds = 0.0;   ///< Wall time since last reset
+        double commandsPerSecond = 0.0;
+    };
+
+private:
+    struct Session;
+    struct Worker;
+
+    vector<unique_ptr<Worker>> _workers;
+    vector<thread> _threads;
+
+    vector<unique_ptr<Session>> _sessions;
+    mutable shared_mutex _sessionsMutex;
+
+    atomic<size_t> _queued{ 0 };       // sessions waiting in worker queues
+    atomic<uint64_t> _pending{ 0 };    // submitted but not yet executed commands
+    atomic<uint64_t> _commands{ 0 };
+    atomic<uint64_t> _steals{ 0 };
+    atomic<int64_t> _statsStart{ 0 };  // steady_clock ticks
+    bool _stopping = false;
+
+    mutex _idleMutex;
+    condition_variable _idleCv;
+    mutex _drainMutex;
+    condition_variable _drainCv;
+
+    Session* findSession(SessionId id) const;
+    void schedule(Session* session, size_t worker);
+    Session* nextSession(size_t worker);
+    void runSession(Session* session, size_t worker);
+    void workerLoop(size_t worker);
+
+public:
+    /**
+     * @brief Start the worker pool
+     *
+     * @param workers Number of worker threads (at least one is always started)
+     */
+    explicit ControllerHost(size_t workers = thread::hardware_concurrency());
+
+    ControllerHost(const ControllerHost&) = delete;
+    ControllerHost& operator=(const ControllerHost&) = delete;
+
+    /**
+     * @brief Run all queued commands, then stop the workers
+     */
+    ~ControllerHost();
+
+    /**
+     * @brief Register a new terminal session
+     *
+     * The devices are referenced, not owned, and must outlive the host.
+     *
+     * @param cardReader Card reader of the terminal
+     * @param bank Banking service used by the session
+     * @param cashBin Cash bin of the terminal
+     */
+    SessionId addSession(ICardReader& cardReader, IBank& bank, ICashBin& cashBin);
+
+    /**
+     * @brief Register a new terminal session with its own Controller configuration
+     *
+     * The devices, and anything cfg points to (journal, deposit queue,
+     * breaker, PIN verifier), are referenced, not owned, and must outlive
+     * the host.
+     *
+     * @param cardReader Card reader of the terminal
+     * @param bank Banking service used by the session
+     * @param cashBin Cash bin of the terminal
+     * @param cfg Configuration of the session's Controller
+     */
+    SessionId addSession(ICardReader& cardReader, IBank& bank, ICashBin& cashBin, const Controller::Config& cfg);
+
+    /**
+     * @brief Queue a command for a session
+     *
+     * Commands for the same session run in submission order.
+     *
+     * @param id Session returned by addSession()
+     * @param command Work to run against the session's Controller
+     */
+    void submit(SessionId id, Command command);
+
+    /**
+     * @brief Queue a command and return a future for its result
+     *
+     * @param id Session returned by addSession()
+     * @param fn Callable taking Controller&
+     */
+    template <typename F>
+    auto call(SessionId id, F fn) -> future<invoke_result_t<F, Controller&>>
+    {
+        using R = invoke_result_t<F, Controller&>;
+        auto task = make_shared<packaged_task<R(Controller&)>>(move(fn));
+        auto result = task->get_future();
+        submit(id, [task](Controller& controller) { (*task)(controller); });
+        return result;
+    }
+
+    /**
+     * @brief Block until every submitted command has run
+     */
+    void drain(void);
+
+    /**
+     * @brief Save every session holding a card to a snapshot file
+     * 
+     * Each session is captured by a command queued behind its pending
+     * ones, so every record is taken between two operations. Sessions
+     * whose ids do not fit a record are left out.
+     * 
+     * @param file Open snapshot file
+     * @param key Host secret the records are sealed with
+     * @return Number of sessions saved
+     */
+    Result<size_t> saveSessions(SessionSnapshotFile& file, const SessionKey& key);
+
+    /**
+     * @brief Resume the sessions of a snapshot file
+     * 
+     * Records are matched to sessions by id, so the sessions must have
+     * been added in the same order as when the snapshot was saved.
+     * Records older than maxAge, not sealed with key, for a busy session
+     * or for a card no longer in the session's reader are skipped.
+     * 
+     * @param file Open snapshot file
+     * @param key Host secret the records were sealed with
+     * @param maxAge Oldest record accepted
+     * @return Number of sessions restored
+     */
+    size_t restoreSessions(const SessionSnapshotFile& file, const SessionKey& key, chrono::seconds maxAge);
+
+    /**
+     * @brief Snapshot of the throughput counters
+     */
+    Stats stats(void) const;
+
+    /**
+     * @brief Restart the throughput window
+     */
+    void resetStats(void);
+
+    size_t sessionCount(void) const;
+
+    size_t workerCount(void) const
+    {
+        return _threads.size();
+    }
+};
@@ -0,0 +1,183 @@
+#pragma once
+#include "LatencyHistogram.hpp"
+#include "Result.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * @brief Latency histograms of one Controller, keyed by outcome
+ *
+ * Records the duration of every public Controller operation and of every
+ * call the controller makes into the bank, card reader and cash bin, each
+ * split by the Err it ended with. Give every controller its own instance
+ * (recording is single-writer) and merge snapshots to aggregate.
+ *
+ * Each timed scope costs two timestamp-counter reads and a few relaxed
+ * stores. Call timing can be switched off to time operations only.
+ */
+class ControllerMetrics {
+public:
+    /**
+     * @brief Public Controller operations
+     */
+    enum class Op : uint8_t {
+        InsertCard,
+        EnterPin,
+        ListAccounts,
+        SelectAccount,
+        GetBalance,
+        Deposit,
+        Withdraw,
+        EjectCard,
+        Count
+    };
+
+    /**
+     * @brief Calls into the controller's dependencies
+     */
+    enum class Call : uint8_t {
+        ReadCard,       ///< ICardReader::read
+        EjectCard,      ///< ICardReader::eject
+        VerifyPin,      ///< IBank::verifyPin
+        ListAccounts,   ///< IBank::listAccounts
+        GetBalance,     ///< IBank::getBalance
+        Deposit,        ///< IBank::deposit
+        PlaceHold,      ///< IBank::placeHold (or waiting for the async hold)
+        CaptureHold,    ///< IBank::captureHold
+        ReleaseHold,    ///< IBank::releaseHold
+        CanDispense,    ///< ICashBin::canDispense (or waiting for the async check)
+        Dispense,       ///< ICashBin::dispense
+        GetBalances,    ///< Waiting for the IBank::getBalances prefetch
+        Count
+    };
+
+    static const size_t kOps = size_t(Op::Count);
+    static const size_t kCalls = size_t(Call::Count);
+    static const size_t kOutcomes = size_t(Err::MemoryError) + 1;
+
+    using Row = array<LatencyHistogram::Snapshot, kOutcomes>;
+
+    /**
+     * @brief Copy of all histograms; merge snapshots of several controllers
+     */
+    struct Snapshot {
+        array<Row, kOps> ops;
+        array<Row, kCalls> calls;
+
+        const LatencyHistogram::Snapshot& op(Op op, Err outcome) const
+        {
+            return ops[size_t(op)][size_t(outcome)];
+        }
+
+        const LatencyHistogram::Snapshot& call(Call call, Err outcome) const
+        {
+            return calls[size_t(call)][size_t(outcome)];
+        }
+
+        /**
+         * @brief Histogram of an operation over all outcomes
+         */
+        LatencyHistogram::Snapshot op(Op op) const;
+
+        /**
+         * @brief Histogram of a dependency call over all outcomes
+         */
+        LatencyHistogram::Snapshot call(Call call) const;
+
+        void merge(const Snapshot& other);
+    };
+
+    /**
+     * @brief Records one operation or call when it goes out of scope
+     *
+     * The outcome defaults to SystemError, which is what an exception
+     * escaping the timed code is counted as.
+     */
+    class Scope {
+    private:
+        LatencyHistogram* _row;
+        uint64_t _start;
+        double _nsPerTick;
+        Err _outcome = Err::SystemError;
+
+    public:
+        Scope(ControllerMetrics& metrics, Op op)
+         : _row(metrics._ops[size_t(op)]), _start(TickClock::now()), _nsPerTick(metrics._nsPerTick)
+        {}
+
+        Scope(ControllerMetrics& metrics, Call call)
+         : _row(metrics._calls[size_t(call)]), _start(TickClock::now()), _nsPerTick(metrics._nsPerTick)
+        {}
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope()
+        {
+            uint64_t ticks = TickClock::now() - _start;
+            _row[size_t(_outcome)].record(uint64_t(double(ticks) * _nsPerTick));
+        }
+
+        void done(Err outcome)
+        {
+            _outcome = outcome;
+        }
+    };
+
+private:
+    LatencyHistogram _ops[kOps][kOutcomes];
+    LatencyHistogram _calls[kCalls][kOutcomes];
+    double _nsPerTick;
+    bool _timeCalls;
+
+public:
+    /**
+     * @brief Create empty histograms
+     *
+     * @param timeCalls Also time calls into the dependencies
+     */
+    explicit ControllerMetrics(bool timeCalls = true);
+
+    bool enabled(Op) const
+    {
+        return true;
+    }
+
+    bool enabled(Call) const
+    {
+        return _timeCalls;
+    }
+
+    ControllerMetrics(const ControllerMetrics&) = delete;
+    ControllerMetrics& operator=(const ControllerMetrics&) = delete;
+
+    Snapshot snapshot(void) const;
+
+    void reset(void);
+
+    static const char* name(Op op);
+    static const char* name(Call call);
+
+    /**
+     * @brief Outcome of a dependency call or operation, by its return value
+     */
+    static Err outcome(const Status& status)
+    {
+        return status.code;
+    }
+
+    template <typename T>
+    static Err outcome(const Result<T>& result)
+    {
+        return result.error();
+    }
+
+    template <typename T>
+    static Err outcome(const T&)
+    {
+        return Err::None;
+    }
+};
@@ -0,0 +1,222 @@
+#pragma once
+#include "Interfaces.hpp"
+#include "MappedFile.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Durable store-and-forward queue for deposits
+ *
+ * enqueue() writes the deposit to a memory-mapped file and returns as soon
+ * as it is on stable storage; a background flusher posts queued deposits
+ * to the bank in batches through IBank::postDeposits(). Every deposit
+ * carries an idempotency key (terminal id in the high bits, a persistent
+ * sequence number below), so a batch whose reply was lost, or that was
+ * in flight when the process died, can be resent safely.
+ *
+ * The file holds a fixed number of deposits and the in-memory index never
+ * grows past it. When the queue is full, enqueue() asks for an immediate
+ * flush and waits a bounded time for room before failing with
+ * Err::MemoryError.
+ *
+ * Batches that hit a link failure stay queued and are retried after a
+ * delay. A deposit the bank refuses is cash in the machine that no account
+ * was credited for, so it stays in the file, marked refused, until an
+ * operator settles it and calls acknowledgeRefused(); until then it holds
+ * its slot. Resending is
+ * only safe with a bank that applies each key once, so open() refuses a
+ * bank without IBank::keyedDeposits(). The bank is called from the flusher
+ * thread, so it must be safe to use concurrently with the controller.
+ */
+class DepositQueue {
+public:
+    /**
+     * @brief Queue configuration
+     */
+    struct Config {
+        size_t capacity = 4096;                         ///< Deposits the file holds
+        size_t batchSize = 64;                          ///< Most deposits per bank call
+        chrono::milliseconds flushInterval{ 200 };      ///< Longest wait for a batch to fill
+        chrono::milliseconds retryDelay{ 1000 };        ///< Pause after a batch hit a link failure
+        chrono::milliseconds fullWait{ 2000 };          ///< How long enqueue() waits for room
+        bool syncEachDeposit = true;                    ///< Sync each deposit before acknowledging it
+        uint32_t terminalId = 0;                        ///< Key prefix; unique per terminal (24 bits)
+    };
+
+    /**
+     * @brief Queue counters since open()
+     */
+    struct Stats {
+        uint64_t enqueued = 0;
+        uint64_t recovered = 0;      ///< Unposted deposits found in the file on open (refused ones excluded)
+        uint64_t posted = 0;         ///< Deposits the bank accepted
+        uint64_t refused = 0;        ///< Deposits the bank rejected; kept until acknowledged
+        uint64_t batches = 0;        ///< postDeposits() calls
+        uint64_t failedBatches = 0;  ///< Batches with at least one link failure
+        uint64_t rejected = 0;       ///< enqueue() calls that found the queue full
+        uint64_t syncs = 0;
+    };
+
+    /**
+     * @brief A deposit the bank refused, awaiting an operator
+     */
+    struct RefusedDeposit {
+        uint64_t key = 0;              ///< Idempotency key it was posted under
+        AccountId account;
+        int money = 0;
+        Err error = Err::None;         ///< The bank's answer
+    };
+
+private:
+    struct Entry {
+        uint64_t key = 0;
+        AccountId account;
+        int money = 0;
+        Err error = Err::None;         // why the bank refused it
+    };
+
+    IBank& _bank;
+    MappedFile _file;
+    Config _cfg;
+    size_t _capacity = 0;              // deposit slots after the header
+
+    mutable mutex _mutex;
+    condition_variable _wake;          // flusher: work to do or stopping
+    mutable condition_variable _changed;  // batch finished, slot freed or reader left
+    vector<Entry> _entries;            // mirror of the slots in use
+    vector<size_t> _free;              // unused slots
+    deque<size_t> _queue;              // slots waiting to be posted, oldest first
+    vector<size_t> _refused;           // slots the bank refused, not yet acknowledged
+    unordered_map<AccountId, int64_t> _pending;  // unposted amount per account, batch in flight included
+    uint64_t _nextSeq = 1;
+    bool _posting = false;             // a batch is at the bank
+    bool _postWanted = false;          // the flusher waits for readers to leave
+    mutable size_t _readers = 0;       // balance reads in progress
+    bool _flushNow = false;
+    bool _stopping = false;
+    Stats _stats;
+
+    thread _flusher;
+
+    void run(void);
+    void writeSlot(size_t slot, uint8_t state);
+    void release(size_t slot, uint8_t state);
+
+public:
+    /**
+     * @brief Create a closed queue posting to a bank
+     *
+     * @param bank Bank the flusher posts to
+     */
+    explicit DepositQueue(IBank& bank);
+
+    DepositQueue(const DepositQueue&) = delete;
+    DepositQueue& operator=(const DepositQueue&) = delete;
+
+    /**
+     * @brief Post what the bank takes and close the file
+     */
+    ~DepositQueue();
+
+    /**
+     * @brief Open or create a queue file with default settings
+     *
+     * @param path Queue file
+     */
+    Status open(const string& path);
+
+    /**
+     * @brief Open or create a queue file and start the flusher
+     *
+     * Deposits left unposted by a previous run are queued again and posted
+     * first, under their original keys. Fails with InvalidArg if the bank
+     * does not apply deposit keys at most once.
+     *
+     * @param path Queue file
+     * @param cfg Queue configuration
+     */
+    Status open(const string& path, const Config& cfg);
+
+    /**
+     * @brief Stop the flusher and close the file
+     *
+     * Queued deposits are posted while the bank accepts them; whatever is
+     * left stays in the file for the next open().
+     */
+    void close(void);
+
+    bool isOpen(void) const
+    {
+        return _file.isOpen();
+    }
+
+    /**
+     * @brief Queue a deposit for posting
+     *
+     * Fails with InvalidArg for a non-positive amount or an account id
+     * longer than 43 bytes, and with MemoryError if the queue stays full
+     * for Config::fullWait.
+     *
+     * @param accountId Account to credit
+     * @param money Amount deposited
+     * @return The deposit's idempotency key
+     */
+    Result<uint64_t> enqueue(const AccountId& accountId, int money);
+
+    /**
+     * @brief Amount queued for an account and not yet posted
+     *
+     * @param accountId Account to look up
+     */
+    int64_t pending(const AccountId& accountId) const;
+
+    /**
+     * @brief Read a balance from the bank and add the account's queued deposits
+     *
+     * No batch is posted while the read is in progress, so a deposit is
+     * counted either by the bank or by the queue, never by both.
+     *
+     * @param accountId Account whose balance is read
+     * @param readBalance Reads the balance from the bank
+     */
+    Result<int> withPending(const AccountId& accountId, const function<Result<int>()>& readBalance) const;
+
+    /**
+     * @brief Deposits not yet posted, refused ones excluded
+     */
+    size_t size(void) const;
+
+    /**
+     * @brief Deposits the bank refused and no one has acknowledged, oldest first
+     */
+    vector<RefusedDeposit> refused(void) const;
+
+    /**
+     * @brief Drop a refused deposit once it has been settled by other means
+     *
+     * Frees its slot. Fails with InvalidArg if no refused deposit has the key.
+     *
+     * @param key Key from refused()
+     */
+    Status acknowledgeRefused(uint64_t key);
+
+    /**
+     * @brief Post everything queued now and wait for it
+     *
+     * @param timeout Longest wait
+     * @return True if the queue became empty
+     */
+    bool drain(chrono::milliseconds timeout);
+
+    Stats stats(void) const;
+};
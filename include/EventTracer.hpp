@@ -0,0 +1,185 @@
+#pragma once
+#include "LatencyHistogram.hpp"
+#include "Result.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#ifndef ATM_TRACING
+#define ATM_TRACING 0
+#endif
+
+/**
+ * @brief Kind of a traced event
+ */
+enum class TraceKind : uint8_t {
+    Begin,      ///< An operation or device call starts
+    End,        ///< The matching operation or call ends
+    State,      ///< State transition; name is the old state, detail the new one
+    Error,      ///< Exception translated to an Err; detail is the exception type, arg the Err
+    Instant     ///< Anything else worth a mark on the timeline
+};
+
+/**
+ * @brief One fixed-size binary trace record
+ *
+ * Names and details must be string literals (or otherwise live for the
+ * whole process): only the pointers are stored.
+ */
+struct TraceEvent {
+    uint64_t ticks = 0;          ///< TickClock::now() when recorded
+    const char* name = nullptr;
+    const char* detail = nullptr;
+    int64_t arg = 0;
+    uint32_t thread = 0;         ///< Small per-thread id assigned by the tracer
+    TraceKind kind = TraceKind::Instant;
+};
+
+/**
+ * @brief Process-wide event tracer with one ring buffer per thread
+ *
+ * Each thread appends to its own fixed-size ring without locks or
+ * allocation, overwriting its oldest events once the ring is full. Any
+ * thread can collect the rings or export them as Chrome trace JSON (which
+ * Perfetto and chrome://tracing load); events overwritten while being
+ * collected are dropped. Recording is off until enable(true).
+ *
+ * Build with ATM_TRACING=OFF to compile the ATM_TRACE* hooks away.
+ */
+class EventTracer {
+public:
+    static const size_t kRingEvents = 4096;   ///< Events kept per thread (power of two)
+    static const size_t kMaxThreads = 256;    ///< Threads that can hold a ring at once
+
+    struct Ring;
+
+private:
+    atomic<Ring*> _rings[kMaxThreads] = {};
+    atomic<size_t> _ringCount{ 0 };
+    mutex _registerMutex;
+    uint64_t _originTicks;
+    double _nsPerTick;
+
+    static inline atomic<bool> s_enabled{ false };
+
+    EventTracer();
+
+    Ring* threadRing(void);
+
+    using Sink = void (*)(void* context, const char* data, size_t size);
+
+    /**
+     * @brief Format the Chrome trace into buffer, handing each full buffer to sink
+     *
+     * Async-signal-safe: no allocation, locks or stdio.
+     */
+    void writeChromeTrace(char* buffer, size_t size, Sink sink, void* context) const;
+
+    /**
+     * @brief Signal handler installed by installCrashHandler()
+     */
+    static void onCrash(int sig);
+
+public:
+    EventTracer(const EventTracer&) = delete;
+    EventTracer& operator=(const EventTracer&) = delete;
+
+    static EventTracer& instance(void);
+
+    static bool enabled(void)
+    {
+        return s_enabled.load(memory_order_relaxed);
+    }
+
+    static void enable(bool on)
+    {
+        s_enabled.store(on, memory_order_relaxed);
+    }
+
+    /**
+     * @brief Append an event to the calling thread's ring
+     */
+    void record(TraceKind kind, const char* name, const char* detail = nullptr, int64_t arg = 0);
+
+    /**
+     * @brief Events of all threads, oldest first
+     */
+    vector<TraceEvent> collect(void) const;
+
+    /**
+     * @brief Forget all recorded events
+     */
+    void clear(void);
+
+    /**
+     * @brief Write all events as Chrome trace JSON
+     *
+     * Formats into a stack buffer without allocating; the crash handler
+     * uses the same formatter with write(2) instead of stdio.
+     *
+     * @param out Destination stream
+     */
+    void writeChromeTrace(FILE* out) const;
+
+    /**
+     * @brief Write all events as Chrome trace JSON to a file
+     *
+     * @param path Destination file
+     */
+    Status writeChromeTrace(const string& path) const;
+
+    /**
+     * @brief Dump the trace to a file when the process crashes
+     *
+     * Handles SIGSEGV, SIGABRT, SIGFPE and SIGILL (and SIGBUS where it
+     * exists), then re-raises the signal. The handler only formats into a
+     * preallocated buffer and write()s it out. The dump is best effort:
+     * the process state may already be damaged.
+     *
+     * @param path Destination file, opened now
+     */
+    static Status installCrashHandler(const string& path);
+};
+
+/**
+ * @brief Records Begin on construction and End on destruction
+ */
+class TraceScope {
+private:
+    const char* _name;
+
+public:
+    explicit TraceScope(const char* name)
+     : _name(EventTracer::enabled() ? name : nullptr)
+    {
+        if (_name) EventTracer::instance().record(TraceKind::Begin, _name);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    ~TraceScope()
+    {
+        if (_name) EventTracer::instance().record(TraceKind::End, _name);
+    }
+};
+
+#if ATM_TRACING
+#define ATM_TRACE_CONCAT_(a, b) a##b
+#define ATM_TRACE_CONCAT(a, b) ATM_TRACE_CONCAT_(a, b)
+#define ATM_TRACE(kind, name, detail, arg)                                    \
+    do {                                                                      \
+        if (EventTracer::enabled())                                           \
+            EventTracer::instance().record((kind), (name), (detail), (arg));  \
+    } while (0)
+#define ATM_TRACE_SCOPE(name) TraceScope ATM_TRACE_CONCAT(atmTraceScope, __LINE__)(name)
+#else
+#define ATM_TRACE(kind, name, detail, arg) do {} while (0)
+#define ATM_TRACE_SCOPE(name) do {} while (0)
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * @brief 32-bit FNV-1a over length bytes
+ *
+ * Not a MAC: it detects torn or damaged records in the mapped files, not
+ * deliberate changes.
+ *
+ * @param data First byte
+ * @param length Bytes to hash
+ */
+inline uint32_t fnv1a(const void* data, size_t length)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+    {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief 64-bit FNV-1a over length bytes
+ *
+ * @param data First byte
+ * @param length Bytes to hash
+ */
+inline uint64_t fnv1a64(const void* data, size_t length)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < length; ++i)
+    {
+        h = (h ^ p[i]) * 1099511628211ull;
+    }
+    return h;
+}
@@ -0,0 +1,247 @@
+#pragma once
+#include "Interfaces.hpp"
+#include "TransactionJournal.hpp"
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+using namespace std;
+
+template <typename Signature, size_t Capacity>
+class InlineFunction;
+
+/**
+ * @brief Move-only callable stored in a fixed inline buffer
+ *
+ * Never allocates; a callable larger than Capacity bytes is rejected at
+ * compile time.
+ */
+template <typename R, typename... Args, size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+private:
+    alignas(max_align_t) unsigned char _storage[Capacity];
+    R (*_invoke)(void*, Args&&...) = nullptr;
+    void (*_destroy)(void*) = nullptr;
+
+public:
+    InlineFunction() = default;
+
+    InlineFunction(const InlineFunction&) = delete;
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    ~InlineFunction()
+    {
+        reset();
+    }
+
+    /**
+     * @brief Construct a callable in place, replacing any previous one
+     *
+     * @param fn Callable to store
+     */
+    template <typename F>
+    void emplace(F&& fn)
+    {
+        using Fn = decay_t<F>;
+        static_assert(sizeof(Fn) <= Capacity, "callable does not fit the inline buffer");
+        static_assert(alignof(Fn) <= alignof(max_align_t), "callable is over-aligned");
+
+        reset();
+        ::new (static_cast<void*>(_storage)) Fn(forward<F>(fn));
+        _invoke = [](void* p, Args&&... args) -> R {
+            return (*static_cast<Fn*>(p))(forward<Args>(args)...);
+        };
+        _destroy = [](void* p) {
+            static_cast<Fn*>(p)->~Fn();
+        };
+    }
+
+    void reset(void)
+    {
+        if (_destroy) {
+            _destroy(_storage);
+            _invoke = nullptr;
+            _destroy = nullptr;
+        }
+    }
+
+    explicit operator bool() const
+    {
+        return _invoke != nullptr;
+    }
+
+    R operator()(Args... args)
+    {
+        return _invoke(_storage, forward<Args>(args)...);
+    }
+};
+
+/**
+ * @brief TransactionManager with inline operation storage
+ *
+ * Same execute/commit/rollback semantics as TransactionManager, but holds
+ * at most MaxOps operations in place and never touches the heap. With a
+ * journal attached, steps that carry a JournalStep are logged ahead of
+ * execution so a crash leaves enough to compensate them.
+ *
+ * @tparam MaxOps Maximum number of operations
+ * @tparam Capacity Inline bytes available to each execute/rollback callable
+ */
+template <size_t MaxOps, size_t Capacity = 4 * sizeof(void*)>
+class InlineTransactionManager {
+private:
+    struct Operation {
+        InlineFunction<Status(), Capacity> execute;
+        InlineFunction<void(), Capacity> rollback;
+        JournalStep* step = nullptr;
+        bool executed = false;
+    };
+
+    Operation operations[MaxOps];
+    size_t count = 0;
+    bool committed = false;
+
+    TransactionJournal* journal = nullptr;
+    uint64_t txId = 0;
+    bool journalClosed = false;
+
+public:
+    InlineTransactionManager() = default;
+
+    /**
+     * @brief Create a transaction logged to a journal
+     *
+     * @param journal Journal to log to, or nullptr for none
+     */
+    explicit InlineTransactionManager(TransactionJournal* journal) : journal(journal)
+    {}
+
+    InlineTransactionManager(const InlineTransactionManager&) = delete;
+    InlineTransactionManager& operator=(const InlineTransactionManager&) = delete;
+
+    /**
+     * @brief Destructor automatically rolls back uncommitted transactions
+     */
+    ~InlineTransactionManager()
+    {
+        if (!committed) {
+            rollback();
+        }
+    }
+
+    /**
+     * @brief Add an operation to the transaction
+     *
+     * @param execute Function to execute the operation
+     * @param rollback Function to rollback the operation if needed
+     * @param step Journal description of the operation; must outlive the transaction
+     */
+    template <typename Exec, typename Roll>
+    Status addOperation(Exec&& execute, Roll&& rollback, JournalStep* step = nullptr)
+    {
+        if (count == MaxOps) {
+            return Status::error(Err::MemoryError);
+        }
+
+        Operation& op = operations[count++];
+        op.execute.emplace(forward<Exec>(execute));
+        op.rollback.emplace(forward<Roll>(rollback));
+        op.step = step;
+        op.executed = false;
+        return Status::okStatus();
+    }
+
+    /**
+     * @brief Execute all operations in the transaction
+     */
+    Status execute()
+    {
+        if (journal && txId == 0) {
+            // Intent and executed per step, plus the closing record
+            auto begun = journal->begin(2 * count + 1);
+            if (!begun.isOk()) {
+                return Status::error(begun.error());
+            }
+            txId = begun.value();
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            Operation& op = operations[i];
+            bool logged = journal && op.step;
+
+            if (logged) {
+                Status status = journal->intent(txId, (uint8_t)i, *op.step);
+                if (!status.isOk()) {
+                    return status;
+                }
+            }
+
+            Status status = op.execute();
+            if (!status.isOk()) {
+                return status;
+            }
+            op.executed = true;
+
+            if (logged) {
+                // Side effect is done; if it cannot be logged, undo it now
+                status = journal->executed(txId, (uint8_t)i, *op.step);
+                if (!status.isOk()) {
+                    return status;
+                }
+            }
+        }
+        return Status::okStatus();
+    }
+
+    /**
+     * @brief Commit the transaction
+     */
+    void commit()
+    {
+        committed = true;
+        if (journal && txId != 0 && !journalClosed) {
+            journalClosed = true;
+            (void)journal->commit(txId);
+        }
+    }
+
+    /**
+     * @brief Commit, leaving a follow-up step for journal recovery to settle
+     *
+     * For a transaction that stands but owes a step the caller could not
+     * complete; see TransactionJournal::defer().
+     *
+     * @param owed The step still owed
+     */
+    void commitDeferred(const JournalStep& owed)
+    {
+        committed = true;
+        if (journal && txId != 0 && !journalClosed) {
+            journalClosed = true;
+            (void)journal->defer(txId, (uint8_t)count, owed);
+        }
+    }
+
+    /**
+     * @brief Manually rollback all executed operations
+     */
+    void rollback()
+    {
+        // Rollback in reverse order
+        for (size_t i = count; i-- > 0;) {
+            if (operations[i].executed) {
+                try {
+                    operations[i].rollback();
+                } catch (...) {
+                }
+                operations[i].executed = false;
+            }
+        }
+
+        if (journal && txId != 0 && !journalClosed) {
+            journalClosed = true;
+            (void)journal->rolledBack(txId);
+        }
+    }
+};
@@ -1,13 +1,49 @@
 #pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 #include "Result.hpp"
+#include "InternedId.hpp"
 
 using namespace std;
 
-using Card = string;      // bank card id
-using Pin = string;       // PIN code
-using AccountId = string; // bank account id
+struct CardTag {};
+struct AccountTag {};
+
+using Card = InternedId<CardTag>;          // bank card id
+using Pin = string;                        // PIN code (never interned)
+using AccountId = InternedId<AccountTag>;  // bank account id
+using HoldId = uint64_t;  // funds hold id
+
+/**
+ * @brief Salted, hashed PIN reference for offline verification
+ *
+ * See OfflinePinVerifier::makeReference() for how the digest is derived.
+ */
+struct PinReference {
+    array<uint8_t, 16> salt{};
+    array<uint8_t, 32> digest{};
+    uint32_t rounds = 0;    ///< Hash iterations
+};
+
+/**
+ * @brief Deposit posted in a batch, identified by an idempotency key
+ */
+struct DepositPosting {
+    uint64_t key = 0;       ///< Unique per deposit; a repeated key must not be applied twice
+    AccountId accountId;
+    int money = 0;
+};
+
+/**
+ * @brief Balance of one of a card's accounts, as returned by IBank::getBalances()
+ */
+struct AccountBalance {
+    AccountId accountId;
+    Result<int> balance;
+};
 
 /**
  * @brief Interface for bank service operations
@@ -61,6 +97,94 @@ public:
      * @param money The amount to withdraw
      */
     virtual Status withdraw(const AccountId& accountId, int money) = 0;
+
+    /**
+     * @brief Reserve funds for a withdrawal in one round trip
+     * 
+     * The held amount is no longer available, but stays on the account
+     * until the hold is captured or released.
+     * 
+     * @param accountId The account to reserve funds on
+     * @param money The amount to reserve
+     */
+    virtual Result<HoldId> placeHold(const AccountId& accountId, int money) = 0;
+
+    /**
+     * @brief Settle a hold, debiting the reserved funds
+     * 
+     * @param holdId The hold returned by placeHold()
+     */
+    virtual Status captureHold(HoldId holdId) = 0;
+
+    /**
+     * @brief Cancel a hold, making the reserved funds available again
+     * 
+     * @param holdId The hold returned by placeHold()
+     */
+    virtual Status releaseHold(HoldId holdId) = 0;
+
+    /**
+     * @brief True if postDeposits() applies each key at most once
+     * 
+     * Only then may a batch be resent after a lost reply or a per-deposit
+     * NetworkError. The default postDeposits() cannot detect resent keys.
+     */
+    virtual bool keyedDeposits(void) const
+    {
+        return false;
+    }
+
+    /**
+     * @brief Post several deposits in one round trip
+     * 
+     * Banks that support batching apply each key at most once (see
+     * keyedDeposits()). The default posts the deposits one by one; a
+     * NetworkError entry then means the deposit may or may not have been
+     * applied, and resending it could credit it twice.
+     * 
+     * @param batch Deposits to post
+     * @return One status per deposit, in batch order
+     */
+    virtual vector<Status> postDeposits(const vector<DepositPosting>& batch)
+    {
+        vector<Status> statuses;
+        statuses.reserve(batch.size());
+        for (const DepositPosting& posting : batch)
+        {
+            try {
+                statuses.push_back(deposit(posting.accountId, posting.money));
+            }
+            catch (...) {
+                statuses.push_back(Status::error(Err::NetworkError));
+            }
+        }
+        return statuses;
+    }
+
+    /**
+     * @brief Retrieve a card's accounts and their balances in one round trip
+     * 
+     * The default asks listAccounts() and then getBalance() per account.
+     * Fails like listAccounts() (by throwing) when the accounts cannot be
+     * listed; a balance that cannot be read is reported in its entry.
+     * 
+     * @param card The card id to query
+     * @return One entry per account, in listAccounts() order
+     */
+    virtual vector<AccountBalance> getBalances(const Card& card)
+    {
+        vector<AccountBalance> balances;
+        for (const AccountId& accountId : listAccounts(card))
+        {
+            try {
+                balances.push_back({ accountId, getBalance(accountId) });
+            }
+            catch (...) {
+                balances.push_back({ accountId, Result<int>(Err::NetworkError) });
+            }
+        }
+        return balances;
+    }
 };
 
 /**
@@ -79,6 +203,14 @@ public:
      * @brief Eject the card
      */
     virtual Status eject(void) = 0;
+
+    /**
+     * @brief PIN reference delivered with the last card read, if the card carries one
+     */
+    virtual optional<PinReference> pinReference(void)
+    {
+        return nullopt;
+    }
 };
 
 /**
@@ -0,0 +1,179 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief Canonical copy of an interned string, shared by its handles
+ */
+struct InternedString {
+    string value;
+    size_t hash = 0;           ///< String hash, computed once when interned
+    atomic<size_t> refs{ 0 };  ///< Handles pointing here
+    size_t stripe = 0;         ///< Intern table stripe holding the string
+    bool pinned = false;       ///< Never counted or freed (the empty string)
+};
+
+/**
+ * @brief Returns the canonical copy of a string from the global intern table,
+ * holding one reference to it for the caller
+ *
+ * The table is safe to use from any thread. A string is dropped from the
+ * table when releaseString() gives back its last reference.
+ */
+const InternedString* internString(const string& value);
+
+/**
+ * @brief The canonical empty string; handles to it are not counted
+ */
+const InternedString* emptyString(void) noexcept;
+
+/**
+ * @brief Give back a reference taken by internString() or retainString()
+ */
+void releaseString(const InternedString* value) noexcept;
+
+/**
+ * @brief Number of strings currently in the intern table
+ */
+size_t internedStrings(void);
+
+/**
+ * @brief Take another reference to an interned string
+ */
+inline void retainString(const InternedString* value) noexcept
+{
+    if (!value->pinned)
+    {
+        const_cast<InternedString*>(value)->refs.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Pointer-sized handle to an interned identifier string
+ *
+ * Construction from a string interns it once; equality is then an O(1)
+ * pointer comparison, hashing returns the string hash stored at intern
+ * time, and a copy bumps a reference count. The
+ * string is freed with its last handle, so ids (card numbers included) do
+ * not outlive the sessions using them. The Tag keeps card and account ids
+ * from being mixed up. Never use it for secrets such as PINs.
+ */
+template <typename Tag>
+class InternedId {
+private:
+    const InternedString* _value;
+
+public:
+    InternedId() noexcept : _value(emptyString())
+    {}
+
+    InternedId(const string& value) : _value(internString(value))
+    {}
+
+    InternedId(const char* value) : _value(internString(value))
+    {}
+
+    InternedId(const InternedId& other) noexcept : _value(other._value)
+    {
+        retainString(_value);
+    }
+
+    InternedId(InternedId&& other) noexcept : _value(other._value)
+    {
+        other._value = emptyString();
+    }
+
+    InternedId& operator=(const InternedId& other) noexcept
+    {
+        retainString(other._value);
+        releaseString(_value);
+        _value = other._value;
+        return *this;
+    }
+
+    InternedId& operator=(InternedId&& other) noexcept
+    {
+        swap(_value, other._value);
+        return *this;
+    }
+
+    ~InternedId()
+    {
+        releaseString(_value);
+    }
+
+    const string& str(void) const
+    {
+        return _value->value;
+    }
+
+    const char* c_str(void) const
+    {
+        return _value->value.c_str();
+    }
+
+    size_t size(void) const
+    {
+        return _value->value.size();
+    }
+
+    bool empty(void) const
+    {
+        return _value->value.empty();
+    }
+
+    /**
+     * @brief Hash of the string, equal for equal ids
+     */
+    size_t hash(void) const noexcept
+    {
+        return _value->hash;
+    }
+
+    /**
+     * @brief Address of the canonical string; equal ids share it
+     */
+    const void* raw(void) const
+    {
+        return _value;
+    }
+
+    friend bool operator==(const InternedId& a, const InternedId& b)
+    {
+        return a._value == b._value;
+    }
+
+    friend bool operator!=(const InternedId& a, const InternedId& b)
+    {
+        return a._value != b._value;
+    }
+
+    /**
+     * @brief Lexicographic order, for sorted containers and stable output
+     */
+    friend bool operator<(const InternedId& a, const InternedId& b)
+    {
+        return a._value != b._value && a._value->value < b._value->value;
+    }
+
+    friend ostream& operator<<(ostream& os, const InternedId& id)
+    {
+        return os << id._value->value;
+    }
+};
+
+namespace std {
+    template <typename Tag>
+    struct hash<InternedId<Tag>> {
+        size_t operator()(const InternedId<Tag>& id) const noexcept
+        {
+            // Not the address: its low bits are the same for every node
+            return id.hash();
+        }
+    };
+}
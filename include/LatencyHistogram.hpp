@@ -0,0 +1,169 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+/**
+ * @brief Cheap monotonic tick source for latency measurements
+ *
+ * Reads the CPU timestamp counter where available and the steady clock
+ * elsewhere. Convert tick differences with nsPerTick(), which is
+ * calibrated once per process.
+ */
+namespace TickClock {
+    /**
+     * @brief Nanoseconds since an arbitrary epoch from the steady clock
+     */
+    uint64_t steadyNs(void);
+
+    inline uint64_t now(void)
+    {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return steadyNs();
+#endif
+    }
+
+    /**
+     * @brief Nanoseconds per tick of now()
+     */
+    double nsPerTick(void);
+}
+
+/**
+ * @brief Log2-bucketed latency histogram
+ *
+ * Bucket 0 counts zero durations and bucket b counts durations in
+ * [2^(b-1), 2^b) nanoseconds; the last bucket also takes everything longer.
+ * Recording is a handful of relaxed stores: it allows one writer at a time,
+ * while any thread may take snapshots.
+ */
+class LatencyHistogram {
+public:
+    static const size_t kBuckets = 40;
+
+    /**
+     * @brief Point-in-time copy that can be merged and queried
+     */
+    struct Snapshot {
+        array<uint64_t, kBuckets> buckets{};
+        uint64_t count = 0;
+        uint64_t sumNs = 0;
+        uint64_t maxNs = 0;
+
+        void merge(const Snapshot& other)
+        {
+            for (size_t b = 0; b < kBuckets; ++b) {
+                buckets[b] += other.buckets[b];
+            }
+            count += other.count;
+            sumNs += other.sumNs;
+            maxNs = max(maxNs, other.maxNs);
+        }
+
+        double meanNs(void) const
+        {
+            return count ? double(sumNs) / double(count) : 0.0;
+        }
+
+        /**
+         * @brief Upper bound of the bucket holding the p-th quantile
+         *
+         * @param p Quantile in [0, 1]
+         */
+        uint64_t percentileNs(double p) const
+        {
+            if (!count) {
+                return 0;
+            }
+
+            uint64_t rank = uint64_t(p * double(count - 1)) + 1;
+            uint64_t seen = 0;
+            for (size_t b = 0; b < kBuckets; ++b) {
+                seen += buckets[b];
+                if (seen >= rank) {
+                    return min(upperBoundNs(b), maxNs);
+                }
+            }
+            return maxNs;
+        }
+    };
+
+private:
+    atomic<uint64_t> _buckets[kBuckets] = {};
+    atomic<uint64_t> _count{ 0 };
+    atomic<uint64_t> _sumNs{ 0 };
+    atomic<uint64_t> _maxNs{ 0 };
+
+    static void bump(atomic<uint64_t>& counter, uint64_t by)
+    {
+        // Single writer: a plain load/store pair, no locked read-modify-write
+        counter.store(counter.load(memory_order_relaxed) + by, memory_order_relaxed);
+    }
+
+public:
+    static size_t bucketOf(uint64_t ns)
+    {
+        size_t bits = 0;
+#if defined(__GNUC__) || defined(__clang__)
+        bits = ns ? size_t(64 - __builtin_clzll(ns)) : 0;
+#else
+        while (ns) {
+            ++bits;
+            ns >>= 1;
+        }
+#endif
+        return min(bits, kBuckets - 1);
+    }
+
+    static uint64_t upperBoundNs(size_t bucket)
+    {
+        return bucket ? (uint64_t(1) << bucket) - 1 : 0;
+    }
+
+    void record(uint64_t ns)
+    {
+        bump(_buckets[bucketOf(ns)], 1);
+        bump(_count, 1);
+        bump(_sumNs, ns);
+        if (ns > _maxNs.load(memory_order_relaxed)) {
+            _maxNs.store(ns, memory_order_relaxed);
+        }
+    }
+
+    Snapshot snapshot(void) const
+    {
+        Snapshot s;
+        for (size_t b = 0; b < kBuckets; ++b) {
+            s.buckets[b] = _buckets[b].load(memory_order_relaxed);
+        }
+        s.count = _count.load(memory_order_relaxed);
+        s.sumNs = _sumNs.load(memory_order_relaxed);
+        s.maxNs = _maxNs.load(memory_order_relaxed);
+        return s;
+    }
+
+    /**
+     * @brief Zero all counters; records racing with the reset may survive it
+     */
+    void reset(void)
+    {
+        for (auto& b : _buckets) {
+            b.store(0, memory_order_relaxed);
+        }
+        _count.store(0, memory_order_relaxed);
+        _sumNs.store(0, memory_order_relaxed);
+        _maxNs.store(0, memory_order_relaxed);
+    }
+};
@@ -0,0 +1,220 @@
+#pragma once
+#include "Interfaces.hpp"
+#include "MappedFile.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Persistent local bank backed by memory-mapped files
+ *
+ * Balances live in an open-addressing table inside a snapshot file, mapped
+ * copy-on-write, so opening a ledger with millions of accounts maps the
+ * table instead of reading it and pages come in on first use. Every change
+ * is appended to a log before it is acknowledged; concurrent writers share
+ * one sync of the log (group commit). A background thread periodically
+ * writes the table to the other of two snapshot files and resets the log,
+ * so open() only replays the records written since the last snapshot.
+ *
+ * Files: path.snap0, path.snap1 and path.log. A snapshot counts once its
+ * header is synced after its data, so a crash while writing one leaves the
+ * previous snapshot and the log in charge.
+ *
+ * The table is sized for Config::capacity accounts when the ledger is
+ * created and never grows. Account ids are limited to 47 bytes. Cards are
+ * not persisted; register them with addCard() after open(). PINs are kept
+ * only as salted, iterated hashes and checked in constant time. Writers
+ * are serialized and readers share a lock; a snapshot holds the lock
+ * exclusively for the length of a table copy and sync, so it blocks
+ * readers as well as writers.
+ */
+class LedgerBank : public IBank {
+public:
+    /**
+     * @brief Ledger configuration
+     *
+     * capacity, holds and postingKeys apply when the ledger is created; an
+     * existing ledger keeps the sizes it was created with.
+     */
+    struct Config {
+        size_t capacity = 1 << 20;                  ///< Most accounts
+        size_t holds = 4096;                        ///< Most open holds
+        size_t postingKeys = 65536;                 ///< Recent deposit keys remembered by postDeposits()
+        size_t logRecords = 1 << 16;                ///< Records the log holds
+        size_t snapshotRecords = 1 << 15;           ///< Log fill that triggers a snapshot
+        chrono::seconds snapshotInterval{ 300 };    ///< Longest time between snapshots while writing
+        bool syncEachWrite = true;                  ///< Acknowledge writes once their record is on stable storage
+        uint32_t pinRounds = 1024;                  ///< Hash iterations of the PIN references addCard() stores
+    };
+
+    /**
+     * @brief Ledger counters since open()
+     */
+    struct Stats {
+        uint64_t replayed = 0;      ///< Log records applied by open()
+        uint64_t records = 0;       ///< Log records appended
+        uint64_t syncs = 0;         ///< Log syncs; below records when writes share them
+        uint64_t snapshots = 0;
+    };
+
+private:
+    struct Hold {
+        uint32_t slot;
+        int amount;
+    };
+
+    MappedFile _table;                  // live accounts: private view of the newest snapshot
+    MappedFile _log;
+    string _path;
+    Config _cfg;
+    uint32_t _current = 0;              // snapshot file the table maps
+    size_t _slots = 0;                  // account slots, a power of two
+    size_t _holdCapacity = 0;
+    size_t _keyCapacity = 0;
+    size_t _logCapacity = 0;
+    uint32_t _generation = 0;           // log generation; bumped when the log is reset
+
+    mutable shared_mutex _mutex;        // table, holds, keys and log tail
+    size_t _accounts = 0;
+    unordered_map<HoldId, Hold> _holds;
+    unordered_set<uint64_t> _keys;      // deposit keys already applied
+    deque<uint64_t> _keyOrder;          // the same keys, oldest first
+    uint64_t _seq = 0;                  // last record appended
+    uint64_t _snapshotSeq = 0;          // last record in the newest snapshot
+    size_t _tail = 0;                   // next log slot
+    bool _snapshotAsked = false;
+    Stats _stats;
+
+    mutex _syncMutex;                   // group commit leader and snapshots; taken before _mutex
+    size_t _syncedTail = 0;
+    uint64_t _syncedSeq = 0;
+
+    mutable shared_mutex _cardMutex;
+    unordered_map<Card, PinReference> _pins;
+    unordered_map<Card, vector<AccountId>> _cards;
+    mt19937_64 _random{ random_device{}() };   // PIN salts; guarded by _cardMutex
+
+    mutex _wakeMutex;
+    condition_variable _wake;
+    bool _snapshotDue = false;
+    bool _stopping = false;
+    thread _snapshotter;
+
+    string snapshotPath(uint32_t index) const;
+    size_t snapshotBytes(void) const;
+    size_t find(const AccountId& accountId) const;
+    uint64_t appendLocked(uint8_t type, uint32_t slot, int amount, uint64_t arg, const char* account);
+    void applyLocked(uint64_t seq, uint8_t type, uint32_t slot, int amount, uint64_t arg, const char* account);
+    void rememberLocked(uint64_t key);
+    bool reserveLocked(unique_lock<shared_mutex>& lock);
+    Status durable(uint64_t seq);
+    Status syncLogLocked(void);
+    void run(void);
+
+public:
+    LedgerBank() = default;
+
+    LedgerBank(const LedgerBank&) = delete;
+    LedgerBank& operator=(const LedgerBank&) = delete;
+
+    /**
+     * @brief Sync the log and close the files
+     */
+    ~LedgerBank();
+
+    /**
+     * @brief Open or create a ledger with default settings
+     *
+     * @param path Ledger file prefix
+     */
+    Status open(const string& path);
+
+    /**
+     * @brief Open or create a ledger and start the snapshot thread
+     *
+     * Maps the newest complete snapshot and replays the log records written
+     * after it; a torn record ends the replay.
+     *
+     * @param path Ledger file prefix
+     * @param cfg Ledger configuration
+     */
+    Status open(const string& path, const Config& cfg);
+
+    /**
+     * @brief Stop the snapshot thread, sync the log and close the files
+     *
+     * The next open() replays what was written since the last snapshot.
+     */
+    void close(void);
+
+    bool isOpen(void) const
+    {
+        return _log.isOpen();
+    }
+
+    /**
+     * @brief Open an account
+     *
+     * Fails with InvalidArg for a known account, a negative balance or an
+     * id longer than 47 bytes, and with MemoryError when the ledger is full.
+     *
+     * @param accountId New account id
+     * @param balance Initial balance
+     */
+    Status addAccount(const AccountId& accountId, int balance);
+
+    /**
+     * @brief Register a card with its PIN and accounts (kept in memory only)
+     *
+     * Only a salted reference of the PIN is kept (see OfflinePinVerifier).
+     *
+     * @param card Card id
+     * @param pin PIN code of the card
+     * @param accounts Accounts reachable with the card
+     */
+    Status addCard(const Card& card, const Pin& pin, const vector<AccountId>& accounts);
+
+    /**
+     * @brief Write the table to a snapshot file now and reset the log
+     *
+     * Does nothing if no record was written since the last snapshot. If the
+     * log cannot be reset, the log is kept as it was and the error is
+     * returned; the new snapshot stays in use.
+     */
+    Status snapshot(void);
+
+    /**
+     * @brief Force every appended record to stable storage
+     */
+    Status flush(void);
+
+    /**
+     * @brief Number of accounts
+     */
+    size_t size(void) const;
+
+    Stats stats(void);
+
+    Status verifyPin(const Card& card, const Pin& pin) override;
+    vector<AccountId> listAccounts(const Card& card) override;
+    Result<int> getBalance(const AccountId& accountId) override;
+    Status deposit(const AccountId& accountId, int money) override;
+    Status canWithdraw(const AccountId& accountId, int money) override;
+    Status withdraw(const AccountId& accountId, int money) override;
+    Result<HoldId> placeHold(const AccountId& accountId, int money) override;
+    Status captureHold(HoldId holdId) override;
+    Status releaseHold(HoldId holdId) override;
+    vector<Status> postDeposits(const vector<DepositPosting>& batch) override;
+    bool keyedDeposits(void) const override;
+};
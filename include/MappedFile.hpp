@@ -0,0 +1,97 @@
+#pragma once
+#include "Result.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief File mapped into memory
+ *
+ * Used for the journal, snapshot and ledger files. The file is created or
+ * grown to the requested size on open.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief How changes to the mapping reach the file
+     */
+    enum class Mode {
+        ReadWrite,    ///< Writes go to the file
+        CopyOnWrite   ///< Writes stay private to this process
+    };
+
+private:
+    uint8_t* _data = nullptr;
+    size_t _size = 0;
+#if defined(_WIN32)
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#else
+    int _fd = -1;
+#endif
+
+public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    ~MappedFile();
+
+    /**
+     * @brief Map a file, creating or growing it to at least minSize bytes
+     *
+     * A larger existing file is mapped whole.
+     *
+     * @param path File to map
+     * @param minSize Minimum mapped size in bytes
+     * @param mode Whether writes reach the file
+     */
+    Status open(const string& path, size_t minSize, Mode mode = Mode::ReadWrite);
+
+    /**
+     * @brief Unmap and close the file
+     */
+    void close(void);
+
+    /**
+     * @brief Flush a byte range of the mapping to stable storage
+     *
+     * @param offset First byte to flush
+     * @param length Number of bytes to flush
+     */
+    Status sync(size_t offset, size_t length);
+
+    /**
+     * @brief Flush the whole mapping to stable storage
+     */
+    Status sync(void)
+    {
+        return sync(0, _size);
+    }
+
+    bool isOpen(void) const
+    {
+        return _data != nullptr;
+    }
+
+    uint8_t* data(void)
+    {
+        return _data;
+    }
+
+    const uint8_t* data(void) const
+    {
+        return _data;
+    }
+
+    size_t size(void) const
+    {
+        return _size;
+    }
+};
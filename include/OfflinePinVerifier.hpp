@@ -0,0 +1,110 @@
+#pragma once
+#include "Interfaces.hpp"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * @brief Verifies PINs locally against salted, hashed references
+ *
+ * A reference either comes with the card read (issuer-provided, like an
+ * EMV offline PIN) or is cached here after a successful online
+ * verification. Only hashes are kept, never PINs, and digests are compared
+ * in constant time.
+ *
+ * An issuer reference is authoritative. A cached reference can only
+ * confirm a PIN: it may be stale after a PIN change, so a mismatch is
+ * reported as Unknown and the caller verifies online. Cached references
+ * expire after a TTL, which bounds how long a card blocked at the bank
+ * can still pass offline (its transactions still need the bank).
+ * Safe to share between controllers.
+ */
+class OfflinePinVerifier {
+public:
+    /**
+     * @brief Result of an offline check
+     */
+    enum class Verdict {
+        Match,      ///< PIN is correct
+        Mismatch,   ///< PIN is wrong (issuer reference only)
+        Unknown     ///< No usable reference: verify online
+    };
+
+    /**
+     * @brief Verifier configuration
+     */
+    struct Config {
+        size_t capacity = 10000;                 ///< Cached references kept
+        chrono::seconds ttl{ 600 };              ///< Lifetime of a cached reference
+        uint32_t rounds = 1024;                  ///< Hash iterations for cached references
+    };
+
+    /**
+     * @brief Offline check counters
+     */
+    struct Stats {
+        uint64_t matches = 0;
+        uint64_t mismatches = 0;
+        uint64_t unknown = 0;
+    };
+
+private:
+    struct Entry {
+        PinReference reference;
+        chrono::steady_clock::time_point expires;
+    };
+
+    Config _cfg;
+    mutable mutex _mutex;
+    unordered_map<Card, Entry> _cache;
+    mt19937_64 _random;
+    Stats _stats;
+
+    PinReference makeSaltedReference(const Card& card, const Pin& pin);
+
+public:
+    OfflinePinVerifier();
+    explicit OfflinePinVerifier(const Config& cfg);
+
+    /**
+     * @brief Derive a reference: SHA-256 over salt, card and PIN, iterated
+     *
+     * @param card Card the PIN belongs to
+     * @param pin PIN code
+     * @param salt Random salt
+     * @param rounds Hash iterations (at least one)
+     */
+    static PinReference makeReference(const Card& card, const Pin& pin,
+                                      const array<uint8_t, 16>& salt, uint32_t rounds);
+
+    /**
+     * @brief True if pin matches the reference; runs in time independent of the PIN
+     */
+    static bool matches(const PinReference& reference, const Card& card, const Pin& pin);
+
+    /**
+     * @brief Check a PIN offline
+     *
+     * @param card Inserted card
+     * @param pin Entered PIN
+     * @param issuer Reference delivered with the card, if any
+     */
+    Verdict verify(const Card& card, const Pin& pin, const optional<PinReference>& issuer);
+
+    /**
+     * @brief Cache a reference for a PIN the bank just accepted
+     */
+    void remember(const Card& card, const Pin& pin);
+
+    /**
+     * @brief Drop the cached reference of a card
+     */
+    void forget(const Card& card);
+
+    Stats stats(void) const;
+};
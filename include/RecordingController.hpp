@@ -0,0 +1,145 @@
+#pragma once
+#include "Controller.hpp"
+#include "SessionTrace.hpp"
+
+using namespace std;
+
+/**
+ * @brief Controller that records its operations and device responses
+ *
+ * Wraps the card reader, bank and cash bin in recording decorators and
+ * forwards every operation to an inner Controller, appending the
+ * arguments, results, device responses and timings to a SessionTrace that
+ * SessionReplayer can run again. Not thread-safe, like Controller itself.
+ * Config::prefetch is ignored: answers fetched on a pool thread could not
+ * be recorded in operation order.
+ */
+class RecordingController {
+private:
+    class Recorder;
+
+    class CardReader : public ICardReader {
+    private:
+        ICardReader& _inner;
+        Recorder& _recorder;
+
+    public:
+        CardReader(ICardReader& inner, Recorder& recorder) : _inner(inner), _recorder(recorder)
+        {}
+
+        Result<Card> read(void) override;
+        Status eject(void) override;
+
+        optional<PinReference> pinReference(void) override
+        {
+            return _inner.pinReference();
+        }
+    };
+
+    class Bank : public IBank {
+    private:
+        IBank& _inner;
+        Recorder& _recorder;
+
+    public:
+        Bank(IBank& inner, Recorder& recorder) : _inner(inner), _recorder(recorder)
+        {}
+
+        Status verifyPin(const Card& card, const Pin& pin) override;
+        vector<AccountId> listAccounts(const Card& card) override;
+        Result<int> getBalance(const AccountId& accountId) override;
+        Status deposit(const AccountId& accountId, int money) override;
+        Status canWithdraw(const AccountId& accountId, int money) override;
+        Status withdraw(const AccountId& accountId, int money) override;
+        Result<HoldId> placeHold(const AccountId& accountId, int money) override;
+        Status captureHold(HoldId holdId) override;
+        Status releaseHold(HoldId holdId) override;
+        vector<Status> postDeposits(const vector<DepositPosting>& batch) override;
+
+        bool keyedDeposits(void) const override
+        {
+            return _inner.keyedDeposits();
+        }
+    };
+
+    class CashBin : public ICashBin {
+    private:
+        ICashBin& _inner;
+        Recorder& _recorder;
+
+    public:
+        CashBin(ICashBin& inner, Recorder& recorder) : _inner(inner), _recorder(recorder)
+        {}
+
+        Status canDispense(int money) override;
+        Status dispense(int money) override;
+    };
+
+    /**
+     * @brief Appends records to the trace and times device calls
+     */
+    class Recorder {
+    private:
+        SessionTrace& _trace;
+        double _nsPerTick;
+        bool _inOperation = false;
+
+    public:
+        explicit Recorder(SessionTrace& trace);
+
+        template <typename F>
+        auto device(ControllerMetrics::Call call, F&& f) -> decltype(f());
+
+        template <typename F>
+        auto operation(ControllerMetrics::Op op, int64_t money, const string& account, F&& f) -> decltype(f());
+    };
+
+    SessionTrace _trace;
+    Recorder _recorder;
+    CardReader _cardReader;
+    Bank _bank;
+    CashBin _cashBin;
+    Controller _controller;
+
+public:
+    /**
+     * @brief Record a controller over the given devices
+     *
+     * @param cardReader Hardware interface for card operations
+     * @param bank Service interface for banking operations
+     * @param cashBin Hardware interface for cash dispensing
+     * @param cfg ATM configuration of the inner controller
+     */
+    RecordingController(ICardReader& cardReader, IBank& bank, ICashBin& cashBin,
+                        const Controller::Config& cfg = Controller::Config());
+
+    RecordingController(const RecordingController&) = delete;
+    RecordingController& operator=(const RecordingController&) = delete;
+
+    Controller::State state(void) const
+    {
+        return _controller.state();
+    }
+
+    Status insertCard(void);
+    Status ejectCard(void);
+    Status enterPin(const Pin& pin);
+    Result<vector<AccountId>> listAccounts(void);
+    Status selectAccount(const AccountId& accountId);
+    Result<int> getBalance(void);
+    Status deposit(int money);
+    Status withdraw(int money);
+
+    /**
+     * @brief Everything recorded so far
+     */
+    const SessionTrace& trace(void) const
+    {
+        return _trace;
+    }
+
+    /**
+     * @brief Hand over the recording and start a new one
+     */
+    SessionTrace takeTrace(void);
+};
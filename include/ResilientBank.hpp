@@ -0,0 +1,142 @@
+#pragma once
+#include "Interfaces.hpp"
+#include "LatencyHistogram.hpp"
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+
+using namespace std;
+
+/**
+ * @brief IBank decorator adding deadlines, retries and hedged reads
+ *
+ * Every call runs on the pool while the caller waits at most until the
+ * call's deadline. Reads (listAccounts, getBalance, getBalances,
+ * canWithdraw) are retried after a transport failure, an Err::NetworkError
+ * or an attempt timeout, with jittered exponential backoff; so is
+ * postDeposits when the inner bank applies each idempotency key once.
+ * verifyPin is retried only after the bank answered Err::NetworkError: a
+ * lost or late attempt may still count a wrong PIN. Other calls that move
+ * money get a single attempt: after a timeout their outcome at the bank is
+ * unknown and only the bank can settle it. A hold placed by an attempt that
+ * answered too late is released by that attempt's task.
+ *
+ * With hedging on, a second getBalance, getBalances or listAccounts request
+ * is sent when the first has not answered within the observed p95 latency,
+ * and the first answer wins. A call that runs out of time fails with
+ * Err::NetworkError; listAccounts, getBalances and postDeposits, which
+ * have no single error channel, throw runtime_error instead, which
+ * Controller translates to the same error.
+ *
+ * Abandoned attempts finish in the background, so the inner bank and the
+ * pool must outlive the decorator's last call. The pool needs two workers
+ * per concurrent caller for hedging. Safe to share between controllers
+ * when the inner bank is.
+ */
+class ResilientBank : public IBank {
+public:
+    /**
+     * @brief Deadline, retry and hedging policy
+     */
+    struct Config {
+        chrono::milliseconds deadline{ 2000 };       ///< Budget of one call, retries included
+        chrono::milliseconds attemptTimeout{ 800 };  ///< Budget of one attempt
+        int maxAttempts = 3;                         ///< Attempts of an idempotent call
+        chrono::milliseconds backoff{ 10 };          ///< Backoff before the first retry, doubled per retry
+        chrono::milliseconds maxBackoff{ 200 };      ///< Backoff cap; the wait is uniform in [0, backoff]
+        bool hedgeReads = false;                     ///< Hedge getBalance, getBalances and listAccounts
+        chrono::milliseconds hedgeDelay{ 50 };       ///< Hedge delay until enough latencies are known
+        uint64_t hedgeMinSamples = 32;               ///< Latencies needed before hedging after the p95
+    };
+
+    /**
+     * @brief Counters since construction
+     */
+    struct Stats {
+        uint64_t calls = 0;
+        uint64_t retries = 0;
+        uint64_t timeouts = 0;      ///< Attempts abandoned at their timeout
+        uint64_t hedges = 0;        ///< Duplicate reads sent
+        uint64_t hedgeWins = 0;     ///< Duplicate reads that answered first
+    };
+
+    /**
+     * @brief Calls whose latencies drive the hedge delay
+     */
+    enum class Read { ListAccounts, GetBalance, GetBalances };
+
+private:
+    IBank& _inner;
+    ThreadPool& _pool;
+    Config _cfg;
+
+    mutable mutex _mutex;               // Guards the histograms and the backoff jitter
+    LatencyHistogram _latency[3];
+    mt19937_64 _random;
+
+    atomic<uint64_t> _calls{ 0 };
+    atomic<uint64_t> _retries{ 0 };
+    atomic<uint64_t> _timeouts{ 0 };
+    atomic<uint64_t> _hedges{ 0 };
+    atomic<uint64_t> _hedgeWins{ 0 };
+
+    /**
+     * @brief Failures after which a call is sent again
+     */
+    enum class Resend {
+        Never,      ///< One attempt
+        Answered,   ///< After an Err::NetworkError answer only
+        Always      ///< Also after a transport failure or an attempt timeout
+    };
+
+    /**
+     * @brief Run fn on the pool under the deadline, retry and hedging policy
+     *
+     * @param resend Failures after which fn is sent again
+     * @param read Read whose latencies drive hedging, or nullptr to never hedge
+     * @param fn Bank call, copied into each attempt's task
+     * @param orphan Undo, called by the task with the inner bank for a value
+     *               that arrived after the caller gave up on its attempt
+     */
+    template <typename T, typename F>
+    T call(Resend resend, const Read* read, F&& fn, void (*orphan)(IBank&, T&) = nullptr);
+
+    chrono::nanoseconds backoff(int retry);
+
+public:
+    ResilientBank(IBank& inner, ThreadPool& pool);
+    ResilientBank(IBank& inner, ThreadPool& pool, const Config& cfg);
+
+    ResilientBank(const ResilientBank&) = delete;
+    ResilientBank& operator=(const ResilientBank&) = delete;
+
+    Status verifyPin(const Card& card, const Pin& pin) override;
+    vector<AccountId> listAccounts(const Card& card) override;
+    Result<int> getBalance(const AccountId& accountId) override;
+    Status deposit(const AccountId& accountId, int money) override;
+    Status canWithdraw(const AccountId& accountId, int money) override;
+    Status withdraw(const AccountId& accountId, int money) override;
+    Result<HoldId> placeHold(const AccountId& accountId, int money) override;
+    Status captureHold(HoldId holdId) override;
+    Status releaseHold(HoldId holdId) override;
+    vector<Status> postDeposits(const vector<DepositPosting>& batch) override;
+    vector<AccountBalance> getBalances(const Card& card) override;
+
+    bool keyedDeposits(void) const override
+    {
+        return _inner.keyedDeposits();
+    }
+
+    /**
+     * @brief Current hedge delay of a read
+     *
+     * The observed p95, rounded up to its histogram bucket, or
+     * Config::hedgeDelay until hedgeMinSamples answers were seen.
+     */
+    chrono::nanoseconds hedgeDelay(Read read) const;
+
+    Stats stats(void) const;
+};
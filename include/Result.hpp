@@ -1,9 +1,12 @@
 #pragma once
-#include <optional>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 using namespace std;
 
-enum class Err {
+enum class Err : uint8_t {
     None = 0,
     InvalidState,
     InvalidArg,
@@ -22,7 +25,7 @@ enum class Err {
 /**
  * @brief Status wrapper for operations that don't return values
  */
-struct Status {
+struct [[nodiscard]] Status {
     Err code = Err::None;
     
     bool isOk(void) const
@@ -41,46 +44,271 @@ struct Status {
     }
 };
 
+template <typename T>
+class Result;
+
+namespace detail {
+    template <typename T>
+    struct IsResult : false_type {};
+
+    template <typename T>
+    struct IsResult<Result<T>> : true_type {};
+
+    /**
+     * @brief Value-or-error storage for trivially copyable values
+     *
+     * Copies, moves and destruction stay trivial, so Result<int> and friends
+     * are passed in registers like a plain struct.
+     */
+    template <typename T, bool Trivial = is_trivially_copyable<T>::value>
+    struct ResultStorage {
+        union {
+            T _v;
+            char _none;
+        };
+        Err _e;
+
+        ResultStorage(const T& value) : _v(value), _e(Err::None)
+        {}
+
+        ResultStorage(T&& value) : _v(move(value)), _e(Err::None)
+        {}
+
+        ResultStorage(Err error) : _none(), _e(error)
+        {}
+    };
+
+    /**
+     * @brief Value-or-error storage that constructs and destroys T by hand
+     */
+    template <typename T>
+    struct ResultStorage<T, false> {
+        union {
+            T _v;
+            char _none;
+        };
+        Err _e;
+
+        ResultStorage(const T& value) : _v(value), _e(Err::None)
+        {}
+
+        ResultStorage(T&& value) : _v(move(value)), _e(Err::None)
+        {}
+
+        ResultStorage(Err error) : _none(), _e(error)
+        {}
+
+        ResultStorage(const ResultStorage& other) : _none(), _e(other._e)
+        {
+            if (_e == Err::None) new (&_v) T(other._v);
+        }
+
+        ResultStorage(ResultStorage&& other) noexcept(is_nothrow_move_constructible<T>::value)
+         : _none(), _e(other._e)
+        {
+            if (_e == Err::None) new (&_v) T(move(other._v));
+        }
+
+        ResultStorage& operator=(const ResultStorage& other)
+        {
+            if (this != &other)
+            {
+                if (_e == Err::None && other._e == Err::None)
+                {
+                    _v = other._v;
+                }
+                else
+                {
+                    destroy();
+                    if (other._e == Err::None) new (&_v) T(other._v);
+                    _e = other._e;
+                }
+            }
+            return *this;
+        }
+
+        ResultStorage& operator=(ResultStorage&& other) noexcept(is_nothrow_move_assignable<T>::value
+                                                                 && is_nothrow_move_constructible<T>::value)
+        {
+            if (this != &other)
+            {
+                if (_e == Err::None && other._e == Err::None)
+                {
+                    _v = move(other._v);
+                }
+                else
+                {
+                    destroy();
+                    if (other._e == Err::None) new (&_v) T(move(other._v));
+                    _e = other._e;
+                }
+            }
+            return *this;
+        }
+
+        ~ResultStorage()
+        {
+            destroy();
+        }
+
+    private:
+        void destroy(void)
+        {
+            if (_e == Err::None) _v.~T();
+        }
+    };
+}
+
 /**
  * @brief Result class that can hold either a value or an error
  * 
+ * The value and the error share storage, so a Result is the size of T plus
+ * one byte (rounded up to T's alignment), and it is trivially copyable
+ * whenever T is.
+ * 
  * Usage:
  *  - Check success with isOk()
- *  - Get value with value() (when isOk() is true)
+ *  - Get value with value() (when isOk() is true); on an rvalue Result,
+ *    value() and take() move the value out instead of copying it
  *  - Get error with error() (when isOk() is false)
+ *  - Chain with and_then() / map() / or_else(); an rvalue Result moves its
+ *    value into the callback
  */
 template <typename T>
-class Result {
+class [[nodiscard]] Result : private detail::ResultStorage<T> {
 private:
-    optional<T> _v;
-    Err _e{ Err::None };
+    using Storage = detail::ResultStorage<T>;
+
+    template <typename Self, typename F>
+    static auto andThen(Self&& self, F&& f)
+    {
+        using R = decay_t<invoke_result_t<F, decltype(forward<Self>(self).get())>>;
+        static_assert(detail::IsResult<R>::value, "and_then callback must return a Result");
+        if (!self.isOk()) return R(self.error());
+        return forward<F>(f)(forward<Self>(self).get());
+    }
+
+    template <typename Self, typename F>
+    static auto mapValue(Self&& self, F&& f)
+    {
+        using U = decay_t<invoke_result_t<F, decltype(forward<Self>(self).get())>>;
+        if (!self.isOk()) return Result<U>(self.error());
+        return Result<U>(forward<F>(f)(forward<Self>(self).get()));
+    }
+
+    template <typename Self, typename F>
+    static Result orElse(Self&& self, F&& f)
+    {
+        if (self.isOk()) return forward<Self>(self);
+        return forward<F>(f)(self.error());
+    }
+
+    const T& get(void) const &
+    {
+        return this->_v;
+    }
+
+    T&& get(void) &&
+    {
+        return move(this->_v);
+    }
+
 public:
-    Result(const T& value): _v(value)
+    using value_type = T;
+
+    Result(const T& value): Storage(value)
     {}
 
-    Result(T&& value): _v(move(value))
+    Result(T&& value): Storage(move(value))
     {}
 
-    Result(Err error): _v(nullopt), _e(error)
+    /**
+     * @brief Error result; Err::None, which would read as ok with no value, becomes SystemError
+     */
+    Result(Err error): Storage(error == Err::None ? Err::SystemError : error)
     {}
 
     bool isOk() const
     {
-        return _v.has_value();
+        return this->_e == Err::None;
+    }
+
+    const T& value() const &
+    {
+        return this->_v;
     }
 
-    const T& value() const
+    T& value() &
     {
-        return *_v;
+        return this->_v;
     }
 
-    T& value()
+    /**
+     * @brief Move the value out of a temporary Result
+     *
+     * Returns by value so that binding the result of a temporary (e.g. in
+     * a range-for) never dangles.
+     */
+    T value() &&
     {
-        return *_v;
+        return move(this->_v);
+    }
+
+    /**
+     * @brief Move the value out, leaving a moved-from value behind
+     */
+    T take()
+    {
+        return move(this->_v);
     }
 
     Err error() const
     {
-        return _e;
+        return this->_e;
+    }
+
+    /**
+     * @brief Call f with the value if ok; f returns the next Result
+     */
+    template <typename F>
+    auto and_then(F&& f) const &
+    {
+        return andThen(*this, forward<F>(f));
+    }
+
+    template <typename F>
+    auto and_then(F&& f) &&
+    {
+        return andThen(move(*this), forward<F>(f));
+    }
+
+    /**
+     * @brief Transform the value if ok; errors pass through unchanged
+     */
+    template <typename F>
+    auto map(F&& f) const &
+    {
+        return mapValue(*this, forward<F>(f));
+    }
+
+    template <typename F>
+    auto map(F&& f) &&
+    {
+        return mapValue(move(*this), forward<F>(f));
     }
-};
\ No newline at end of file
+
+    /**
+     * @brief Call f with the error if not ok; f returns a replacement Result
+     */
+    template <typename F>
+    Result or_else(F&& f) const &
+    {
+        return orElse(*this, forward<F>(f));
+    }
+
+    template <typename F>
+    Result or_else(F&& f) &&
+    {
+        return orElse(move(*this), forward<F>(f));
+    }
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include "Interfaces.hpp"
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Memoizes bank reads for the lifetime of one card session
+ *
+ * Holds the account list of the current card and the balances read so far.
+ * The owner keeps entries consistent with its own writes and clears the
+ * cache when the card leaves.
+ */
+class SessionCache {
+public:
+    /**
+     * @brief Lookup counters, kept across sessions until resetStats()
+     */
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+private:
+    optional<vector<AccountId>> _accounts;
+    unordered_map<AccountId, int> _balances;
+    Stats _stats;
+
+public:
+    /**
+     * @brief Cached account list, or nullptr on a miss
+     */
+    const vector<AccountId>* accounts(void)
+    {
+        if (_accounts) {
+            ++_stats.hits;
+            return &*_accounts;
+        }
+        ++_stats.misses;
+        return nullptr;
+    }
+
+    void storeAccounts(const vector<AccountId>& accounts)
+    {
+        _accounts = accounts;
+    }
+
+    /**
+     * @brief Cached balance of an account, if any
+     *
+     * @param accountId The account to look up
+     */
+    optional<int> balance(const AccountId& accountId)
+    {
+        auto it = _balances.find(accountId);
+        if (it != _balances.end()) {
+            ++_stats.hits;
+            return it->second;
+        }
+        ++_stats.misses;
+        return nullopt;
+    }
+
+    void storeBalance(const AccountId& accountId, int balance)
+    {
+        _balances[accountId] = balance;
+    }
+
+    /**
+     * @brief Apply a confirmed change to a cached balance
+     *
+     * Does nothing if the balance is not cached.
+     *
+     * @param accountId The account that changed
+     * @param delta Signed amount applied by the bank
+     */
+    void adjustBalance(const AccountId& accountId, int delta)
+    {
+        auto it = _balances.find(accountId);
+        if (it != _balances.end()) {
+            it->second += delta;
+        }
+    }
+
+    /**
+     * @brief Forget a balance whose bank-side value is no longer known
+     *
+     * @param accountId The account to forget
+     */
+    void invalidateBalance(const AccountId& accountId)
+    {
+        _balances.erase(accountId);
+    }
+
+    /**
+     * @brief Drop all cached entries, keeping the counters
+     */
+    void clear(void)
+    {
+        _accounts.reset();
+        _balances.clear();
+    }
+
+    Stats stats(void) const
+    {
+        return _stats;
+    }
+
+    void resetStats(void)
+    {
+        _stats = Stats{};
+    }
+};
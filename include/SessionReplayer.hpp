@@ -0,0 +1,65 @@
+#pragma once
+#include "Controller.hpp"
+#include "ControllerMetrics.hpp"
+#include "SessionTrace.hpp"
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * @brief Replays a SessionTrace against fresh Controllers
+ *
+ * The devices are replaced by scripted ones that answer each call with the
+ * recorded response, optionally after the recorded or a fixed latency.
+ * Every operation's result is compared with the recording; a difference
+ * means the controller's behaviour changed. Runs single-threaded for exact
+ * reproduction or on several threads, each with its own controller, to
+ * measure peak throughput.
+ */
+class SessionReplayer {
+public:
+    /**
+     * @brief Device latency applied during replay
+     */
+    enum class Timing {
+        None,       ///< Answer immediately: measures the controller alone
+        Recorded,   ///< Wait as long as the device took when recorded
+        Fixed       ///< Wait a fixed time on every device call
+    };
+
+    /**
+     * @brief Replay configuration
+     */
+    struct Options {
+        Timing timing = Timing::None;
+        chrono::nanoseconds fixedLatency{ 0 };   ///< Device latency for Timing::Fixed
+        size_t threads = 1;                      ///< Controllers replaying in parallel
+        size_t loops = 1;                        ///< Times each thread replays the trace
+        Controller::Config controller;           ///< Configuration of the replayed controllers
+    };
+
+    /**
+     * @brief Replay results, summed over all threads
+     */
+    struct Report {
+        uint64_t operations = 0;
+        uint64_t mismatches = 0;                 ///< Operations whose result differed from the recording
+        uint64_t divergedCalls = 0;              ///< Device calls with no matching recorded response
+        double seconds = 0;
+        double operationsPerSecond = 0;
+        ControllerMetrics::Snapshot metrics;     ///< Latencies of the replayed operations and calls
+    };
+
+private:
+    const SessionTrace& _trace;
+
+public:
+    /**
+     * @param trace Recording to replay; must outlive the replayer
+     */
+    explicit SessionReplayer(const SessionTrace& trace) : _trace(trace)
+    {}
+
+    Report run(const Options& options) const;
+};
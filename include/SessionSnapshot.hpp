@@ -0,0 +1,124 @@
+#pragma once
+#include "Result.hpp"
+#include "MappedFile.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Host secret that authenticates session records
+ *
+ * A record resumes a session without its PIN, so the key must be out of
+ * reach of whoever can write the snapshot file, e.g. in the host's key
+ * store, and a fresh random key per host is best.
+ */
+using SessionKey = array<uint8_t, 32>;
+
+/**
+ * @brief Fixed-size binary snapshot of one Controller session
+ *
+ * Holds what a session needs to resume after a restart: its state, card,
+ * selected account and failed PIN attempts. No PIN or PIN reference is
+ * stored; restore() reads the reference from the card again. Card and
+ * account ids are limited to 47
+ * bytes. Records are plain bytes, so they can be copied straight into a
+ * mapped file, and carry a MAC (HMAC-SHA-256, truncated to 128 bits)
+ * under the host's SessionKey.
+ */
+struct SessionRecord {
+    uint8_t state = 0;              ///< Controller::State
+    uint8_t pinAttempts = 0;
+    uint8_t reserved0[6] = {};
+    int64_t savedAtMs = 0;          ///< Wall clock at snapshot time, ms since the epoch
+    uint64_t sessionId = 0;         ///< Host session the record belongs to
+    char card[48] = {};
+    char account[48] = {};          ///< Empty unless an account is selected
+    uint8_t reserved[56] = {};
+    uint8_t mac[16] = {};
+
+    /**
+     * @brief Compute the MAC over the filled-in record
+     *
+     * @param key Host secret
+     */
+    void seal(const SessionKey& key);
+
+    /**
+     * @brief True if the MAC under key matches the contents; compared in constant time
+     *
+     * @param key Host secret
+     */
+    bool intact(const SessionKey& key) const;
+};
+
+static_assert(sizeof(SessionRecord) == 192, "session record must be 192 bytes");
+
+/**
+ * @brief Memory-mapped file holding the last saved set of session records
+ *
+ * The file has two record areas. save() writes the area not in use, syncs
+ * it and only then switches the header to it, so a crash during save()
+ * leaves the previous snapshot readable.
+ */
+class SessionSnapshotFile {
+private:
+    MappedFile _file;
+    size_t _capacity = 0;      // records per area
+
+    SessionRecord* area(uint32_t index);
+    const SessionRecord* area(uint32_t index) const;
+
+    // Every record of the active area, authentic or not
+    vector<SessionRecord> saved(void) const;
+
+public:
+    SessionSnapshotFile() = default;
+
+    SessionSnapshotFile(const SessionSnapshotFile&) = delete;
+    SessionSnapshotFile& operator=(const SessionSnapshotFile&) = delete;
+
+    /**
+     * @brief Open or create a snapshot file
+     *
+     * An existing snapshot is kept for load().
+     *
+     * @param path Snapshot file
+     * @param capacity Most sessions one snapshot holds
+     */
+    Status open(const string& path, size_t capacity = 1024);
+
+    void close(void)
+    {
+        _file.close();
+    }
+
+    bool isOpen(void) const
+    {
+        return _file.isOpen();
+    }
+
+    size_t capacity(void) const
+    {
+        return _capacity;
+    }
+
+    /**
+     * @brief Replace the saved snapshot
+     *
+     * Fails with MemoryError if there are more records than the capacity.
+     *
+     * @param records Sealed session records
+     */
+    Status save(const vector<SessionRecord>& records);
+
+    /**
+     * @brief Records of the last saved snapshot that are intact under key
+     *
+     * @param key Host secret the records were sealed with
+     */
+    vector<SessionRecord> load(const SessionKey& key) const;
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include "Interfaces.hpp"
+#include "ControllerMetrics.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief One call the controller made into a device during an operation
+ */
+struct DeviceCallRecord {
+    ControllerMetrics::Call call = ControllerMetrics::Call::ReadCard;
+    Err outcome = Err::None;
+    bool threw = false;          ///< The device threw instead of returning
+    uint64_t ns = 0;             ///< Time spent in the device
+    int64_t value = 0;           ///< Balance or hold id returned
+    string text;                 ///< Card returned by the reader
+    vector<string> list;         ///< Accounts returned by the bank
+};
+
+/**
+ * @brief One Controller operation with its arguments, result and device calls
+ *
+ * PINs are never recorded; replay answers verifyPin from the recorded
+ * outcome instead.
+ */
+struct OperationRecord {
+    ControllerMetrics::Op op = ControllerMetrics::Op::InsertCard;
+    Err outcome = Err::None;
+    uint64_t ns = 0;             ///< Time spent in the operation, devices included
+    int64_t money = 0;           ///< Amount of deposit / withdraw
+    string account;              ///< Account of selectAccount
+    vector<DeviceCallRecord> calls;
+};
+
+/**
+ * @brief Recorded sequence of Controller operations, storable as a compact binary file
+ *
+ * The file starts with the magic "ATMSREC1" followed by length-prefixed
+ * records in host byte order.
+ */
+struct SessionTrace {
+    vector<OperationRecord> ops;
+
+    /**
+     * @brief Write the trace to a file
+     *
+     * Fails with InvalidArg, writing nothing, if a string is longer than
+     * 65535 bytes or a call or account list has more than 65535 entries.
+     *
+     * @param path Destination file
+     */
+    Status save(const string& path) const;
+
+    /**
+     * @brief Read a trace written by save()
+     *
+     * @param path Trace file
+     */
+    static Result<SessionTrace> load(const string& path);
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief Incremental SHA-256 (FIPS 180-4)
+ */
+class Sha256 {
+public:
+    using Digest = array<uint8_t, 32>;
+
+private:
+    uint32_t _state[8];
+    uint8_t _block[64];
+    size_t _blockSize = 0;
+    uint64_t _length = 0;   // bytes hashed so far
+
+    void compress(const uint8_t* block);
+
+public:
+    Sha256();
+
+    Sha256& update(const void* data, size_t size);
+
+    Sha256& update(const string& data)
+    {
+        return update(data.data(), data.size());
+    }
+
+    /**
+     * @brief Finish and return the digest; the object must not be reused
+     */
+    Digest finish(void);
+
+    static Digest hash(const void* data, size_t size)
+    {
+        return Sha256().update(data, size).finish();
+    }
+
+    /**
+     * @brief HMAC-SHA-256 (RFC 2104) of data under a key
+     *
+     * @param key Secret key; keys longer than a block are hashed first
+     * @param keySize Key length in bytes
+     * @param data Message
+     * @param size Message length in bytes
+     */
+    static Digest hmac(const void* key, size_t keySize, const void* data, size_t size);
+};
@@ -0,0 +1,111 @@
+#pragma once
+#include "Interfaces.hpp"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Thread-safe in-memory bank for load tests and local backends
+ *
+ * Accounts are spread over lock-striped shards. The shard lock only guards
+ * the account directory; balances are atomics updated by compare-and-swap,
+ * so a withdrawal never overdraws under contention and balance reads never
+ * block writers. Batched deposits apply each idempotency key once, as
+ * long as the key is among the most recent postingKeys.
+ */
+class ShardedBank : public IBank {
+private:
+    struct alignas(64) Account {
+        atomic<int> balance;
+
+        explicit Account(int initial) : balance(initial)
+        {}
+    };
+
+    struct Hold {
+        Account* account;
+        int amount;
+    };
+
+    struct alignas(64) Shard {
+        mutable shared_mutex mutex;
+        unordered_map<AccountId, unique_ptr<Account>> accounts;
+        unordered_map<HoldId, Hold> holds;
+        unordered_set<uint64_t> postings;   // recent deposit keys already applied
+        deque<uint64_t> postingOrder;       // the same keys, oldest first
+    };
+
+    struct alignas(64) CardShard {
+        mutable shared_mutex mutex;
+        unordered_map<Card, Pin> pins;
+        unordered_map<Card, vector<AccountId>> accounts;
+    };
+
+    vector<Shard> _shards;
+    vector<CardShard> _cardShards;
+    size_t _postingKeys;                 // keys remembered per shard
+    atomic<HoldId> _nextHold{ 1 };
+
+    template <typename Key>
+    size_t shardOf(const Key& key) const
+    {
+        return hash<Key>()(key) % _shards.size();
+    }
+
+    Account* find(const AccountId& accountId) const;
+
+    /**
+     * @brief Debit with a CAS loop; fails instead of going below zero
+     */
+    static bool tryDebit(Account& account, int money);
+
+public:
+    /**
+     * @brief Create an empty bank
+     *
+     * @param shards Number of lock stripes (at least one)
+     * @param postingKeys Recent deposit keys remembered, spread over the shards
+     */
+    explicit ShardedBank(size_t shards = 64, size_t postingKeys = 65536);
+
+    /**
+     * @brief Open an account
+     *
+     * @param accountId New account id
+     * @param balance Initial balance
+     */
+    Status addAccount(const AccountId& accountId, int balance);
+
+    /**
+     * @brief Register a card with its PIN and accounts
+     *
+     * @param card Card id
+     * @param pin PIN code of the card
+     * @param accounts Accounts reachable with the card
+     */
+    Status addCard(const Card& card, const Pin& pin, const vector<AccountId>& accounts);
+
+    Status verifyPin(const Card& card, const Pin& pin) override;
+    vector<AccountId> listAccounts(const Card& card) override;
+    Result<int> getBalance(const AccountId& accountId) override;
+    Status deposit(const AccountId& accountId, int money) override;
+    Status canWithdraw(const AccountId& accountId, int money) override;
+    Status withdraw(const AccountId& accountId, int money) override;
+    Result<HoldId> placeHold(const AccountId& accountId, int money) override;
+    Status captureHold(HoldId holdId) override;
+    Status releaseHold(HoldId holdId) override;
+    vector<Status> postDeposits(const vector<DepositPosting>& batch) override;
+
+    bool keyedDeposits(void) const override
+    {
+        return true;
+    }
+};
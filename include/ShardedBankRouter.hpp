@@ -0,0 +1,138 @@
+#pragma once
+#include "Interfaces.hpp"
+#include "ThreadPool.hpp"
+#include <array>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief IBank spreading accounts and cards over several bank partitions
+ *
+ * Each partition ("shard") owns a number of points on a hash ring. An
+ * account or card is routed to the first point after its hash, so adding a
+ * shard moves only the keys that now fall on its points, about 1/N of them,
+ * and removing one moves only its own keys. Card prefixes (BINs) can pin
+ * cards to a shard regardless of the ring. The router moves no data: after
+ * a change the partitions must hold the keys routed to them.
+ *
+ * A card may have accounts in every partition, so listAccounts and
+ * getBalances ask all shards at once and merge the answers in shard order.
+ * Batched deposits are split by shard and posted in parallel; a shard that
+ * fails marks only its own deposits with Err::NetworkError. Holds carry
+ * their shard in the top byte of the HoldId.
+ *
+ * Fan-out calls run on the pool, so the pool must not be one whose workers
+ * call into this router, and the shards must outlive the router's last call.
+ * Routing is thread-safe; shards may be added and removed while calls run.
+ */
+class ShardedBankRouter : public IBank {
+public:
+    /**
+     * @brief Ring layout
+     */
+    struct Config {
+        size_t pointsPerShard = 160;   ///< Ring points per shard; more points spread keys more evenly
+    };
+
+    static constexpr size_t kMaxShards = 255;
+
+private:
+    struct Backend {
+        string name;
+        IBank* bank;
+        uint8_t slot;       // HoldId tag, never reused
+    };
+
+    struct Point {
+        uint64_t hash;
+        uint32_t backend;   // index into _backends
+    };
+
+    ThreadPool& _pool;
+    Config _cfg;
+
+    mutable shared_mutex _mutex;
+    vector<Backend> _backends;
+    vector<Point> _ring;                    // sorted by hash
+    vector<pair<string, string>> _bins;     // card prefix, shard name; longest first
+    array<IBank*, 256> _bySlot{};
+    uint8_t _nextSlot = 1;
+
+    void rebuildRing(void);
+    IBank* route(const char* key) const;
+    size_t backendOf(const char* key) const;
+    IBank* routeCard(const Card& card) const;
+    IBank* routeHold(HoldId holdId) const;
+    vector<IBank*> shards(void) const;
+
+public:
+    explicit ShardedBankRouter(ThreadPool& pool);
+    ShardedBankRouter(ThreadPool& pool, const Config& cfg);
+
+    ShardedBankRouter(const ShardedBankRouter&) = delete;
+    ShardedBankRouter& operator=(const ShardedBankRouter&) = delete;
+
+    /**
+     * @brief Add a partition to the ring
+     *
+     * Fails with InvalidArg for an empty or taken name and with MemoryError
+     * once kMaxShards shards were ever added.
+     *
+     * @param name Stable shard name; it decides the shard's ring points
+     * @param bank Backend of the partition
+     */
+    Status addShard(const string& name, IBank& bank);
+
+    /**
+     * @brief Take a partition off the ring, together with its BIN routes
+     *
+     * Holds placed on it can no longer be captured or released.
+     *
+     * @param name Shard to remove
+     */
+    Status removeShard(const string& name);
+
+    /**
+     * @brief Route every card starting with a prefix to one shard
+     *
+     * The longest matching prefix wins over the ring.
+     *
+     * @param prefix Card number prefix, usually the 6 or 8 digit BIN
+     * @param shard Shard serving those cards
+     */
+    Status routeBin(const string& prefix, const string& shard);
+
+    /**
+     * @brief Name of the shard an account is routed to
+     */
+    Result<string> shardOf(const AccountId& accountId) const;
+
+    /**
+     * @brief Name of the shard verifying a card
+     */
+    Result<string> shardOf(const Card& card) const;
+
+    size_t size(void) const;
+
+    Status verifyPin(const Card& card, const Pin& pin) override;
+    vector<AccountId> listAccounts(const Card& card) override;
+    Result<int> getBalance(const AccountId& accountId) override;
+    Status deposit(const AccountId& accountId, int money) override;
+    Status canWithdraw(const AccountId& accountId, int money) override;
+    Status withdraw(const AccountId& accountId, int money) override;
+    Result<HoldId> placeHold(const AccountId& accountId, int money) override;
+    Status captureHold(HoldId holdId) override;
+    Status releaseHold(HoldId holdId) override;
+    vector<Status> postDeposits(const vector<DepositPosting>& batch) override;
+    vector<AccountBalance> getBalances(const Card& card) override;
+
+    /**
+     * @brief True while every shard applies deposit keys at most once
+     */
+    bool keyedDeposits(void) const override;
+};
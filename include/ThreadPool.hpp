@@ -0,0 +1,105 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Fixed-size worker pool for running blocking calls off the caller thread
+ *
+ * Futures returned by submit() do not block on destruction, so a caller may
+ * abandon a task; the task still runs to completion on a worker.
+ */
+class ThreadPool {
+private:
+    vector<thread> _workers;
+    deque<function<void()>> _tasks;
+    mutex _mutex;
+    condition_variable _cv;
+    bool _stopping = false;
+
+    void workerLoop()
+    {
+        for (;;) {
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(_mutex);
+                _cv.wait(lock, [this] { return _stopping || !_tasks.empty(); });
+                if (_tasks.empty()) {
+                    return;
+                }
+                task = move(_tasks.front());
+                _tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    /**
+     * @brief Start the worker threads
+     *
+     * @param threads Number of workers (at least one is always started)
+     */
+    explicit ThreadPool(size_t threads = thread::hardware_concurrency())
+    {
+        if (threads == 0) {
+            threads = 1;
+        }
+        _workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            _workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Drain queued tasks and join all workers
+     */
+    ~ThreadPool()
+    {
+        {
+            lock_guard<mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _cv.notify_all();
+        for (auto& worker : _workers) {
+            worker.join();
+        }
+    }
+
+    /**
+     * @brief Queue a callable and return a future for its result
+     *
+     * Exceptions thrown by the callable are delivered through the future.
+     *
+     * @param fn Callable to run on a worker thread
+     */
+    template <typename F>
+    auto submit(F&& fn) -> future<invoke_result_t<decay_t<F>>>
+    {
+        using R = invoke_result_t<decay_t<F>>;
+        auto task = make_shared<packaged_task<R()>>(forward<F>(fn));
+        future<R> result = task->get_future();
+        {
+            lock_guard<mutex> lock(_mutex);
+            _tasks.emplace_back([task] { (*task)(); });
+        }
+        _cv.notify_one();
+        return result;
+    }
+
+    size_t size(void) const
+    {
+        return _workers.size();
+    }
+};
@@ -0,0 +1,231 @@
+#pragma once
+#include "Interfaces.hpp"
+#include "MappedFile.hpp"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Describes one transaction step for the journal
+ *
+ * The execute function of a step may fill in arg (e.g. a hold id) before
+ * the executed record is written.
+ */
+struct JournalStep {
+    uint16_t op = 0;                     ///< Caller-defined operation code
+    AccountId account;                   ///< Account touched by the step
+    int amount = 0;                      ///< Amount moved by the step
+    int64_t arg = 0;                     ///< Value needed to undo the step
+};
+
+/**
+ * @brief Step of an unfinished transaction found by recovery
+ */
+struct RecoveredStep {
+    uint8_t index = 0;       ///< Position within the transaction
+    uint16_t op = 0;
+    AccountId account;       ///< Account id (truncated to 31 bytes)
+    int amount = 0;
+    int64_t arg = 0;
+    bool executed = false;   ///< False if only the intent was recorded
+};
+
+/**
+ * @brief Append-only, memory-mapped write-ahead journal for transactions
+ *
+ * Each step writes an intent record before it runs and an executed record
+ * after it succeeds; the transaction ends with a committed or rolled-back
+ * record. After a crash, recover() hands every unfinished transaction to a
+ * compensation callback. Appends are safe from multiple threads.
+ *
+ * The file is reused from the start whenever no transaction is open, so a
+ * journal shared by many sessions must be sized for their peak of
+ * concurrently open transactions. A transaction that stands but still owes
+ * a step (see defer()) is copied to a small deferred area ahead of the log
+ * and closed, so it does not keep the log from being reused.
+ */
+class TransactionJournal {
+public:
+    /**
+     * @brief When committed records are forced to stable storage
+     */
+    enum class FsyncPolicy {
+        Never,        ///< Leave write-back to the OS
+        EveryCommit,  ///< Sync on every commit
+        Grouped       ///< Sync once per group of commits or time window
+    };
+
+    /**
+     * @brief Journal configuration
+     */
+    struct Config {
+        size_t capacity = 65536;                            ///< Records in the file
+        size_t deferred = 64;                               ///< Deferred-area slots; fixed when the file is created
+        FsyncPolicy fsync = FsyncPolicy::Grouped;
+        size_t groupCommits = 32;                           ///< Commits per grouped sync
+        chrono::microseconds groupWindow{ 2000 };           ///< Longest gap between grouped syncs
+    };
+
+    /**
+     * @brief Journal counters
+     */
+    struct Stats {
+        uint64_t records = 0;
+        uint64_t syncs = 0;
+        uint64_t resets = 0;   ///< Times the file was reused from the start
+        uint64_t deferred = 0; ///< Transactions moved to the deferred area
+    };
+
+    /**
+     * @brief Settles one transaction during recovery
+     *
+     * Returns false if the transaction could not be settled yet (e.g. the
+     * bank is unreachable); it is then handed over again by the next
+     * recover().
+     */
+    using Compensation = function<bool(uint64_t txId, const vector<RecoveredStep>& steps)>;
+
+private:
+    MappedFile _file;
+    Config _cfg;
+    size_t _deferredSlots = 0;  // deferred-area slots after the header
+    size_t _capacity = 0;       // records that fit after the deferred area
+    uint32_t _generation = 0;   // bumped each time the file is reused
+
+    mutex _mutex;
+    size_t _tail = 0;           // next record slot
+    size_t _syncedTail = 0;     // records known to be on stable storage
+    size_t _reserved = 0;       // slots promised to unfinished transactions
+    unordered_map<uint64_t, size_t> _open;  // unfinished transaction -> slots still reserved
+    bool _pinned = false;       // recovery left unsettled records the area had no room for
+    uint64_t _nextTxId = 1;
+    size_t _commitsSinceSync = 0;
+    chrono::steady_clock::time_point _lastSync;
+    Stats _stats;
+
+    mutex _syncMutex;
+
+    Status append(uint64_t txId, uint8_t type, uint8_t step, const JournalStep* info);
+    Status deferLocked(uint64_t txId, const vector<RecoveredStep>& steps);
+    Status resetLocked(void);
+    Status syncRecords(size_t from, size_t to);
+
+public:
+    TransactionJournal() = default;
+
+    TransactionJournal(const TransactionJournal&) = delete;
+    TransactionJournal& operator=(const TransactionJournal&) = delete;
+
+    /**
+     * @brief Flush outstanding records and close the file
+     */
+    ~TransactionJournal();
+
+    /**
+     * @brief Open or create a journal file with default settings
+     *
+     * @param path Journal file
+     */
+    Status open(const string& path);
+
+    /**
+     * @brief Open or create a journal file
+     *
+     * Existing records are kept for recover().
+     *
+     * @param path Journal file
+     * @param cfg Journal configuration
+     */
+    Status open(const string& path, const Config& cfg);
+
+    void close(void);
+
+    bool isOpen(void) const
+    {
+        return _file.isOpen();
+    }
+
+    /**
+     * @brief Start a transaction and return its id
+     * 
+     * Reserves room for the transaction's records up front, so a begun
+     * transaction never runs out of journal space halfway. Fails with
+     * MemoryError if the journal is full of unfinished transactions.
+     * 
+     * @param records Most records the transaction will append
+     */
+    Result<uint64_t> begin(size_t records);
+
+    /**
+     * @brief Record that a step is about to run
+     *
+     * @param txId Transaction from begin()
+     * @param step Position of the step within the transaction
+     * @param info Description of the step
+     */
+    Status intent(uint64_t txId, uint8_t step, const JournalStep& info);
+
+    /**
+     * @brief Record that a step has completed
+     *
+     * @param txId Transaction from begin()
+     * @param step Position of the step within the transaction
+     * @param info Description of the step, including its undo value
+     */
+    Status executed(uint64_t txId, uint8_t step, const JournalStep& info);
+
+    /**
+     * @brief Record that the transaction committed, syncing per policy
+     *
+     * @param txId Transaction from begin()
+     */
+    Status commit(uint64_t txId);
+
+    /**
+     * @brief Record that the transaction was rolled back
+     *
+     * @param txId Transaction from begin()
+     */
+    Status rolledBack(uint64_t txId);
+
+    /**
+     * @brief Close a transaction that stands but still owes one step
+     *
+     * The owed step is written to the deferred area and synced before the
+     * transaction is closed; recover() hands it to the compensation
+     * callback as a single step that has not executed. Fails with
+     * MemoryError, leaving the transaction open, if the area is full.
+     *
+     * @param txId Transaction from begin()
+     * @param step Position of the owed step within the transaction
+     * @param owed Description of the owed step
+     */
+    Status defer(uint64_t txId, uint8_t step, const JournalStep& owed);
+
+    /**
+     * @brief Settle deferred transactions and those left unfinished by a crash
+     *
+     * Call once after open() and before new transactions begin. The
+     * callback receives each transaction's steps in reverse order. A
+     * settled transaction is marked rolled back (or dropped from the
+     * deferred area); an unsettled one is moved to the deferred area, or,
+     * if that is full, left open and the log is not reused until a later
+     * recover() settles it. Returns the number of settled transactions.
+     *
+     * @param compensate Callback settling one transaction
+     */
+    size_t recover(const Compensation& compensate);
+
+    /**
+     * @brief Force all appended records to stable storage
+     */
+    Status flush(void);
+
+    Stats stats(void);
+};
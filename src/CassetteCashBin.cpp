@@ -0,0 +1,262 @@
+#include "CassetteCashBin.hpp"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <numeric>
+
+CassetteCashBin::CassetteCashBin(vector<Cassette> cassettes)
+ : CassetteCashBin(move(cassettes), Config())
+{}
+
+CassetteCashBin::CassetteCashBin(vector<Cassette> cassettes, const Config& cfg)
+ : _cassettes(move(cassettes)), _cfg(cfg)
+{
+    _cfg.maxDispense = max(_cfg.maxDispense, 0);
+    _cfg.maxNotes = max(_cfg.maxNotes, 0);
+
+    int unit = 0;
+    for (size_t i = 0; i < _cassettes.size(); ++i)
+    {
+        _cassettes[i].count = max(_cassettes[i].count, 0);
+        if (_cassettes[i].denomination > 0)
+        {
+            _order.push_back(i);
+            unit = gcd(unit, _cassettes[i].denomination);
+        }
+    }
+    stable_sort(_order.begin(), _order.end(), [&](size_t a, size_t b) {
+        return _cassettes[a].denomination < _cassettes[b].denomination;
+    });
+
+    _unit = unit ? unit : 1;
+    _slots = size_t(_cfg.maxDispense / _unit) + 1;
+
+    // The level past the last cassette can only pay out nothing
+    size_t levels = _order.size();
+    _minNotes.assign((levels + 1) * _slots, kUnreachable);
+    _minNotes[levels * _slots] = 0;
+
+    _usable.resize(levels);
+    for (size_t level = 0; level < levels; ++level)
+    {
+        _usable[level] = usable(_cassettes[_order[level]]);
+    }
+    if (levels)
+    {
+        rebuild(levels - 1);
+    }
+}
+
+int CassetteCashBin::usable(const Cassette& cassette) const
+{
+    return min(cassette.count, _cfg.maxDispense / cassette.denomination);
+}
+
+void CassetteCashBin::rebuild(size_t top)
+{
+    for (size_t level = top + 1; level-- > 0;)
+    {
+        size_t step = size_t(_cassettes[_order[level]].denomination / _unit);
+        int64_t limit = _usable[level];
+        const uint32_t* next = &_minNotes[(level + 1) * _slots];
+        uint32_t* out = &_minNotes[level * _slots];
+
+        // Bounded change-making per residue class: out[r + j*step] is the
+        // minimum over the last `limit + 1` positions i of next[r + i*step] + j - i,
+        // kept in a monotonic queue of (i, next - i).
+        deque<pair<int64_t, int64_t>> window;
+        for (size_t r = 0; r < step && r < _slots; ++r)
+        {
+            window.clear();
+            int64_t j = 0;
+            for (size_t slot = r; slot < _slots; slot += step, ++j)
+            {
+                if (next[slot] != kUnreachable)
+                {
+                    int64_t key = int64_t(next[slot]) - j;
+                    while (!window.empty() && window.back().second >= key)
+                    {
+                        window.pop_back();
+                    }
+                    window.emplace_back(j, key);
+                }
+                while (!window.empty() && window.front().first < j - limit)
+                {
+                    window.pop_front();
+                }
+                out[slot] = window.empty() ? kUnreachable : uint32_t(window.front().second + j);
+            }
+        }
+    }
+}
+
+void CassetteCashBin::refreshTables(void)
+{
+    size_t top = _order.size();
+    for (size_t level = 0; level < _order.size(); ++level)
+    {
+        int now = usable(_cassettes[_order[level]]);
+        if (now != _usable[level])
+        {
+            _usable[level] = now;
+            top = level;
+        }
+    }
+    if (top < _order.size())
+    {
+        rebuild(top);
+    }
+}
+
+size_t CassetteCashBin::slotOf(int money) const
+{
+    if (money <= 0 || money > _cfg.maxDispense || money % _unit)
+    {
+        return _slots;
+    }
+    return size_t(money / _unit);
+}
+
+Status CassetteCashBin::canDispense(int money)
+{
+    if (money <= 0)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    size_t slot = slotOf(money);
+    if (slot == _slots)
+    {
+        return Status::error(Err::InsufficientCashBin);
+    }
+
+    uint32_t notes = minNotes(0, slot);
+    if (notes == kUnreachable || (_cfg.maxNotes && notes > uint32_t(_cfg.maxNotes)))
+    {
+        return Status::error(Err::InsufficientCashBin);
+    }
+    return Status::okStatus();
+}
+
+Result<CassetteCashBin::Plan> CassetteCashBin::plan(int money, Strategy strategy) const
+{
+    if (money <= 0)
+    {
+        return Err::InvalidArg;
+    }
+
+    size_t slot = slotOf(money);
+    if (slot == _slots || minNotes(0, slot) == kUnreachable
+        || (_cfg.maxNotes && minNotes(0, slot) > uint32_t(_cfg.maxNotes)))
+    {
+        return Err::InsufficientCashBin;
+    }
+
+    // Cash left from each level on, to weigh cassettes for Strategy::Balanced
+    vector<int64_t> suffixCash(_order.size() + 1, 0);
+    for (size_t level = _order.size(); level-- > 0;)
+    {
+        const Cassette& cassette = _cassettes[_order[level]];
+        suffixCash[level] = suffixCash[level + 1] + int64_t(cassette.count) * cassette.denomination;
+    }
+
+    Plan plan(_cassettes.size(), 0);
+    size_t rest = slot;
+    uint32_t notes = 0;
+    for (size_t level = 0; level < _order.size(); ++level)
+    {
+        const Cassette& cassette = _cassettes[_order[level]];
+        size_t step = size_t(cassette.denomination / _unit);
+        int most = int(min<size_t>(size_t(_usable[level]), rest / step));
+
+        auto payable = [&](int n) {
+            uint32_t after = minNotes(level + 1, rest - size_t(n) * step);
+            return after != kUnreachable && (!_cfg.maxNotes || notes + n + after <= uint32_t(_cfg.maxNotes));
+        };
+
+        int chosen = -1;
+        if (strategy == Strategy::FewestNotes)
+        {
+            // Fewest small notes among the optimal mixes
+            for (int n = 0; n <= most && chosen < 0; ++n)
+            {
+                uint32_t after = minNotes(level + 1, rest - size_t(n) * step);
+                if (after != kUnreachable && n + after == minNotes(level, rest))
+                {
+                    chosen = n;
+                }
+            }
+        }
+        else
+        {
+            // This cassette's share of the cash left, then the nearest payable count
+            double share = suffixCash[level] ? double(cassette.count) / double(suffixCash[level]) : 0.0;
+            int center = min(most, int(lround(double(rest) * _unit * share)));
+            for (int d = 0; d <= most && chosen < 0; ++d)
+            {
+                if (center - d >= 0 && payable(center - d))
+                {
+                    chosen = center - d;
+                }
+                else if (center + d <= most && payable(center + d))
+                {
+                    chosen = center + d;
+                }
+            }
+        }
+
+        if (chosen < 0)
+        {
+            return Err::SystemError;
+        }
+
+        plan[_order[level]] = chosen;
+        rest -= size_t(chosen) * step;
+        notes += uint32_t(chosen);
+    }
+
+    return plan;
+}
+
+Status CassetteCashBin::dispense(int money)
+{
+    auto mix = plan(money, _cfg.strategy);
+    if (!mix.isOk())
+    {
+        return Status::error(mix.error());
+    }
+
+    const Plan& notes = mix.value();
+    for (size_t i = 0; i < _cassettes.size(); ++i)
+    {
+        _cassettes[i].count -= notes[i];
+    }
+    refreshTables();
+    return Status::okStatus();
+}
+
+Status CassetteCashBin::refill(size_t cassette, int notes)
+{
+    if (cassette >= _cassettes.size() || notes < 0)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    _cassettes[cassette].count += notes;
+    if (_cassettes[cassette].denomination > 0)
+    {
+        refreshTables();
+    }
+    return Status::okStatus();
+}
+
+int64_t CassetteCashBin::total(void) const
+{
+    int64_t cash = 0;
+    for (size_t level = 0; level < _order.size(); ++level)
+    {
+        const Cassette& cassette = _cassettes[_order[level]];
+        cash += int64_t(cassette.count) * cassette.denomination;
+    }
+    return cash;
+}
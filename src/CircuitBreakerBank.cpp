@@ -0,0 +1,306 @@
+#include "CircuitBreakerBank.hpp"
+#include "EventTracer.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+    bool failed(const Status& status)
+    {
+        return status.code == Err::NetworkError;
+    }
+
+    template <typename V>
+    bool failed(const Result<V>& result)
+    {
+        return result.error() == Err::NetworkError;
+    }
+
+    bool failed(const vector<AccountId>&)
+    {
+        return false;
+    }
+
+    bool failed(const vector<Status>& statuses)
+    {
+        return any_of(statuses.begin(), statuses.end(), [](const Status& s) { return failed(s); });
+    }
+
+    bool failed(const vector<AccountBalance>& balances)
+    {
+        return any_of(balances.begin(), balances.end(), [](const AccountBalance& b) { return failed(b.balance); });
+    }
+
+    template <typename T>
+    T failFast(void)
+    {
+        if constexpr (is_same<T, Status>::value)
+        {
+            return Status::error(Err::NetworkError);
+        }
+        else if constexpr (is_same<T, vector<AccountId>>::value || is_same<T, vector<Status>>::value
+                           || is_same<T, vector<AccountBalance>>::value)
+        {
+            throw runtime_error("bank circuit open");
+        }
+        else
+        {
+            return T(Err::NetworkError);
+        }
+    }
+}
+
+CircuitBreakerBank::CircuitBreakerBank(IBank& inner)
+ : CircuitBreakerBank(inner, Config())
+{}
+
+CircuitBreakerBank::CircuitBreakerBank(IBank& inner, const Config& cfg)
+ : _inner(inner), _cfg(cfg)
+{
+    _cfg.window = max<size_t>(_cfg.window, 1);
+    _cfg.minCalls = min(max<size_t>(_cfg.minCalls, 1), _cfg.window);
+    _cfg.halfOpenProbes = max<size_t>(_cfg.halfOpenProbes, 1);
+    _window.resize(_cfg.window, Outcome::Ok);
+}
+
+const char* CircuitBreakerBank::stateName(State state)
+{
+    switch (state)
+    {
+    case State::Closed:   return "closed";
+    case State::Open:     return "open";
+    case State::HalfOpen: return "half-open";
+    default:              return "unknown";
+    }
+}
+
+void CircuitBreakerBank::resetWindow(void)
+{
+    _next = 0;
+    _recorded = 0;
+    _failures = 0;
+    _slow = 0;
+    _probesInFlight = 0;
+    _probesPassed = 0;
+}
+
+void CircuitBreakerBank::open(void)
+{
+    ATM_TRACE(TraceKind::State, "bankCircuit", stateName(State::Open), int64_t(_failures));
+    _state = State::Open;
+    _openedAt = Clock::now();
+    ++_stats.opened;
+    resetWindow();
+}
+
+void CircuitBreakerBank::close(void)
+{
+    ATM_TRACE(TraceKind::State, "bankCircuit", stateName(State::Closed), 0);
+    _state = State::Closed;
+    resetWindow();
+}
+
+bool CircuitBreakerBank::admit(bool& probe)
+{
+    lock_guard<mutex> lock(_mutex);
+    ++_stats.calls;
+    probe = false;
+
+    if (_state == State::Open)
+    {
+        if (Clock::now() - _openedAt < _cfg.openDuration)
+        {
+            ++_stats.rejected;
+            return false;
+        }
+        ATM_TRACE(TraceKind::State, "bankCircuit", stateName(State::HalfOpen), 0);
+        _state = State::HalfOpen;
+        resetWindow();
+    }
+
+    if (_state == State::HalfOpen)
+    {
+        if (_probesInFlight + _probesPassed >= _cfg.halfOpenProbes)
+        {
+            ++_stats.rejected;
+            return false;
+        }
+        ++_probesInFlight;
+        probe = true;
+    }
+    return true;
+}
+
+void CircuitBreakerBank::complete(bool probe, Outcome outcome)
+{
+    lock_guard<mutex> lock(_mutex);
+
+    if (probe)
+    {
+        --_probesInFlight;
+        if (_state != State::HalfOpen)
+        {
+            return;
+        }
+        if (outcome != Outcome::Ok)
+        {
+            open();
+        }
+        else if (++_probesPassed >= _cfg.halfOpenProbes)
+        {
+            close();
+        }
+        return;
+    }
+
+    // Calls admitted before the circuit opened do not count against the next period
+    if (_state != State::Closed)
+    {
+        return;
+    }
+
+    if (_recorded == _cfg.window)
+    {
+        Outcome oldest = _window[_next];
+        _failures -= oldest == Outcome::Failed;
+        _slow -= oldest == Outcome::Slow;
+    }
+    else
+    {
+        ++_recorded;
+    }
+    _window[_next] = outcome;
+    _next = (_next + 1) % _cfg.window;
+    _failures += outcome == Outcome::Failed;
+    _slow += outcome == Outcome::Slow;
+
+    if (_recorded >= _cfg.minCalls
+        && (double(_failures) >= _cfg.failureRate * double(_recorded)
+            || double(_slow) >= _cfg.slowRate * double(_recorded)))
+    {
+        open();
+    }
+}
+
+template <typename T>
+CircuitBreakerBank::Outcome CircuitBreakerBank::outcomeOf(const T& result, Clock::time_point start) const
+{
+    if (failed(result))
+    {
+        return Outcome::Failed;
+    }
+    return Clock::now() - start >= _cfg.slowCall ? Outcome::Slow : Outcome::Ok;
+}
+
+template <typename T, typename F>
+T CircuitBreakerBank::call(F&& fn)
+{
+    bool probe = false;
+    if (!admit(probe))
+    {
+        return failFast<T>();
+    }
+
+    auto start = Clock::now();
+    try {
+        T result = fn();
+        complete(probe, outcomeOf(result, start));
+        return result;
+    }
+    catch (...) {
+        complete(probe, Outcome::Failed);
+        throw;
+    }
+}
+
+template <typename F>
+Status CircuitBreakerBank::settle(F&& fn)
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+        ++_stats.calls;
+    }
+
+    // Never refused and never a probe; the outcome counts only while closed
+    auto start = Clock::now();
+    try {
+        Status result = fn();
+        complete(false, outcomeOf(result, start));
+        return result;
+    }
+    catch (...) {
+        complete(false, Outcome::Failed);
+        throw;
+    }
+}
+
+Status CircuitBreakerBank::verifyPin(const Card& card, const Pin& pin)
+{
+    return call<Status>([&] { return _inner.verifyPin(card, pin); });
+}
+
+vector<AccountId> CircuitBreakerBank::listAccounts(const Card& card)
+{
+    return call<vector<AccountId>>([&] { return _inner.listAccounts(card); });
+}
+
+Result<int> CircuitBreakerBank::getBalance(const AccountId& accountId)
+{
+    return call<Result<int>>([&] { return _inner.getBalance(accountId); });
+}
+
+Status CircuitBreakerBank::deposit(const AccountId& accountId, int money)
+{
+    return call<Status>([&] { return _inner.deposit(accountId, money); });
+}
+
+Status CircuitBreakerBank::canWithdraw(const AccountId& accountId, int money)
+{
+    return call<Status>([&] { return _inner.canWithdraw(accountId, money); });
+}
+
+Status CircuitBreakerBank::withdraw(const AccountId& accountId, int money)
+{
+    return call<Status>([&] { return _inner.withdraw(accountId, money); });
+}
+
+Result<HoldId> CircuitBreakerBank::placeHold(const AccountId& accountId, int money)
+{
+    return call<Result<HoldId>>([&] { return _inner.placeHold(accountId, money); });
+}
+
+Status CircuitBreakerBank::captureHold(HoldId holdId)
+{
+    return settle([&] { return _inner.captureHold(holdId); });
+}
+
+Status CircuitBreakerBank::releaseHold(HoldId holdId)
+{
+    return settle([&] { return _inner.releaseHold(holdId); });
+}
+
+vector<Status> CircuitBreakerBank::postDeposits(const vector<DepositPosting>& batch)
+{
+    return call<vector<Status>>([&] { return _inner.postDeposits(batch); });
+}
+
+vector<AccountBalance> CircuitBreakerBank::getBalances(const Card& card)
+{
+    return call<vector<AccountBalance>>([&] { return _inner.getBalances(card); });
+}
+
+CircuitBreakerBank::State CircuitBreakerBank::state(void) const
+{
+    lock_guard<mutex> lock(_mutex);
+    if (_state == State::Open && Clock::now() - _openedAt >= _cfg.openDuration)
+    {
+        return State::HalfOpen;
+    }
+    return _state;
+}
+
+CircuitBreakerBank::Stats CircuitBreakerBank::stats(void) const
+{
+    lock_guard<mutex> lock(_mutex);
+    return _stats;
+}
@@ -1,92 +1,327 @@
 #include "Controller.hpp"
+#include <cstring>
 #include <exception>
 #include <stdexcept>
 
+namespace {
+    using State = Controller::State;
+    using Event = Controller::Event;
+
+    // Cell values; zero marks a pair nobody handled and fails the build
+    constexpr uint8_t kUnhandled = 0;
+    constexpr uint8_t kReject = 1;
+
+    constexpr uint8_t to(State next)
+    {
+        return uint8_t(2 + size_t(next));
+    }
+
+    constexpr uint8_t kNo = kReject;
+    constexpr uint8_t kIdle = to(State::Idle);
+    constexpr uint8_t kCard = to(State::CardInserted);
+    constexpr uint8_t kAuth = to(State::Authenticated);
+    constexpr uint8_t kSel = to(State::AccountSelected);
+
+    /**
+     * @brief Next state for every state and event
+     *
+     * Rows follow Controller::State, columns Controller::Event:
+     * CardRead, PinAccepted, PinRejected, AccountsListed, AccountChosen,
+     * BalanceRead, Deposited, Withdrawn, CardEjected.
+     */
+    constexpr uint8_t kTransitions[Controller::kStateCount][Controller::kEventCount] = {
+        { kCard, kNo,   kNo,   kNo,   kNo,  kNo,  kNo,  kNo,  kNo   },  // Idle
+        { kNo,   kAuth, kCard, kNo,   kNo,  kNo,  kNo,  kNo,  kIdle },  // CardInserted
+        { kNo,   kNo,   kNo,   kAuth, kSel, kNo,  kNo,  kNo,  kIdle },  // Authenticated
+        { kNo,   kNo,   kNo,   kNo,   kNo,  kSel, kSel, kSel, kIdle },  // AccountSelected
+    };
+
+    constexpr bool everyPairHandled(void)
+    {
+        for (size_t state = 0; state < Controller::kStateCount; ++state)
+        {
+            for (size_t event = 0; event < Controller::kEventCount; ++event)
+            {
+                uint8_t cell = kTransitions[state][event];
+                if (cell == kUnhandled || (cell != kReject && size_t(cell - 2) >= Controller::kStateCount))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static_assert(everyPairHandled(), "every state needs a transition or kNo for every event");
+}
+
 Controller::State Controller::state(void) const
 {
     return _state;
 };
 
+bool Controller::accepts(Event event) const
+{
+    return kTransitions[size_t(_state)][size_t(event)] != kReject;
+}
+
+Status Controller::dispatch(Event event)
+{
+    uint8_t cell = kTransitions[size_t(_state)][size_t(event)];
+    if (cell == kReject)
+    {
+        ATM_TRACE(TraceKind::Instant, stateName(_state), eventName(event), int64_t(Err::InvalidState));
+        return Status::error(Err::InvalidState);
+    }
+
+    ++_transitions[size_t(_state)][size_t(event)];
+    State next = State(cell - 2);
+    if (next != _state)
+    {
+        ATM_TRACE(TraceKind::State, stateName(_state), stateName(next), 0);
+        _state = next;
+    }
+    return Status::okStatus();
+}
+
+Status Controller::dispatch(Event event) const
+{
+    if (kTransitions[size_t(_state)][size_t(event)] != to(_state))
+    {
+        return Status::error(Err::InvalidState);
+    }
+
+    ++_transitions[size_t(_state)][size_t(event)];
+    return Status::okStatus();
+}
+
+Controller::~Controller()
+{
+    cancelPrefetch();
+}
+
+void Controller::endSession(void)
+{
+    cancelPrefetch();
+    _card.reset();
+    _account.reset();
+    _pinReference.reset();
+    _cache.clear();
+    _pinAttempts = 0;
+    (void)dispatch(Event::CardEjected);
+}
+
+const char* Controller::stateName(State state)
+{
+    switch (state)
+    {
+    case State::Idle:            return "Idle";
+    case State::CardInserted:    return "CardInserted";
+    case State::Authenticated:   return "Authenticated";
+    case State::AccountSelected: return "AccountSelected";
+    default:                     return "Unknown";
+    }
+}
+
+const char* Controller::eventName(Event event)
+{
+    switch (event)
+    {
+    case Event::CardRead:       return "CardRead";
+    case Event::PinAccepted:    return "PinAccepted";
+    case Event::PinRejected:    return "PinRejected";
+    case Event::AccountsListed: return "AccountsListed";
+    case Event::AccountChosen:  return "AccountChosen";
+    case Event::BalanceRead:    return "BalanceRead";
+    case Event::Deposited:      return "Deposited";
+    case Event::Withdrawn:      return "Withdrawn";
+    case Event::CardEjected:    return "CardEjected";
+    default:                    return "Unknown";
+    }
+}
+
+// Snapshot
+Result<SessionRecord> Controller::snapshot(const SessionKey& key) const
+{
+    SessionRecord record;
+    record.state = uint8_t(_state);
+    record.pinAttempts = uint8_t(min(_pinAttempts, 255));
+    record.savedAtMs = chrono::duration_cast<chrono::milliseconds>(
+        chrono::system_clock::now().time_since_epoch()).count();
+
+    auto copyId = [](char (&out)[48], const char* id) {
+        size_t length = strlen(id);
+        if (length >= sizeof(out))
+        {
+            return false;
+        }
+        memcpy(out, id, length);
+        return true;
+    };
+    if ((_card && !copyId(record.card, _card->c_str()))
+        || (_account && !copyId(record.account, _account->c_str())))
+    {
+        return Err::InvalidArg;
+    }
+
+    record.seal(key);
+    return record;
+}
+
+Status Controller::restore(const SessionRecord& record, const SessionKey& key, chrono::seconds maxAge)
+{
+    if (!accepts(Event::CardRead))
+    {
+        return Status::error(Err::InvalidState);
+    }
+
+    auto now = chrono::system_clock::now();
+    auto savedAt = chrono::system_clock::time_point(chrono::milliseconds(record.savedAtMs));
+    State state = State(record.state);
+    size_t cardLength = strnlen(record.card, sizeof(record.card));
+    size_t accountLength = strnlen(record.account, sizeof(record.account));
+
+    // An old, damaged or forged record must not resume an authenticated session
+    if (!record.intact(key) || savedAt > now || now - savedAt > maxAge
+        || state < State::CardInserted || state > State::AccountSelected
+        || cardLength == 0 || cardLength == sizeof(record.card)
+        || accountLength == sizeof(record.account)
+        || (state == State::AccountSelected) != (accountLength > 0)
+        || int(record.pinAttempts) >= _cfg.maxPinAttempts)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    // The PIN is not asked again: the reader must hold the card the session was opened with
+    Card card = Card(string(record.card, cardLength));
+    Result<Card> inserted = Err::HardwareError;
+    optional<PinReference> reference;
+    try {
+        inserted = timed(ControllerMetrics::Call::ReadCard, [&] { return _cardReader.read(); });
+        if (inserted.isOk() && inserted.value() == card)
+        {
+            // As insertCard() does: the card, not the record, holds the reference
+            reference = _cfg.pinVerifier ? _cardReader.pinReference() : nullopt;
+        }
+    }
+    catch (const std::exception& e) {
+        return Status::error(translated("restore", "exception", Err::HardwareError));
+    }
+    catch (...) {
+        return Status::error(translated("restore", "unknown", Err::SystemError));
+    }
+    if (!inserted.isOk())
+    {
+        return Status::error(inserted.error());
+    }
+    if (inserted.value() != card)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    _card = card;
+    if (accountLength > 0)
+    {
+        _account = AccountId(string(record.account, accountLength));
+    }
+    _pinReference = reference;
+    _cache.clear();
+    _pinAttempts = record.pinAttempts;
+
+    // Walk the same transitions the session took the first time
+    (void)dispatch(Event::CardRead);
+    if (state >= State::Authenticated)
+    {
+        (void)dispatch(Event::PinAccepted);
+    }
+    if (state == State::AccountSelected)
+    {
+        (void)dispatch(Event::AccountChosen);
+    }
+    return Status::okStatus();
+}
+
 // Card
 Status Controller::insertCard(void)
+{
+    return timed(ControllerMetrics::Op::InsertCard, [&] { return insertCardImpl(); });
+}
+
+Status Controller::insertCardImpl(void)
 {
     try {
-        if (_state != State::Idle)
+        if (!accepts(Event::CardRead))
         {
             return Status::error(Err::InvalidState);
         }
 
-        auto result = _cardReader.read();
+        auto result = timed(ControllerMetrics::Call::ReadCard, [&] { return _cardReader.read(); });
         if (!result.isOk()) return Status::error(result.error());
 
-        _card = result.value();
+        _card = result.take();
+        _pinReference = _cfg.pinVerifier ? _cardReader.pinReference() : nullopt;
+        _cache.clear();
         _pinAttempts = 0;
-        _state = State::CardInserted;
-
-        return Status::okStatus();
+        return dispatch(Event::CardRead);
     }
     catch (const std::bad_alloc& e) {
-        return Status::error(Err::MemoryError);
+        return Status::error(translated("insertCard", "bad_alloc", Err::MemoryError));
     }
     catch (const std::runtime_error& e) {
-        return Status::error(Err::HardwareError);
+        return Status::error(translated("insertCard", "runtime_error", Err::HardwareError));
     }
     catch (const std::exception& e) {
-        return Status::error(Err::SystemError);
+        return Status::error(translated("insertCard", "exception", Err::SystemError));
     }
     catch (...) {
-        return Status::error(Err::SystemError);
+        return Status::error(translated("insertCard", "unknown", Err::SystemError));
     }
 }
 
 Status Controller::ejectCard(void)
+{
+    return timed(ControllerMetrics::Op::EjectCard, [&] { return ejectCardImpl(); });
+}
+
+Status Controller::ejectCardImpl(void)
 {
     try {
-        if (_state == State::Idle)
+        if (!accepts(Event::CardEjected))
         {
             return Status::error(Err::InvalidState);
         }
 
-        _cardReader.eject();
-        _card.reset();
-        _account.reset();
-
-        _pinAttempts = 0;
-        _state = State::Idle;
-
+        (void)timed(ControllerMetrics::Call::EjectCard, [&] { return _cardReader.eject(); });
+        endSession();
         return Status::okStatus();
     }
     catch (const std::runtime_error& e) {
         // Reset state anyway to avoid getting stuck
-        _card.reset();
-        _account.reset();
-        _pinAttempts = 0;
-        _state = State::Idle;
-        return Status::error(Err::HardwareError);
+        endSession();
+        return Status::error(translated("ejectCard", "runtime_error", Err::HardwareError));
     }
     catch (const std::exception& e) {
         // Reset state anyway to avoid getting stuck
-        _card.reset();
-        _account.reset();
-        _pinAttempts = 0;
-        _state = State::Idle;
-        return Status::error(Err::SystemError);
+        endSession();
+        return Status::error(translated("ejectCard", "exception", Err::SystemError));
     }
     catch (...) {
         // Reset state anyway to avoid getting stuck
-        _card.reset();
-        _account.reset();
-        _pinAttempts = 0;
-        _state = State::Idle;
-        return Status::error(Err::SystemError);
+        endSession();
+        return Status::error(translated("ejectCard", "unknown", Err::SystemError));
     }
 }
 
 // Bank
 Status Controller::enterPin(const Pin& pin)
+{
+    return timed(ControllerMetrics::Op::EnterPin, [&] { return enterPinImpl(pin); });
+}
+
+Status Controller::enterPinImpl(const Pin& pin)
 {
     try {
-        if (_state != State::CardInserted)
+        if (!accepts(Event::PinAccepted))
         {
             return Status::error(Err::InvalidState);
         }
@@ -96,36 +331,140 @@ Status Controller::enterPin(const Pin& pin)
             return Status::error(Err::CardAbsent);
         }
 
-        if (!_bank.verifyPin(*_card, pin).isOk())
+        // Offline check first; the bank is only asked when it cannot decide
+        auto verdict = OfflinePinVerifier::Verdict::Unknown;
+        if (_cfg.pinVerifier)
+        {
+            verdict = _cfg.pinVerifier->verify(*_card, pin, _pinReference);
+            ATM_TRACE(TraceKind::Instant, "offlinePin", verdict == OfflinePinVerifier::Verdict::Unknown
+                      ? "unknown" : "decided", int64_t(verdict));
+        }
+
+        bool verified = verdict == OfflinePinVerifier::Verdict::Match;
+        if (verdict == OfflinePinVerifier::Verdict::Unknown)
+        {
+            verified = timed(ControllerMetrics::Call::VerifyPin, [&] { return _bank.verifyPin(*_card, pin); }).isOk();
+            if (verified && _cfg.pinVerifier)
+            {
+                _cfg.pinVerifier->remember(*_card, pin);
+            }
+        }
+
+        if (!verified)
         {
             ++_pinAttempts;
+            (void)dispatch(Event::PinRejected);
             if (_pinAttempts >= _cfg.maxPinAttempts)
             {
-                Controller::ejectCard();
-                return Status::error(Err::PinFailed);
+                (void)Controller::ejectCard();
             }
             return Status::error(Err::PinFailed);
         }
 
-        _state = State::Authenticated;
-
-        return Status::okStatus();
+        if (_cfg.prefetch)
+        {
+            startPrefetch();
+        }
+        return dispatch(Event::PinAccepted);
     }
     catch (const std::runtime_error& e) {
-        return Status::error(Err::NetworkError);
+        return Status::error(translated("enterPin", "runtime_error", Err::NetworkError));
     }
     catch (const std::exception& e) {
-        return Status::error(Err::SystemError);
+        return Status::error(translated("enterPin", "exception", Err::SystemError));
+    }
+    catch (...) {
+        return Status::error(translated("enterPin", "unknown", Err::SystemError));
+    }
+}
+
+void Controller::startPrefetch(void)
+{
+    auto cancelled = make_shared<atomic<bool>>(false);
+    IBank* bank = &_bank;
+    Card card = *_card;
+    try {
+        auto answer = _cfg.prefetch->submit([bank, card, cancelled] {
+            // Ejected before a worker got to it: leave the bank alone
+            if (cancelled->load(memory_order_acquire))
+            {
+                return vector<AccountBalance>();
+            }
+            return bank->getBalances(card);
+        });
+        _prefetch = Prefetch{ move(answer), move(cancelled) };
     }
     catch (...) {
-        return Status::error(Err::SystemError);
+        // Without a prefetch the reads ask the bank themselves
+        ATM_TRACE(TraceKind::Error, "prefetch", "submit", int64_t(Err::MemoryError));
     }
 }
 
+void Controller::absorbPrefetch(void) const
+{
+    if (!_prefetch)
+    {
+        return;
+    }
+
+    Prefetch prefetch = move(*_prefetch);
+    _prefetch.reset();
+    try {
+        auto balances = timed(ControllerMetrics::Call::GetBalances, [&] { return prefetch.answer.get(); });
+        vector<AccountId> accounts;
+        accounts.reserve(balances.size());
+        for (const AccountBalance& entry : balances)
+        {
+            accounts.push_back(entry.accountId);
+            // Queued deposits can only be added to a balance read under the queue's guard
+            if (entry.balance.isOk() && !_cfg.depositQueue)
+            {
+                _cache.storeBalance(entry.accountId, entry.balance.value());
+            }
+        }
+        _cache.storeAccounts(accounts);
+    }
+    catch (...) {
+        ATM_TRACE(TraceKind::Instant, "prefetch", "failed", int64_t(Err::NetworkError));
+    }
+}
+
+void Controller::cancelPrefetch(void)
+{
+    if (_prefetch)
+    {
+        _prefetch->cancelled->store(true, memory_order_release);
+        _prefetch.reset();
+    }
+}
+
+vector<AccountId> Controller::fetchAccounts(void) const
+{
+    if (!caching())
+    {
+        return timed(ControllerMetrics::Call::ListAccounts, [&] { return _bank.listAccounts(*_card); });
+    }
+
+    absorbPrefetch();
+    if (auto cached = _cache.accounts())
+    {
+        return *cached;
+    }
+
+    auto accounts = timed(ControllerMetrics::Call::ListAccounts, [&] { return _bank.listAccounts(*_card); });
+    _cache.storeAccounts(accounts);
+    return accounts;
+}
+
 Result<vector<AccountId>> Controller::listAccounts() const
+{
+    return timed(ControllerMetrics::Op::ListAccounts, [&] { return listAccountsImpl(); });
+}
+
+Result<vector<AccountId>> Controller::listAccountsImpl() const
 {
     try {
-        if (_state != State::Authenticated)
+        if (!accepts(Event::AccountsListed))
         {
             return Err::InvalidState;
         }
@@ -135,23 +474,30 @@ Result<vector<AccountId>> Controller::listAccounts() const
             return Err::CardAbsent;
         }
 
-        return _bank.listAccounts(*_card);
+        auto accounts = fetchAccounts();
+        (void)dispatch(Event::AccountsListed);
+        return accounts;
     }
     catch (const std::runtime_error& e) {
-        return Err::NetworkError;
+        return translated("listAccounts", "runtime_error", Err::NetworkError);
     }
     catch (const std::exception& e) {
-        return Err::SystemError;
+        return translated("listAccounts", "exception", Err::SystemError);
     }
     catch (...) {
-        return Err::SystemError;
+        return translated("listAccounts", "unknown", Err::SystemError);
     }
 }
 
 Status Controller::selectAccount(const AccountId& accountId)
+{
+    return timed(ControllerMetrics::Op::SelectAccount, [&] { return selectAccountImpl(accountId); });
+}
+
+Status Controller::selectAccountImpl(const AccountId& accountId)
 {
     try {
-        if (_state != State::Authenticated)
+        if (!accepts(Event::AccountChosen))
         {
             return Status::error(Err::InvalidState);
         }
@@ -161,7 +507,7 @@ Status Controller::selectAccount(const AccountId& accountId)
             return Status::error(Err::CardAbsent);
         }
 
-        auto accounts = _bank.listAccounts(*_card);
+        auto accounts = fetchAccounts();
         bool found = false;
 
         for (auto& a : accounts)
@@ -179,25 +525,28 @@ Status Controller::selectAccount(const AccountId& accountId)
         }
 
         _account = accountId;
-        _state = State::AccountSelected;
-
-        return Status::okStatus();
+        return dispatch(Event::AccountChosen);
     }
     catch (const std::runtime_error& e) {
-        return Status::error(Err::NetworkError);
+        return Status::error(translated("selectAccount", "runtime_error", Err::NetworkError));
     }
     catch (const std::exception& e) {
-        return Status::error(Err::SystemError);
+        return Status::error(translated("selectAccount", "exception", Err::SystemError));
     }
     catch (...) {
-        return Status::error(Err::SystemError);
+        return Status::error(translated("selectAccount", "unknown", Err::SystemError));
     }
 }
 
 Result<int> Controller::getBalance(void) const
+{
+    return timed(ControllerMetrics::Op::GetBalance, [&] { return getBalanceImpl(); });
+}
+
+Result<int> Controller::getBalanceImpl(void) const
 {
     try {
-        if (_state != State::AccountSelected)
+        if (!accepts(Event::BalanceRead))
         {
             return Err::InvalidState;
         }
@@ -207,23 +556,58 @@ Result<int> Controller::getBalance(void) const
             return Err::AccountNotSelected;
         }
 
-        return _bank.getBalance(*_account);
+        // Balance inquiry is disabled while the bank link is down, even from the cache
+        if (refusedWhileDegraded("getBalance"))
+        {
+            return Err::NetworkError;
+        }
+
+        if (caching())
+        {
+            absorbPrefetch();
+            if (auto cached = _cache.balance(*_account))
+            {
+                (void)dispatch(Event::BalanceRead);
+                return *cached;
+            }
+        }
+
+        auto read = [&] {
+            return timed(ControllerMetrics::Call::GetBalance, [&] { return _bank.getBalance(*_account); });
+        };
+        // Queued deposits are shown as soon as the customer made them
+        auto balance = _cfg.depositQueue ? _cfg.depositQueue->withPending(*_account, read) : read();
+        if (balance.isOk())
+        {
+            if (caching())
+            {
+                _cache.storeBalance(*_account, balance.value());
+            }
+            (void)dispatch(Event::BalanceRead);
+        }
+
+        return balance;
     }
     catch (const std::runtime_error& e) {
-        return Err::NetworkError;
+        return translated("getBalance", "runtime_error", Err::NetworkError);
     }
     catch (const std::exception& e) {
-        return Err::SystemError;
+        return translated("getBalance", "exception", Err::SystemError);
     }
     catch (...) {
-        return Err::SystemError;
+        return translated("getBalance", "unknown", Err::SystemError);
     }
 }
 
 Status Controller::deposit(int money)
+{
+    return timed(ControllerMetrics::Op::Deposit, [&] { return depositImpl(money); });
+}
+
+Status Controller::depositImpl(int money)
 {
     try {
-        if (_state != State::AccountSelected)
+        if (!accepts(Event::Deposited))
         {
             return Status::error(Err::InvalidState);
         }
@@ -238,23 +622,64 @@ Status Controller::deposit(int money)
             return Status::error(Err::InvalidArg);
         }
 
-        return _bank.deposit(*_account, money);
+        // Only the durable queue may accept a deposit the bank cannot take now
+        if (!_cfg.depositQueue && refusedWhileDegraded("deposit"))
+        {
+            return Status::error(Err::NetworkError);
+        }
+
+        auto post = [&] {
+            return timed(ControllerMetrics::Call::Deposit, [&] {
+                if (!_cfg.depositQueue)
+                {
+                    return _bank.deposit(*_account, money);
+                }
+                auto key = _cfg.depositQueue->enqueue(*_account, money);
+                return key.isOk() ? Status::okStatus() : Status::error(key.error());
+            });
+        };
+
+        Status status;
+        try {
+            status = post();
+        }
+        catch (...) {
+            _cache.invalidateBalance(*_account);
+            throw;
+        }
+
+        if (status.isOk())
+        {
+            _cache.adjustBalance(*_account, money);
+            (void)dispatch(Event::Deposited);
+        }
+        else
+        {
+            _cache.invalidateBalance(*_account);
+        }
+
+        return status;
     }
     catch (const std::runtime_error& e) {
-        return Status::error(Err::NetworkError);
+        return Status::error(translated("deposit", "runtime_error", Err::NetworkError));
     }
     catch (const std::exception& e) {
-        return Status::error(Err::SystemError);
+        return Status::error(translated("deposit", "exception", Err::SystemError));
     }
     catch (...) {
-        return Status::error(Err::SystemError);
+        return Status::error(translated("deposit", "unknown", Err::SystemError));
     }
 }
 
 Status Controller::withdraw(int money)
+{
+    return timed(ControllerMetrics::Op::Withdraw, [&] { return withdrawImpl(money); });
+}
+
+Status Controller::withdrawImpl(int money)
 {
     try {
-        if (_state != State::AccountSelected)
+        if (!accepts(Event::Withdrawn))
         {
             return Status::error(Err::InvalidState);
         }
@@ -269,59 +694,180 @@ Status Controller::withdraw(int money)
             return Status::error(Err::InvalidArg);
         }
 
-        if (!_bank.canWithdraw(*_account, money).isOk())
+        if (refusedWhileDegraded("withdraw"))
         {
-            return Status::error(Err::InsufficientBank);
+            return Status::error(Err::NetworkError);
         }
 
-        if (!_cashBin.canDispense(money).isOk())
+        // Funds are reserved with a hold, then captured once the cash is out
+        // or released if it is not, so the bank never sees a compensating deposit.
+        optional<future<Result<HoldId>>> pendingHold;
+
+        if (_asyncBank && _asyncCashBin)
+        {
+            // Independent steps: pay for one round trip instead of two
+            pendingHold = _asyncBank->placeHold(*_account, money);
+            auto cashCheck = _asyncCashBin->canDispense(money);
+
+            auto dropPendingHold = [&]() {
+                try {
+                    auto hold = pendingHold->get();
+                    if (hold.isOk())
+                    {
+                        (void)timed(ControllerMetrics::Call::ReleaseHold, [&] { return _bank.releaseHold(hold.value()); });
+                    }
+                } catch (...) {
+                }
+            };
+
+            Status cash;
+            try {
+                cash = timed(ControllerMetrics::Call::CanDispense, [&] { return cashCheck.get(); });
+            }
+            catch (...) {
+                dropPendingHold();
+                throw;
+            }
+
+            if (!cash.isOk())
+            {
+                dropPendingHold();
+                return Status::error(Err::InsufficientCashBin);
+            }
+        }
+        else if (!timed(ControllerMetrics::Call::CanDispense, [&] { return _cashBin.canDispense(money); }).isOk())
         {
+            // Local device check first: a short cash bin costs no bank round trip
             return Status::error(Err::InsufficientCashBin);
         }
 
-        TransactionManager transaction;
+        // Fixed two-step transaction kept inline: no heap traffic per withdrawal
+        InlineTransactionManager<2> transaction(_cfg.journal);
+        JournalStep holdStep{ WithdrawHold, *_account, money, 0 };
+        JournalStep dispenseStep{ WithdrawDispense, *_account, money, 0 };
         
-        // bank withdraw operation
-        transaction.addOperation(
+        // bank hold operation (two slots for two operations, so adding cannot fail)
+        (void)transaction.addOperation(
             [&]() -> Status { 
-                return _bank.withdraw(*_account, money); 
+                auto hold = timed(ControllerMetrics::Call::PlaceHold, [&] {
+                    return pendingHold ? pendingHold->get() : _bank.placeHold(*_account, money);
+                });
+                if (!hold.isOk())
+                {
+                    return Status::error(Err::InsufficientBank);
+                }
+                holdStep.arg = (int64_t)hold.value();
+                return Status::okStatus();
             },
             [&]() { 
                 try {
-                    _bank.deposit(*_account, money);
+                    (void)timed(ControllerMetrics::Call::ReleaseHold, [&] { return _bank.releaseHold((HoldId)holdStep.arg); });
                 } catch (...) {
                 }
-            }
+            },
+            &holdStep
         );
         
         // cash dispense operation
-        transaction.addOperation(
+        (void)transaction.addOperation(
             [&]() -> Status { 
-                return _cashBin.dispense(money); 
+                return timed(ControllerMetrics::Call::Dispense, [&] { return _cashBin.dispense(money); });
             },
             [&]() { 
-            }
+            },
+            &dispenseStep
         );
         
         // Execute the atomic transaction
-        Status result = transaction.execute();
+        Status result;
+        try {
+            result = transaction.execute();
+        }
+        catch (...) {
+            _cache.invalidateBalance(*_account);
+            throw;
+        }
+
         if (result.isOk()) {
-            // All operations succeeded - commit the transaction
-            transaction.commit();
+            _cache.adjustBalance(*_account, -money);
+            (void)dispatch(Event::Withdrawn);
+
+            // Cash is out, so the withdrawal stands even if settling fails.
+            // An uncaptured hold is deferred in the journal, where
+            // recoverWithdrawals() finds it and captures it.
+            Status captured = Status::error(Err::NetworkError);
+            try {
+                captured = timed(ControllerMetrics::Call::CaptureHold, [&] { return _bank.captureHold((HoldId)holdStep.arg); });
+            } catch (...) {
+            }
+
+            if (captured.isOk()) {
+                transaction.commit();
+            }
+            else {
+                ATM_TRACE(TraceKind::Error, "withdraw", "captureHold", int64_t(captured.code));
+                transaction.commitDeferred(JournalStep{ WithdrawCapture, *_account, money, holdStep.arg });
+            }
+        }
+        else {
+            // Rollback may not have restored the exact bank-side value
+            _cache.invalidateBalance(*_account);
         }
         
         return result;
     }
     catch (const std::bad_alloc& e) {
-        return Status::error(Err::MemoryError);
+        return Status::error(translated("withdraw", "bad_alloc", Err::MemoryError));
     }
     catch (const std::runtime_error& e) {
-        return Status::error(Err::NetworkError);
+        return Status::error(translated("withdraw", "runtime_error", Err::NetworkError));
     }
     catch (const std::exception& e) {
-        return Status::error(Err::SystemError);
+        return Status::error(translated("withdraw", "exception", Err::SystemError));
     }
     catch (...) {
-        return Status::error(Err::SystemError);
+        return Status::error(translated("withdraw", "unknown", Err::SystemError));
     }
 }
+
+size_t Controller::recoverWithdrawals(TransactionJournal& journal, IBank& bank)
+{
+    return journal.recover([&](uint64_t, const vector<RecoveredStep>& steps) {
+        // A dispense that never reported back is treated as not dispensed;
+        // the device counters settle that case during reconciliation. A
+        // dispensed withdrawal whose capture failed is captured here.
+        bool dispensed = false;
+        for (const auto& step : steps)
+        {
+            dispensed = dispensed || (step.op == WithdrawDispense && step.executed) || step.op == WithdrawCapture;
+        }
+
+        bool settled = true;
+        for (const auto& step : steps)
+        {
+            bool holdPlaced = (step.op == WithdrawHold && step.executed) || step.op == WithdrawCapture;
+            if (!holdPlaced)
+            {
+                continue;
+            }
+
+            // Only a transport failure is worth retrying; any other answer
+            // (e.g. the hold expired) will not change on the next run
+            Status status = Status::error(Err::NetworkError);
+            try {
+                status = dispensed ? bank.captureHold((HoldId)step.arg) : bank.releaseHold((HoldId)step.arg);
+            } catch (...) {
+            }
+            if (status.code == Err::NetworkError)
+            {
+                settled = false;
+            }
+        }
+        return settled;
+    });
+}
+
+SessionCache::Stats Controller::cacheStats(void) const
+{
+    return _cache.stats();
+}
@@ -0,0 +1,303 @@
+#include "ControllerHost.hpp"
+#include <deque>
+#include <stdexcept>
+
+struct ControllerHost::Session {
+    Controller controller;
+    size_t home;
+
+    mutex inboxMutex;
+    deque<Command> inbox;
+    bool scheduled = false;   // queued on a worker or currently running
+
+    Session(ICardReader& cardReader, IBank& bank, ICashBin& cashBin, const Controller::Config& cfg, size_t home)
+     : controller(cardReader, bank, cashBin, cfg), home(home)
+    {}
+};
+
+struct ControllerHost::Worker {
+    mutex readyMutex;
+    deque<Session*> ready;
+};
+
+static int64_t nowTicks(void)
+{
+    return chrono::steady_clock::now().time_since_epoch().count();
+}
+
+ControllerHost::ControllerHost(size_t workers)
+{
+    if (workers == 0)
+    {
+        workers = 1;
+    }
+
+    _statsStart = nowTicks();
+    for (size_t i = 0; i < workers; ++i)
+    {
+        _workers.push_back(make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workers; ++i)
+    {
+        _threads.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ControllerHost::~ControllerHost()
+{
+    drain();
+    {
+        lock_guard<mutex> lock(_idleMutex);
+        _stopping = true;
+    }
+    _idleCv.notify_all();
+    for (auto& t : _threads)
+    {
+        t.join();
+    }
+}
+
+ControllerHost::SessionId ControllerHost::addSession(ICardReader& cardReader, IBank& bank, ICashBin& cashBin)
+{
+    return addSession(cardReader, bank, cashBin, Controller::Config());
+}
+
+ControllerHost::SessionId ControllerHost::addSession(ICardReader& cardReader, IBank& bank, ICashBin& cashBin,
+                                                     const Controller::Config& cfg)
+{
+    unique_lock<shared_mutex> lock(_sessionsMutex);
+    SessionId id = _sessions.size();
+    _sessions.push_back(make_unique<Session>(cardReader, bank, cashBin, cfg, id % _workers.size()));
+    return id;
+}
+
+ControllerHost::Session* ControllerHost::findSession(SessionId id) const
+{
+    shared_lock<shared_mutex> lock(_sessionsMutex);
+    if (id >= _sessions.size())
+    {
+        return nullptr;
+    }
+    return _sessions[id].get();
+}
+
+void ControllerHost::submit(SessionId id, Command command)
+{
+    Session* session = findSession(id);
+    if (!session)
+    {
+        throw out_of_range("ControllerHost: unknown session");
+    }
+
+    _pending.fetch_add(1);
+
+    bool needsSchedule = false;
+    {
+        lock_guard<mutex> lock(session->inboxMutex);
+        session->inbox.push_back(move(command));
+        if (!session->scheduled)
+        {
+            session->scheduled = true;
+            needsSchedule = true;
+        }
+    }
+
+    if (needsSchedule)
+    {
+        schedule(session, session->home);
+    }
+}
+
+void ControllerHost::schedule(Session* session, size_t worker)
+{
+    {
+        lock_guard<mutex> lock(_idleMutex);
+        _queued.fetch_add(1);
+    }
+    {
+        lock_guard<mutex> lock(_workers[worker]->readyMutex);
+        _workers[worker]->ready.push_back(session);
+    }
+    _idleCv.notify_one();
+}
+
+ControllerHost::Session* ControllerHost::nextSession(size_t worker)
+{
+    {
+        Worker& own = *_workers[worker];
+        lock_guard<mutex> lock(own.readyMutex);
+        if (!own.ready.empty())
+        {
+            Session* session = own.ready.front();
+            own.ready.pop_front();
+            return session;
+        }
+    }
+
+    // Steal from the back of the other queues, starting at the neighbour
+    for (size_t i = 1; i < _workers.size(); ++i)
+    {
+        Worker& victim = *_workers[(worker + i) % _workers.size()];
+        lock_guard<mutex> lock(victim.readyMutex);
+        if (!victim.ready.empty())
+        {
+            Session* session = victim.ready.back();
+            victim.ready.pop_back();
+            _steals.fetch_add(1, memory_order_relaxed);
+            return session;
+        }
+    }
+
+    return nullptr;
+}
+
+void ControllerHost::runSession(Session* session, size_t worker)
+{
+    deque<Command> batch;
+    {
+        lock_guard<mutex> lock(session->inboxMutex);
+        batch.swap(session->inbox);
+    }
+
+    for (auto& command : batch)
+    {
+        try {
+            command(session->controller);
+        }
+        catch (...) {
+            // A failing command must not take the worker down
+        }
+    }
+
+    _commands.fetch_add(batch.size(), memory_order_relaxed);
+
+    bool again = false;
+    {
+        lock_guard<mutex> lock(session->inboxMutex);
+        if (session->inbox.empty())
+        {
+            session->scheduled = false;
+        }
+        else
+        {
+            again = true;
+        }
+    }
+
+    if (again)
+    {
+        schedule(session, worker);
+    }
+
+    if (_pending.fetch_sub(batch.size()) == batch.size())
+    {
+        lock_guard<mutex> lock(_drainMutex);
+        _drainCv.notify_all();
+    }
+}
+
+void ControllerHost::workerLoop(size_t worker)
+{
+    for (;;)
+    {
+        Session* session = nextSession(worker);
+        if (!session)
+        {
+            unique_lock<mutex> lock(_idleMutex);
+            _idleCv.wait(lock, [this] { return _stopping || _queued.load() > 0; });
+            if (_stopping && _queued.load() == 0)
+            {
+                return;
+            }
+            continue;
+        }
+
+        _queued.fetch_sub(1);
+        runSession(session, worker);
+    }
+}
+
+void ControllerHost::drain(void)
+{
+    unique_lock<mutex> lock(_drainMutex);
+    _drainCv.wait(lock, [this] { return _pending.load() == 0; });
+}
+
+Result<size_t> ControllerHost::saveSessions(SessionSnapshotFile& file, const SessionKey& key)
+{
+    size_t count = sessionCount();
+    vector<future<Result<SessionRecord>>> snapshots;
+    snapshots.reserve(count);
+    for (SessionId id = 0; id < count; ++id)
+    {
+        snapshots.push_back(call(id, [&key](Controller& controller) { return controller.snapshot(key); }));
+    }
+
+    vector<SessionRecord> records;
+    for (SessionId id = 0; id < count; ++id)
+    {
+        auto snapshot = snapshots[id].get();
+        if (!snapshot.isOk() || snapshot.value().state == uint8_t(Controller::State::Idle))
+        {
+            continue;
+        }
+        records.push_back(snapshot.take());
+        records.back().sessionId = id;
+        records.back().seal(key);
+    }
+
+    Status status = file.save(records);
+    if (!status.isOk())
+    {
+        return status.code;
+    }
+    return records.size();
+}
+
+size_t ControllerHost::restoreSessions(const SessionSnapshotFile& file, const SessionKey& key, chrono::seconds maxAge)
+{
+    size_t count = sessionCount();
+    vector<future<Status>> restores;
+    for (const SessionRecord& record : file.load(key))
+    {
+        if (record.sessionId < count)
+        {
+            restores.push_back(call(SessionId(record.sessionId), [record, key, maxAge](Controller& controller) {
+                return controller.restore(record, key, maxAge);
+            }));
+        }
+    }
+
+    size_t restored = 0;
+    for (auto& restore : restores)
+    {
+        restored += restore.get().isOk();
+    }
+    return restored;
+}
+
+ControllerHost::Stats ControllerHost::stats(void) const
+{
+    Stats s;
+    s.sessions = sessionCount();
+    s.commands = _commands.load(memory_order_relaxed);
+    s.steals = _steals.load(memory_order_relaxed);
+
+    auto elapsed = chrono::steady_clock::duration(nowTicks() - _statsStart.load());
+    s.elapsedSeconds = chrono::duration<double>(elapsed).count();
+    s.commandsPerSecond = s.elapsedSeconds > 0.0 ? s.commands / s.elapsedSeconds : 0.0;
+    return s;
+}
+
+void ControllerHost::resetStats(void)
+{
+    _commands = 0;
+    _steals = 0;
+    _statsStart = nowTicks();
+}
+
+size_t ControllerHost::sessionCount(void) const
+{
+    shared_lock<shared_mutex> lock(_sessionsMutex);
+    return _sessions.size();
+}
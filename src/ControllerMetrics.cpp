@@ -0,0 +1,111 @@
+#include "ControllerMetrics.hpp"
+
+ControllerMetrics::ControllerMetrics(bool timeCalls)
+ : _nsPerTick(TickClock::nsPerTick()), _timeCalls(timeCalls)
+{}
+
+LatencyHistogram::Snapshot ControllerMetrics::Snapshot::op(Op op) const
+{
+    LatencyHistogram::Snapshot total;
+    for (const auto& h : ops[size_t(op)])
+    {
+        total.merge(h);
+    }
+    return total;
+}
+
+LatencyHistogram::Snapshot ControllerMetrics::Snapshot::call(Call call) const
+{
+    LatencyHistogram::Snapshot total;
+    for (const auto& h : calls[size_t(call)])
+    {
+        total.merge(h);
+    }
+    return total;
+}
+
+void ControllerMetrics::Snapshot::merge(const Snapshot& other)
+{
+    for (size_t i = 0; i < kOps; ++i)
+    {
+        for (size_t e = 0; e < kOutcomes; ++e)
+        {
+            ops[i][e].merge(other.ops[i][e]);
+        }
+    }
+    for (size_t i = 0; i < kCalls; ++i)
+    {
+        for (size_t e = 0; e < kOutcomes; ++e)
+        {
+            calls[i][e].merge(other.calls[i][e]);
+        }
+    }
+}
+
+ControllerMetrics::Snapshot ControllerMetrics::snapshot(void) const
+{
+    Snapshot s;
+    for (size_t i = 0; i < kOps; ++i)
+    {
+        for (size_t e = 0; e < kOutcomes; ++e)
+        {
+            s.ops[i][e] = _ops[i][e].snapshot();
+        }
+    }
+    for (size_t i = 0; i < kCalls; ++i)
+    {
+        for (size_t e = 0; e < kOutcomes; ++e)
+        {
+            s.calls[i][e] = _calls[i][e].snapshot();
+        }
+    }
+    return s;
+}
+
+void ControllerMetrics::reset(void)
+{
+    for (auto& row : _ops)
+    {
+        for (auto& h : row) h.reset();
+    }
+    for (auto& row : _calls)
+    {
+        for (auto& h : row) h.reset();
+    }
+}
+
+const char* ControllerMetrics::name(Op op)
+{
+    switch (op)
+    {
+    case Op::InsertCard:    return "insertCard";
+    case Op::EnterPin:      return "enterPin";
+    case Op::ListAccounts:  return "listAccounts";
+    case Op::SelectAccount: return "selectAccount";
+    case Op::GetBalance:    return "getBalance";
+    case Op::Deposit:       return "deposit";
+    case Op::Withdraw:      return "withdraw";
+    case Op::EjectCard:     return "ejectCard";
+    default:                return "unknown";
+    }
+}
+
+const char* ControllerMetrics::name(Call call)
+{
+    switch (call)
+    {
+    case Call::ReadCard:    return "cardReader.read";
+    case Call::EjectCard:   return "cardReader.eject";
+    case Call::VerifyPin:   return "bank.verifyPin";
+    case Call::ListAccounts: return "bank.listAccounts";
+    case Call::GetBalance:  return "bank.getBalance";
+    case Call::Deposit:     return "bank.deposit";
+    case Call::PlaceHold:   return "bank.placeHold";
+    case Call::CaptureHold: return "bank.captureHold";
+    case Call::ReleaseHold: return "bank.releaseHold";
+    case Call::CanDispense: return "cashBin.canDispense";
+    case Call::Dispense:    return "cashBin.dispense";
+    case Call::GetBalances: return "bank.getBalances";
+    default:                return "unknown";
+    }
+}
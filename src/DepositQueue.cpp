@@ -0,0 +1,439 @@
+#include "DepositQueue.hpp"
+#include "EventTracer.hpp"
+#include "Fnv1a.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+    const char kMagic[8] = { 'A', 'T', 'M', 'D', 'E', 'P', 'Q', '1' };
+
+    enum SlotState : uint8_t {
+        Free = 0,
+        Queued = 1,
+        Refused = 2,    // the bank said no; kept until acknowledged
+    };
+
+    const int kSeqBits = 40;
+    const uint64_t kSeqMask = (uint64_t(1) << kSeqBits) - 1;
+
+    struct Header {
+        char magic[8];
+        uint32_t reserved[14];
+    };
+
+    struct Slot {
+        uint64_t key;
+        int32_t money;
+        uint8_t state;
+        uint8_t error;          // Err of a refused deposit
+        uint8_t reserved[2];
+        char account[44];
+        uint32_t checksum;
+    };
+
+    static_assert(sizeof(Header) == 64, "deposit queue header must be 64 bytes");
+    static_assert(sizeof(Slot) == 64, "deposit queue slot must be 64 bytes");
+
+    // FNV-1a over everything but the checksum; detects torn slots
+    uint32_t checksum(const Slot& s)
+    {
+        return fnv1a(&s, offsetof(Slot, checksum));
+    }
+}
+
+DepositQueue::DepositQueue(IBank& bank)
+ : _bank(bank)
+{}
+
+DepositQueue::~DepositQueue()
+{
+    close();
+}
+
+Status DepositQueue::open(const string& path)
+{
+    return open(path, Config());
+}
+
+Status DepositQueue::open(const string& path, const Config& cfg)
+{
+    close();
+
+    // Every resend below relies on the bank dropping keys it has already applied
+    if (cfg.capacity == 0 || cfg.batchSize == 0 || !_bank.keyedDeposits())
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    Status status = _file.open(path, sizeof(Header) + cfg.capacity * sizeof(Slot));
+    if (!status.isOk())
+    {
+        return status;
+    }
+
+    lock_guard<mutex> lock(_mutex);
+    _cfg = cfg;
+    _cfg.terminalId &= (1u << (64 - kSeqBits)) - 1;
+    _capacity = (_file.size() - sizeof(Header)) / sizeof(Slot);
+
+    Header* header = reinterpret_cast<Header*>(_file.data());
+    if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0)
+    {
+        memset(_file.data(), 0, _file.size());
+        memcpy(header->magic, kMagic, sizeof(kMagic));
+        (void)_file.sync();
+    }
+
+    // Freed slots keep their key, so the sequence survives an empty queue
+    _entries.assign(_capacity, Entry{});
+    _free.clear();
+    _queue.clear();
+    _refused.clear();
+    _pending.clear();
+    _nextSeq = 1;
+    _stats = Stats{};
+
+    const Slot* slots = reinterpret_cast<const Slot*>(_file.data() + sizeof(Header));
+    vector<size_t> queued;
+    for (size_t i = _capacity; i-- > 0; )
+    {
+        const Slot& s = slots[i];
+        bool valid = s.key != 0 && s.checksum == checksum(s);
+        if (valid)
+        {
+            _nextSeq = max(_nextSeq, (s.key & kSeqMask) + 1);
+        }
+        if (!valid || (s.state != Queued && s.state != Refused))
+        {
+            _free.push_back(i);
+            continue;
+        }
+
+        Entry& e = _entries[i];
+        e.key = s.key;
+        e.account = string(s.account, strnlen(s.account, sizeof(s.account)));
+        e.money = s.money;
+        e.error = Err(s.error);
+        if (s.state == Refused)
+        {
+            _refused.push_back(i);
+        }
+        else
+        {
+            queued.push_back(i);
+        }
+    }
+
+    sort(queued.begin(), queued.end(),
+         [&](size_t a, size_t b) { return (_entries[a].key & kSeqMask) < (_entries[b].key & kSeqMask); });
+    for (size_t slot : queued)
+    {
+        _queue.push_back(slot);
+        _pending[_entries[slot].account] += _entries[slot].money;
+    }
+    _stats.recovered = queued.size();
+
+    _posting = false;
+    _postWanted = false;
+    _flushNow = !queued.empty();
+    _stopping = false;
+    _flusher = thread([this] { run(); });
+    return Status::okStatus();
+}
+
+void DepositQueue::close(void)
+{
+    if (_flusher.joinable())
+    {
+        {
+            lock_guard<mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _wake.notify_all();
+        _changed.notify_all();
+        _flusher.join();
+    }
+
+    if (_file.isOpen())
+    {
+        (void)_file.sync();
+        _file.close();
+    }
+}
+
+void DepositQueue::writeSlot(size_t slot, uint8_t state)
+{
+    const Entry& e = _entries[slot];
+    Slot s;
+    memset(&s, 0, sizeof(s));
+    s.key = e.key;
+    s.money = e.money;
+    s.state = state;
+    s.error = uint8_t(e.error);
+    strncpy(s.account, e.account.c_str(), sizeof(s.account) - 1);
+    s.checksum = checksum(s);
+
+    Slot* slots = reinterpret_cast<Slot*>(_file.data() + sizeof(Header));
+    memcpy(&slots[slot], &s, sizeof(s));
+}
+
+void DepositQueue::release(size_t slot, uint8_t state)
+{
+    // Not synced: if this is lost, the deposit is resent under its key and answered again
+    writeSlot(slot, state);
+
+    Entry& e = _entries[slot];
+    auto it = _pending.find(e.account);
+    if (it != _pending.end() && (it->second -= e.money) == 0)
+    {
+        _pending.erase(it);
+    }
+    if (state == Refused)
+    {
+        _refused.push_back(slot);
+    }
+    else
+    {
+        _free.push_back(slot);
+    }
+}
+
+Result<uint64_t> DepositQueue::enqueue(const AccountId& accountId, int money)
+{
+    if (money <= 0 || strlen(accountId.c_str()) >= sizeof(Slot::account))
+    {
+        return Err::InvalidArg;
+    }
+
+    unique_lock<mutex> lock(_mutex);
+    if (!_file.isOpen() || _stopping)
+    {
+        return Err::InvalidState;
+    }
+
+    if (_free.empty())
+    {
+        // Back-pressure: post now and wait a bounded time for room
+        _flushNow = true;
+        _wake.notify_one();
+        if (!_changed.wait_for(lock, _cfg.fullWait, [&] { return !_free.empty() || _stopping; }) || _stopping)
+        {
+            ++_stats.rejected;
+            return Err::MemoryError;
+        }
+    }
+
+    size_t slot = _free.back();
+    _free.pop_back();
+
+    Entry& e = _entries[slot];
+    e.key = (uint64_t(_cfg.terminalId) << kSeqBits) | (_nextSeq++ & kSeqMask);
+    e.account = accountId;
+    e.money = money;
+    e.error = Err::None;
+    writeSlot(slot, Queued);
+
+    if (_cfg.syncEachDeposit)
+    {
+        Status status = _file.sync(sizeof(Header) + slot * sizeof(Slot), sizeof(Slot));
+        if (!status.isOk())
+        {
+            writeSlot(slot, Free);
+            _free.push_back(slot);
+            return status.code;
+        }
+        ++_stats.syncs;
+    }
+
+    _queue.push_back(slot);
+    _pending[accountId] += money;
+    ++_stats.enqueued;
+    if (_queue.size() >= _cfg.batchSize)
+    {
+        _wake.notify_one();
+    }
+    return e.key;
+}
+
+void DepositQueue::run(void)
+{
+    unique_lock<mutex> lock(_mutex);
+    bool backingOff = false;
+    while (true)
+    {
+        auto wait = backingOff ? _cfg.retryDelay : _cfg.flushInterval;
+        _wake.wait_for(lock, wait, [&] {
+            return _stopping || _flushNow || (!backingOff && _queue.size() >= _cfg.batchSize);
+        });
+
+        if (_queue.empty() || (_stopping && backingOff))
+        {
+            _flushNow = false;
+            if (_stopping)
+            {
+                break;
+            }
+            continue;
+        }
+
+        // Balance reads in progress finish before the batch reaches the bank
+        _postWanted = true;
+        _changed.wait(lock, [&] { return _readers == 0; });
+        _postWanted = false;
+        _posting = true;
+
+        size_t count = min(_cfg.batchSize, _queue.size());
+        vector<size_t> batch(_queue.begin(), _queue.begin() + count);
+        _queue.erase(_queue.begin(), _queue.begin() + count);
+
+        vector<DepositPosting> postings;
+        postings.reserve(count);
+        for (size_t slot : batch)
+        {
+            const Entry& e = _entries[slot];
+            postings.push_back({ e.key, e.account, e.money });
+        }
+
+        lock.unlock();
+        vector<Status> statuses;
+        try {
+            statuses = _bank.postDeposits(postings);
+        }
+        catch (...) {
+            statuses.clear();
+        }
+        if (statuses.size() != count)
+        {
+            statuses.assign(count, Status::error(Err::NetworkError));
+        }
+        lock.lock();
+
+        ++_stats.batches;
+        backingOff = false;
+        for (size_t i = count; i-- > 0; )
+        {
+            const Status& status = statuses[i];
+            if (status.code == Err::NetworkError)
+            {
+                // Keeps its place ahead of anything queued meanwhile
+                _queue.push_front(batch[i]);
+                backingOff = true;
+                continue;
+            }
+
+            if (status.isOk())
+            {
+                ++_stats.posted;
+                release(batch[i], Free);
+            }
+            else
+            {
+                ATM_TRACE(TraceKind::Instant, "depositRefused", "", int64_t(status.code));
+                ++_stats.refused;
+                _entries[batch[i]].error = status.code;
+                release(batch[i], Refused);
+            }
+        }
+        _stats.failedBatches += backingOff;
+
+        _posting = false;
+        if (_queue.empty() || backingOff)
+        {
+            _flushNow = false;
+        }
+        _changed.notify_all();
+    }
+}
+
+int64_t DepositQueue::pending(const AccountId& accountId) const
+{
+    lock_guard<mutex> lock(_mutex);
+    auto it = _pending.find(accountId);
+    return it != _pending.end() ? it->second : 0;
+}
+
+Result<int> DepositQueue::withPending(const AccountId& accountId, const function<Result<int>()>& readBalance) const
+{
+    int64_t queued = 0;
+    {
+        unique_lock<mutex> lock(_mutex);
+        _changed.wait(lock, [&] { return !_posting && !_postWanted; });
+        ++_readers;
+        auto it = _pending.find(accountId);
+        queued = it != _pending.end() ? it->second : 0;
+    }
+
+    struct Leave {
+        const DepositQueue& queue;
+        ~Leave()
+        {
+            lock_guard<mutex> lock(queue._mutex);
+            if (--queue._readers == 0)
+            {
+                queue._changed.notify_all();
+            }
+        }
+    } leave{ *this };
+
+    Result<int> balance = readBalance();
+    if (!balance.isOk())
+    {
+        return balance;
+    }
+    return int(min<int64_t>(INT_MAX, int64_t(balance.value()) + queued));
+}
+
+size_t DepositQueue::size(void) const
+{
+    lock_guard<mutex> lock(_mutex);
+    return _capacity - _free.size() - _refused.size();
+}
+
+vector<DepositQueue::RefusedDeposit> DepositQueue::refused(void) const
+{
+    lock_guard<mutex> lock(_mutex);
+    vector<RefusedDeposit> result;
+    result.reserve(_refused.size());
+    for (size_t slot : _refused)
+    {
+        const Entry& e = _entries[slot];
+        result.push_back({ e.key, e.account, e.money, e.error });
+    }
+    sort(result.begin(), result.end(),
+         [](const RefusedDeposit& a, const RefusedDeposit& b) { return (a.key & kSeqMask) < (b.key & kSeqMask); });
+    return result;
+}
+
+Status DepositQueue::acknowledgeRefused(uint64_t key)
+{
+    lock_guard<mutex> lock(_mutex);
+    auto it = find_if(_refused.begin(), _refused.end(), [&](size_t slot) { return _entries[slot].key == key; });
+    if (it == _refused.end())
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    // Not synced: a lost acknowledgement only lists the deposit again
+    size_t slot = *it;
+    _refused.erase(it);
+    writeSlot(slot, Free);
+    _free.push_back(slot);
+    _changed.notify_all();
+    return Status::okStatus();
+}
+
+bool DepositQueue::drain(chrono::milliseconds timeout)
+{
+    unique_lock<mutex> lock(_mutex);
+    _flushNow = true;
+    _wake.notify_one();
+    return _changed.wait_for(lock, timeout, [&] { return _queue.empty() && !_posting; });
+}
+
+DepositQueue::Stats DepositQueue::stats(void) const
+{
+    lock_guard<mutex> lock(_mutex);
+    return _stats;
+}
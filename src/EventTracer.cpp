@@ -0,0 +1,441 @@
+#include "EventTracer.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Single-writer ring of one thread's events
+ *
+ * Each slot is a seqlock: the writer clears the slot's stamp, stores the
+ * fields and then publishes the stamp of the event's index. A reader keeps
+ * a copy only if it saw that stamp both before and after copying.
+ */
+struct EventTracer::Ring {
+    struct Slot {
+        atomic<uint64_t> stamp{ 0 };   // index + 1 of the event held, 0 while written
+        atomic<uint64_t> ticks{ 0 };
+        atomic<const char*> name{ nullptr };
+        atomic<const char*> detail{ nullptr };
+        atomic<int64_t> arg{ 0 };
+        atomic<TraceKind> kind{ TraceKind::Instant };
+    };
+
+    Slot slots[kRingEvents];
+    atomic<uint64_t> head{ 0 };      // events ever written
+    atomic<uint64_t> cleared{ 0 };   // events before this index were cleared
+    atomic<bool> inUse{ true };      // owned by a live thread
+    uint32_t thread = 0;
+
+    void push(const TraceEvent& event)
+    {
+        uint64_t h = head.load(memory_order_relaxed);
+        Slot& slot = slots[h & (kRingEvents - 1)];
+        slot.stamp.store(0, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        slot.ticks.store(event.ticks, memory_order_relaxed);
+        slot.name.store(event.name, memory_order_relaxed);
+        slot.detail.store(event.detail, memory_order_relaxed);
+        slot.arg.store(event.arg, memory_order_relaxed);
+        slot.kind.store(event.kind, memory_order_relaxed);
+        slot.stamp.store(h + 1, memory_order_release);
+        head.store(h + 1, memory_order_release);
+    }
+
+    /**
+     * @brief Visit the retained events, skipping any overwritten meanwhile
+     */
+    template <typename F>
+    void forEach(F&& visit) const
+    {
+        uint64_t end = head.load(memory_order_acquire);
+        uint64_t begin = max(cleared.load(memory_order_relaxed),
+                             end > kRingEvents ? end - kRingEvents : 0);
+        for (uint64_t i = begin; i < end; ++i)
+        {
+            const Slot& slot = slots[i & (kRingEvents - 1)];
+            if (slot.stamp.load(memory_order_acquire) != i + 1)
+            {
+                continue;
+            }
+
+            TraceEvent event;
+            event.ticks = slot.ticks.load(memory_order_relaxed);
+            event.name = slot.name.load(memory_order_relaxed);
+            event.detail = slot.detail.load(memory_order_relaxed);
+            event.arg = slot.arg.load(memory_order_relaxed);
+            event.kind = slot.kind.load(memory_order_relaxed);
+            event.thread = thread;
+            atomic_thread_fence(memory_order_acquire);
+
+            // The writer may have lapped us while we copied
+            if (slot.stamp.load(memory_order_relaxed) != i + 1)
+            {
+                continue;
+            }
+            visit(event);
+        }
+    }
+};
+
+namespace {
+    static_assert((EventTracer::kRingEvents & (EventTracer::kRingEvents - 1)) == 0,
+                  "ring size must be a power of two");
+
+    /**
+     * @brief Hands the thread's ring back to the tracer when the thread exits
+     */
+    struct RingLease {
+        EventTracer::Ring* ring = nullptr;
+
+        ~RingLease()
+        {
+            if (ring) ring->inUse.store(false, memory_order_release);
+        }
+    };
+
+    thread_local RingLease t_lease;
+
+    int g_crashFd = -1;
+    char g_crashBuffer[8192];   // the crash handler must not allocate
+
+    const char* kindPhase(TraceKind kind)
+    {
+        switch (kind)
+        {
+        case TraceKind::Begin: return "B";
+        case TraceKind::End:   return "E";
+        default:               return "i";
+        }
+    }
+
+    /**
+     * @brief Appends JSON text to a fixed buffer, handing it to a sink when full
+     *
+     * Only does async-signal-safe work, so the crash handler can use it.
+     */
+    class TraceText {
+    private:
+        char* _buffer;
+        size_t _size;
+        size_t _used = 0;
+        void (*_sink)(void*, const char*, size_t);
+        void* _context;
+
+    public:
+        TraceText(char* buffer, size_t size, void (*sink)(void*, const char*, size_t), void* context)
+         : _buffer(buffer), _size(size), _sink(sink), _context(context)
+        {}
+
+        void put(char c)
+        {
+            if (_used == _size)
+            {
+                flush();
+            }
+            _buffer[_used++] = c;
+        }
+
+        void put(const char* text)
+        {
+            for (; text && *text; ++text)
+            {
+                put(*text);
+            }
+        }
+
+        void put(uint64_t value)
+        {
+            char digits[20];
+            size_t count = 0;
+            do
+            {
+                digits[count++] = char('0' + value % 10);
+                value /= 10;
+            } while (value);
+            while (count)
+            {
+                put(digits[--count]);
+            }
+        }
+
+        void put(int64_t value)
+        {
+            if (value < 0)
+            {
+                put('-');
+                put(uint64_t(0) - uint64_t(value));
+                return;
+            }
+            put(uint64_t(value));
+        }
+
+        /**
+         * @brief Nanoseconds as microseconds with three decimals
+         */
+        void putMicros(uint64_t ns)
+        {
+            put(ns / 1000);
+            put('.');
+            put(char('0' + ns / 100 % 10));
+            put(char('0' + ns / 10 % 10));
+            put(char('0' + ns % 10));
+        }
+
+        void flush(void)
+        {
+            if (_used)
+            {
+                _sink(_context, _buffer, _used);
+                _used = 0;
+            }
+        }
+    };
+
+    void writeFile(void* context, const char* data, size_t size)
+    {
+        fwrite(data, 1, size, static_cast<FILE*>(context));
+    }
+
+    void writeFd(void* context, const char* data, size_t size)
+    {
+        int fd = *static_cast<int*>(context);
+        while (size > 0)
+        {
+#if defined(_WIN32)
+            int written = _write(fd, data, unsigned(size));
+#else
+            ssize_t written = write(fd, data, size);
+#endif
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written <= 0)
+            {
+                return;
+            }
+            data += written;
+            size -= size_t(written);
+        }
+    }
+
+}
+
+EventTracer::EventTracer()
+ : _originTicks(TickClock::now()), _nsPerTick(TickClock::nsPerTick())
+{}
+
+EventTracer& EventTracer::instance(void)
+{
+    // Never destroyed: threads may still trace during static destruction
+    static EventTracer* tracer = new EventTracer();
+    return *tracer;
+}
+
+EventTracer::Ring* EventTracer::threadRing(void)
+{
+    if (t_lease.ring)
+    {
+        return t_lease.ring;
+    }
+
+    lock_guard<mutex> lock(_registerMutex);
+
+    // Reuse the ring of a thread that has exited, keeping its events until overwritten
+    size_t count = _ringCount.load(memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Ring* ring = _rings[i].load(memory_order_relaxed);
+        if (!ring->inUse.load(memory_order_acquire))
+        {
+            ring->inUse.store(true, memory_order_relaxed);
+            t_lease.ring = ring;
+            return ring;
+        }
+    }
+
+    if (count == kMaxThreads)
+    {
+        return nullptr;
+    }
+
+    Ring* ring = new Ring();
+    ring->thread = uint32_t(count + 1);
+    _rings[count].store(ring, memory_order_release);
+    _ringCount.store(count + 1, memory_order_release);
+    t_lease.ring = ring;
+    return ring;
+}
+
+void EventTracer::record(TraceKind kind, const char* name, const char* detail, int64_t arg)
+{
+    Ring* ring = threadRing();
+    if (!ring)
+    {
+        return;
+    }
+
+    TraceEvent event;
+    event.ticks = TickClock::now();
+    event.name = name;
+    event.detail = detail;
+    event.arg = arg;
+    event.kind = kind;
+    ring->push(event);
+}
+
+vector<TraceEvent> EventTracer::collect(void) const
+{
+    vector<TraceEvent> events;
+    size_t count = _ringCount.load(memory_order_acquire);
+    for (size_t i = 0; i < count; ++i)
+    {
+        _rings[i].load(memory_order_acquire)->forEach([&](const TraceEvent& e) { events.push_back(e); });
+    }
+
+    stable_sort(events.begin(), events.end(),
+                [](const TraceEvent& a, const TraceEvent& b) { return a.ticks < b.ticks; });
+    return events;
+}
+
+void EventTracer::clear(void)
+{
+    size_t count = _ringCount.load(memory_order_acquire);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Ring* ring = _rings[i].load(memory_order_acquire);
+        ring->cleared.store(ring->head.load(memory_order_acquire), memory_order_relaxed);
+    }
+}
+
+void EventTracer::writeChromeTrace(FILE* out) const
+{
+    char buffer[4096];
+    writeChromeTrace(buffer, sizeof(buffer), writeFile, out);
+}
+
+void EventTracer::writeChromeTrace(char* buffer, size_t size, Sink sink, void* context) const
+{
+    TraceText out(buffer, size, sink, context);
+    out.put("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    bool first = true;
+    size_t count = _ringCount.load(memory_order_acquire);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Ring* ring = _rings[i].load(memory_order_acquire);
+        out.put(first ? "" : ",\n");
+        out.put("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+        out.put(uint64_t(ring->thread));
+        out.put(",\"args\":{\"name\":\"thread ");
+        out.put(uint64_t(ring->thread));
+        out.put("\"}}");
+        first = false;
+
+        ring->forEach([&](const TraceEvent& e) {
+            double ns = double(e.ticks - _originTicks) * _nsPerTick;
+            out.put(",\n{\"name\":\"");
+            out.put(e.name);
+            out.put("\",\"ph\":\"");
+            out.put(kindPhase(e.kind));
+            out.put("\",\"ts\":");
+            out.putMicros(ns > 0 ? uint64_t(ns) : 0);
+            out.put(",\"pid\":1,\"tid\":");
+            out.put(uint64_t(e.thread));
+
+            switch (e.kind)
+            {
+            case TraceKind::State:
+                out.put(",\"cat\":\"state\",\"s\":\"t\",\"args\":{\"from\":\"");
+                out.put(e.name);
+                out.put("\",\"to\":\"");
+                out.put(e.detail);
+                out.put("\"}}");
+                break;
+            case TraceKind::Error:
+                out.put(",\"cat\":\"error\",\"s\":\"t\",\"args\":{\"exception\":\"");
+                out.put(e.detail);
+                out.put("\",\"err\":");
+                out.put(e.arg);
+                out.put("}}");
+                break;
+            case TraceKind::Instant:
+                out.put(",\"s\":\"t\",\"args\":{\"detail\":\"");
+                out.put(e.detail);
+                out.put("\",\"arg\":");
+                out.put(e.arg);
+                out.put("}}");
+                break;
+            default:
+                out.put("}");
+                break;
+            }
+        });
+    }
+
+    out.put("\n]}\n");
+    out.flush();
+}
+
+Status EventTracer::writeChromeTrace(const string& path) const
+{
+    FILE* out = fopen(path.c_str(), "w");
+    if (!out)
+    {
+        return Status::error(Err::SystemError);
+    }
+
+    writeChromeTrace(out);
+    return fclose(out) == 0 ? Status::okStatus() : Status::error(Err::SystemError);
+}
+
+void EventTracer::onCrash(int sig)
+{
+    if (g_crashFd >= 0)
+    {
+        instance().writeChromeTrace(g_crashBuffer, sizeof(g_crashBuffer), writeFd, &g_crashFd);
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+Status EventTracer::installCrashHandler(const string& path)
+{
+#if defined(_WIN32)
+    int fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+    if (fd < 0)
+    {
+        return Status::error(Err::SystemError);
+    }
+
+    if (g_crashFd >= 0)
+    {
+#if defined(_WIN32)
+        _close(g_crashFd);
+#else
+        ::close(g_crashFd);
+#endif
+    }
+    g_crashFd = fd;
+
+    // Make sure the tracer exists before a crash needs it
+    (void)instance();
+
+    signal(SIGSEGV, onCrash);
+    signal(SIGABRT, onCrash);
+    signal(SIGFPE, onCrash);
+    signal(SIGILL, onCrash);
+#ifdef SIGBUS
+    signal(SIGBUS, onCrash);
+#endif
+    return Status::okStatus();
+}
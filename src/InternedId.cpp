@@ -0,0 +1,131 @@
+#include "InternedId.hpp"
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+    /**
+     * @brief Lock-striped map of reference-counted canonical strings
+     *
+     * Lookups of already interned values only take a shared lock on one
+     * stripe; nodes never move, so handles stay valid until released.
+     */
+    class InternTable {
+    private:
+        static const size_t kStripes = 64;
+
+        struct alignas(64) Stripe {
+            shared_mutex mutex;
+            unordered_map<string_view, unique_ptr<InternedString>> values;  // keys view into the nodes
+        };
+
+        Stripe _stripes[kStripes];
+
+    public:
+        const InternedString* intern(const string& value)
+        {
+            size_t hashed = hash<string>()(value);
+            size_t index = hashed % kStripes;
+            Stripe& stripe = _stripes[index];
+            {
+                shared_lock<shared_mutex> lock(stripe.mutex);
+                auto it = stripe.values.find(string_view(value));
+                if (it != stripe.values.end())
+                {
+                    it->second->refs.fetch_add(1, memory_order_relaxed);
+                    return it->second.get();
+                }
+            }
+
+            unique_lock<shared_mutex> lock(stripe.mutex);
+            auto it = stripe.values.find(string_view(value));
+            if (it == stripe.values.end())
+            {
+                auto node = make_unique<InternedString>();
+                node->value = value;
+                node->hash = hashed;
+                node->stripe = index;
+                string_view key(node->value);
+                it = stripe.values.emplace(key, move(node)).first;
+            }
+            it->second->refs.fetch_add(1, memory_order_relaxed);
+            return it->second.get();
+        }
+
+        size_t size(void)
+        {
+            size_t count = 0;
+            for (Stripe& stripe : _stripes)
+            {
+                shared_lock<shared_mutex> lock(stripe.mutex);
+                count += stripe.values.size();
+            }
+            return count;
+        }
+
+        void release(const InternedString* value) noexcept
+        {
+            auto* node = const_cast<InternedString*>(value);
+
+            // Not the last handle: no lock needed
+            size_t refs = node->refs.load(memory_order_relaxed);
+            while (refs > 1)
+            {
+                if (node->refs.compare_exchange_weak(refs, refs - 1, memory_order_acq_rel, memory_order_relaxed))
+                {
+                    return;
+                }
+            }
+
+            // Possibly the last one: decide under the stripe lock, where intern() cannot revive it
+            Stripe& stripe = _stripes[node->stripe];
+            unique_lock<shared_mutex> lock(stripe.mutex);
+            if (node->refs.fetch_sub(1, memory_order_acq_rel) == 1)
+            {
+                stripe.values.erase(stripe.values.find(string_view(node->value)));
+            }
+        }
+    };
+
+    InternTable& table(void)
+    {
+        // Never destroyed: handles in static storage may outlive it otherwise
+        static InternTable* const instance = new InternTable();
+        return *instance;
+    }
+}
+
+const InternedString* emptyString(void) noexcept
+{
+    static InternedString* const empty = [] {
+        auto* node = new InternedString();
+        node->hash = hash<string>()(node->value);
+        node->pinned = true;
+        return node;
+    }();
+    return empty;
+}
+
+const InternedString* internString(const string& value)
+{
+    if (value.empty())
+    {
+        return emptyString();
+    }
+    return table().intern(value);
+}
+
+void releaseString(const InternedString* value) noexcept
+{
+    if (!value->pinned)
+    {
+        table().release(value);
+    }
+}
+
+size_t internedStrings(void)
+{
+    return table().size();
+}
@@ -0,0 +1,28 @@
+#include "LatencyHistogram.hpp"
+#include <chrono>
+
+uint64_t TickClock::steadyNs(void)
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double TickClock::nsPerTick(void)
+{
+    static const double ratio = [] {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+        // Measure the timestamp counter against the steady clock for ~1ms
+        uint64_t ns0 = steadyNs();
+        uint64_t t0 = now();
+        uint64_t ns1 = ns0;
+        while (ns1 - ns0 < 1000000) {
+            ns1 = steadyNs();
+        }
+        uint64_t t1 = now();
+        return t1 > t0 ? double(ns1 - ns0) / double(t1 - t0) : 1.0;
+#else
+        return 1.0;
+#endif
+    }();
+    return ratio;
+}
@@ -0,0 +1,917 @@
+#include "LedgerBank.hpp"
+#include "Fnv1a.hpp"
+#include "OfflinePinVerifier.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    const char kSnapshotMagic[8] = { 'A', 'T', 'M', 'L', 'D', 'G', 'S', '1' };
+    const char kLogMagic[8] = { 'A', 'T', 'M', 'L', 'D', 'G', 'L', '1' };
+    const size_t kNoSlot = SIZE_MAX;
+
+    enum RecordType : uint8_t {
+        Opened = 1,
+        Deposited = 2,
+        Withdrawn = 3,
+        Held = 4,
+        Captured = 5,
+        Released = 6,
+        Posted = 7,     // deposit under an idempotency key (arg)
+    };
+
+    struct SnapshotHeader {
+        char magic[8];
+        uint64_t seq;           // last log record the snapshot includes
+        uint64_t slots;
+        uint64_t accounts;
+        uint32_t holdCapacity;
+        uint32_t holdCount;
+        uint32_t keyCapacity;
+        uint32_t keyCount;
+        uint32_t reserved[3];
+        uint32_t checksum;
+    };
+
+    // hash is 0 for an empty slot
+    struct AccountSlot {
+        uint64_t hash;
+        int32_t balance;
+        uint32_t reserved;
+        char account[48];
+    };
+
+    struct HoldSlot {
+        uint64_t id;
+        uint32_t slot;
+        int32_t amount;
+    };
+
+    struct LogHeader {
+        char magic[8];
+        uint32_t generation;
+        uint32_t reserved[13];
+    };
+
+    struct LogRecord {
+        uint64_t seq;
+        uint64_t arg;           // hold id or deposit key
+        uint32_t slot;
+        int32_t amount;
+        uint32_t generation;
+        uint8_t type;
+        uint8_t reserved0[3];
+        char account[48];       // Opened records only
+        uint32_t reserved[3];
+        uint32_t checksum;
+    };
+
+    static_assert(sizeof(SnapshotHeader) == 64, "ledger snapshot header must be 64 bytes");
+    static_assert(sizeof(AccountSlot) == 64, "ledger account slot must be 64 bytes");
+    static_assert(sizeof(HoldSlot) == 16, "ledger hold slot must be 16 bytes");
+    static_assert(sizeof(LogHeader) == 64, "ledger log header must be 64 bytes");
+    static_assert(sizeof(LogRecord) == 96, "ledger log record must be 96 bytes");
+
+    // FNV-1a; detects torn headers and records
+    uint32_t checksum(const SnapshotHeader& h)
+    {
+        return fnv1a(&h, offsetof(SnapshotHeader, checksum));
+    }
+
+    uint32_t checksum(const LogRecord& r)
+    {
+        return fnv1a(&r, offsetof(LogRecord, checksum));
+    }
+
+    // 64-bit FNV-1a, never 0 so that 0 can mark an empty slot
+    uint64_t hashOf(const char* id)
+    {
+        uint64_t h = fnv1a64(id, strlen(id));
+        return h ? h : 1;
+    }
+
+    size_t snapshotBytes(uint64_t slots, size_t holds, size_t keys)
+    {
+        return sizeof(SnapshotHeader) + slots * sizeof(AccountSlot) + holds * sizeof(HoldSlot) + keys * sizeof(uint64_t);
+    }
+
+    bool intact(const SnapshotHeader& h, size_t fileSize)
+    {
+        return memcmp(h.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) == 0
+            && h.checksum == checksum(h)
+            && h.slots != 0 && (h.slots & (h.slots - 1)) == 0
+            && h.holdCount <= h.holdCapacity && h.keyCount <= h.keyCapacity
+            && snapshotBytes(h.slots, h.holdCapacity, h.keyCapacity) <= fileSize;
+    }
+
+    AccountSlot* accountsOf(uint8_t* file)
+    {
+        return reinterpret_cast<AccountSlot*>(file + sizeof(SnapshotHeader));
+    }
+
+    const AccountSlot* accountsOf(const uint8_t* file)
+    {
+        return reinterpret_cast<const AccountSlot*>(file + sizeof(SnapshotHeader));
+    }
+
+    LogRecord* recordsOf(uint8_t* file)
+    {
+        return reinterpret_cast<LogRecord*>(file + sizeof(LogHeader));
+    }
+}
+
+LedgerBank::~LedgerBank()
+{
+    close();
+}
+
+string LedgerBank::snapshotPath(uint32_t index) const
+{
+    return _path + ".snap" + to_string(index);
+}
+
+size_t LedgerBank::snapshotBytes(void) const
+{
+    return ::snapshotBytes(_slots, _holdCapacity, _keyCapacity);
+}
+
+Status LedgerBank::open(const string& path)
+{
+    return open(path, Config());
+}
+
+Status LedgerBank::open(const string& path, const Config& cfg)
+{
+    close();
+
+    if (cfg.capacity == 0 || cfg.logRecords == 0)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    lock_guard<mutex> syncLock(_syncMutex);
+    unique_lock<shared_mutex> lock(_mutex);
+    _path = path;
+    _cfg = cfg;
+
+    // Newest complete snapshot
+    SnapshotHeader best;
+    bool found = false;
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        MappedFile file;
+        if (!file.open(snapshotPath(i), sizeof(SnapshotHeader), MappedFile::Mode::CopyOnWrite).isOk())
+        {
+            continue;
+        }
+
+        SnapshotHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        if (intact(header, file.size()) && (!found || header.seq > best.seq))
+        {
+            best = header;
+            _current = i;
+            found = true;
+        }
+    }
+
+    if (found)
+    {
+        _slots = best.slots;
+        _holdCapacity = best.holdCapacity;
+        _keyCapacity = best.keyCapacity;
+    }
+    else
+    {
+        // New ledger: an empty table at load factor 1/2 or below
+        _slots = 2;
+        while (_slots < cfg.capacity * 2)
+        {
+            _slots <<= 1;
+        }
+        _holdCapacity = max<size_t>(cfg.holds, 1);
+        _keyCapacity = cfg.postingKeys;
+        _current = 0;
+
+        // Fresh files are sparse and read as zeros
+        (void)remove(snapshotPath(0).c_str());
+        (void)remove(snapshotPath(1).c_str());
+        MappedFile file;
+        Status status = file.open(snapshotPath(0), snapshotBytes());
+        if (!status.isOk())
+        {
+            return status;
+        }
+
+        memset(&best, 0, sizeof(best));
+        memcpy(best.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+        best.slots = _slots;
+        best.holdCapacity = uint32_t(_holdCapacity);
+        best.keyCapacity = uint32_t(_keyCapacity);
+        best.checksum = checksum(best);
+        memcpy(file.data(), &best, sizeof(best));
+        status = file.sync(0, sizeof(best));
+        if (!status.isOk())
+        {
+            return status;
+        }
+    }
+
+    Status status = _table.open(snapshotPath(_current), snapshotBytes(), MappedFile::Mode::CopyOnWrite);
+    if (!status.isOk())
+    {
+        return status;
+    }
+
+    _accounts = best.accounts;
+    _snapshotSeq = best.seq;
+    _seq = best.seq;
+    _holds.clear();
+    _keys.clear();
+    _keyOrder.clear();
+    _stats = Stats{};
+
+    const HoldSlot* holds = reinterpret_cast<const HoldSlot*>(_table.data() + sizeof(SnapshotHeader) + _slots * sizeof(AccountSlot));
+    for (uint32_t i = 0; i < best.holdCount; ++i)
+    {
+        _holds[holds[i].id] = Hold{ holds[i].slot, holds[i].amount };
+    }
+    const uint64_t* keys = reinterpret_cast<const uint64_t*>(holds + _holdCapacity);
+    for (uint32_t i = 0; i < best.keyCount; ++i)
+    {
+        rememberLocked(keys[i]);
+    }
+
+    status = _log.open(path + ".log", sizeof(LogHeader) + cfg.logRecords * sizeof(LogRecord));
+    if (!status.isOk())
+    {
+        _table.close();
+        return status;
+    }
+    _logCapacity = (_log.size() - sizeof(LogHeader)) / sizeof(LogRecord);
+
+    LogHeader* logHeader = reinterpret_cast<LogHeader*>(_log.data());
+    if (memcmp(logHeader->magic, kLogMagic, sizeof(kLogMagic)) != 0)
+    {
+        memset(_log.data(), 0, _log.size());
+        memcpy(logHeader->magic, kLogMagic, sizeof(kLogMagic));
+        logHeader->generation = 1;
+        status = _log.sync(0, sizeof(LogHeader));
+    }
+    else if (!found)
+    {
+        // Records of a ledger whose snapshots are gone do not apply to the new one
+        ++logHeader->generation;
+        status = _log.sync(0, sizeof(LogHeader));
+    }
+    if (!status.isOk())
+    {
+        _log.close();
+        _table.close();
+        return status;
+    }
+    _generation = logHeader->generation;
+
+    // Replay the tail: records up to the first torn one, skipping those already in the snapshot
+    LogRecord* records = recordsOf(_log.data());
+    _tail = 0;
+    while (_tail < _logCapacity)
+    {
+        const LogRecord& r = records[_tail];
+        if (r.type == 0 || r.generation != _generation || r.checksum != checksum(r))
+        {
+            break;
+        }
+        if (r.seq > _seq)
+        {
+            applyLocked(r.seq, r.type, r.slot, r.amount, r.arg, r.account);
+            _seq = r.seq;
+            ++_stats.replayed;
+        }
+        ++_tail;
+    }
+
+    _cfg.snapshotRecords = min(max<size_t>(cfg.snapshotRecords, 1), _logCapacity);
+    _syncedTail = _tail;
+    _syncedSeq = _seq;
+    _snapshotAsked = _tail >= _cfg.snapshotRecords;
+    _snapshotDue = _snapshotAsked;
+    _stopping = false;
+    _snapshotter = thread([this] { run(); });
+    return Status::okStatus();
+}
+
+void LedgerBank::close(void)
+{
+    if (_snapshotter.joinable())
+    {
+        {
+            lock_guard<mutex> lock(_wakeMutex);
+            _stopping = true;
+        }
+        _wake.notify_all();
+        _snapshotter.join();
+    }
+
+    if (_log.isOpen())
+    {
+        (void)flush();
+    }
+
+    lock_guard<mutex> syncLock(_syncMutex);
+    unique_lock<shared_mutex> lock(_mutex);
+    _log.close();
+    _table.close();
+}
+
+void LedgerBank::run(void)
+{
+    unique_lock<mutex> lock(_wakeMutex);
+    while (!_stopping)
+    {
+        _wake.wait_for(lock, _cfg.snapshotInterval, [this] { return _stopping || _snapshotDue; });
+        if (_stopping)
+        {
+            break;
+        }
+        _snapshotDue = false;
+
+        lock.unlock();
+        (void)snapshot();
+        lock.lock();
+    }
+}
+
+size_t LedgerBank::find(const AccountId& accountId) const
+{
+    const string& id = accountId.str();
+    if (id.size() >= sizeof(AccountSlot::account))
+    {
+        return kNoSlot;
+    }
+
+    // The table is at most half full, so a probe always reaches an empty slot
+    uint64_t hash = hashOf(id.c_str());
+    const AccountSlot* slots = accountsOf(_table.data());
+    for (size_t i = hash & (_slots - 1);; i = (i + 1) & (_slots - 1))
+    {
+        const AccountSlot& slot = slots[i];
+        if (slot.hash == 0)
+        {
+            return kNoSlot;
+        }
+        if (slot.hash == hash && strncmp(slot.account, id.c_str(), sizeof(slot.account)) == 0)
+        {
+            return i;
+        }
+    }
+}
+
+uint64_t LedgerBank::appendLocked(uint8_t type, uint32_t slot, int amount, uint64_t arg, const char* account)
+{
+    LogRecord r;
+    memset(&r, 0, sizeof(r));
+    r.seq = _seq + 1;
+    r.arg = arg;
+    r.slot = slot;
+    r.amount = amount;
+    r.generation = _generation;
+    r.type = type;
+    if (account)
+    {
+        strncpy(r.account, account, sizeof(r.account) - 1);
+    }
+    r.checksum = checksum(r);
+
+    memcpy(&recordsOf(_log.data())[_tail], &r, sizeof(r));
+    ++_tail;
+    ++_stats.records;
+    _seq = r.seq;
+    applyLocked(r.seq, type, slot, amount, arg, account);
+
+    if (!_snapshotAsked && _tail >= _cfg.snapshotRecords)
+    {
+        _snapshotAsked = true;
+        {
+            lock_guard<mutex> lock(_wakeMutex);
+            _snapshotDue = true;
+        }
+        _wake.notify_one();
+    }
+    return r.seq;
+}
+
+void LedgerBank::applyLocked(uint64_t seq, uint8_t type, uint32_t slot, int amount, uint64_t arg, const char* account)
+{
+    if (slot >= _slots)
+    {
+        return;
+    }
+
+    AccountSlot& target = accountsOf(_table.data())[slot];
+    switch (type)
+    {
+    case Opened:
+        strncpy(target.account, account, sizeof(target.account) - 1);
+        target.account[sizeof(target.account) - 1] = '\0';
+        target.hash = hashOf(target.account);
+        target.balance = amount;
+        ++_accounts;
+        break;
+    case Posted:
+        rememberLocked(arg);
+        target.balance += amount;
+        break;
+    case Deposited:
+        target.balance += amount;
+        break;
+    case Withdrawn:
+        target.balance -= amount;
+        break;
+    case Held:
+        // A hold is named after its record
+        target.balance -= amount;
+        _holds[seq] = Hold{ slot, amount };
+        break;
+    case Captured:
+        _holds.erase(arg);
+        break;
+    case Released:
+    {
+        auto it = _holds.find(arg);
+        if (it != _holds.end())
+        {
+            accountsOf(_table.data())[it->second.slot].balance += it->second.amount;
+            _holds.erase(it);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void LedgerBank::rememberLocked(uint64_t key)
+{
+    if (key == 0 || _keyCapacity == 0 || !_keys.insert(key).second)
+    {
+        return;
+    }
+
+    _keyOrder.push_back(key);
+    if (_keyOrder.size() > _keyCapacity)
+    {
+        _keys.erase(_keyOrder.front());
+        _keyOrder.pop_front();
+    }
+}
+
+bool LedgerBank::reserveLocked(unique_lock<shared_mutex>& lock)
+{
+    // A full log is emptied by a snapshot taken by the writer that found it full
+    while (_log.isOpen() && _tail >= _logCapacity)
+    {
+        lock.unlock();
+        Status status = snapshot();
+        lock.lock();
+        if (!status.isOk())
+        {
+            return false;
+        }
+    }
+    return _log.isOpen();
+}
+
+Status LedgerBank::durable(uint64_t seq)
+{
+    if (!_cfg.syncEachWrite)
+    {
+        return Status::okStatus();
+    }
+
+    // Whoever gets the sync mutex first syncs every record appended so far
+    lock_guard<mutex> syncLock(_syncMutex);
+    if (_syncedSeq >= seq)
+    {
+        return Status::okStatus();
+    }
+    return syncLogLocked();
+}
+
+Status LedgerBank::syncLogLocked(void)
+{
+    size_t from = _syncedTail;
+    size_t to = 0;
+    uint64_t upTo = 0;
+    {
+        shared_lock<shared_mutex> lock(_mutex);
+        if (!_log.isOpen())
+        {
+            return Status::error(Err::InvalidState);
+        }
+        to = _tail;
+        upTo = _seq;
+    }
+
+    if (to > from)
+    {
+        Status status = _log.sync(sizeof(LogHeader) + from * sizeof(LogRecord), (to - from) * sizeof(LogRecord));
+        if (!status.isOk())
+        {
+            return status;
+        }
+        unique_lock<shared_mutex> lock(_mutex);
+        ++_stats.syncs;
+    }
+    _syncedTail = to;
+    _syncedSeq = upTo;
+    return Status::okStatus();
+}
+
+Status LedgerBank::flush(void)
+{
+    lock_guard<mutex> syncLock(_syncMutex);
+    return syncLogLocked();
+}
+
+Status LedgerBank::snapshot(void)
+{
+    lock_guard<mutex> syncLock(_syncMutex);
+    unique_lock<shared_mutex> lock(_mutex);
+    if (!_log.isOpen())
+    {
+        return Status::error(Err::InvalidState);
+    }
+    if (_seq == _snapshotSeq)
+    {
+        return Status::okStatus();
+    }
+
+    uint32_t target = _current ^ 1;
+    MappedFile file;
+    Status status = file.open(snapshotPath(target), snapshotBytes());
+    if (!status.isOk())
+    {
+        return status;
+    }
+
+    // Invalidate the target first, so a crash while copying cannot make it count
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(file.data(), &header, sizeof(header));
+    status = file.sync(0, sizeof(header));
+    if (!status.isOk())
+    {
+        return status;
+    }
+
+    memcpy(accountsOf(file.data()), accountsOf(_table.data()), _slots * sizeof(AccountSlot));
+    HoldSlot* holds = reinterpret_cast<HoldSlot*>(file.data() + sizeof(SnapshotHeader) + _slots * sizeof(AccountSlot));
+    uint32_t holdCount = 0;
+    for (const auto& hold : _holds)
+    {
+        holds[holdCount++] = HoldSlot{ hold.first, hold.second.slot, hold.second.amount };
+    }
+    uint64_t* keys = reinterpret_cast<uint64_t*>(holds + _holdCapacity);
+    uint32_t keyCount = 0;
+    for (uint64_t key : _keyOrder)
+    {
+        keys[keyCount++] = key;
+    }
+
+    status = file.sync(sizeof(SnapshotHeader), snapshotBytes() - sizeof(SnapshotHeader));
+    if (!status.isOk())
+    {
+        return status;
+    }
+
+    memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+    header.seq = _seq;
+    header.slots = _slots;
+    header.accounts = _accounts;
+    header.holdCapacity = uint32_t(_holdCapacity);
+    header.holdCount = holdCount;
+    header.keyCapacity = uint32_t(_keyCapacity);
+    header.keyCount = keyCount;
+    header.checksum = checksum(header);
+    memcpy(file.data(), &header, sizeof(header));
+    status = file.sync(0, sizeof(header));
+    if (!status.isOk())
+    {
+        return status;
+    }
+    file.close();
+
+    // Serve from the new snapshot, which leaves the old file free to be overwritten next time
+    MappedFile table;
+    status = table.open(snapshotPath(target), snapshotBytes(), MappedFile::Mode::CopyOnWrite);
+    if (!status.isOk())
+    {
+        return status;
+    }
+    _table = move(table);
+    _current = target;
+    _snapshotSeq = _seq;
+
+    // Everything logged is in the snapshot; start the log over. Records
+    // appended under a generation the file never got would not replay.
+    LogHeader* logHeader = reinterpret_cast<LogHeader*>(_log.data());
+    logHeader->generation = _generation + 1;
+    status = _log.sync(0, sizeof(LogHeader));
+    if (!status.isOk())
+    {
+        logHeader->generation = _generation;
+        return status;
+    }
+    ++_generation;
+    _tail = 0;
+    _syncedTail = 0;
+    _syncedSeq = _seq;
+    _snapshotAsked = false;
+    ++_stats.snapshots;
+    return Status::okStatus();
+}
+
+Status LedgerBank::addAccount(const AccountId& accountId, int balance)
+{
+    if (balance < 0 || accountId.empty() || accountId.size() >= sizeof(AccountSlot::account))
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    unique_lock<shared_mutex> lock(_mutex);
+    if (!reserveLocked(lock))
+    {
+        return Status::error(Err::InvalidState);
+    }
+    if (find(accountId) != kNoSlot)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+    if (_accounts >= _slots / 2)
+    {
+        return Status::error(Err::MemoryError);
+    }
+
+    uint64_t hash = hashOf(accountId.c_str());
+    const AccountSlot* slots = accountsOf(_table.data());
+    size_t slot = hash & (_slots - 1);
+    while (slots[slot].hash != 0)
+    {
+        slot = (slot + 1) & (_slots - 1);
+    }
+
+    uint64_t seq = appendLocked(Opened, uint32_t(slot), balance, 0, accountId.c_str());
+    lock.unlock();
+    return durable(seq);
+}
+
+Status LedgerBank::addCard(const Card& card, const Pin& pin, const vector<AccountId>& accounts)
+{
+    unique_lock<shared_mutex> lock(_cardMutex);
+    array<uint8_t, 16> salt;
+    for (size_t i = 0; i < salt.size(); i += 8)
+    {
+        uint64_t bits = _random();
+        for (size_t b = 0; b < 8; ++b)
+        {
+            salt[i + b] = uint8_t(bits >> (8 * b));
+        }
+    }
+    _pins[card] = OfflinePinVerifier::makeReference(card, pin, salt, max<uint32_t>(_cfg.pinRounds, 1));
+    _cards[card] = accounts;
+    return Status::okStatus();
+}
+
+size_t LedgerBank::size(void) const
+{
+    shared_lock<shared_mutex> lock(_mutex);
+    return _accounts;
+}
+
+LedgerBank::Stats LedgerBank::stats(void)
+{
+    lock_guard<mutex> syncLock(_syncMutex);
+    shared_lock<shared_mutex> lock(_mutex);
+    return _stats;
+}
+
+Status LedgerBank::verifyPin(const Card& card, const Pin& pin)
+{
+    PinReference reference;
+    {
+        shared_lock<shared_mutex> lock(_cardMutex);
+        auto it = _pins.find(card);
+        if (it == _pins.end())
+        {
+            return Status::error(Err::InvalidArg);
+        }
+        reference = it->second;
+    }
+
+    // Hashing runs outside the lock; the comparison takes the same time for every PIN
+    if (OfflinePinVerifier::matches(reference, card, pin))
+    {
+        return Status::okStatus();
+    }
+    return Status::error(Err::InvalidArg);
+}
+
+vector<AccountId> LedgerBank::listAccounts(const Card& card)
+{
+    shared_lock<shared_mutex> lock(_cardMutex);
+    auto it = _cards.find(card);
+    if (it != _cards.end())
+    {
+        return it->second;
+    }
+    return vector<AccountId>();
+}
+
+Result<int> LedgerBank::getBalance(const AccountId& accountId)
+{
+    shared_lock<shared_mutex> lock(_mutex);
+    if (!_table.isOpen())
+    {
+        return Err::InvalidState;
+    }
+    size_t slot = find(accountId);
+    if (slot == kNoSlot)
+    {
+        return Err::InvalidArg;
+    }
+    return int(accountsOf(_table.data())[slot].balance);
+}
+
+Status LedgerBank::deposit(const AccountId& accountId, int money)
+{
+    unique_lock<shared_mutex> lock(_mutex);
+    if (!reserveLocked(lock))
+    {
+        return Status::error(Err::InvalidState);
+    }
+    size_t slot = find(accountId);
+    if (slot == kNoSlot || money < 0 || accountsOf(_table.data())[slot].balance > INT_MAX - money)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    uint64_t seq = appendLocked(Deposited, uint32_t(slot), money, 0, nullptr);
+    lock.unlock();
+    return durable(seq);
+}
+
+Status LedgerBank::canWithdraw(const AccountId& accountId, int money)
+{
+    shared_lock<shared_mutex> lock(_mutex);
+    if (!_table.isOpen())
+    {
+        return Status::error(Err::InvalidState);
+    }
+    size_t slot = find(accountId);
+    if (slot != kNoSlot && accountsOf(_table.data())[slot].balance >= money)
+    {
+        return Status::okStatus();
+    }
+    return Status::error(Err::InsufficientBank);
+}
+
+Status LedgerBank::withdraw(const AccountId& accountId, int money)
+{
+    unique_lock<shared_mutex> lock(_mutex);
+    if (!reserveLocked(lock))
+    {
+        return Status::error(Err::InvalidState);
+    }
+    size_t slot = find(accountId);
+    if (slot == kNoSlot || money < 0)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+    if (accountsOf(_table.data())[slot].balance < money)
+    {
+        return Status::error(Err::InsufficientBank);
+    }
+
+    uint64_t seq = appendLocked(Withdrawn, uint32_t(slot), money, 0, nullptr);
+    lock.unlock();
+    return durable(seq);
+}
+
+Result<HoldId> LedgerBank::placeHold(const AccountId& accountId, int money)
+{
+    unique_lock<shared_mutex> lock(_mutex);
+    if (!reserveLocked(lock))
+    {
+        return Err::InvalidState;
+    }
+    size_t slot = find(accountId);
+    if (slot == kNoSlot || money < 0)
+    {
+        return Err::InvalidArg;
+    }
+    if (accountsOf(_table.data())[slot].balance < money)
+    {
+        return Err::InsufficientBank;
+    }
+    if (_holds.size() >= _holdCapacity)
+    {
+        return Err::MemoryError;
+    }
+
+    uint64_t seq = appendLocked(Held, uint32_t(slot), money, 0, nullptr);
+    lock.unlock();
+    Status status = durable(seq);
+    if (!status.isOk())
+    {
+        return status.code;
+    }
+    return HoldId(seq);
+}
+
+Status LedgerBank::captureHold(HoldId holdId)
+{
+    unique_lock<shared_mutex> lock(_mutex);
+    if (!reserveLocked(lock))
+    {
+        return Status::error(Err::InvalidState);
+    }
+    auto it = _holds.find(holdId);
+    if (it == _holds.end())
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    uint64_t seq = appendLocked(Captured, it->second.slot, it->second.amount, holdId, nullptr);
+    lock.unlock();
+    return durable(seq);
+}
+
+Status LedgerBank::releaseHold(HoldId holdId)
+{
+    unique_lock<shared_mutex> lock(_mutex);
+    if (!reserveLocked(lock))
+    {
+        return Status::error(Err::InvalidState);
+    }
+    auto it = _holds.find(holdId);
+    if (it == _holds.end())
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    uint64_t seq = appendLocked(Released, it->second.slot, it->second.amount, holdId, nullptr);
+    lock.unlock();
+    return durable(seq);
+}
+
+vector<Status> LedgerBank::postDeposits(const vector<DepositPosting>& batch)
+{
+    vector<Status> statuses;
+    statuses.reserve(batch.size());
+    uint64_t last = 0;
+    for (const DepositPosting& posting : batch)
+    {
+        unique_lock<shared_mutex> lock(_mutex);
+        if (!reserveLocked(lock))
+        {
+            statuses.push_back(Status::error(Err::InvalidState));
+            continue;
+        }
+        size_t slot = find(posting.accountId);
+        if (slot == kNoSlot || posting.money < 0 || accountsOf(_table.data())[slot].balance > INT_MAX - posting.money)
+        {
+            statuses.push_back(Status::error(Err::InvalidArg));
+            continue;
+        }
+
+        // A resent key is acknowledged again without being applied
+        if (posting.key == 0 || !_keys.count(posting.key))
+        {
+            last = appendLocked(Posted, uint32_t(slot), posting.money, posting.key, nullptr);
+        }
+        statuses.push_back(Status::okStatus());
+    }
+
+    // One sync for the whole batch
+    Status synced = last ? durable(last) : Status::okStatus();
+    if (!synced.isOk())
+    {
+        for (Status& status : statuses)
+        {
+            if (status.isOk())
+            {
+                status = synced;
+            }
+        }
+    }
+    return statuses;
+}
+
+bool LedgerBank::keyedDeposits(void) const
+{
+    shared_lock<shared_mutex> lock(_mutex);
+    return _keyCapacity > 0;
+}
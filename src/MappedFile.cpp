@@ -0,0 +1,217 @@
+#include "MappedFile.hpp"
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        swap(_data, other._data);
+        swap(_size, other._size);
+#if defined(_WIN32)
+        swap(_file, other._file);
+        swap(_mapping, other._mapping);
+#else
+        swap(_fd, other._fd);
+#endif
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#if defined(_WIN32)
+
+Status MappedFile::open(const string& path, size_t minSize, Mode mode)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return Status::error(Err::SystemError);
+    }
+
+    LARGE_INTEGER current;
+    if (!GetFileSizeEx(file, &current))
+    {
+        CloseHandle(file);
+        return Status::error(Err::SystemError);
+    }
+
+    size_t size = (size_t)current.QuadPart < minSize ? minSize : (size_t)current.QuadPart;
+    if (size == 0)
+    {
+        CloseHandle(file);
+        return Status::error(Err::InvalidArg);
+    }
+
+    LARGE_INTEGER wanted;
+    wanted.QuadPart = (LONGLONG)size;
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, wanted.HighPart, wanted.LowPart, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return Status::error(Err::SystemError);
+    }
+
+    DWORD access = mode == Mode::CopyOnWrite ? FILE_MAP_COPY : FILE_MAP_ALL_ACCESS;
+    void* view = MapViewOfFile(mapping, access, 0, 0, size);
+    if (!view)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return Status::error(Err::SystemError);
+    }
+
+    _file = file;
+    _mapping = mapping;
+    _data = static_cast<uint8_t*>(view);
+    _size = size;
+    return Status::okStatus();
+}
+
+void MappedFile::close(void)
+{
+    if (_data)
+    {
+        UnmapViewOfFile(_data);
+        _data = nullptr;
+    }
+    if (_mapping)
+    {
+        CloseHandle(_mapping);
+        _mapping = nullptr;
+    }
+    if (_file)
+    {
+        CloseHandle(_file);
+        _file = nullptr;
+    }
+    _size = 0;
+}
+
+Status MappedFile::sync(size_t offset, size_t length)
+{
+    if (!_data || offset >= _size)
+    {
+        return Status::error(Err::InvalidState);
+    }
+    if (length > _size - offset)
+    {
+        length = _size - offset;
+    }
+
+    if (!FlushViewOfFile(_data + offset, length) || !FlushFileBuffers(_file))
+    {
+        return Status::error(Err::SystemError);
+    }
+    return Status::okStatus();
+}
+
+#else
+
+Status MappedFile::open(const string& path, size_t minSize, Mode mode)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return Status::error(Err::SystemError);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return Status::error(Err::SystemError);
+    }
+
+    size_t size = (size_t)st.st_size;
+    if (size < minSize)
+    {
+        if (ftruncate(fd, (off_t)minSize) != 0)
+        {
+            ::close(fd);
+            return Status::error(Err::SystemError);
+        }
+        size = minSize;
+    }
+    if (size == 0)
+    {
+        ::close(fd);
+        return Status::error(Err::InvalidArg);
+    }
+
+    int flags = mode == Mode::CopyOnWrite ? MAP_PRIVATE : MAP_SHARED;
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (view == MAP_FAILED)
+    {
+        ::close(fd);
+        return Status::error(Err::SystemError);
+    }
+
+    _fd = fd;
+    _data = static_cast<uint8_t*>(view);
+    _size = size;
+    return Status::okStatus();
+}
+
+void MappedFile::close(void)
+{
+    if (_data)
+    {
+        munmap(_data, _size);
+        _data = nullptr;
+    }
+    if (_fd >= 0)
+    {
+        ::close(_fd);
+        _fd = -1;
+    }
+    _size = 0;
+}
+
+Status MappedFile::sync(size_t offset, size_t length)
+{
+    if (!_data || offset >= _size)
+    {
+        return Status::error(Err::InvalidState);
+    }
+    if (length > _size - offset)
+    {
+        length = _size - offset;
+    }
+
+    // msync needs a page-aligned start address
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = offset - offset % page;
+    if (msync(_data + start, length + (offset - start), MS_SYNC) != 0)
+    {
+        return Status::error(Err::SystemError);
+    }
+    return Status::okStatus();
+}
+
+#endif
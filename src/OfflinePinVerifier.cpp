@@ -0,0 +1,128 @@
+#include "OfflinePinVerifier.hpp"
+#include "Sha256.hpp"
+
+OfflinePinVerifier::OfflinePinVerifier() : OfflinePinVerifier(Config())
+{}
+
+OfflinePinVerifier::OfflinePinVerifier(const Config& cfg)
+ : _cfg(cfg), _random(random_device()())
+{}
+
+PinReference OfflinePinVerifier::makeReference(const Card& card, const Pin& pin,
+                                               const array<uint8_t, 16>& salt, uint32_t rounds)
+{
+    PinReference reference;
+    reference.salt = salt;
+    reference.rounds = rounds ? rounds : 1;
+
+    // The card id is length-prefixed so that card and PIN cannot run into each other
+    uint32_t cardSize = uint32_t(card.size());
+    Sha256::Digest digest = Sha256()
+        .update(salt.data(), salt.size())
+        .update(&cardSize, sizeof(cardSize))
+        .update(card.str())
+        .update(pin)
+        .finish();
+
+    for (uint32_t i = 1; i < reference.rounds; ++i)
+    {
+        digest = Sha256().update(salt.data(), salt.size()).update(digest.data(), digest.size()).finish();
+    }
+
+    reference.digest = digest;
+    return reference;
+}
+
+bool OfflinePinVerifier::matches(const PinReference& reference, const Card& card, const Pin& pin)
+{
+    PinReference candidate = makeReference(card, pin, reference.salt, reference.rounds);
+
+    // No early exit: the comparison time does not reveal the matching prefix
+    uint8_t diff = 0;
+    for (size_t i = 0; i < candidate.digest.size(); ++i)
+    {
+        diff |= uint8_t(candidate.digest[i] ^ reference.digest[i]);
+    }
+    return diff == 0;
+}
+
+PinReference OfflinePinVerifier::makeSaltedReference(const Card& card, const Pin& pin)
+{
+    array<uint8_t, 16> salt;
+    {
+        lock_guard<mutex> lock(_mutex);
+        for (size_t i = 0; i < salt.size(); i += 8)
+        {
+            uint64_t bits = _random();
+            for (size_t b = 0; b < 8; ++b)
+            {
+                salt[i + b] = uint8_t(bits >> (8 * b));
+            }
+        }
+    }
+    return makeReference(card, pin, salt, _cfg.rounds);
+}
+
+OfflinePinVerifier::Verdict OfflinePinVerifier::verify(const Card& card, const Pin& pin,
+                                                       const optional<PinReference>& issuer)
+{
+    if (issuer)
+    {
+        bool ok = matches(*issuer, card, pin);
+        lock_guard<mutex> lock(_mutex);
+        ++(ok ? _stats.matches : _stats.mismatches);
+        return ok ? Verdict::Match : Verdict::Mismatch;
+    }
+
+    optional<PinReference> cached;
+    {
+        lock_guard<mutex> lock(_mutex);
+        auto it = _cache.find(card);
+        if (it != _cache.end() && it->second.expires > chrono::steady_clock::now())
+        {
+            cached = it->second.reference;
+        }
+    }
+
+    // Hash outside the lock; a cached mismatch may just be stale
+    bool ok = cached && matches(*cached, card, pin);
+    lock_guard<mutex> lock(_mutex);
+    ++(ok ? _stats.matches : _stats.unknown);
+    return ok ? Verdict::Match : Verdict::Unknown;
+}
+
+void OfflinePinVerifier::remember(const Card& card, const Pin& pin)
+{
+    PinReference reference = makeSaltedReference(card, pin);
+    auto now = chrono::steady_clock::now();
+
+    lock_guard<mutex> lock(_mutex);
+    if (_cache.size() >= _cfg.capacity && !_cache.count(card))
+    {
+        for (auto it = _cache.begin(); it != _cache.end();)
+        {
+            it = it->second.expires <= now ? _cache.erase(it) : next(it);
+        }
+        if (_cache.size() >= _cfg.capacity && !_cache.empty())
+        {
+            _cache.erase(_cache.begin());
+        }
+    }
+
+    if (_cfg.capacity)
+    {
+        _cache[card] = Entry{ reference, now + _cfg.ttl };
+    }
+}
+
+void OfflinePinVerifier::forget(const Card& card)
+{
+    lock_guard<mutex> lock(_mutex);
+    _cache.erase(card);
+}
+
+OfflinePinVerifier::Stats OfflinePinVerifier::stats(void) const
+{
+    lock_guard<mutex> lock(_mutex);
+    return _stats;
+}
@@ -0,0 +1,241 @@
+#include "RecordingController.hpp"
+
+namespace {
+    void fill(DeviceCallRecord& record, const Status& status)
+    {
+        record.outcome = status.code;
+    }
+
+    void fill(DeviceCallRecord& record, const Result<int>& result)
+    {
+        record.outcome = result.error();
+        if (result.isOk()) record.value = result.value();
+    }
+
+    void fill(DeviceCallRecord& record, const Result<HoldId>& result)
+    {
+        record.outcome = result.error();
+        if (result.isOk()) record.value = int64_t(result.value());
+    }
+
+    void fill(DeviceCallRecord& record, const Result<Card>& result)
+    {
+        record.outcome = result.error();
+        if (result.isOk()) record.text = result.value().str();
+    }
+
+    void fill(DeviceCallRecord& record, const vector<AccountId>& accounts)
+    {
+        for (const auto& account : accounts)
+        {
+            record.list.push_back(account.str());
+        }
+    }
+
+    Controller::Config withoutPrefetch(Controller::Config cfg)
+    {
+        cfg.prefetch = nullptr;
+        return cfg;
+    }
+}
+
+RecordingController::Recorder::Recorder(SessionTrace& trace)
+ : _trace(trace), _nsPerTick(TickClock::nsPerTick())
+{}
+
+template <typename F>
+auto RecordingController::Recorder::device(ControllerMetrics::Call call, F&& f) -> decltype(f())
+{
+    if (!_inOperation)
+    {
+        return f();
+    }
+
+    DeviceCallRecord record;
+    record.call = call;
+    uint64_t start = TickClock::now();
+    try {
+        auto result = f();
+        record.ns = uint64_t(double(TickClock::now() - start) * _nsPerTick);
+        fill(record, result);
+        _trace.ops.back().calls.push_back(move(record));
+        return result;
+    }
+    catch (...) {
+        record.ns = uint64_t(double(TickClock::now() - start) * _nsPerTick);
+        record.threw = true;
+        record.outcome = Err::SystemError;
+        _trace.ops.back().calls.push_back(move(record));
+        throw;
+    }
+}
+
+template <typename F>
+auto RecordingController::Recorder::operation(ControllerMetrics::Op op, int64_t money,
+                                              const string& account, F&& f) -> decltype(f())
+{
+    OperationRecord record;
+    record.op = op;
+    record.money = money;
+    record.account = account;
+    _trace.ops.push_back(move(record));
+
+    // Controller operations never throw
+    _inOperation = true;
+    uint64_t start = TickClock::now();
+    auto result = f();
+    _inOperation = false;
+
+    OperationRecord& done = _trace.ops.back();
+    done.ns = uint64_t(double(TickClock::now() - start) * _nsPerTick);
+    done.outcome = ControllerMetrics::outcome(result);
+    return result;
+}
+
+// Card reader
+Result<Card> RecordingController::CardReader::read(void)
+{
+    return _recorder.device(ControllerMetrics::Call::ReadCard, [&] { return _inner.read(); });
+}
+
+Status RecordingController::CardReader::eject(void)
+{
+    return _recorder.device(ControllerMetrics::Call::EjectCard, [&] { return _inner.eject(); });
+}
+
+// Bank
+Status RecordingController::Bank::verifyPin(const Card& card, const Pin& pin)
+{
+    return _recorder.device(ControllerMetrics::Call::VerifyPin, [&] { return _inner.verifyPin(card, pin); });
+}
+
+vector<AccountId> RecordingController::Bank::listAccounts(const Card& card)
+{
+    return _recorder.device(ControllerMetrics::Call::ListAccounts, [&] { return _inner.listAccounts(card); });
+}
+
+Result<int> RecordingController::Bank::getBalance(const AccountId& accountId)
+{
+    return _recorder.device(ControllerMetrics::Call::GetBalance, [&] { return _inner.getBalance(accountId); });
+}
+
+Status RecordingController::Bank::deposit(const AccountId& accountId, int money)
+{
+    return _recorder.device(ControllerMetrics::Call::Deposit, [&] { return _inner.deposit(accountId, money); });
+}
+
+Status RecordingController::Bank::canWithdraw(const AccountId& accountId, int money)
+{
+    // Not used by the controller's withdraw path; forwarded unrecorded
+    return _inner.canWithdraw(accountId, money);
+}
+
+Status RecordingController::Bank::withdraw(const AccountId& accountId, int money)
+{
+    return _inner.withdraw(accountId, money);
+}
+
+Result<HoldId> RecordingController::Bank::placeHold(const AccountId& accountId, int money)
+{
+    return _recorder.device(ControllerMetrics::Call::PlaceHold, [&] { return _inner.placeHold(accountId, money); });
+}
+
+Status RecordingController::Bank::captureHold(HoldId holdId)
+{
+    return _recorder.device(ControllerMetrics::Call::CaptureHold, [&] { return _inner.captureHold(holdId); });
+}
+
+Status RecordingController::Bank::releaseHold(HoldId holdId)
+{
+    return _recorder.device(ControllerMetrics::Call::ReleaseHold, [&] { return _inner.releaseHold(holdId); });
+}
+
+vector<Status> RecordingController::Bank::postDeposits(const vector<DepositPosting>& batch)
+{
+    // Batches come from a background flusher, not from a recorded operation
+    return _inner.postDeposits(batch);
+}
+
+// Cash bin
+Status RecordingController::CashBin::canDispense(int money)
+{
+    return _recorder.device(ControllerMetrics::Call::CanDispense, [&] { return _inner.canDispense(money); });
+}
+
+Status RecordingController::CashBin::dispense(int money)
+{
+    return _recorder.device(ControllerMetrics::Call::Dispense, [&] { return _inner.dispense(money); });
+}
+
+// Controller
+RecordingController::RecordingController(ICardReader& cardReader, IBank& bank, ICashBin& cashBin,
+                                         const Controller::Config& cfg)
+ : _recorder(_trace),
+   _cardReader(cardReader, _recorder),
+   _bank(bank, _recorder),
+   _cashBin(cashBin, _recorder),
+   _controller(_cardReader, _bank, _cashBin, withoutPrefetch(cfg))
+{}
+
+Status RecordingController::insertCard(void)
+{
+    return _recorder.operation(ControllerMetrics::Op::InsertCard, 0, string(), [&] {
+        return _controller.insertCard();
+    });
+}
+
+Status RecordingController::ejectCard(void)
+{
+    return _recorder.operation(ControllerMetrics::Op::EjectCard, 0, string(), [&] {
+        return _controller.ejectCard();
+    });
+}
+
+Status RecordingController::enterPin(const Pin& pin)
+{
+    return _recorder.operation(ControllerMetrics::Op::EnterPin, 0, string(), [&] {
+        return _controller.enterPin(pin);
+    });
+}
+
+Result<vector<AccountId>> RecordingController::listAccounts(void)
+{
+    return _recorder.operation(ControllerMetrics::Op::ListAccounts, 0, string(), [&] {
+        return _controller.listAccounts();
+    });
+}
+
+Status RecordingController::selectAccount(const AccountId& accountId)
+{
+    return _recorder.operation(ControllerMetrics::Op::SelectAccount, 0, accountId.str(), [&] {
+        return _controller.selectAccount(accountId);
+    });
+}
+
+Result<int> RecordingController::getBalance(void)
+{
+    return _recorder.operation(ControllerMetrics::Op::GetBalance, 0, string(), [&] {
+        return _controller.getBalance();
+    });
+}
+
+Status RecordingController::deposit(int money)
+{
+    return _recorder.operation(ControllerMetrics::Op::Deposit, money, string(), [&] {
+        return _controller.deposit(money);
+    });
+}
+
+Status RecordingController::withdraw(int money)
+{
+    return _recorder.operation(ControllerMetrics::Op::Withdraw, money, string(), [&] {
+        return _controller.withdraw(money);
+    });
+}
+
+SessionTrace RecordingController::takeTrace(void)
+{
+    SessionTrace trace = move(_trace);
+    _trace.ops.clear();
+    return trace;
+}
@@ -0,0 +1,321 @@
+#include "ResilientBank.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+namespace {
+    /**
+     * @brief First answer among the launches of one attempt
+     */
+    template <typename T>
+    struct Race {
+        mutex lock;
+        condition_variable cv;
+        optional<T> value;
+        exception_ptr error;
+        int launched = 0;
+        int failed = 0;
+        int winner = -1;
+        bool abandoned = false;     // The caller stopped waiting for this attempt
+
+        bool done(void) const
+        {
+            return value.has_value() || failed == launched;
+        }
+    };
+
+    bool retryable(const Status& status)
+    {
+        return status.code == Err::NetworkError;
+    }
+
+    template <typename V>
+    bool retryable(const Result<V>& result)
+    {
+        return result.error() == Err::NetworkError;
+    }
+
+    bool retryable(const vector<AccountId>&)
+    {
+        return false;
+    }
+
+    // Per-deposit failures are left to the caller, which resends only those
+    bool retryable(const vector<Status>&)
+    {
+        return false;
+    }
+
+    bool retryable(const vector<AccountBalance>& balances)
+    {
+        return any_of(balances.begin(), balances.end(),
+                      [](const AccountBalance& b) { return retryable(b.balance); });
+    }
+
+    template <typename T>
+    T deadlineExceeded(void)
+    {
+        if constexpr (is_same<T, Status>::value)
+        {
+            return Status::error(Err::NetworkError);
+        }
+        else if constexpr (is_same<T, vector<AccountId>>::value || is_same<T, vector<Status>>::value
+                           || is_same<T, vector<AccountBalance>>::value)
+        {
+            throw runtime_error("bank deadline exceeded");
+        }
+        else
+        {
+            return T(Err::NetworkError);
+        }
+    }
+}
+
+ResilientBank::ResilientBank(IBank& inner, ThreadPool& pool)
+ : ResilientBank(inner, pool, Config())
+{}
+
+ResilientBank::ResilientBank(IBank& inner, ThreadPool& pool, const Config& cfg)
+ : _inner(inner), _pool(pool), _cfg(cfg), _random(random_device{}())
+{}
+
+chrono::nanoseconds ResilientBank::backoff(int retry)
+{
+    auto cap = min(_cfg.maxBackoff, _cfg.backoff * (int64_t(1) << min(retry, 20)));
+    auto capNs = chrono::duration_cast<chrono::nanoseconds>(cap).count();
+
+    lock_guard<mutex> lock(_mutex);
+    return chrono::nanoseconds(uniform_int_distribution<int64_t>(0, max<int64_t>(capNs, 0))(_random));
+}
+
+chrono::nanoseconds ResilientBank::hedgeDelay(Read read) const
+{
+    LatencyHistogram::Snapshot latency;
+    {
+        lock_guard<mutex> lock(_mutex);
+        latency = _latency[size_t(read)].snapshot();
+    }
+
+    if (latency.count < _cfg.hedgeMinSamples)
+    {
+        return _cfg.hedgeDelay;
+    }
+    return chrono::nanoseconds(latency.percentileNs(0.95));
+}
+
+template <typename T, typename F>
+T ResilientBank::call(Resend resend, const Read* read, F&& fn, void (*orphan)(IBank&, T&))
+{
+    using Clock = chrono::steady_clock;
+
+    _calls.fetch_add(1, memory_order_relaxed);
+    auto deadline = Clock::now() + _cfg.deadline;
+    int attempts = resend == Resend::Never ? 1 : max(_cfg.maxAttempts, 1);
+
+    for (int attempt = 0;; ++attempt)
+    {
+        // Tasks own the race and a copy of the call, so an abandoned attempt is harmless
+        auto race = make_shared<Race<T>>();
+        auto launch = [&](int index) {
+            {
+                lock_guard<mutex> lock(race->lock);
+                ++race->launched;
+            }
+            (void)_pool.submit([race, index, fn, orphan, bank = &_inner] {
+                optional<T> late;
+                try {
+                    T value = fn();
+                    lock_guard<mutex> lock(race->lock);
+                    if (race->abandoned || race->value)
+                    {
+                        late.emplace(move(value));
+                    }
+                    else
+                    {
+                        race->value.emplace(move(value));
+                        race->winner = index;
+                    }
+                }
+                catch (...) {
+                    lock_guard<mutex> lock(race->lock);
+                    ++race->failed;
+                    race->error = current_exception();
+                }
+                race->cv.notify_all();
+
+                // Nobody will see this answer: undo what it did at the bank
+                if (late && orphan)
+                {
+                    try {
+                        orphan(*bank, *late);
+                    }
+                    catch (...) {
+                    }
+                }
+            });
+        };
+
+        auto attemptStart = Clock::now();
+        auto attemptEnd = min(deadline, attemptStart + _cfg.attemptTimeout);
+        auto hedgeAt = attemptEnd;
+        if (read && _cfg.hedgeReads)
+        {
+            hedgeAt = min(attemptEnd, attemptStart + chrono::duration_cast<Clock::duration>(hedgeDelay(*read)));
+        }
+        launch(0);
+
+        unique_lock<mutex> lock(race->lock);
+        if (hedgeAt < attemptEnd && !race->cv.wait_until(lock, hedgeAt, [&] { return race->done(); }))
+        {
+            lock.unlock();
+            launch(1);
+            _hedges.fetch_add(1, memory_order_relaxed);
+            lock.lock();
+        }
+
+        bool answered = race->cv.wait_until(lock, attemptEnd, [&] { return race->done(); });
+        if (answered && race->value)
+        {
+            T value = move(*race->value);
+            bool hedgeWon = race->winner == 1;
+            lock.unlock();
+
+            if (hedgeWon)
+            {
+                _hedgeWins.fetch_add(1, memory_order_relaxed);
+            }
+            if (read)
+            {
+                auto ns = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - attemptStart).count();
+                lock_guard<mutex> stats(_mutex);
+                _latency[size_t(*read)].record(uint64_t(ns));
+            }
+            if (!retryable(value) || attempt + 1 >= attempts)
+            {
+                return value;
+            }
+        }
+        else if (answered)
+        {
+            // Every launch threw: a transport failure, the request may have reached the bank
+            exception_ptr error = race->error;
+            lock.unlock();
+            if (resend != Resend::Always || attempt + 1 >= attempts)
+            {
+                rethrow_exception(error);
+            }
+        }
+        else
+        {
+            race->abandoned = true;
+            lock.unlock();
+            _timeouts.fetch_add(1, memory_order_relaxed);
+            if (resend != Resend::Always || attempt + 1 >= attempts)
+            {
+                return deadlineExceeded<T>();
+            }
+        }
+
+        auto wait = backoff(attempt);
+        if (Clock::now() + wait >= deadline)
+        {
+            return deadlineExceeded<T>();
+        }
+        this_thread::sleep_for(wait);
+        _retries.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+Status ResilientBank::verifyPin(const Card& card, const Pin& pin)
+{
+    IBank& bank = _inner;
+    return call<Status>(Resend::Answered, nullptr, [&bank, card, pin] { return bank.verifyPin(card, pin); });
+}
+
+vector<AccountId> ResilientBank::listAccounts(const Card& card)
+{
+    IBank& bank = _inner;
+    const Read read = Read::ListAccounts;
+    return call<vector<AccountId>>(Resend::Always, &read, [&bank, card] { return bank.listAccounts(card); });
+}
+
+Result<int> ResilientBank::getBalance(const AccountId& accountId)
+{
+    IBank& bank = _inner;
+    const Read read = Read::GetBalance;
+    return call<Result<int>>(Resend::Always, &read, [&bank, accountId] { return bank.getBalance(accountId); });
+}
+
+Status ResilientBank::deposit(const AccountId& accountId, int money)
+{
+    IBank& bank = _inner;
+    return call<Status>(Resend::Never, nullptr, [&bank, accountId, money] { return bank.deposit(accountId, money); });
+}
+
+vector<Status> ResilientBank::postDeposits(const vector<DepositPosting>& batch)
+{
+    // Safe to resend only when the bank applies each idempotency key once
+    IBank& bank = _inner;
+    Resend resend = bank.keyedDeposits() ? Resend::Always : Resend::Never;
+    return call<vector<Status>>(resend, nullptr, [&bank, batch] { return bank.postDeposits(batch); });
+}
+
+vector<AccountBalance> ResilientBank::getBalances(const Card& card)
+{
+    IBank& bank = _inner;
+    const Read read = Read::GetBalances;
+    return call<vector<AccountBalance>>(Resend::Always, &read, [&bank, card] { return bank.getBalances(card); });
+}
+
+Status ResilientBank::canWithdraw(const AccountId& accountId, int money)
+{
+    IBank& bank = _inner;
+    return call<Status>(Resend::Always, nullptr, [&bank, accountId, money] { return bank.canWithdraw(accountId, money); });
+}
+
+Status ResilientBank::withdraw(const AccountId& accountId, int money)
+{
+    IBank& bank = _inner;
+    return call<Status>(Resend::Never, nullptr, [&bank, accountId, money] { return bank.withdraw(accountId, money); });
+}
+
+Result<HoldId> ResilientBank::placeHold(const AccountId& accountId, int money)
+{
+    IBank& bank = _inner;
+    return call<Result<HoldId>>(Resend::Never, nullptr,
+                                [&bank, accountId, money] { return bank.placeHold(accountId, money); },
+                                [](IBank& inner, Result<HoldId>& hold) {
+                                    if (hold.isOk())
+                                    {
+                                        (void)inner.releaseHold(hold.value());
+                                    }
+                                });
+}
+
+Status ResilientBank::captureHold(HoldId holdId)
+{
+    IBank& bank = _inner;
+    return call<Status>(Resend::Never, nullptr, [&bank, holdId] { return bank.captureHold(holdId); });
+}
+
+Status ResilientBank::releaseHold(HoldId holdId)
+{
+    IBank& bank = _inner;
+    return call<Status>(Resend::Never, nullptr, [&bank, holdId] { return bank.releaseHold(holdId); });
+}
+
+ResilientBank::Stats ResilientBank::stats(void) const
+{
+    Stats s;
+    s.calls = _calls.load(memory_order_relaxed);
+    s.retries = _retries.load(memory_order_relaxed);
+    s.timeouts = _timeouts.load(memory_order_relaxed);
+    s.hedges = _hedges.load(memory_order_relaxed);
+    s.hedgeWins = _hedgeWins.load(memory_order_relaxed);
+    return s;
+}
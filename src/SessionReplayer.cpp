@@ -0,0 +1,264 @@
+#include "SessionReplayer.hpp"
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+    /**
+     * @brief Card reader, bank and cash bin answering from one recorded operation
+     *
+     * Each call takes the first unused response of the same kind recorded
+     * for the current operation, so the order of independent calls does not
+     * have to match the recording exactly.
+     */
+    class ScriptedDevices : public ICardReader, public IBank, public ICashBin {
+    private:
+        const SessionReplayer::Options& _options;
+        const OperationRecord* _op = nullptr;
+        vector<bool> _used;
+
+    public:
+        uint64_t diverged = 0;
+
+        explicit ScriptedDevices(const SessionReplayer::Options& options) : _options(options)
+        {}
+
+        void begin(const OperationRecord& op)
+        {
+            _op = &op;
+            _used.assign(op.calls.size(), false);
+        }
+
+        /**
+         * @brief Recorded response to a call, after the configured latency
+         *
+         * Returns nullptr (and counts a divergence) if none is left.
+         */
+        const DeviceCallRecord* answer(ControllerMetrics::Call call)
+        {
+            const DeviceCallRecord* record = nullptr;
+            for (size_t i = 0; _op && i < _op->calls.size(); ++i)
+            {
+                if (!_used[i] && _op->calls[i].call == call)
+                {
+                    _used[i] = true;
+                    record = &_op->calls[i];
+                    break;
+                }
+            }
+
+            if (!record)
+            {
+                ++diverged;
+                return nullptr;
+            }
+
+            switch (_options.timing)
+            {
+            case SessionReplayer::Timing::Recorded:
+                wait(record->ns);
+                break;
+            case SessionReplayer::Timing::Fixed:
+                wait(uint64_t(_options.fixedLatency.count()));
+                break;
+            default:
+                break;
+            }
+
+            if (record->threw)
+            {
+                throw runtime_error("replayed device failure");
+            }
+            return record;
+        }
+
+        static void wait(uint64_t ns)
+        {
+            uint64_t deadline = TickClock::steadyNs() + ns;
+
+            // Sleep through long waits, spin the last stretch for precision
+            const uint64_t spinNs = 100000;
+            if (ns > 2 * spinNs)
+            {
+                this_thread::sleep_for(chrono::nanoseconds(ns - spinNs));
+            }
+            while (TickClock::steadyNs() < deadline) {}
+        }
+
+        Status status(ControllerMetrics::Call call)
+        {
+            auto record = answer(call);
+            return Status::error(record ? record->outcome : Err::SystemError);
+        }
+
+        // ICardReader
+        Result<Card> read(void) override
+        {
+            auto record = answer(ControllerMetrics::Call::ReadCard);
+            if (!record) return Err::SystemError;
+            if (record->outcome != Err::None) return record->outcome;
+            return Card(record->text);
+        }
+
+        Status eject(void) override
+        {
+            return status(ControllerMetrics::Call::EjectCard);
+        }
+
+        // IBank
+        Status verifyPin(const Card&, const Pin&) override
+        {
+            return status(ControllerMetrics::Call::VerifyPin);
+        }
+
+        vector<AccountId> listAccounts(const Card&) override
+        {
+            auto record = answer(ControllerMetrics::Call::ListAccounts);
+            vector<AccountId> accounts;
+            if (record)
+            {
+                accounts.assign(record->list.begin(), record->list.end());
+            }
+            return accounts;
+        }
+
+        Result<int> getBalance(const AccountId&) override
+        {
+            auto record = answer(ControllerMetrics::Call::GetBalance);
+            if (!record) return Err::SystemError;
+            if (record->outcome != Err::None) return record->outcome;
+            return int(record->value);
+        }
+
+        Status deposit(const AccountId&, int) override
+        {
+            return status(ControllerMetrics::Call::Deposit);
+        }
+
+        Status canWithdraw(const AccountId&, int) override
+        {
+            return Status::okStatus();
+        }
+
+        Status withdraw(const AccountId&, int) override
+        {
+            return Status::okStatus();
+        }
+
+        Result<HoldId> placeHold(const AccountId&, int) override
+        {
+            auto record = answer(ControllerMetrics::Call::PlaceHold);
+            if (!record) return Err::SystemError;
+            if (record->outcome != Err::None) return record->outcome;
+            return HoldId(record->value);
+        }
+
+        Status captureHold(HoldId) override
+        {
+            return status(ControllerMetrics::Call::CaptureHold);
+        }
+
+        Status releaseHold(HoldId) override
+        {
+            return status(ControllerMetrics::Call::ReleaseHold);
+        }
+
+        // ICashBin
+        Status canDispense(int) override
+        {
+            return status(ControllerMetrics::Call::CanDispense);
+        }
+
+        Status dispense(int) override
+        {
+            return status(ControllerMetrics::Call::Dispense);
+        }
+    };
+
+    Err replay(Controller& atm, const OperationRecord& op)
+    {
+        using Op = ControllerMetrics::Op;
+        switch (op.op)
+        {
+        case Op::InsertCard:    return atm.insertCard().code;
+        case Op::EjectCard:     return atm.ejectCard().code;
+        case Op::EnterPin:      return atm.enterPin(Pin()).code;   // the scripted bank answers
+        case Op::ListAccounts:  return atm.listAccounts().error();
+        case Op::SelectAccount: return atm.selectAccount(AccountId(op.account)).code;
+        case Op::GetBalance:    return atm.getBalance().error();
+        case Op::Deposit:       return atm.deposit(int(op.money)).code;
+        case Op::Withdraw:      return atm.withdraw(int(op.money)).code;
+        default:                return Err::InvalidArg;
+        }
+    }
+}
+
+SessionReplayer::Report SessionReplayer::run(const Options& options) const
+{
+    size_t threadCount = options.threads ? options.threads : 1;
+
+    struct Worker {
+        ControllerMetrics metrics;
+        uint64_t operations = 0;
+        uint64_t mismatches = 0;
+        uint64_t diverged = 0;
+    };
+    vector<unique_ptr<Worker>> workers;
+    for (size_t t = 0; t < threadCount; ++t)
+    {
+        workers.push_back(make_unique<Worker>());
+    }
+
+    auto replayLoop = [&](Worker& worker) {
+        ScriptedDevices devices(options);
+        Controller::Config cfg = options.controller;
+        cfg.metrics = &worker.metrics;
+        cfg.prefetch = nullptr;     // scripted answers belong to the operations that asked
+
+        for (size_t loop = 0; loop < options.loops; ++loop)
+        {
+            // Every pass starts from a fresh, idle controller
+            Controller atm(devices, devices, devices, cfg);
+            for (const auto& op : _trace.ops)
+            {
+                devices.begin(op);
+                if (replay(atm, op) != op.outcome)
+                {
+                    ++worker.mismatches;
+                }
+                ++worker.operations;
+            }
+        }
+        worker.diverged = devices.diverged;
+    };
+
+    atomic<bool> go{ false };
+    vector<thread> threads;
+    for (size_t t = 1; t < threadCount; ++t)
+    {
+        threads.emplace_back([&, t] {
+            while (!go.load()) {}
+            replayLoop(*workers[t]);
+        });
+    }
+
+    uint64_t start = TickClock::steadyNs();
+    go = true;
+    replayLoop(*workers[0]);
+    for (auto& t : threads) t.join();
+    uint64_t elapsed = TickClock::steadyNs() - start;
+
+    Report report;
+    for (const auto& worker : workers)
+    {
+        report.operations += worker->operations;
+        report.mismatches += worker->mismatches;
+        report.divergedCalls += worker->diverged;
+        report.metrics.merge(worker->metrics.snapshot());
+    }
+    report.seconds = double(elapsed) / 1e9;
+    report.operationsPerSecond = elapsed ? double(report.operations) / report.seconds : 0.0;
+    return report;
+}
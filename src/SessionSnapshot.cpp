@@ -0,0 +1,164 @@
+#include "SessionSnapshot.hpp"
+#include "Fnv1a.hpp"
+#include "Sha256.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    const char kMagic[8] = { 'A', 'T', 'M', 'S', 'N', 'A', 'P', '1' };
+
+    struct Header {
+        char magic[8];
+        uint64_t generation;    // bumped by every save
+        uint32_t capacity;      // records per area
+        uint32_t active;        // area holding the snapshot
+        uint32_t count;         // records in the active area
+        uint32_t checksum;
+        uint32_t reserved[8];
+    };
+
+    static_assert(sizeof(Header) == 64, "snapshot header must be 64 bytes");
+
+    uint32_t checksum(const Header& h)
+    {
+        return fnv1a(&h, offsetof(Header, checksum));
+    }
+
+    bool valid(const Header& h)
+    {
+        return memcmp(h.magic, kMagic, sizeof(kMagic)) == 0 && h.checksum == checksum(h)
+            && h.active < 2 && h.count <= h.capacity;
+    }
+}
+
+void SessionRecord::seal(const SessionKey& key)
+{
+    Sha256::Digest digest = Sha256::hmac(key.data(), key.size(), this, offsetof(SessionRecord, mac));
+    memcpy(mac, digest.data(), sizeof(mac));
+}
+
+bool SessionRecord::intact(const SessionKey& key) const
+{
+    Sha256::Digest digest = Sha256::hmac(key.data(), key.size(), this, offsetof(SessionRecord, mac));
+
+    // No early exit: the comparison time does not reveal the matching prefix
+    uint8_t diff = 0;
+    for (size_t i = 0; i < sizeof(mac); ++i)
+    {
+        diff |= uint8_t(digest[i] ^ mac[i]);
+    }
+    return diff == 0;
+}
+
+SessionRecord* SessionSnapshotFile::area(uint32_t index)
+{
+    return reinterpret_cast<SessionRecord*>(_file.data() + sizeof(Header)) + size_t(index) * _capacity;
+}
+
+const SessionRecord* SessionSnapshotFile::area(uint32_t index) const
+{
+    return reinterpret_cast<const SessionRecord*>(_file.data() + sizeof(Header)) + size_t(index) * _capacity;
+}
+
+Status SessionSnapshotFile::open(const string& path, size_t capacity)
+{
+    close();
+
+    if (capacity == 0 || capacity > UINT32_MAX)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    Status status = _file.open(path, sizeof(Header) + 2 * capacity * sizeof(SessionRecord));
+    if (!status.isOk())
+    {
+        return status;
+    }
+
+    Header* header = reinterpret_cast<Header*>(_file.data());
+    if (!valid(*header))
+    {
+        _capacity = capacity;
+        memset(header, 0, sizeof(Header));
+        memcpy(header->magic, kMagic, sizeof(kMagic));
+        header->capacity = uint32_t(capacity);
+        header->checksum = checksum(*header);
+        return _file.sync(0, sizeof(Header));
+    }
+
+    if (header->capacity == capacity)
+    {
+        _capacity = capacity;
+        return Status::okStatus();
+    }
+
+    // Resized: carry the snapshot over into the new layout
+    _capacity = header->capacity;
+    vector<SessionRecord> records = saved();
+    records.resize(min(records.size(), capacity));
+    _capacity = capacity;
+    header->capacity = uint32_t(capacity);
+    header->active = 1;
+    return save(records);
+}
+
+Status SessionSnapshotFile::save(const vector<SessionRecord>& records)
+{
+    if (!_file.isOpen())
+    {
+        return Status::error(Err::InvalidState);
+    }
+    if (records.size() > _capacity)
+    {
+        return Status::error(Err::MemoryError);
+    }
+
+    Header* header = reinterpret_cast<Header*>(_file.data());
+    uint32_t next = header->active ^ 1;
+    size_t offset = sizeof(Header) + size_t(next) * _capacity * sizeof(SessionRecord);
+    if (!records.empty())
+    {
+        memcpy(area(next), records.data(), records.size() * sizeof(SessionRecord));
+        Status status = _file.sync(offset, records.size() * sizeof(SessionRecord));
+        if (!status.isOk())
+        {
+            return status;
+        }
+    }
+
+    header->generation += 1;
+    header->active = next;
+    header->count = uint32_t(records.size());
+    header->checksum = checksum(*header);
+    return _file.sync(0, sizeof(Header));
+}
+
+vector<SessionRecord> SessionSnapshotFile::saved(void) const
+{
+    vector<SessionRecord> records;
+    if (!_file.isOpen())
+    {
+        return records;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(_file.data());
+    if (!valid(*header))
+    {
+        return records;
+    }
+
+    const SessionRecord* active = area(header->active);
+    records.assign(active, active + header->count);
+    return records;
+}
+
+vector<SessionRecord> SessionSnapshotFile::load(const SessionKey& key) const
+{
+    vector<SessionRecord> records = saved();
+    records.erase(remove_if(records.begin(), records.end(),
+                            [&](const SessionRecord& record) { return !record.intact(key); }),
+                  records.end());
+    return records;
+}
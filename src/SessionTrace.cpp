@@ -0,0 +1,206 @@
+#include "SessionTrace.hpp"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    const char kMagic[8] = { 'A', 'T', 'M', 'S', 'R', 'E', 'C', '1' };
+
+    // Smallest stored operation: op, outcome, ns, money, empty account, no calls
+    const size_t kMinOpBytes = 1 + 1 + sizeof(uint64_t) + sizeof(int64_t) + sizeof(uint16_t) + sizeof(uint16_t);
+
+    class Writer {
+    private:
+        ofstream& _out;
+
+    public:
+        explicit Writer(ofstream& out) : _out(out)
+        {}
+
+        template <typename T>
+        void put(T value)
+        {
+            _out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        void put(const string& value)
+        {
+            put(uint16_t(value.size()));
+            _out.write(value.data(), value.size());
+        }
+    };
+
+    // Every length and count is stored in 16 bits (the op count in 32)
+    bool fitsFormat(const SessionTrace& trace)
+    {
+        auto fits = [](size_t n) { return n <= UINT16_MAX; };
+        if (trace.ops.size() > UINT32_MAX)
+        {
+            return false;
+        }
+        for (const auto& op : trace.ops)
+        {
+            if (!fits(op.account.size()) || !fits(op.calls.size()))
+            {
+                return false;
+            }
+            for (const auto& call : op.calls)
+            {
+                if (!fits(call.text.size()) || !fits(call.list.size()))
+                {
+                    return false;
+                }
+                for (const auto& item : call.list)
+                {
+                    if (!fits(item.size()))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    class Reader {
+    private:
+        ifstream& _in;
+
+    public:
+        explicit Reader(ifstream& in) : _in(in)
+        {}
+
+        template <typename T>
+        bool get(T& value)
+        {
+            return bool(_in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+        }
+
+        bool get(string& value)
+        {
+            uint16_t size = 0;
+            if (!get(size)) return false;
+            value.resize(size);
+            return bool(_in.read(&value[0], size));
+        }
+
+        /**
+         * @brief Bytes left to read in the file
+         */
+        size_t remaining(void)
+        {
+            streampos here = _in.tellg();
+            _in.seekg(0, ios::end);
+            streampos end = _in.tellg();
+            _in.seekg(here);
+            return here < 0 || end < here ? 0 : size_t(end - here);
+        }
+
+        template <typename E>
+        bool getEnum(E& value, size_t count)
+        {
+            uint8_t raw = 0;
+            if (!get(raw) || raw >= count) return false;
+            value = E(raw);
+            return true;
+        }
+    };
+}
+
+Status SessionTrace::save(const string& path) const
+{
+    // Checked up front, so an existing file is not replaced by a truncated one
+    if (!fitsFormat(*this))
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out)
+    {
+        return Status::error(Err::SystemError);
+    }
+
+    Writer w(out);
+    out.write(kMagic, sizeof(kMagic));
+    w.put(uint32_t(ops.size()));
+    for (const auto& op : ops)
+    {
+        w.put(uint8_t(op.op));
+        w.put(uint8_t(op.outcome));
+        w.put(op.ns);
+        w.put(op.money);
+        w.put(op.account);
+        w.put(uint16_t(op.calls.size()));
+        for (const auto& call : op.calls)
+        {
+            w.put(uint8_t(call.call));
+            w.put(uint8_t(call.outcome));
+            w.put(uint8_t(call.threw));
+            w.put(call.ns);
+            w.put(call.value);
+            w.put(call.text);
+            w.put(uint16_t(call.list.size()));
+            for (const auto& item : call.list)
+            {
+                w.put(item);
+            }
+        }
+    }
+
+    out.flush();
+    return out ? Status::okStatus() : Status::error(Err::SystemError);
+}
+
+Result<SessionTrace> SessionTrace::load(const string& path)
+{
+    ifstream in(path, ios::binary);
+    char magic[sizeof(kMagic)] = {};
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, kMagic, sizeof(kMagic)) != 0)
+    {
+        return Err::InvalidArg;
+    }
+
+    Reader r(in);
+    SessionTrace trace;
+    uint32_t opCount = 0;
+    // The count comes from the file: never reserve more than the file can hold
+    if (!r.get(opCount) || opCount > r.remaining() / kMinOpBytes)
+    {
+        return Err::InvalidArg;
+    }
+
+    trace.ops.reserve(opCount);
+    for (uint32_t i = 0; i < opCount; ++i)
+    {
+        OperationRecord op;
+        uint16_t callCount = 0;
+        if (!r.getEnum(op.op, ControllerMetrics::kOps) || !r.getEnum(op.outcome, ControllerMetrics::kOutcomes)
+            || !r.get(op.ns) || !r.get(op.money) || !r.get(op.account) || !r.get(callCount))
+        {
+            return Err::InvalidArg;
+        }
+
+        op.calls.resize(callCount);
+        for (auto& call : op.calls)
+        {
+            uint8_t threw = 0;
+            uint16_t listCount = 0;
+            if (!r.getEnum(call.call, ControllerMetrics::kCalls) || !r.getEnum(call.outcome, ControllerMetrics::kOutcomes)
+                || !r.get(threw) || !r.get(call.ns) || !r.get(call.value) || !r.get(call.text) || !r.get(listCount))
+            {
+                return Err::InvalidArg;
+            }
+
+            call.threw = threw != 0;
+            call.list.resize(listCount);
+            for (auto& item : call.list)
+            {
+                if (!r.get(item)) return Err::InvalidArg;
+            }
+        }
+        trace.ops.push_back(move(op));
+    }
+
+    return trace;
+}
@@ -0,0 +1,137 @@
+#include "Sha256.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    const uint32_t kRound[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    inline uint32_t rotr(uint32_t x, int n)
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+}
+
+Sha256::Sha256()
+ : _state{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 }
+{}
+
+void Sha256::compress(const uint8_t* block)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i)
+    {
+        w[i] = (uint32_t(block[4 * i]) << 24) | (uint32_t(block[4 * i + 1]) << 16)
+             | (uint32_t(block[4 * i + 2]) << 8) | uint32_t(block[4 * i + 3]);
+    }
+    for (int i = 16; i < 64; ++i)
+    {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = _state[0], b = _state[1], c = _state[2], d = _state[3];
+    uint32_t e = _state[4], f = _state[5], g = _state[6], h = _state[7];
+    for (int i = 0; i < 64; ++i)
+    {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kRound[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    _state[0] += a; _state[1] += b; _state[2] += c; _state[3] += d;
+    _state[4] += e; _state[5] += f; _state[6] += g; _state[7] += h;
+}
+
+Sha256& Sha256::update(const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    _length += size;
+
+    while (size > 0)
+    {
+        size_t take = min(size, sizeof(_block) - _blockSize);
+        memcpy(_block + _blockSize, bytes, take);
+        _blockSize += take;
+        bytes += take;
+        size -= take;
+
+        if (_blockSize == sizeof(_block))
+        {
+            compress(_block);
+            _blockSize = 0;
+        }
+    }
+    return *this;
+}
+
+Sha256::Digest Sha256::finish(void)
+{
+    uint64_t bits = _length * 8;
+    uint8_t pad = 0x80;
+    update(&pad, 1);
+
+    uint8_t zero = 0;
+    while (_blockSize != 56)
+    {
+        update(&zero, 1);
+    }
+
+    uint8_t length[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        length[i] = uint8_t(bits >> (56 - 8 * i));
+    }
+    update(length, sizeof(length));
+
+    Digest digest;
+    for (int i = 0; i < 8; ++i)
+    {
+        digest[4 * i] = uint8_t(_state[i] >> 24);
+        digest[4 * i + 1] = uint8_t(_state[i] >> 16);
+        digest[4 * i + 2] = uint8_t(_state[i] >> 8);
+        digest[4 * i + 3] = uint8_t(_state[i]);
+    }
+    return digest;
+}
+
+Sha256::Digest Sha256::hmac(const void* key, size_t keySize, const void* data, size_t size)
+{
+    uint8_t block[64] = {};
+    if (keySize > sizeof(block))
+    {
+        Digest hashed = hash(key, keySize);
+        memcpy(block, hashed.data(), hashed.size());
+    }
+    else if (keySize > 0)
+    {
+        memcpy(block, key, keySize);
+    }
+
+    uint8_t inner[64];
+    uint8_t outer[64];
+    for (size_t i = 0; i < sizeof(block); ++i)
+    {
+        inner[i] = uint8_t(block[i] ^ 0x36);
+        outer[i] = uint8_t(block[i] ^ 0x5c);
+    }
+
+    Digest innerDigest = Sha256().update(inner, sizeof(inner)).update(data, size).finish();
+    return Sha256().update(outer, sizeof(outer)).update(innerDigest.data(), innerDigest.size()).finish();
+}
@@ -0,0 +1,202 @@
+#include "ShardedBank.hpp"
+#include <algorithm>
+
+ShardedBank::ShardedBank(size_t shards, size_t postingKeys)
+ : _shards(shards ? shards : 1), _cardShards(shards ? shards : 1),
+   _postingKeys(max<size_t>(1, postingKeys / _shards.size()))
+{}
+
+Status ShardedBank::addAccount(const AccountId& accountId, int balance)
+{
+    if (balance < 0)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    Shard& shard = _shards[shardOf(accountId)];
+    unique_lock<shared_mutex> lock(shard.mutex);
+    if (!shard.accounts.emplace(accountId, make_unique<Account>(balance)).second)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+    return Status::okStatus();
+}
+
+Status ShardedBank::addCard(const Card& card, const Pin& pin, const vector<AccountId>& accounts)
+{
+    CardShard& shard = _cardShards[shardOf(card)];
+    unique_lock<shared_mutex> lock(shard.mutex);
+    shard.pins[card] = pin;
+    shard.accounts[card] = accounts;
+    return Status::okStatus();
+}
+
+ShardedBank::Account* ShardedBank::find(const AccountId& accountId) const
+{
+    // Accounts are never removed, so the pointer stays valid after unlocking
+    const Shard& shard = _shards[shardOf(accountId)];
+    shared_lock<shared_mutex> lock(shard.mutex);
+    auto it = shard.accounts.find(accountId);
+    return it != shard.accounts.end() ? it->second.get() : nullptr;
+}
+
+bool ShardedBank::tryDebit(Account& account, int money)
+{
+    int current = account.balance.load(memory_order_relaxed);
+    do
+    {
+        if (current < money)
+        {
+            return false;
+        }
+    } while (!account.balance.compare_exchange_weak(current, current - money,
+                                                    memory_order_acq_rel, memory_order_relaxed));
+    return true;
+}
+
+Status ShardedBank::verifyPin(const Card& card, const Pin& pin)
+{
+    const CardShard& shard = _cardShards[shardOf(card)];
+    shared_lock<shared_mutex> lock(shard.mutex);
+    auto it = shard.pins.find(card);
+    if (it != shard.pins.end() && it->second == pin)
+    {
+        return Status::okStatus();
+    }
+    return Status::error(Err::InvalidArg);
+}
+
+vector<AccountId> ShardedBank::listAccounts(const Card& card)
+{
+    const CardShard& shard = _cardShards[shardOf(card)];
+    shared_lock<shared_mutex> lock(shard.mutex);
+    auto it = shard.accounts.find(card);
+    if (it != shard.accounts.end())
+    {
+        return it->second;
+    }
+    return vector<AccountId>();
+}
+
+Result<int> ShardedBank::getBalance(const AccountId& accountId)
+{
+    Account* account = find(accountId);
+    if (!account)
+    {
+        return Err::InvalidArg;
+    }
+    return account->balance.load(memory_order_acquire);
+}
+
+Status ShardedBank::deposit(const AccountId& accountId, int money)
+{
+    Account* account = find(accountId);
+    if (!account || money < 0)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+    account->balance.fetch_add(money, memory_order_acq_rel);
+    return Status::okStatus();
+}
+
+Status ShardedBank::canWithdraw(const AccountId& accountId, int money)
+{
+    Account* account = find(accountId);
+    if (account && account->balance.load(memory_order_acquire) >= money)
+    {
+        return Status::okStatus();
+    }
+    return Status::error(Err::InsufficientBank);
+}
+
+Status ShardedBank::withdraw(const AccountId& accountId, int money)
+{
+    Account* account = find(accountId);
+    if (!account || money < 0)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+    if (!tryDebit(*account, money))
+    {
+        return Status::error(Err::InsufficientBank);
+    }
+    return Status::okStatus();
+}
+
+Result<HoldId> ShardedBank::placeHold(const AccountId& accountId, int money)
+{
+    Account* account = find(accountId);
+    if (!account || money < 0)
+    {
+        return Err::InvalidArg;
+    }
+    if (!tryDebit(*account, money))
+    {
+        return Err::InsufficientBank;
+    }
+
+    HoldId id = _nextHold.fetch_add(1, memory_order_relaxed);
+    Shard& shard = _shards[id % _shards.size()];
+    unique_lock<shared_mutex> lock(shard.mutex);
+    shard.holds.emplace(id, Hold{ account, money });
+    return id;
+}
+
+Status ShardedBank::captureHold(HoldId holdId)
+{
+    Shard& shard = _shards[holdId % _shards.size()];
+    unique_lock<shared_mutex> lock(shard.mutex);
+    return shard.holds.erase(holdId) ? Status::okStatus() : Status::error(Err::InvalidArg);
+}
+
+Status ShardedBank::releaseHold(HoldId holdId)
+{
+    Hold hold;
+    {
+        Shard& shard = _shards[holdId % _shards.size()];
+        unique_lock<shared_mutex> lock(shard.mutex);
+        auto it = shard.holds.find(holdId);
+        if (it == shard.holds.end())
+        {
+            return Status::error(Err::InvalidArg);
+        }
+        hold = it->second;
+        shard.holds.erase(it);
+    }
+
+    hold.account->balance.fetch_add(hold.amount, memory_order_acq_rel);
+    return Status::okStatus();
+}
+
+vector<Status> ShardedBank::postDeposits(const vector<DepositPosting>& batch)
+{
+    vector<Status> statuses;
+    statuses.reserve(batch.size());
+    for (const DepositPosting& posting : batch)
+    {
+        Account* account = find(posting.accountId);
+        if (!account || posting.money < 0)
+        {
+            statuses.push_back(Status::error(Err::InvalidArg));
+            continue;
+        }
+
+        // A resent key is acknowledged again without being applied
+        Shard& shard = _shards[posting.key % _shards.size()];
+        unique_lock<shared_mutex> lock(shard.mutex);
+        if (shard.postings.insert(posting.key).second)
+        {
+            account->balance.fetch_add(posting.money, memory_order_acq_rel);
+
+            // Keys are only resent shortly after their first posting
+            shard.postingOrder.push_back(posting.key);
+            if (shard.postingOrder.size() > _postingKeys)
+            {
+                shard.postings.erase(shard.postingOrder.front());
+                shard.postingOrder.pop_front();
+            }
+        }
+        statuses.push_back(Status::okStatus());
+    }
+    return statuses;
+}
@@ -0,0 +1,428 @@
+#include "ShardedBankRouter.hpp"
+#include "Fnv1a.hpp"
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <mutex>
+
+namespace {
+    constexpr int kSlotShift = 56;
+    constexpr HoldId kInnerHoldMask = (HoldId(1) << kSlotShift) - 1;
+
+    // FNV-1a, finished with the splitmix64 mixer so that nearby names and
+    // ids land far apart on the ring
+    uint64_t ringHash(const char* key, size_t length)
+    {
+        uint64_t h = fnv1a64(key, length);
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebull;
+        h ^= h >> 31;
+        return h;
+    }
+
+    vector<Status> unreachable(size_t count)
+    {
+        return vector<Status>(count, Status::error(Err::NetworkError));
+    }
+}
+
+ShardedBankRouter::ShardedBankRouter(ThreadPool& pool)
+ : ShardedBankRouter(pool, Config())
+{}
+
+ShardedBankRouter::ShardedBankRouter(ThreadPool& pool, const Config& cfg)
+ : _pool(pool), _cfg(cfg)
+{
+    _cfg.pointsPerShard = max<size_t>(_cfg.pointsPerShard, 1);
+}
+
+void ShardedBankRouter::rebuildRing(void)
+{
+    _ring.clear();
+    _ring.reserve(_backends.size() * _cfg.pointsPerShard);
+    for (size_t i = 0; i < _backends.size(); ++i)
+    {
+        for (size_t point = 0; point < _cfg.pointsPerShard; ++point)
+        {
+            string label = _backends[i].name + "#" + to_string(point);
+            _ring.push_back({ ringHash(label.data(), label.size()), uint32_t(i) });
+        }
+    }
+
+    // Ties are broken by name so the ring does not depend on insertion order
+    sort(_ring.begin(), _ring.end(), [this](const Point& a, const Point& b) {
+        if (a.hash != b.hash)
+        {
+            return a.hash < b.hash;
+        }
+        return _backends[a.backend].name < _backends[b.backend].name;
+    });
+}
+
+size_t ShardedBankRouter::backendOf(const char* key) const
+{
+    uint64_t h = ringHash(key, strlen(key));
+    auto it = lower_bound(_ring.begin(), _ring.end(), h, [](const Point& point, uint64_t value) {
+        return point.hash < value;
+    });
+    if (it == _ring.end())
+    {
+        it = _ring.begin();
+    }
+    return it->backend;
+}
+
+IBank* ShardedBankRouter::route(const char* key) const
+{
+    shared_lock<shared_mutex> lock(_mutex);
+    return _ring.empty() ? nullptr : _backends[backendOf(key)].bank;
+}
+
+IBank* ShardedBankRouter::routeCard(const Card& card) const
+{
+    shared_lock<shared_mutex> lock(_mutex);
+    for (const auto& bin : _bins)
+    {
+        if (strncmp(card.c_str(), bin.first.c_str(), bin.first.size()) == 0)
+        {
+            for (const Backend& backend : _backends)
+            {
+                if (backend.name == bin.second)
+                {
+                    return backend.bank;
+                }
+            }
+        }
+    }
+    return _ring.empty() ? nullptr : _backends[backendOf(card.c_str())].bank;
+}
+
+IBank* ShardedBankRouter::routeHold(HoldId holdId) const
+{
+    shared_lock<shared_mutex> lock(_mutex);
+    return _bySlot[holdId >> kSlotShift];
+}
+
+Status ShardedBankRouter::addShard(const string& name, IBank& bank)
+{
+    if (name.empty())
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    unique_lock<shared_mutex> lock(_mutex);
+    for (const Backend& backend : _backends)
+    {
+        if (backend.name == name)
+        {
+            return Status::error(Err::InvalidArg);
+        }
+    }
+    if (_nextSlot == 0)
+    {
+        return Status::error(Err::MemoryError);
+    }
+
+    uint8_t slot = _nextSlot++;
+    _backends.push_back({ name, &bank, slot });
+    _bySlot[slot] = &bank;
+    rebuildRing();
+    return Status::okStatus();
+}
+
+Status ShardedBankRouter::removeShard(const string& name)
+{
+    unique_lock<shared_mutex> lock(_mutex);
+    auto it = find_if(_backends.begin(), _backends.end(), [&](const Backend& backend) {
+        return backend.name == name;
+    });
+    if (it == _backends.end())
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    _bySlot[it->slot] = nullptr;
+    _backends.erase(it);
+    _bins.erase(remove_if(_bins.begin(), _bins.end(), [&](const pair<string, string>& bin) {
+        return bin.second == name;
+    }), _bins.end());
+    rebuildRing();
+    return Status::okStatus();
+}
+
+Status ShardedBankRouter::routeBin(const string& prefix, const string& shard)
+{
+    if (prefix.empty())
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    unique_lock<shared_mutex> lock(_mutex);
+    bool known = any_of(_backends.begin(), _backends.end(), [&](const Backend& backend) {
+        return backend.name == shard;
+    });
+    if (!known)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    _bins.erase(remove_if(_bins.begin(), _bins.end(), [&](const pair<string, string>& bin) {
+        return bin.first == prefix;
+    }), _bins.end());
+    _bins.emplace_back(prefix, shard);
+    stable_sort(_bins.begin(), _bins.end(), [](const pair<string, string>& a, const pair<string, string>& b) {
+        return a.first.size() > b.first.size();
+    });
+    return Status::okStatus();
+}
+
+Result<string> ShardedBankRouter::shardOf(const AccountId& accountId) const
+{
+    shared_lock<shared_mutex> lock(_mutex);
+    if (_ring.empty())
+    {
+        return Err::InvalidState;
+    }
+    return _backends[backendOf(accountId.c_str())].name;
+}
+
+Result<string> ShardedBankRouter::shardOf(const Card& card) const
+{
+    IBank* bank = routeCard(card);
+    shared_lock<shared_mutex> lock(_mutex);
+    for (const Backend& backend : _backends)
+    {
+        if (backend.bank == bank)
+        {
+            return backend.name;
+        }
+    }
+    return Err::InvalidState;
+}
+
+size_t ShardedBankRouter::size(void) const
+{
+    shared_lock<shared_mutex> lock(_mutex);
+    return _backends.size();
+}
+
+Status ShardedBankRouter::verifyPin(const Card& card, const Pin& pin)
+{
+    IBank* bank = routeCard(card);
+    return bank ? bank->verifyPin(card, pin) : Status::error(Err::NetworkError);
+}
+
+vector<IBank*> ShardedBankRouter::shards(void) const
+{
+    shared_lock<shared_mutex> lock(_mutex);
+    vector<IBank*> banks;
+    banks.reserve(_backends.size());
+    for (const Backend& backend : _backends)
+    {
+        banks.push_back(backend.bank);
+    }
+    return banks;
+}
+
+vector<AccountId> ShardedBankRouter::listAccounts(const Card& card)
+{
+    vector<IBank*> banks = shards();
+    if (banks.empty())
+    {
+        return {};
+    }
+
+    // The caller asks the first shard itself while the pool asks the rest
+    vector<future<vector<AccountId>>> pending;
+    pending.reserve(banks.size() - 1);
+    for (size_t i = 1; i < banks.size(); ++i)
+    {
+        IBank* bank = banks[i];
+        pending.push_back(_pool.submit([bank, card] { return bank->listAccounts(card); }));
+    }
+
+    vector<AccountId> accounts = banks[0]->listAccounts(card);
+    for (auto& answer : pending)
+    {
+        for (const AccountId& accountId : answer.get())
+        {
+            if (find(accounts.begin(), accounts.end(), accountId) == accounts.end())
+            {
+                accounts.push_back(accountId);
+            }
+        }
+    }
+    return accounts;
+}
+
+Result<int> ShardedBankRouter::getBalance(const AccountId& accountId)
+{
+    IBank* bank = route(accountId.c_str());
+    return bank ? bank->getBalance(accountId) : Result<int>(Err::NetworkError);
+}
+
+Status ShardedBankRouter::deposit(const AccountId& accountId, int money)
+{
+    IBank* bank = route(accountId.c_str());
+    return bank ? bank->deposit(accountId, money) : Status::error(Err::NetworkError);
+}
+
+Status ShardedBankRouter::canWithdraw(const AccountId& accountId, int money)
+{
+    IBank* bank = route(accountId.c_str());
+    return bank ? bank->canWithdraw(accountId, money) : Status::error(Err::NetworkError);
+}
+
+Status ShardedBankRouter::withdraw(const AccountId& accountId, int money)
+{
+    IBank* bank = route(accountId.c_str());
+    return bank ? bank->withdraw(accountId, money) : Status::error(Err::NetworkError);
+}
+
+Result<HoldId> ShardedBankRouter::placeHold(const AccountId& accountId, int money)
+{
+    uint8_t slot = 0;
+    IBank* bank = nullptr;
+    {
+        shared_lock<shared_mutex> lock(_mutex);
+        if (!_ring.empty())
+        {
+            const Backend& backend = _backends[backendOf(accountId.c_str())];
+            bank = backend.bank;
+            slot = backend.slot;
+        }
+    }
+    if (!bank)
+    {
+        return Err::NetworkError;
+    }
+
+    auto hold = bank->placeHold(accountId, money);
+    if (!hold.isOk())
+    {
+        return hold;
+    }
+    if (hold.value() > kInnerHoldMask)
+    {
+        // No room for the shard tag; give the funds back rather than strand them
+        (void)bank->releaseHold(hold.value());
+        return Err::SystemError;
+    }
+    return (HoldId(slot) << kSlotShift) | hold.value();
+}
+
+Status ShardedBankRouter::captureHold(HoldId holdId)
+{
+    IBank* bank = routeHold(holdId);
+    return bank ? bank->captureHold(holdId & kInnerHoldMask) : Status::error(Err::InvalidArg);
+}
+
+Status ShardedBankRouter::releaseHold(HoldId holdId)
+{
+    IBank* bank = routeHold(holdId);
+    return bank ? bank->releaseHold(holdId & kInnerHoldMask) : Status::error(Err::InvalidArg);
+}
+
+vector<Status> ShardedBankRouter::postDeposits(const vector<DepositPosting>& batch)
+{
+    struct Group {
+        IBank* bank;
+        vector<size_t> positions;
+        vector<DepositPosting> postings;
+    };
+
+    vector<Group> groups;
+    {
+        shared_lock<shared_mutex> lock(_mutex);
+        if (_ring.empty())
+        {
+            return unreachable(batch.size());
+        }
+
+        vector<size_t> groupOf(_backends.size(), SIZE_MAX);
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            size_t backend = backendOf(batch[i].accountId.c_str());
+            if (groupOf[backend] == SIZE_MAX)
+            {
+                groupOf[backend] = groups.size();
+                groups.push_back({ _backends[backend].bank, {}, {} });
+            }
+            Group& group = groups[groupOf[backend]];
+            group.positions.push_back(i);
+            group.postings.push_back(batch[i]);
+        }
+    }
+
+    auto post = [](const Group& group) {
+        try {
+            vector<Status> statuses = group.bank->postDeposits(group.postings);
+            if (statuses.size() == group.postings.size())
+            {
+                return statuses;
+            }
+        }
+        catch (...) {
+        }
+        return unreachable(group.postings.size());
+    };
+
+    vector<future<vector<Status>>> pending;
+    for (size_t g = 1; g < groups.size(); ++g)
+    {
+        const Group* group = &groups[g];
+        pending.push_back(_pool.submit([&post, group] { return post(*group); }));
+    }
+
+    vector<Status> statuses(batch.size());
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        vector<Status> answer = g == 0 ? post(groups[0]) : pending[g - 1].get();
+        for (size_t i = 0; i < answer.size(); ++i)
+        {
+            statuses[groups[g].positions[i]] = answer[i];
+        }
+    }
+    return statuses;
+}
+
+bool ShardedBankRouter::keyedDeposits(void) const
+{
+    shared_lock<shared_mutex> lock(_mutex);
+    return !_backends.empty() && all_of(_backends.begin(), _backends.end(),
+                                        [](const Backend& backend) { return backend.bank->keyedDeposits(); });
+}
+
+vector<AccountBalance> ShardedBankRouter::getBalances(const Card& card)
+{
+    vector<IBank*> banks = shards();
+    if (banks.empty())
+    {
+        return {};
+    }
+
+    vector<future<vector<AccountBalance>>> pending;
+    pending.reserve(banks.size() - 1);
+    for (size_t i = 1; i < banks.size(); ++i)
+    {
+        IBank* bank = banks[i];
+        pending.push_back(_pool.submit([bank, card] { return bank->getBalances(card); }));
+    }
+
+    vector<AccountBalance> balances = banks[0]->getBalances(card);
+    for (auto& answer : pending)
+    {
+        for (AccountBalance& entry : answer.get())
+        {
+            auto known = find_if(balances.begin(), balances.end(),
+                                 [&](const AccountBalance& b) { return b.accountId == entry.accountId; });
+            if (known == balances.end())
+            {
+                balances.push_back(move(entry));
+            }
+        }
+    }
+    return balances;
+}
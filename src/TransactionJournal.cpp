@@ -0,0 +1,539 @@
+#include "TransactionJournal.hpp"
+#include "Fnv1a.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <map>
+
+namespace {
+    const char kMagic[8] = { 'A', 'T', 'M', 'J', 'R', 'N', 'L', '1' };
+
+    enum RecordType : uint8_t {
+        Empty = 0,
+        Intent = 1,
+        Executed = 2,
+        Committed = 3,
+        RolledBack = 4,
+        Deferred = 5,   // closed; its owed steps live in the deferred area
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t generation;
+        uint32_t deferred;      // slots in the deferred area; 0 in older files
+        uint32_t reserved[12];
+    };
+
+    struct Record {
+        uint64_t txId;
+        int64_t arg;
+        int32_t amount;
+        uint32_t generation;
+        uint8_t type;
+        uint8_t step;
+        uint16_t op;
+        char account[32];
+        uint32_t checksum;
+    };
+
+    static_assert(sizeof(Header) == 64, "journal header must be 64 bytes");
+    static_assert(sizeof(Record) == 64, "journal record must be 64 bytes");
+
+    // FNV-1a over everything but the checksum; detects torn records
+    uint32_t checksum(const Record& r)
+    {
+        return fnv1a(&r, offsetof(Record, checksum));
+    }
+
+    Record makeRecord(uint64_t txId, uint8_t type, uint8_t step, uint16_t op,
+                      const char* account, int amount, int64_t arg)
+    {
+        Record r;
+        memset(&r, 0, sizeof(r));
+        r.txId = txId;
+        r.type = type;
+        r.step = step;
+        r.op = op;
+        r.amount = amount;
+        r.arg = arg;
+        strncpy(r.account, account, sizeof(r.account) - 1);
+        return r;
+    }
+
+    RecoveredStep toStep(const Record& r)
+    {
+        RecoveredStep s;
+        s.index = r.step;
+        s.op = r.op;
+        s.account = string(r.account, strnlen(r.account, sizeof(r.account)));
+        s.amount = r.amount;
+        s.arg = r.arg;
+        s.executed = r.type == Executed;
+        return s;
+    }
+
+    // The deferred area follows the header; the reusable log follows it
+    Record* deferredArea(MappedFile& file)
+    {
+        return reinterpret_cast<Record*>(file.data() + sizeof(Header));
+    }
+
+    Record* recordArea(MappedFile& file, size_t deferredSlots)
+    {
+        return deferredArea(file) + deferredSlots;
+    }
+
+    void sortReversed(vector<RecoveredStep>& steps)
+    {
+        sort(steps.begin(), steps.end(),
+             [](const RecoveredStep& a, const RecoveredStep& b) { return a.index > b.index; });
+    }
+}
+
+TransactionJournal::~TransactionJournal()
+{
+    close();
+}
+
+Status TransactionJournal::open(const string& path)
+{
+    return open(path, Config());
+}
+
+Status TransactionJournal::open(const string& path, const Config& cfg)
+{
+    close();
+
+    if (cfg.capacity == 0)
+    {
+        return Status::error(Err::InvalidArg);
+    }
+
+    Status status = _file.open(path, sizeof(Header) + (cfg.deferred + cfg.capacity) * sizeof(Record));
+    if (!status.isOk())
+    {
+        return status;
+    }
+
+    lock_guard<mutex> lock(_mutex);
+    _cfg = cfg;
+
+    Header* header = reinterpret_cast<Header*>(_file.data());
+    if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0)
+    {
+        memset(_file.data(), 0, _file.size());
+        memcpy(header->magic, kMagic, sizeof(kMagic));
+        header->generation = 1;
+        header->deferred = uint32_t(cfg.deferred);
+        Status synced = _file.sync(0, sizeof(Header));
+        if (!synced.isOk())
+        {
+            _file.close();
+            return synced;
+        }
+    }
+
+    // An existing file keeps the deferred area it was created with
+    size_t slots = (_file.size() - sizeof(Header)) / sizeof(Record);
+    if (header->deferred >= slots)
+    {
+        _file.close();
+        return Status::error(Err::InvalidArg);
+    }
+    _deferredSlots = header->deferred;
+    _capacity = slots - _deferredSlots;
+    _generation = header->generation;
+
+    // Transaction ids must not collide with those still owing a step
+    _nextTxId = 1;
+    const Record* deferred = deferredArea(_file);
+    for (size_t i = 0; i < _deferredSlots; ++i)
+    {
+        const Record& r = deferred[i];
+        if (r.type != Empty && r.checksum == checksum(r))
+        {
+            _nextTxId = max(_nextTxId, r.txId + 1);
+        }
+    }
+
+    // Find the tail: the first slot that is not a valid record of this generation
+    const Record* records = recordArea(_file, _deferredSlots);
+    _tail = 0;
+    while (_tail < _capacity)
+    {
+        const Record& r = records[_tail];
+        if (r.type == Empty || r.generation != _generation || r.checksum != checksum(r))
+        {
+            break;
+        }
+        _nextTxId = max(_nextTxId, r.txId + 1);
+        ++_tail;
+    }
+
+    _syncedTail = _tail;
+    _reserved = 0;
+    _open.clear();
+    _pinned = false;
+    _commitsSinceSync = 0;
+    _lastSync = chrono::steady_clock::now();
+    _stats = Stats{};
+    return Status::okStatus();
+}
+
+void TransactionJournal::close(void)
+{
+    if (_file.isOpen())
+    {
+        (void)flush();
+        _file.close();
+    }
+}
+
+Result<uint64_t> TransactionJournal::begin(size_t records)
+{
+    lock_guard<mutex> lock(_mutex);
+    if (!_file.isOpen())
+    {
+        return Err::InvalidState;
+    }
+
+    // Reuse the file while quiescent, before it is actually full
+    if (_open.empty() && !_pinned && (_tail >= _capacity / 2 || _tail + records > _capacity))
+    {
+        // If the new generation cannot be synced, keep appending to the old one
+        (void)resetLocked();
+    }
+
+    if (_tail + _reserved + records > _capacity)
+    {
+        return Err::MemoryError;
+    }
+
+    uint64_t txId = _nextTxId++;
+    _reserved += records;
+    _open.emplace(txId, records);
+    return txId;
+}
+
+Status TransactionJournal::intent(uint64_t txId, uint8_t step, const JournalStep& info)
+{
+    return append(txId, Intent, step, &info);
+}
+
+Status TransactionJournal::executed(uint64_t txId, uint8_t step, const JournalStep& info)
+{
+    return append(txId, Executed, step, &info);
+}
+
+Status TransactionJournal::commit(uint64_t txId)
+{
+    Status status = append(txId, Committed, 0, nullptr);
+    if (!status.isOk() || _cfg.fsync == FsyncPolicy::Never)
+    {
+        return status;
+    }
+
+    size_t from = 0;
+    size_t to = 0;
+    {
+        lock_guard<mutex> lock(_mutex);
+        ++_commitsSinceSync;
+
+        auto now = chrono::steady_clock::now();
+        bool due = _cfg.fsync == FsyncPolicy::EveryCommit
+                || _commitsSinceSync >= _cfg.groupCommits
+                || now - _lastSync >= _cfg.groupWindow;
+        if (!due || _syncedTail == _tail)
+        {
+            return Status::okStatus();
+        }
+
+        // This committer syncs on behalf of every record appended so far
+        from = _syncedTail;
+        to = _tail;
+        _syncedTail = _tail;
+        _commitsSinceSync = 0;
+        _lastSync = now;
+    }
+
+    return syncRecords(from, to);
+}
+
+Status TransactionJournal::rolledBack(uint64_t txId)
+{
+    return append(txId, RolledBack, 0, nullptr);
+}
+
+Status TransactionJournal::defer(uint64_t txId, uint8_t step, const JournalStep& owed)
+{
+    if (!_file.isOpen())
+    {
+        return Status::error(Err::InvalidState);
+    }
+
+    RecoveredStep s;
+    s.index = step;
+    s.op = owed.op;
+    s.account = owed.account;
+    s.amount = owed.amount;
+    s.arg = owed.arg;
+    {
+        lock_guard<mutex> lock(_mutex);
+        Status status = deferLocked(txId, { s });
+        if (!status.isOk())
+        {
+            return status;
+        }
+    }
+
+    // The deferred slot is authoritative, so this record need not be synced
+    return append(txId, Deferred, 0, nullptr);
+}
+
+Status TransactionJournal::append(uint64_t txId, uint8_t type, uint8_t step, const JournalStep* info)
+{
+    if (!_file.isOpen())
+    {
+        return Status::error(Err::InvalidState);
+    }
+
+    Record r = info ? makeRecord(txId, type, step, info->op, info->account.c_str(), info->amount, info->arg)
+                    : makeRecord(txId, type, step, 0, "", 0, 0);
+
+    lock_guard<mutex> lock(_mutex);
+    auto it = _open.find(txId);
+    if (it != _open.end() && it->second > 0)
+    {
+        --it->second;
+        --_reserved;
+    }
+    else if (_tail + _reserved >= _capacity)
+    {
+        return Status::error(Err::MemoryError);
+    }
+
+    r.generation = _generation;
+    r.checksum = checksum(r);
+
+    memcpy(&recordArea(_file, _deferredSlots)[_tail], &r, sizeof(r));
+    ++_tail;
+    ++_stats.records;
+
+    if ((type == Committed || type == RolledBack || type == Deferred) && it != _open.end())
+    {
+        _reserved -= it->second;
+        _open.erase(it);
+    }
+    return Status::okStatus();
+}
+
+Status TransactionJournal::deferLocked(uint64_t txId, const vector<RecoveredStep>& steps)
+{
+    // All steps or none: a partial set would be settled wrongly by recovery
+    Record* deferred = deferredArea(_file);
+    vector<size_t> free;
+    for (size_t i = 0; i < _deferredSlots && free.size() < steps.size(); ++i)
+    {
+        if (deferred[i].type == Empty || deferred[i].checksum != checksum(deferred[i]))
+        {
+            free.push_back(i);
+        }
+    }
+    if (free.size() < steps.size())
+    {
+        return Status::error(Err::MemoryError);
+    }
+
+    for (size_t i = 0; i < steps.size(); ++i)
+    {
+        const RecoveredStep& s = steps[i];
+        Record r = makeRecord(txId, s.executed ? Executed : Intent, s.index, s.op, s.account.c_str(), s.amount, s.arg);
+        r.checksum = checksum(r);
+        memcpy(&deferred[free[i]], &r, sizeof(r));
+    }
+
+    Status status = _file.sync(sizeof(Header), _deferredSlots * sizeof(Record));
+    if (!status.isOk())
+    {
+        for (size_t slot : free)
+        {
+            memset(&deferred[slot], 0, sizeof(Record));
+        }
+        return status;
+    }
+    ++_stats.deferred;
+    return Status::okStatus();
+}
+
+Status TransactionJournal::resetLocked(void)
+{
+    // Bumping the generation invalidates every old record at once
+    Header* header = reinterpret_cast<Header*>(_file.data());
+    header->generation = _generation + 1;
+    Status status = _file.sync(0, sizeof(Header));
+    if (!status.isOk())
+    {
+        // Records appended under an unsynced generation could be dropped on reopen
+        header->generation = _generation;
+        return status;
+    }
+
+    ++_generation;
+    _tail = 0;
+    _syncedTail = 0;
+    ++_stats.resets;
+    return Status::okStatus();
+}
+
+Status TransactionJournal::syncRecords(size_t from, size_t to)
+{
+    if (from >= to)
+    {
+        return Status::okStatus();
+    }
+
+    lock_guard<mutex> lock(_syncMutex);
+    size_t base = sizeof(Header) + _deferredSlots * sizeof(Record);
+    Status status = _file.sync(base + from * sizeof(Record), (to - from) * sizeof(Record));
+    if (status.isOk())
+    {
+        lock_guard<mutex> statsLock(_mutex);
+        ++_stats.syncs;
+    }
+    return status;
+}
+
+Status TransactionJournal::flush(void)
+{
+    size_t from = 0;
+    size_t to = 0;
+    {
+        lock_guard<mutex> lock(_mutex);
+        from = _syncedTail;
+        to = _tail;
+        _syncedTail = _tail;
+        _commitsSinceSync = 0;
+        _lastSync = chrono::steady_clock::now();
+    }
+    return syncRecords(from, to);
+}
+
+size_t TransactionJournal::recover(const Compensation& compensate)
+{
+    struct Pending {
+        vector<RecoveredStep> steps;
+        bool finished = false;
+    };
+
+    map<uint64_t, Pending> transactions;
+    map<uint64_t, vector<RecoveredStep>> deferred;
+    {
+        lock_guard<mutex> lock(_mutex);
+        const Record* owed = deferredArea(_file);
+        for (size_t i = 0; i < _deferredSlots; ++i)
+        {
+            const Record& r = owed[i];
+            if (r.type != Empty && r.checksum == checksum(r))
+            {
+                deferred[r.txId].push_back(toStep(r));
+            }
+        }
+
+        const Record* records = recordArea(_file, _deferredSlots);
+        for (size_t i = 0; i < _tail; ++i)
+        {
+            const Record& r = records[i];
+            Pending& tx = transactions[r.txId];
+            if (r.type == Committed || r.type == RolledBack || r.type == Deferred)
+            {
+                tx.finished = true;
+                continue;
+            }
+
+            auto it = find_if(tx.steps.begin(), tx.steps.end(),
+                              [&](const RecoveredStep& s) { return s.index == r.step; });
+            if (it == tx.steps.end())
+            {
+                tx.steps.push_back(toStep(r));
+            }
+            else
+            {
+                it->executed = it->executed || r.type == Executed;
+            }
+        }
+    }
+
+    size_t recovered = 0;
+    for (auto& entry : deferred)
+    {
+        sortReversed(entry.second);
+        if (!compensate(entry.first, entry.second))
+        {
+            continue;
+        }
+
+        lock_guard<mutex> lock(_mutex);
+        Record* owed = deferredArea(_file);
+        for (size_t i = 0; i < _deferredSlots; ++i)
+        {
+            if (owed[i].type != Empty && owed[i].txId == entry.first)
+            {
+                memset(&owed[i], 0, sizeof(Record));
+            }
+        }
+        // Unsynced, the slot is settled again next time; capture and release are idempotent
+        (void)_file.sync(sizeof(Header), _deferredSlots * sizeof(Record));
+        ++recovered;
+    }
+
+    bool pinned = false;
+    for (auto& entry : transactions)
+    {
+        Pending& tx = entry.second;
+        // A deferred copy means a lost Deferred record, not a second transaction
+        if (tx.finished || deferred.count(entry.first))
+        {
+            continue;
+        }
+
+        sortReversed(tx.steps);
+        if (compensate(entry.first, tx.steps))
+        {
+            (void)rolledBack(entry.first);
+            ++recovered;
+            continue;
+        }
+
+        // Still unsettled: move it out of the way of reuse, or keep the file as it is
+        Status moved;
+        {
+            lock_guard<mutex> lock(_mutex);
+            moved = deferLocked(entry.first, tx.steps);
+        }
+        if (moved.isOk())
+        {
+            (void)append(entry.first, Deferred, 0, nullptr);
+        }
+        else
+        {
+            pinned = true;
+        }
+    }
+
+    (void)flush();
+
+    lock_guard<mutex> lock(_mutex);
+    _pinned = pinned;
+    if (_open.empty() && !_pinned)
+    {
+        // On failure the settled records simply stay until the next reuse
+        (void)resetLocked();
+    }
+    return recovered;
+}
+
+TransactionJournal::Stats TransactionJournal::stats(void)
+{
+    lock_guard<mutex> lock(_mutex);
+    return _stats;
+}
@@ -0,0 +1,122 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "AsyncInterfaces.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include <chrono>
+#include <future>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Test withdrawal through the async adapters
+ *
+ * - Blocking fakes work unchanged behind the adapters
+ * - Successful withdrawal updates bank and cash bin
+ * - Pre-check failures map to the same errors as the blocking path
+ * - A hold placed while the cash bin is short is released
+ */
+TEST(test_async_withdraw_through_adapters)
+    Card card = "CARD-001";
+    Pin pin = "12345";
+    AccountId account1 = "ACCOUNT-001";
+    AccountId account2 = "ACCOUNT-002";
+    int cashCapacity = 1000;
+
+    unordered_map<Card, Pin> pinMap = {{card, pin}};
+    unordered_map<Card, vector<AccountId>> accountsMap = {{card, {account1, account2}}};
+    unordered_map<AccountId, int> balanceMap = {{account1, 10000}, {account2, 100}};
+
+    FakeBank bank(pinMap, accountsMap, balanceMap);
+    FakeCashBin cashBin(cashCapacity);
+    FakeCardReader cardReader(card);
+
+    ThreadPool pool(2);
+    AsyncBankAdapter asyncBank(bank, pool);
+    AsyncCashBinAdapter asyncCashBin(cashBin, pool);
+    Controller atm(cardReader, bank, cashBin, asyncBank, asyncCashBin);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account1).isOk());
+
+    REQUIRE(atm.withdraw(200).isOk());
+    REQUIRE(atm.getBalance().value() == 10000 - 200);
+    REQUIRE(cashBin.getCurrentCapacity() == cashCapacity - 200);
+
+    // Cash bin short, bank fine: the concurrent hold is released again
+    REQUIRE(atm.withdraw(900).code == Err::InsufficientCashBin);
+    REQUIRE(atm.getBalance().value() == 10000 - 200);
+    REQUIRE(bank.holds.empty());
+    REQUIRE(atm.ejectCard().isOk());
+
+    // Bank short, cash bin fine
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account2).isOk());
+    REQUIRE(atm.withdraw(500).code == Err::InsufficientBank);
+    REQUIRE(atm.getBalance().value() == 100);
+    REQUIRE(cashBin.getCurrentCapacity() == cashCapacity - 200);
+
+    REQUIRE(atm.ejectCard().isOk());
+END_TEST
+
+/**
+ * @brief Test that the bank hold and cash bin pre-check run concurrently
+ *
+ * The bank hold only succeeds once the cash bin pre-check has started,
+ * which can only happen if both are in flight at the same time.
+ */
+TEST(test_async_prechecks_overlap)
+    Card card = "CARD-001";
+    Pin pin = "12345";
+    AccountId account = "ACCOUNT-001";
+
+    class RendezvousBank : public FakeBank {
+    public:
+        shared_future<void> cashCheckStarted;
+
+        using FakeBank::FakeBank;
+
+        Result<HoldId> placeHold(const AccountId& accountId, int money) override
+        {
+            if (cashCheckStarted.wait_for(chrono::seconds(2)) != future_status::ready) {
+                return Err::NetworkError;
+            }
+            return FakeBank::placeHold(accountId, money);
+        }
+    };
+
+    class RendezvousCashBin : public FakeCashBin {
+    public:
+        promise<void> started;
+
+        using FakeCashBin::FakeCashBin;
+
+        Status canDispense(int money) override
+        {
+            started.set_value();
+            return FakeCashBin::canDispense(money);
+        }
+    };
+
+    RendezvousBank bank({{card, pin}}, {{card, {account}}}, {{account, 1000}});
+    RendezvousCashBin cashBin(1000);
+    bank.cashCheckStarted = cashBin.started.get_future().share();
+    FakeCardReader cardReader(card);
+
+    ThreadPool pool(2);
+    AsyncBankAdapter asyncBank(bank, pool);
+    AsyncCashBinAdapter asyncCashBin(cashBin, pool);
+    Controller atm(cardReader, bank, cashBin, asyncBank, asyncCashBin);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+    REQUIRE_MSG(atm.withdraw(100).isOk(), "Pre-checks should be in flight together");
+    REQUIRE(atm.getBalance().value() == 900);
+    REQUIRE(atm.ejectCard().isOk());
+END_TEST
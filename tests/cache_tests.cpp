@@ -0,0 +1,126 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    class CountingBank : public FakeBank {
+    public:
+        int listCalls = 0;
+        int balanceCalls = 0;
+
+        using FakeBank::FakeBank;
+
+        vector<AccountId> listAccounts(const Card& card) override
+        {
+            ++listCalls;
+            return FakeBank::listAccounts(card);
+        }
+
+        Result<int> getBalance(const AccountId& accountId) override
+        {
+            ++balanceCalls;
+            return FakeBank::getBalance(accountId);
+        }
+    };
+}
+
+/**
+ * @brief Test session cache round-trip savings
+ *
+ * - Account list is fetched once for listAccounts and selectAccount
+ * - Balance is fetched once and kept current across deposit and withdraw
+ * - Ejecting the card drops the cache
+ */
+TEST(test_session_cache_saves_round_trips)
+    Card card = "CARD-001";
+    Pin pin = "12345";
+    AccountId account = "ACCOUNT-001";
+
+    CountingBank bank({{card, pin}}, {{card, {account}}}, {{account, 1000}});
+    FakeCashBin cashBin(10000);
+    FakeCardReader cardReader(card);
+
+    Controller::Config cfg;
+    cfg.sessionCache = true;
+    Controller atm(cardReader, bank, cashBin, cfg);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.listAccounts().value().size() == 1);
+    REQUIRE(atm.selectAccount(account).isOk());
+    REQUIRE(bank.listCalls == 1);
+
+    REQUIRE(atm.getBalance().value() == 1000);
+    REQUIRE(atm.getBalance().value() == 1000);
+    REQUIRE(bank.balanceCalls == 1);
+
+    REQUIRE(atm.deposit(250).isOk());
+    REQUIRE(atm.getBalance().value() == 1250);
+    REQUIRE(atm.withdraw(50).isOk());
+    REQUIRE(atm.getBalance().value() == 1200);
+    REQUIRE(bank.balanceCalls == 1);
+    REQUIRE(bank.balanceMap[account] == 1200);
+
+    auto stats = atm.cacheStats();
+    REQUIRE(stats.hits == 4);
+    REQUIRE(stats.misses == 2);
+
+    // New session must go back to the bank
+    REQUIRE(atm.ejectCard().isOk());
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+    REQUIRE(atm.getBalance().value() == 1200);
+    REQUIRE(bank.listCalls == 2);
+    REQUIRE(bank.balanceCalls == 2);
+    REQUIRE(atm.ejectCard().isOk());
+END_TEST
+
+/**
+ * @brief Test session cache after a failed withdrawal
+ *
+ * - Failed dispense invalidates the cached balance
+ * - Next balance read reflects the rolled-back bank value
+ */
+TEST(test_session_cache_invalidated_on_failed_withdraw)
+    Card card = "CARD-001";
+    Pin pin = "12345";
+    AccountId account = "ACCOUNT-001";
+
+    class FailingCashBin : public ICashBin {
+    public:
+        Status canDispense(int) override
+        {
+            return Status::okStatus();
+        }
+
+        Status dispense(int) override
+        {
+            return Status::error(Err::HardwareError);
+        }
+    };
+
+    CountingBank bank({{card, pin}}, {{card, {account}}}, {{account, 1000}});
+    FailingCashBin cashBin;
+    FakeCardReader cardReader(card);
+
+    Controller::Config cfg;
+    cfg.sessionCache = true;
+    Controller atm(cardReader, bank, cashBin, cfg);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+    REQUIRE(atm.getBalance().value() == 1000);
+
+    REQUIRE(!atm.withdraw(100).isOk());
+    REQUIRE(atm.getBalance().value() == 1000);
+    REQUIRE(bank.balanceCalls == 2);
+    REQUIRE(atm.ejectCard().isOk());
+END_TEST
@@ -0,0 +1,161 @@
+#include "test_framework.hpp"
+#include "CassetteCashBin.hpp"
+#include "Controller.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    /**
+     * @brief Fewest notes for an amount by trying every mix, INT_MAX if none
+     */
+    int bruteForceNotes(const vector<CassetteCashBin::Cassette>& cassettes, size_t i, int money)
+    {
+        if (i == cassettes.size())
+        {
+            return money == 0 ? 0 : INT_MAX;
+        }
+
+        int best = INT_MAX;
+        for (int n = 0; n <= cassettes[i].count && n * cassettes[i].denomination <= money; ++n)
+        {
+            int rest = bruteForceNotes(cassettes, i + 1, money - n * cassettes[i].denomination);
+            if (rest != INT_MAX)
+            {
+                best = min(best, n + rest);
+            }
+        }
+        return best;
+    }
+
+    bool validPlan(const CassetteCashBin& bin, const CassetteCashBin::Plan& plan, int money)
+    {
+        int paid = 0;
+        for (size_t i = 0; i < plan.size(); ++i)
+        {
+            if (plan[i] < 0 || plan[i] > bin.cassettes()[i].count) return false;
+            paid += plan[i] * bin.cassettes()[i].denomination;
+        }
+        return paid == money;
+    }
+
+    int noteCount(const CassetteCashBin::Plan& plan)
+    {
+        int notes = 0;
+        for (int n : plan) notes += n;
+        return notes;
+    }
+}
+
+/**
+ * @brief Test canDispense and plans against exhaustive search
+ *
+ * - Every amount up to the limit agrees with a brute-force search
+ * - FewestNotes plans are optimal, Balanced plans are valid
+ * - Amounts off the note grid, over the limit or not positive are refused
+ */
+TEST(test_cassette_plans)
+    vector<CassetteCashBin::Cassette> cassettes{ {50, 3}, {20, 4}, {10, 1}, {100, 2} };
+    CassetteCashBin::Config cfg;
+    cfg.maxDispense = 500;
+    CassetteCashBin bin(cassettes, cfg);
+
+    int mismatches = 0;
+    for (int money = 10; money <= cfg.maxDispense; money += 10)
+    {
+        int expected = bruteForceNotes(cassettes, 0, money);
+        bool can = bin.canDispense(money).isOk();
+        auto fewest = bin.plan(money, CassetteCashBin::Strategy::FewestNotes);
+        auto balanced = bin.plan(money, CassetteCashBin::Strategy::Balanced);
+
+        if (can != (expected != INT_MAX) || fewest.isOk() != can || balanced.isOk() != can)
+        {
+            ++mismatches;
+        }
+        else if (can && (!validPlan(bin, fewest.value(), money) || noteCount(fewest.value()) != expected
+                         || !validPlan(bin, balanced.value(), money)))
+        {
+            ++mismatches;
+        }
+    }
+    REQUIRE_MSG(mismatches == 0, "tables agree with exhaustive search");
+
+    REQUIRE(bin.canDispense(0).code == Err::InvalidArg);
+    REQUIRE(bin.canDispense(-10).code == Err::InvalidArg);
+    REQUIRE(bin.canDispense(15).code == Err::InsufficientCashBin);
+    REQUIRE(bin.canDispense(510).code == Err::InsufficientCashBin);
+    REQUIRE(bin.total() == 150 + 80 + 10 + 200);
+END_TEST
+
+/**
+ * @brief Test inventory and table updates across dispenses
+ *
+ * - Dispensing takes notes out and the tables follow
+ * - Refills make amounts payable again
+ * - Balanced draws from the cassette holding the most cash
+ * - The per-dispense note limit is enforced
+ */
+TEST(test_cassette_dispense)
+    CassetteCashBin bin({ {10000, 2}, {5000, 1}, {1000, 3} });
+
+    REQUIRE(bin.canDispense(8000).isOk());
+    REQUIRE(bin.dispense(8000).isOk());
+    REQUIRE(bin.cassettes()[1].count == 0);
+    REQUIRE(bin.cassettes()[2].count == 0);
+    REQUIRE(bin.canDispense(1000).code == Err::InsufficientCashBin);
+    REQUIRE(bin.dispense(5000).code == Err::InsufficientCashBin);
+    REQUIRE(bin.total() == 20000);
+
+    REQUIRE(bin.refill(2, 5).isOk());
+    REQUIRE(bin.refill(7, 5).code == Err::InvalidArg);
+    REQUIRE(bin.canDispense(4000).isOk());
+    REQUIRE(bin.dispense(14000).isOk());
+    REQUIRE(bin.cassettes()[0].count == 1);
+    REQUIRE(bin.cassettes()[2].count == 1);
+
+    CassetteCashBin::Config balanced;
+    balanced.strategy = CassetteCashBin::Strategy::Balanced;
+    CassetteCashBin even({ {50, 10}, {20, 100} }, balanced);
+    auto fewest = even.plan(200, CassetteCashBin::Strategy::FewestNotes);
+    REQUIRE(fewest.isOk() && fewest.value()[0] == 4);
+    REQUIRE(even.dispense(200).isOk());
+    REQUIRE(even.cassettes()[0].count == 10);
+    REQUIRE(even.cassettes()[1].count == 90);
+
+    CassetteCashBin::Config limited;
+    limited.maxNotes = 5;
+    CassetteCashBin small({ {20, 100} }, limited);
+    REQUIRE(small.canDispense(100).isOk());
+    REQUIRE(small.canDispense(120).code == Err::InsufficientCashBin);
+    REQUIRE(small.dispense(120).code == Err::InsufficientCashBin);
+    REQUIRE(small.cassettes()[0].count == 100);
+END_TEST
+
+/**
+ * @brief Test a Controller withdrawing from cassettes
+ *
+ * - An amount the notes cannot make is refused before the bank is charged
+ */
+TEST(test_cassette_controller_withdraw)
+    Card card = "CARD-001";
+    Pin pin = "1234";
+    AccountId account = "ACCOUNT-001";
+
+    FakeCardReader cardReader(card);
+    FakeBank bank({ {card, pin} }, { {card, {account}} }, { {account, 100000} });
+    CassetteCashBin cashBin({ {10000, 5}, {5000, 2} });
+    Controller atm(cardReader, bank, cashBin);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+
+    REQUIRE(atm.withdraw(1000).code == Err::InsufficientCashBin);
+    REQUIRE(atm.withdraw(25000).isOk());
+    REQUIRE(bank.balanceMap[account] == 75000);
+    REQUIRE(cashBin.total() == 35000);
+END_TEST
@@ -0,0 +1,317 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "CircuitBreakerBank.hpp"
+#include "DepositQueue.hpp"
+#include "ShardedBank.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/LatencyBank.hpp"
+#include "fakes/TempPath.hpp"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+namespace {
+    /**
+     * @brief Thread-safe bank whose link can be cut; calls then throw like a dead connection
+     */
+    class LinkBank : public ShardedBank {
+    public:
+        atomic<bool> down{ false };
+        atomic<int> calls{ 0 };
+
+        LinkBank(const Card& card, const Pin& pin, const AccountId& account, int balance)
+        {
+            (void)addAccount(account, balance);
+            (void)addCard(card, pin, { account });
+        }
+
+        void arrive(void)
+        {
+            ++calls;
+            if (down)
+            {
+                throw runtime_error("connection refused");
+            }
+        }
+
+        /**
+         * @brief Balance at the bank, without going over the link
+         */
+        int balance(const AccountId& accountId)
+        {
+            return ShardedBank::getBalance(accountId).value();
+        }
+
+        Status verifyPin(const Card& card, const Pin& pin) override
+        {
+            arrive();
+            return ShardedBank::verifyPin(card, pin);
+        }
+
+        vector<AccountId> listAccounts(const Card& card) override
+        {
+            arrive();
+            return ShardedBank::listAccounts(card);
+        }
+
+        Result<int> getBalance(const AccountId& accountId) override
+        {
+            arrive();
+            return ShardedBank::getBalance(accountId);
+        }
+
+        Status deposit(const AccountId& accountId, int money) override
+        {
+            arrive();
+            return ShardedBank::deposit(accountId, money);
+        }
+
+        Result<HoldId> placeHold(const AccountId& accountId, int money) override
+        {
+            arrive();
+            return ShardedBank::placeHold(accountId, money);
+        }
+
+        Status captureHold(HoldId holdId) override
+        {
+            arrive();
+            return ShardedBank::captureHold(holdId);
+        }
+
+        Status releaseHold(HoldId holdId) override
+        {
+            arrive();
+            return ShardedBank::releaseHold(holdId);
+        }
+
+        vector<Status> postDeposits(const vector<DepositPosting>& batch) override
+        {
+            arrive();
+            return ShardedBank::postDeposits(batch);
+        }
+    };
+
+    CircuitBreakerBank::Config quickBreaker(void)
+    {
+        CircuitBreakerBank::Config cfg;
+        cfg.window = 10;
+        cfg.minCalls = 4;
+        cfg.openDuration = chrono::milliseconds(50);
+        cfg.halfOpenProbes = 2;
+        return cfg;
+    }
+}
+
+/**
+ * @brief Test the closed, open and half-open cycle
+ *
+ * - Failures past the threshold open the circuit
+ * - Open: calls fail fast without reaching the bank
+ * - Half-open: passing probes close it, a failing probe opens it again
+ */
+TEST(test_breaker_cycle)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+    LinkBank link(card, "1234", account, 1000);
+    CircuitBreakerBank bank(link, quickBreaker());
+
+    REQUIRE(bank.getBalance(account).isOk());
+    link.down = true;
+    int thrown = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        try {
+            (void)bank.getBalance(account);
+        }
+        catch (const runtime_error&) {
+            ++thrown;
+        }
+    }
+    REQUIRE(thrown == 3);
+    REQUIRE(bank.state() == CircuitBreakerBank::State::Open);
+
+    int before = link.calls;
+    REQUIRE(bank.getBalance(account).error() == Err::NetworkError);
+    REQUIRE(bank.verifyPin(card, "1234").code == Err::NetworkError);
+    bool threw = false;
+    try {
+        (void)bank.listAccounts(card);
+    }
+    catch (const runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+    REQUIRE(bank.deposit(account, 100).code == Err::NetworkError);
+    REQUIRE(link.calls == before);
+    REQUIRE(bank.stats().rejected == 4);
+
+    // A failing probe reopens
+    this_thread::sleep_for(chrono::milliseconds(60));
+    REQUIRE(bank.state() == CircuitBreakerBank::State::HalfOpen);
+    threw = false;
+    try {
+        (void)bank.getBalance(account);
+    }
+    catch (const runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+    REQUIRE(bank.state() == CircuitBreakerBank::State::Open);
+    REQUIRE(bank.stats().opened == 2);
+
+    link.down = false;
+    this_thread::sleep_for(chrono::milliseconds(60));
+    REQUIRE(bank.getBalance(account).isOk());
+    REQUIRE(bank.state() == CircuitBreakerBank::State::HalfOpen);
+    REQUIRE(bank.verifyPin(card, "1234").isOk());
+    REQUIRE(bank.state() == CircuitBreakerBank::State::Closed);
+
+    // Business errors are not link failures
+    for (int i = 0; i < 8; ++i)
+    {
+        REQUIRE(bank.verifyPin(card, "0000").code == Err::InvalidArg);
+    }
+    REQUIRE(bank.state() == CircuitBreakerBank::State::Closed);
+END_TEST
+
+/**
+ * @brief Test that holds are settled while the circuit is open
+ *
+ * - captureHold and releaseHold reach the bank instead of failing fast
+ * - They do not close the circuit as probes would
+ */
+TEST(test_breaker_passes_settlement)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+    LinkBank link(card, "1234", account, 1000);
+    CircuitBreakerBank::Config cfg = quickBreaker();
+    cfg.openDuration = chrono::seconds(60);
+    CircuitBreakerBank bank(link, cfg);
+
+    HoldId captured = bank.placeHold(account, 100).value();
+    HoldId released = bank.placeHold(account, 200).value();
+
+    link.down = true;
+    for (int i = 0; i < 4; ++i)
+    {
+        try {
+            (void)bank.getBalance(account);
+        }
+        catch (const runtime_error&) {
+        }
+    }
+    REQUIRE(bank.isOpen());
+
+    // The link is back, but the circuit stays open for a minute
+    link.down = false;
+    int before = link.calls;
+    uint64_t rejected = bank.stats().rejected;
+    REQUIRE(bank.getBalance(account).error() == Err::NetworkError);
+    REQUIRE(bank.captureHold(captured).isOk());
+    REQUIRE(bank.releaseHold(released).isOk());
+    REQUIRE(link.calls == before + 2);
+    REQUIRE(link.balance(account) == 900);
+    REQUIRE(bank.isOpen());
+    REQUIRE(bank.stats().rejected == rejected + 1);
+END_TEST
+
+/**
+ * @brief Test opening on slow calls
+ */
+TEST(test_breaker_slow_calls)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+    FakeBank fake({ {card, "1234"} }, { {card, {account}} }, { {account, 1000} });
+    LatencyBank slow(fake);
+    slow.setLatency(chrono::milliseconds(5));
+
+    auto cfg = quickBreaker();
+    cfg.slowCall = chrono::milliseconds(2);
+    CircuitBreakerBank bank(slow, cfg);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        REQUIRE(bank.getBalance(account).isOk());
+    }
+    REQUIRE(bank.isOpen());
+    REQUIRE(bank.getBalance(account).error() == Err::NetworkError);
+    REQUIRE(slow.calls == 4);
+END_TEST
+
+/**
+ * @brief Test the controller's degraded mode
+ *
+ * - Balance inquiry and withdrawal fail fast while the circuit is open
+ * - Deposits go to the durable queue, whose flusher posts them once the
+ *   circuit closes
+ * - Without a queue, deposits fail fast as well
+ */
+TEST(test_breaker_degraded_controller)
+    Card card = "CARD-001";
+    Pin pin = "1234";
+    AccountId account = "ACCOUNT-001";
+
+    FakeCardReader cardReader(card);
+    LinkBank link(card, pin, account, 1000);
+    FakeCashBin cashBin(1000);
+
+    auto breakerCfg = quickBreaker();
+    breakerCfg.halfOpenProbes = 1;
+    CircuitBreakerBank bank(link, breakerCfg);
+
+    DepositQueue queue(bank);
+    DepositQueue::Config queueCfg;
+    queueCfg.flushInterval = chrono::milliseconds(5);
+    queueCfg.retryDelay = chrono::milliseconds(20);
+    REQUIRE(queue.open(tempPath("degraded", ".deposits"), queueCfg).isOk());
+
+    Controller::Config cfg;
+    cfg.sessionCache = true;
+    cfg.breaker = &bank;
+    cfg.depositQueue = &queue;
+    Controller atm(cardReader, bank, cashBin, cfg);
+
+    Controller::Config directCfg;
+    directCfg.breaker = &bank;
+    FakeCardReader directReader(card);
+    Controller direct(directReader, bank, cashBin, directCfg);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+    REQUIRE(atm.getBalance().value() == 1000);
+    REQUIRE(direct.insertCard().isOk());
+    REQUIRE(direct.enterPin(pin).isOk());
+    REQUIRE(direct.selectAccount(account).isOk());
+    REQUIRE(!atm.degraded());
+
+    link.down = true;
+    for (int i = 0; i < 10 && !atm.degraded(); ++i)
+    {
+        REQUIRE(direct.deposit(10).code == Err::NetworkError);
+    }
+    REQUIRE(atm.degraded());
+
+    REQUIRE(atm.getBalance().error() == Err::NetworkError);
+    REQUIRE(atm.withdraw(100).code == Err::NetworkError);
+    REQUIRE(cashBin.getCurrentCapacity() == 1000);
+    int before = link.calls;
+    REQUIRE(direct.deposit(100).code == Err::NetworkError);
+    REQUIRE(link.calls == before);
+    REQUIRE(atm.deposit(100).isOk());
+    REQUIRE(atm.deposit(200).isOk());
+    REQUIRE(queue.pending(account) == 300);
+
+    link.down = false;
+    REQUIRE(queue.drain(chrono::milliseconds(2000)));
+    REQUIRE(!atm.degraded());
+    REQUIRE(link.balance(account) == 1000 + 300);
+    REQUIRE(atm.withdraw(100).isOk());
+    REQUIRE(link.balance(account) == 1000 + 300 - 100);
+    REQUIRE(queue.stats().posted == 2);
+END_TEST
@@ -0,0 +1,251 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "DepositQueue.hpp"
+#include "ShardedBank.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/TempPath.hpp"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+    using ms = chrono::milliseconds;
+
+    /**
+     * @brief Thread-safe bank whose batch link can fail before or after applying
+     */
+    class PostingBank : public ShardedBank {
+    public:
+        atomic<bool> down{ false };       ///< Batches fail before reaching the bank
+        atomic<int> loseReplies{ 0 };     ///< Batches applied, then the reply is lost
+        atomic<int> batches{ 0 };
+        atomic<int> deposits{ 0 };        ///< Single deposit() calls
+
+        Status deposit(const AccountId& accountId, int money) override
+        {
+            ++deposits;
+            return ShardedBank::deposit(accountId, money);
+        }
+
+        vector<Status> postDeposits(const vector<DepositPosting>& batch) override
+        {
+            ++batches;
+            if (down)
+            {
+                throw runtime_error("connection refused");
+            }
+            auto statuses = ShardedBank::postDeposits(batch);
+            if (loseReplies > 0)
+            {
+                --loseReplies;
+                throw runtime_error("connection reset");
+            }
+            return statuses;
+        }
+    };
+}
+
+/**
+ * @brief Test batching, idempotent resends and recovery from the file
+ *
+ * - Deposits are posted in batches of at most batchSize
+ * - A batch whose reply was lost is resent without being applied twice
+ * - Deposits left unposted on close are posted after reopening, and new
+ *   keys continue the old sequence
+ * - A bank that cannot recognize resent keys is refused
+ * - The bank forgets only its oldest keys
+ */
+TEST(test_deposit_queue_batches)
+    AccountId account = "ACCOUNT-001";
+    AccountId other = "ACCOUNT-002";
+    string path = tempPath("batches", ".deposits");
+
+    PostingBank bank;
+    (void)bank.addAccount(account, 1000);
+    (void)bank.addAccount(other, 0);
+
+    DepositQueue::Config cfg;
+    cfg.batchSize = 4;
+    cfg.flushInterval = ms(5000);
+    cfg.retryDelay = ms(10);
+    cfg.terminalId = 7;
+
+    uint64_t lastKey = 0;
+    {
+        DepositQueue queue(bank);
+        REQUIRE(queue.open(path, cfg).isOk());
+        REQUIRE(queue.enqueue(account, 0).error() == Err::InvalidArg);
+
+        for (int i = 1; i <= 10; ++i)
+        {
+            auto key = queue.enqueue(i % 2 ? account : other, 10);
+            REQUIRE(key.isOk() && key.value() > lastKey);
+            REQUIRE((key.value() >> 40) == 7);
+            lastKey = key.value();
+        }
+        REQUIRE(queue.drain(ms(2000)));
+        REQUIRE(bank.batches == 3);
+        REQUIRE(bank.deposits == 0);
+        REQUIRE(bank.getBalance(account).value() == 1050);
+        REQUIRE(bank.getBalance(other).value() == 50);
+
+        bank.loseReplies = 1;
+        REQUIRE(queue.enqueue(account, 100).isOk());
+        REQUIRE(queue.drain(ms(2000)));
+        REQUIRE(bank.batches == 5);
+        REQUIRE(bank.getBalance(account).value() == 1150);
+        REQUIRE(queue.stats().failedBatches == 1);
+        REQUIRE(queue.stats().posted == 11);
+
+        // The link is down at close, so the deposits stay in the file
+        bank.down = true;
+        REQUIRE(queue.enqueue(account, 200).isOk());
+        REQUIRE(queue.enqueue(other, 300).isOk());
+        REQUIRE(queue.pending(account) == 200);
+    }
+    REQUIRE(bank.getBalance(account).value() == 1150);
+
+    bank.down = false;
+    DepositQueue queue(bank);
+    REQUIRE(queue.open(path, cfg).isOk());
+    REQUIRE(queue.stats().recovered == 2);
+    REQUIRE(queue.drain(ms(2000)));
+    REQUIRE(bank.getBalance(account).value() == 1350);
+    REQUIRE(bank.getBalance(other).value() == 350);
+
+    auto key = queue.enqueue(account, 1);
+    REQUIRE(key.isOk() && key.value() == lastKey + 4);
+    queue.close();
+
+    FakeBank plain({}, {}, {{account, 0}});
+    DepositQueue unkeyed(plain);
+    REQUIRE(!plain.keyedDeposits());
+    REQUIRE(unkeyed.open(tempPath("unkeyed", ".deposits"), cfg).code == Err::InvalidArg);
+
+    // One shard remembering two keys: the oldest is the first forgotten
+    ShardedBank small(1, 2);
+    (void)small.addAccount(other, 0);
+    (void)small.postDeposits({ { 1, other, 10 }, { 2, other, 10 }, { 2, other, 10 } });
+    REQUIRE(small.getBalance(other).value() == 20);
+    (void)small.postDeposits({ { 3, other, 10 }, { 2, other, 10 }, { 1, other, 10 } });
+    REQUIRE(small.getBalance(other).value() == 40);
+END_TEST
+
+/**
+ * @brief Test back-pressure when the queue is full
+ *
+ * - A full queue fails enqueue with MemoryError after fullWait
+ * - Once the bank is back, a full queue makes room by flushing at once
+ * - Deposits the bank refuses are kept, across reopening, until acknowledged
+ */
+TEST(test_deposit_queue_backpressure)
+    AccountId account = "ACCOUNT-001";
+    string path = tempPath("backpressure", ".deposits");
+
+    PostingBank bank;
+    (void)bank.addAccount(account, 0);
+
+    DepositQueue::Config cfg;
+    cfg.capacity = 4;
+    cfg.batchSize = 8;
+    cfg.flushInterval = ms(5000);
+    cfg.retryDelay = ms(5000);
+    cfg.fullWait = ms(50);
+
+    DepositQueue queue(bank);
+    REQUIRE(queue.open(path, cfg).isOk());
+
+    bank.down = true;
+    for (int i = 0; i < 4; ++i)
+    {
+        REQUIRE(queue.enqueue(account, 100).isOk());
+    }
+    REQUIRE(queue.enqueue(account, 100).error() == Err::MemoryError);
+    REQUIRE(queue.stats().rejected == 1);
+    REQUIRE(queue.size() == 4);
+
+    bank.down = false;
+    REQUIRE(queue.enqueue(account, 100).isOk());
+    REQUIRE(queue.drain(ms(2000)));
+    REQUIRE(bank.getBalance(account).value() == 500);
+
+    AccountId unknown = "ACCOUNT-404";
+    uint64_t key = queue.enqueue(unknown, 100).value();
+    REQUIRE(queue.drain(ms(2000)));
+    REQUIRE(queue.stats().refused == 1);
+    REQUIRE(queue.size() == 0);
+    REQUIRE(queue.refused().size() == 1);
+
+    // Still held after a restart, and it keeps its slot
+    queue.close();
+    REQUIRE(queue.open(path, cfg).isOk());
+    REQUIRE(queue.stats().recovered == 0);
+    auto refused = queue.refused();
+    REQUIRE(refused.size() == 1);
+    REQUIRE(refused[0].key == key);
+    REQUIRE(refused[0].account == unknown);
+    REQUIRE(refused[0].money == 100);
+    REQUIRE(refused[0].error != Err::None);
+    bank.down = true;
+    for (int i = 0; i < 3; ++i)
+    {
+        REQUIRE(queue.enqueue(account, 100).isOk());
+    }
+    REQUIRE(queue.enqueue(account, 100).error() == Err::MemoryError);
+
+    REQUIRE(queue.acknowledgeRefused(key).isOk());
+    REQUIRE(queue.acknowledgeRefused(key).code == Err::InvalidArg);
+    REQUIRE(queue.refused().empty());
+    REQUIRE(queue.enqueue(account, 100).isOk());
+    bank.down = false;
+END_TEST
+
+/**
+ * @brief Test deposits through the controller
+ *
+ * - Deposits are acknowledged before the bank sees them
+ * - The balance shows queued deposits, but they cannot be withdrawn yet
+ * - After posting the balance is unchanged
+ */
+TEST(test_deposit_queue_controller)
+    Card card = "CARD-001";
+    Pin pin = "1234";
+    AccountId account = "ACCOUNT-001";
+    string path = tempPath("controller", ".deposits");
+
+    PostingBank bank;
+    (void)bank.addAccount(account, 1000);
+    (void)bank.addCard(card, pin, { account });
+
+    DepositQueue::Config queueCfg;
+    queueCfg.flushInterval = ms(5000);
+    DepositQueue queue(bank);
+    REQUIRE(queue.open(path, queueCfg).isOk());
+
+    FakeCardReader cardReader(card);
+    FakeCashBin cashBin(10000);
+    Controller::Config cfg;
+    cfg.depositQueue = &queue;
+    Controller atm(cardReader, bank, cashBin, cfg);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+
+    REQUIRE(atm.deposit(500).isOk());
+    REQUIRE(atm.deposit(-1).code == Err::InvalidArg);
+    REQUIRE(bank.getBalance(account).value() == 1000);
+    REQUIRE(atm.getBalance().value() == 1500);
+    REQUIRE(atm.withdraw(1200).code == Err::InsufficientBank);
+
+    REQUIRE(queue.drain(ms(2000)));
+    REQUIRE(bank.getBalance(account).value() == 1500);
+    REQUIRE(atm.getBalance().value() == 1500);
+    REQUIRE(atm.withdraw(1200).isOk());
+    REQUIRE(atm.getBalance().value() == 300);
+    REQUIRE(bank.deposits == 0);
+END_TEST
@@ -10,6 +10,8 @@ public:
     unordered_map<Card, Pin> pinMap;
     unordered_map<Card, vector<AccountId>> accountsMap;
     unordered_map<AccountId, int> balanceMap;
+    unordered_map<HoldId, pair<AccountId, int>> holds;
+    HoldId nextHoldId = 1;
 
     FakeBank(unordered_map<Card, Pin> pinMap,
              unordered_map<Card, vector<AccountId>> accountsMap,
@@ -37,14 +39,32 @@ public:
         return vector<AccountId>();
     }
 
-    Result<int> getBalance(const AccountId& accountId)
+    /**
+     * @brief Balance minus the open holds on the account
+     */
+    int available(const AccountId& accountId) const
     {
         auto it = balanceMap.find(accountId);
-        if (it != balanceMap.end()) {
-            return Result<int>(it->second);
+        if (it == balanceMap.end()) {
+            return 0;
         }
 
-        return Result<int>(Err::InvalidArg);
+        int amount = it->second;
+        for (const auto& hold : holds) {
+            if (hold.second.first == accountId) {
+                amount -= hold.second.second;
+            }
+        }
+        return amount;
+    }
+
+    Result<int> getBalance(const AccountId& accountId)
+    {
+        if (balanceMap.count(accountId)) {
+            return available(accountId);
+        }
+
+        return Err::InvalidArg;
     }
 
     Status deposit(const AccountId& accountId, int money)
@@ -60,8 +80,7 @@ public:
 
     Status canWithdraw(const AccountId& accountId, int money)
     {
-        auto it = balanceMap.find(accountId);
-        if (it != balanceMap.end() && it->second >= money)
+        if (balanceMap.count(accountId) && available(accountId) >= money)
         {
             return Status::okStatus();
         }
@@ -72,11 +91,49 @@ public:
     Status withdraw(const AccountId& accountId, int money)
     {
         auto it = balanceMap.find(accountId);
-        if (it != balanceMap.end() && it->second >= money) {
+        if (it != balanceMap.end() && available(accountId) >= money) {
             it->second -= money;
             return Status::okStatus();
         }
 
         return Status::error(Err::InvalidArg);
     }
+
+    Result<HoldId> placeHold(const AccountId& accountId, int money)
+    {
+        if (!balanceMap.count(accountId)) {
+            return Err::InvalidArg;
+        }
+        if (available(accountId) < money) {
+            return Err::InsufficientBank;
+        }
+
+        // Held funds stay in balanceMap until captured; only available() drops
+        HoldId id = nextHoldId++;
+        holds.emplace(id, make_pair(accountId, money));
+        return id;
+    }
+
+    Status captureHold(HoldId holdId)
+    {
+        auto it = holds.find(holdId);
+        if (it == holds.end()) {
+            return Status::error(Err::InvalidArg);
+        }
+
+        balanceMap[it->second.first] -= it->second.second;
+        holds.erase(it);
+        return Status::okStatus();
+    }
+
+    Status releaseHold(HoldId holdId)
+    {
+        auto it = holds.find(holdId);
+        if (it == holds.end()) {
+            return Status::error(Err::InvalidArg);
+        }
+
+        holds.erase(it);
+        return Status::okStatus();
+    }
 };
\ No newline at end of file
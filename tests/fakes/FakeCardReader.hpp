@@ -6,6 +6,7 @@ public:
     Result<Card> card;
     bool inserted = false;
     bool ejected = false;
+    optional<PinReference> reference;
 
     FakeCardReader(Card& card) : card(card)
     {}
@@ -21,4 +22,9 @@ public:
         ejected = true;
         return Status::okStatus();
     }
+
+    optional<PinReference> pinReference(void)
+    {
+        return reference;
+    }
 };
\ No newline at end of file
@@ -0,0 +1,301 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "LatencyHistogram.hpp"
+#include "Result.hpp"
+
+using namespace std;
+
+/**
+ * @brief Time source the fault models wait on
+ */
+class FaultClock {
+public:
+    virtual ~FaultClock() = default;
+
+    virtual chrono::nanoseconds now(void) = 0;
+    virtual void sleep(chrono::nanoseconds delay) = 0;
+};
+
+/**
+ * @brief Steady clock; delays are really slept
+ */
+class RealClock : public FaultClock {
+private:
+    chrono::steady_clock::time_point _start = chrono::steady_clock::now();
+
+public:
+    chrono::nanoseconds now(void)
+    {
+        return chrono::steady_clock::now() - _start;
+    }
+
+    void sleep(chrono::nanoseconds delay)
+    {
+        this_thread::sleep_for(delay);
+    }
+};
+
+/**
+ * @brief Simulated clock; a delay moves time forward without waiting
+ *
+ * Runs are deterministic and take no wall time. Time is shared by every
+ * caller, so it models one caller at a time. Code that measures time itself
+ * (deadlines, breakers) does not see the simulated delays.
+ */
+class VirtualClock : public FaultClock {
+private:
+    atomic<int64_t> _ns{ 0 };
+
+public:
+    chrono::nanoseconds now(void)
+    {
+        return chrono::nanoseconds(_ns.load(memory_order_relaxed));
+    }
+
+    void sleep(chrono::nanoseconds delay)
+    {
+        advance(delay);
+    }
+
+    void advance(chrono::nanoseconds delay)
+    {
+        _ns.fetch_add(delay.count(), memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief Distribution of call latencies
+ */
+class LatencyModel {
+private:
+    function<chrono::nanoseconds(mt19937_64&)> _draw;
+
+    explicit LatencyModel(function<chrono::nanoseconds(mt19937_64&)> draw) : _draw(move(draw))
+    {}
+
+public:
+    LatencyModel() : LatencyModel(fixed(chrono::nanoseconds(0)))
+    {}
+
+    static LatencyModel fixed(chrono::nanoseconds latency)
+    {
+        return LatencyModel([latency](mt19937_64&) { return latency; });
+    }
+
+    /**
+     * @brief Lognormal latencies, the usual shape of a remote call
+     *
+     * @param median Half the calls are faster than this
+     * @param sigma Spread; 0.5 puts p99 at about 3.2x the median, 1.0 at about 10x
+     */
+    static LatencyModel lognormal(chrono::nanoseconds median, double sigma)
+    {
+        lognormal_distribution<double> shape(log(double(max<int64_t>(median.count(), 1))), max(sigma, 0.0));
+        return LatencyModel([shape](mt19937_64& random) mutable {
+            return chrono::nanoseconds(int64_t(shape(random)));
+        });
+    }
+
+    /**
+     * @brief Latencies drawn from a recorded histogram, e.g. a ControllerMetrics call
+     *
+     * A bucket is picked in proportion to its count, then a latency uniformly
+     * within the bucket, capped at the recorded maximum.
+     */
+    static LatencyModel replay(const LatencyHistogram::Snapshot& recorded)
+    {
+        if (recorded.count == 0)
+        {
+            return fixed(chrono::nanoseconds(0));
+        }
+
+        vector<double> weights(recorded.buckets.begin(), recorded.buckets.end());
+        discrete_distribution<size_t> bucket(weights.begin(), weights.end());
+        uint64_t maxNs = recorded.maxNs;
+        return LatencyModel([bucket, maxNs](mt19937_64& random) mutable {
+            size_t b = bucket(random);
+            uint64_t low = b ? LatencyHistogram::upperBoundNs(b - 1) + 1 : 0;
+            uint64_t high = max(low, min(LatencyHistogram::upperBoundNs(b), maxNs));
+            return chrono::nanoseconds(int64_t(uniform_int_distribution<uint64_t>(low, high)(random)));
+        });
+    }
+
+    chrono::nanoseconds operator()(mt19937_64& random) const
+    {
+        return _draw(random);
+    }
+};
+
+/**
+ * @brief How one kind of call behaves
+ *
+ * Rates are independent probabilities per call, checked in the order
+ * throw, error, lost reply.
+ */
+struct FaultModel {
+    LatencyModel latency;
+    double throwRate = 0;           ///< Throw runtime_error without reaching the device
+    double errorRate = 0;           ///< Answer with error without reaching the device
+    Err error = Err::NetworkError;
+    double lostReplyRate = 0;       ///< Reach the device, then throw as if the reply was lost
+};
+
+/**
+ * @brief Window on the clock during which a link is down
+ */
+struct Outage {
+    chrono::nanoseconds from{ 0 };
+    chrono::nanoseconds to{ 0 };
+    bool hang = false;              ///< Calls wait until the end of the window instead of failing at once
+};
+
+/**
+ * @brief Draws latency and faults for the calls of the faulty fakes
+ *
+ * Outages and models apply to every fake using the injector, so give each
+ * link its own injector (on a shared clock) when they fail independently.
+ * The same seed and the same calls give the same delays and faults.
+ * Thread-safe.
+ */
+class FaultInjector {
+public:
+    enum class Outcome {
+        Forward,        ///< Call the device normally
+        Error,          ///< Answer with Fault::error
+        Throw,          ///< Throw without calling the device
+        LoseReply,      ///< Call the device, then throw
+    };
+
+    struct Fault {
+        Outcome outcome = Outcome::Forward;
+        Err error = Err::None;
+    };
+
+    struct Stats {
+        uint64_t calls = 0;
+        uint64_t errors = 0;
+        uint64_t throws = 0;
+        uint64_t lostReplies = 0;
+        uint64_t outageCalls = 0;   ///< Calls that hit an outage (counted in throws too)
+        chrono::nanoseconds delay{ 0 };
+    };
+
+private:
+    FaultClock& _clock;
+    mutable mutex _mutex;
+    mt19937_64 _random;
+    FaultModel _default;
+    unordered_map<string, FaultModel> _models;
+    vector<Outage> _outages;
+    Stats _stats;
+
+public:
+    explicit FaultInjector(FaultClock& clock, uint64_t seed = 1) : _clock(clock), _random(seed)
+    {}
+
+    FaultClock& clock(void)
+    {
+        return _clock;
+    }
+
+    /**
+     * @brief Behavior of every call without a model of its own
+     */
+    void setModel(const FaultModel& model)
+    {
+        lock_guard<mutex> lock(_mutex);
+        _default = model;
+    }
+
+    /**
+     * @brief Behavior of one call, named like the interface method ("placeHold", "dispense")
+     */
+    void setModel(const string& call, const FaultModel& model)
+    {
+        lock_guard<mutex> lock(_mutex);
+        _models[call] = model;
+    }
+
+    void addOutage(const Outage& outage)
+    {
+        lock_guard<mutex> lock(_mutex);
+        _outages.push_back(outage);
+    }
+
+    /**
+     * @brief Wait out a call's latency and decide its fault
+     *
+     * @param call Interface method being called
+     */
+    Fault arrive(const char* call)
+    {
+        chrono::nanoseconds delay;
+        Fault fault;
+        const Outage* down = nullptr;
+        {
+            lock_guard<mutex> lock(_mutex);
+            ++_stats.calls;
+
+            chrono::nanoseconds now = _clock.now();
+            for (const Outage& outage : _outages)
+            {
+                if (now >= outage.from && now < outage.to)
+                {
+                    down = &outage;
+                    break;
+                }
+            }
+
+            if (down)
+            {
+                ++_stats.outageCalls;
+                ++_stats.throws;
+                delay = down->hang ? down->to - now : chrono::nanoseconds(0);
+                fault.outcome = Outcome::Throw;
+            }
+            else
+            {
+                auto it = _models.find(call);
+                const FaultModel& model = it != _models.end() ? it->second : _default;
+                delay = model.latency(_random);
+
+                uniform_real_distribution<double> chance(0.0, 1.0);
+                if (model.throwRate > 0 && chance(_random) < model.throwRate)
+                {
+                    ++_stats.throws;
+                    fault.outcome = Outcome::Throw;
+                }
+                else if (model.errorRate > 0 && chance(_random) < model.errorRate)
+                {
+                    ++_stats.errors;
+                    fault = { Outcome::Error, model.error };
+                }
+                else if (model.lostReplyRate > 0 && chance(_random) < model.lostReplyRate)
+                {
+                    ++_stats.lostReplies;
+                    fault.outcome = Outcome::LoseReply;
+                }
+            }
+            _stats.delay += delay;
+        }
+
+        _clock.sleep(delay);
+        return fault;
+    }
+
+    Stats stats(void) const
+    {
+        lock_guard<mutex> lock(_mutex);
+        return _stats;
+    }
+};
@@ -0,0 +1,172 @@
+#pragma once
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "FaultModel.hpp"
+#include "Interfaces.hpp"
+
+using namespace std;
+
+namespace FaultyDetail {
+    /**
+     * @brief Run a device call under the injector's verdict
+     *
+     * Errors go through the call's own error channel; calls without one
+     * (listAccounts, postDeposits, getBalances) throw instead.
+     */
+    template <typename T, typename F>
+    T call(FaultInjector& faults, const char* name, F&& forward)
+    {
+        FaultInjector::Fault fault = faults.arrive(name);
+        switch (fault.outcome)
+        {
+        case FaultInjector::Outcome::Throw:
+            throw runtime_error(string("injected failure in ") + name);
+        case FaultInjector::Outcome::Error:
+            if constexpr (is_same<T, Status>::value)
+            {
+                return Status::error(fault.error);
+            }
+            else if constexpr (is_constructible<T, Err>::value)
+            {
+                return T(fault.error);
+            }
+            else
+            {
+                throw runtime_error(string("injected error in ") + name);
+            }
+        case FaultInjector::Outcome::LoseReply:
+            (void)forward();
+            throw runtime_error(string("reply lost in ") + name);
+        default:
+            return forward();
+        }
+    }
+}
+
+/**
+ * @brief Bank wrapper whose calls follow a FaultInjector
+ */
+class FaultyBank : public IBank {
+private:
+    IBank& _inner;
+    FaultInjector& _faults;
+
+public:
+    FaultyBank(IBank& inner, FaultInjector& faults) : _inner(inner), _faults(faults)
+    {}
+
+    Status verifyPin(const Card& card, const Pin& pin)
+    {
+        return FaultyDetail::call<Status>(_faults, "verifyPin", [&] { return _inner.verifyPin(card, pin); });
+    }
+
+    vector<AccountId> listAccounts(const Card& card)
+    {
+        return FaultyDetail::call<vector<AccountId>>(_faults, "listAccounts", [&] { return _inner.listAccounts(card); });
+    }
+
+    Result<int> getBalance(const AccountId& accountId)
+    {
+        return FaultyDetail::call<Result<int>>(_faults, "getBalance", [&] { return _inner.getBalance(accountId); });
+    }
+
+    Status deposit(const AccountId& accountId, int money)
+    {
+        return FaultyDetail::call<Status>(_faults, "deposit", [&] { return _inner.deposit(accountId, money); });
+    }
+
+    Status canWithdraw(const AccountId& accountId, int money)
+    {
+        return FaultyDetail::call<Status>(_faults, "canWithdraw", [&] { return _inner.canWithdraw(accountId, money); });
+    }
+
+    Status withdraw(const AccountId& accountId, int money)
+    {
+        return FaultyDetail::call<Status>(_faults, "withdraw", [&] { return _inner.withdraw(accountId, money); });
+    }
+
+    Result<HoldId> placeHold(const AccountId& accountId, int money)
+    {
+        return FaultyDetail::call<Result<HoldId>>(_faults, "placeHold", [&] { return _inner.placeHold(accountId, money); });
+    }
+
+    Status captureHold(HoldId holdId)
+    {
+        return FaultyDetail::call<Status>(_faults, "captureHold", [&] { return _inner.captureHold(holdId); });
+    }
+
+    Status releaseHold(HoldId holdId)
+    {
+        return FaultyDetail::call<Status>(_faults, "releaseHold", [&] { return _inner.releaseHold(holdId); });
+    }
+
+    vector<Status> postDeposits(const vector<DepositPosting>& batch)
+    {
+        return FaultyDetail::call<vector<Status>>(_faults, "postDeposits", [&] { return _inner.postDeposits(batch); });
+    }
+
+    bool keyedDeposits(void) const
+    {
+        return _inner.keyedDeposits();
+    }
+
+    vector<AccountBalance> getBalances(const Card& card)
+    {
+        return FaultyDetail::call<vector<AccountBalance>>(_faults, "getBalances", [&] { return _inner.getBalances(card); });
+    }
+};
+
+/**
+ * @brief Cash bin wrapper whose calls follow a FaultInjector
+ *
+ * A lost reply on dispense models notes that left the bin although the
+ * device reported a failure.
+ */
+class FaultyCashBin : public ICashBin {
+private:
+    ICashBin& _inner;
+    FaultInjector& _faults;
+
+public:
+    FaultyCashBin(ICashBin& inner, FaultInjector& faults) : _inner(inner), _faults(faults)
+    {}
+
+    Status canDispense(int money)
+    {
+        return FaultyDetail::call<Status>(_faults, "canDispense", [&] { return _inner.canDispense(money); });
+    }
+
+    Status dispense(int money)
+    {
+        return FaultyDetail::call<Status>(_faults, "dispense", [&] { return _inner.dispense(money); });
+    }
+};
+
+/**
+ * @brief Card reader wrapper whose calls follow a FaultInjector
+ */
+class FaultyCardReader : public ICardReader {
+private:
+    ICardReader& _inner;
+    FaultInjector& _faults;
+
+public:
+    FaultyCardReader(ICardReader& inner, FaultInjector& faults) : _inner(inner), _faults(faults)
+    {}
+
+    Result<Card> read(void)
+    {
+        return FaultyDetail::call<Result<Card>>(_faults, "read", [&] { return _inner.read(); });
+    }
+
+    Status eject(void)
+    {
+        return FaultyDetail::call<Status>(_faults, "eject", [&] { return _inner.eject(); });
+    }
+
+    optional<PinReference> pinReference(void)
+    {
+        return _inner.pinReference();
+    }
+};
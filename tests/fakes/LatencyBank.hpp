@@ -0,0 +1,171 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include "Interfaces.hpp"
+
+using namespace std;
+
+/**
+ * @brief Bank wrapper with injectable latency and transport failures
+ *
+ * Each call first takes the next scripted delay (or the default latency),
+ * sleeps for it, and throws runtime_error if a failure is pending; then it
+ * forwards to the inner bank. Calls may arrive from several threads.
+ */
+class LatencyBank : public IBank {
+private:
+    IBank& _inner;
+    mutex _mutex;
+    deque<chrono::microseconds> _script;
+    chrono::microseconds _latency{ 0 };
+    function<chrono::microseconds()> _distribution;
+    int _failures = 0;
+
+    void arrive(void)
+    {
+        chrono::microseconds delay;
+        bool fail = false;
+        {
+            lock_guard<mutex> lock(_mutex);
+            ++calls;
+            if (!_script.empty())
+            {
+                delay = _script.front();
+                _script.pop_front();
+            }
+            else
+            {
+                delay = _distribution ? _distribution() : _latency;
+            }
+            if (_failures > 0)
+            {
+                --_failures;
+                fail = true;
+            }
+        }
+
+        this_thread::sleep_for(delay);
+        if (fail)
+        {
+            throw runtime_error("injected transport failure");
+        }
+    }
+
+public:
+    atomic<int> calls{ 0 };
+
+    explicit LatencyBank(IBank& inner) : _inner(inner)
+    {}
+
+    /**
+     * @brief Latency of every call without a scripted delay
+     */
+    void setLatency(chrono::microseconds latency)
+    {
+        lock_guard<mutex> lock(_mutex);
+        _latency = latency;
+    }
+
+    /**
+     * @brief Draw unscripted latencies from a generator (called under the lock)
+     */
+    void setDistribution(function<chrono::microseconds()> distribution)
+    {
+        lock_guard<mutex> lock(_mutex);
+        _distribution = move(distribution);
+    }
+
+    /**
+     * @brief Delays of the next calls, in arrival order
+     */
+    void script(initializer_list<chrono::microseconds> delays)
+    {
+        lock_guard<mutex> lock(_mutex);
+        _script.insert(_script.end(), delays.begin(), delays.end());
+    }
+
+    /**
+     * @brief Make the next calls throw after their delay
+     */
+    void failNext(int count)
+    {
+        lock_guard<mutex> lock(_mutex);
+        _failures += count;
+    }
+
+    Status verifyPin(const Card& card, const Pin& pin)
+    {
+        arrive();
+        return _inner.verifyPin(card, pin);
+    }
+
+    vector<AccountId> listAccounts(const Card& card)
+    {
+        arrive();
+        return _inner.listAccounts(card);
+    }
+
+    Result<int> getBalance(const AccountId& accountId)
+    {
+        arrive();
+        return _inner.getBalance(accountId);
+    }
+
+    Status deposit(const AccountId& accountId, int money)
+    {
+        arrive();
+        return _inner.deposit(accountId, money);
+    }
+
+    Status canWithdraw(const AccountId& accountId, int money)
+    {
+        arrive();
+        return _inner.canWithdraw(accountId, money);
+    }
+
+    Status withdraw(const AccountId& accountId, int money)
+    {
+        arrive();
+        return _inner.withdraw(accountId, money);
+    }
+
+    Result<HoldId> placeHold(const AccountId& accountId, int money)
+    {
+        arrive();
+        return _inner.placeHold(accountId, money);
+    }
+
+    Status captureHold(HoldId holdId)
+    {
+        arrive();
+        return _inner.captureHold(holdId);
+    }
+
+    Status releaseHold(HoldId holdId)
+    {
+        arrive();
+        return _inner.releaseHold(holdId);
+    }
+
+    vector<Status> postDeposits(const vector<DepositPosting>& batch)
+    {
+        arrive();
+        return _inner.postDeposits(batch);
+    }
+
+    bool keyedDeposits(void) const
+    {
+        return _inner.keyedDeposits();
+    }
+
+    vector<AccountBalance> getBalances(const Card& card)
+    {
+        arrive();
+        return _inner.getBalances(card);
+    }
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include <filesystem>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief Path of a scratch file in the temp directory, removed if it exists
+ *
+ * @param name Test-specific part of the file name
+ * @param suffix File extension, dot included
+ */
+inline string tempPath(const string& name, const string& suffix)
+{
+    auto path = filesystem::temp_directory_path() / ("atm_" + name + suffix);
+    filesystem::remove(path);
+    return path.string();
+}
@@ -0,0 +1,208 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/FaultModel.hpp"
+#include "fakes/FaultyDevices.hpp"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    using ns = chrono::nanoseconds;
+    using us = chrono::microseconds;
+    using ms = chrono::milliseconds;
+
+    vector<int64_t> draw(const LatencyModel& model, size_t count, uint64_t seed)
+    {
+        mt19937_64 random(seed);
+        vector<int64_t> samples;
+        for (size_t i = 0; i < count; ++i)
+        {
+            samples.push_back(model(random).count());
+        }
+        sort(samples.begin(), samples.end());
+        return samples;
+    }
+}
+
+/**
+ * @brief Test the latency distributions
+ *
+ * - Fixed latencies are exact
+ * - Lognormal latencies have the requested median and a long tail
+ * - Replayed latencies stay inside the recorded buckets, in proportion
+ */
+TEST(test_fault_latency_models)
+    auto fixed = draw(LatencyModel::fixed(us(250)), 10, 1);
+    REQUIRE(fixed.front() == 250000 && fixed.back() == 250000);
+
+    auto lognormal = draw(LatencyModel::lognormal(ms(2), 0.5), 20000, 7);
+    int64_t median = lognormal[lognormal.size() / 2];
+    int64_t p99 = lognormal[lognormal.size() * 99 / 100];
+    REQUIRE(median > 1900000 && median < 2100000);
+    REQUIRE(p99 > 5 * median / 2 && p99 < 4 * median);
+    REQUIRE(lognormal == draw(LatencyModel::lognormal(ms(2), 0.5), 20000, 7));
+
+    LatencyHistogram recorded;
+    for (int i = 0; i < 900; ++i)
+    {
+        recorded.record(1000);      // bucket [512, 1023]
+    }
+    for (int i = 0; i < 100; ++i)
+    {
+        recorded.record(50000);
+    }
+    auto replayed = draw(LatencyModel::replay(recorded.snapshot()), 10000, 3);
+    size_t fast = count_if(replayed.begin(), replayed.end(), [](int64_t n) { return n >= 512 && n <= 1023; });
+    size_t slow = count_if(replayed.begin(), replayed.end(), [](int64_t n) { return n >= 32768 && n <= 50000; });
+    REQUIRE(fast + slow == replayed.size());
+    REQUIRE(fast > 8700 && fast < 9300);
+    REQUIRE(replayed.back() <= 50000);
+    REQUIRE(draw(LatencyModel::replay(LatencyHistogram::Snapshot()), 3, 1).back() == 0);
+END_TEST
+
+/**
+ * @brief Test faults on the virtual clock
+ *
+ * - Error, throw and lost-reply rates come out as configured, per call
+ * - A lost reply reaches the bank before failing
+ * - The same seed gives the same run, and simulated time is the sum of the delays
+ */
+TEST(test_fault_injection)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+
+    auto run = [&](uint64_t seed, int& applied, FaultInjector::Stats& stats, ns& elapsed) {
+        FakeBank fake({{card, "1234"}}, {{card, {account}}}, {{account, 0}});
+        VirtualClock clock;
+        FaultInjector faults(clock, seed);
+        FaultModel lossy;
+        lossy.latency = LatencyModel::lognormal(ms(1), 0.3);
+        lossy.throwRate = 0.05;
+        lossy.errorRate = 0.10;
+        lossy.lostReplyRate = 0.20;
+        faults.setModel("deposit", lossy);
+
+        FaultyBank bank(fake, faults);
+        int errors = 0;
+        for (int i = 0; i < 2000; ++i)
+        {
+            try {
+                errors += bank.deposit(account, 1).code == Err::NetworkError;
+            }
+            catch (const runtime_error&) {
+            }
+        }
+        REQUIRE(bank.getBalance(account).isOk());
+        applied = fake.balanceMap[account];
+        stats = faults.stats();
+        elapsed = clock.now();
+        REQUIRE(uint64_t(errors) == stats.errors);
+    };
+
+    int applied = 0;
+    FaultInjector::Stats stats;
+    ns elapsed{ 0 };
+    run(11, applied, stats, elapsed);
+    REQUIRE(stats.calls == 2001);
+    REQUIRE(stats.throws > 60 && stats.throws < 140);
+    REQUIRE(stats.errors > 130 && stats.errors < 250);
+    REQUIRE(stats.lostReplies > 250 && stats.lostReplies < 440);
+    REQUIRE(uint64_t(applied) == 2000 - stats.throws - stats.errors);
+    REQUIRE(elapsed == stats.delay);
+    REQUIRE(elapsed > ms(1800) && elapsed < ms(2300));
+
+    int again = 0;
+    FaultInjector::Stats sameStats;
+    ns sameElapsed{ 0 };
+    run(11, again, sameStats, sameElapsed);
+    REQUIRE(again == applied && sameElapsed == elapsed && sameStats.lostReplies == stats.lostReplies);
+
+    // The real clock really waits
+    RealClock real;
+    FaultInjector faults(real);
+    faults.setModel(FaultModel{ LatencyModel::fixed(ms(5)) });
+    FakeCashBin fakeCash(100);
+    FaultyCashBin cashBin(fakeCash, faults);
+    REQUIRE_WITHIN(ms(500), cashBin.canDispense(10).isOk());
+    REQUIRE(real.now() >= ms(5));
+END_TEST
+
+/**
+ * @brief Test scripted outages and the withdraw rollback paths
+ *
+ * - Calls inside an outage fail; hanging outages wait for its end
+ * - A failed dispense releases the hold, a lost hold reply strands it
+ * - A failed capture leaves the withdrawal standing with the funds held
+ */
+TEST(test_fault_outages_and_withdraw)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+    FakeBank fake({{card, "1234"}}, {{card, {account}}}, {{account, 1000}});
+    FakeCashBin fakeCash(10000);
+    FakeCardReader fakeReader(card);
+
+    // The bank link and the terminal's own devices fail independently
+    VirtualClock clock;
+    FaultInjector faults(clock);
+    FaultInjector devices(clock);
+    faults.setModel(FaultModel{ LatencyModel::fixed(ms(10)) });
+    devices.setModel(FaultModel{ LatencyModel::fixed(ms(10)) });
+    FaultyBank bank(fake, faults);
+    FaultyCashBin cashBin(fakeCash, devices);
+    FaultyCardReader cardReader(fakeReader, devices);
+    Controller atm(cardReader, bank, cashBin);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin("1234").isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+    ns start = clock.now();
+
+    // Refused outage: the withdrawal fails fast and nothing moves
+    faults.addOutage({ start, start + ms(100) });
+    REQUIRE(atm.withdraw(100).code == Err::NetworkError);
+    REQUIRE(fake.balanceMap[account] == 1000 && fake.holds.empty());
+    REQUIRE(clock.now() == start + ms(10));     // canDispense only
+
+    // Hanging outage: the call waits it out, then fails
+    clock.advance(ms(100));
+    faults.addOutage({ clock.now() + ms(10), clock.now() + ms(500), true });
+    ns before = clock.now();
+    REQUIRE(atm.withdraw(100).code == Err::NetworkError);
+    REQUIRE(clock.now() == before + ms(500));
+    REQUIRE(fake.balanceMap[account] == 1000 && fake.holds.empty());
+    REQUIRE(faults.stats().outageCalls == 2);
+
+    // Dispense fails: the hold is released
+    FaultModel jammed{ LatencyModel::fixed(ms(10)) };
+    jammed.errorRate = 1.0;
+    jammed.error = Err::HardwareError;
+    devices.setModel("dispense", jammed);
+    REQUIRE(!atm.withdraw(100).isOk());
+    REQUIRE(fake.balanceMap[account] == 1000 && fake.holds.empty());
+    REQUIRE(fakeCash.capacity == 10000);
+
+    // Hold reply lost: the withdrawal fails, the funds stay held at the bank
+    devices.setModel("dispense", FaultModel{ LatencyModel::fixed(ms(10)) });
+    FaultModel lost{ LatencyModel::fixed(ms(10)) };
+    lost.lostReplyRate = 1.0;
+    faults.setModel("placeHold", lost);
+    REQUIRE(atm.withdraw(100).code == Err::NetworkError);
+    REQUIRE(fake.balanceMap[account] == 1000 && fake.available(account) == 900 && fake.holds.size() == 1);
+    REQUIRE(fakeCash.capacity == 10000);
+
+    // Capture fails after the cash is out: the withdrawal stands, still held
+    faults.setModel("placeHold", FaultModel{ LatencyModel::fixed(ms(10)) });
+    FaultModel down{ LatencyModel::fixed(ms(10)) };
+    down.throwRate = 1.0;
+    faults.setModel("captureHold", down);
+    REQUIRE(atm.withdraw(200).isOk());
+    REQUIRE(fake.balanceMap[account] == 1000 && fake.available(account) == 700 && fake.holds.size() == 2);
+    REQUIRE(fakeCash.capacity == 9800);
+END_TEST
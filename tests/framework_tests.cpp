@@ -0,0 +1,110 @@
+#include "test_framework.hpp"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+using TestFramework::Options;
+using TestFramework::Run;
+using TestFramework::TestCase;
+
+/**
+ * @brief Test running tests in parallel
+ *
+ * - Every test counts its own REQUIREs, however the tests interleave
+ * - Output of one test is logged in one piece
+ * - Exceptions and blown time budgets fail only their own test
+ * - Alone tests run while no other test does
+ */
+TEST(test_runner_parallel)
+    atomic<int> running{ 0 };
+    atomic<bool> overlapped{ false };
+    vector<TestCase> tests;
+    for (int i = 0; i < 8; ++i)
+    {
+        tests.push_back({ "counting_" + to_string(i), [&running, i] {
+            ++running;
+            for (int n = 0; n <= i; ++n)
+            {
+                TestFramework::out() << "line " << n << '\n';
+                REQUIRE(n >= 0);
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+            REQUIRE(i % 2 == 0);
+            --running;
+        } });
+    }
+    tests.push_back({ "throwing", [] { throw runtime_error("boom"); } });
+    tests.push_back({ "over_budget", [] {
+        REQUIRE_WITHIN(chrono::milliseconds(1), (this_thread::sleep_for(chrono::milliseconds(20)), true));
+        REQUIRE_WITHIN(chrono::seconds(10), true);
+    } });
+    tests.push_back({ "alone", [&running, &overlapped] { overlapped = running != 0; REQUIRE(true); }, Run::Alone });
+
+    Options opt;
+    opt.jobs = 4;
+    ostringstream log;
+    auto results = TestFramework::runTests(tests, opt, log);
+
+    REQUIRE(results.size() == tests.size());
+    for (int i = 0; i < 8; ++i)
+    {
+        REQUIRE(results[i].name == "counting_" + to_string(i));
+        REQUIRE(results[i].passed == i + 1 + (i % 2 == 0));
+        REQUIRE(results[i].failed == (i % 2));
+        REQUIRE(results[i].ms > 0);
+    }
+    REQUIRE(results[8].threw && results[8].failed == 1);
+    REQUIRE(results[8].output.find("boom") != string::npos);
+    REQUIRE(results[9].passed == 1 && results[9].failed == 1);
+    REQUIRE(results[9].output.find("budget") != string::npos);
+    REQUIRE(!overlapped && results[10].failed == 0);
+
+    // The seven lines of counting_6 appear together
+    REQUIRE(results[6].output.find("line 6") != string::npos);
+    REQUIRE(log.str().find(results[6].output) != string::npos);
+END_TEST
+
+/**
+ * @brief Test name filters, option parsing and the JSON report
+ *
+ * - Only tests matching a filter run
+ * - Bad options are refused
+ * - The report lists each test with its counts and status
+ */
+TEST(test_runner_filter_and_report)
+    const char* args[] = { "atm", "--jobs", "2", "--filter", "keep", "--filter", "also", "--report", "r.json" };
+    Options opt;
+    REQUIRE(TestFramework::parseArgs(9, const_cast<char**>(args), opt));
+    REQUIRE(opt.jobs == 2 && opt.filters.size() == 2 && opt.reportPath == "r.json");
+
+    const char* bad[] = { "atm", "--jobs" };
+    Options unchanged;
+    REQUIRE(!TestFramework::parseArgs(2, const_cast<char**>(bad), unchanged));
+
+    vector<TestCase> tests = {
+        { "keep_me", [] { REQUIRE(true); } },
+        { "skip_me", [] { REQUIRE(false); } },
+        { "also_me", [] { REQUIRE(1 + 1 == 3); } },
+    };
+    ostringstream log;
+    auto results = TestFramework::runTests(tests, opt, log);
+    REQUIRE(results.size() == 2);
+    REQUIRE(results[0].name == "keep_me" && results[1].name == "also_me");
+    REQUIRE(log.str().find("skip_me") == string::npos);
+
+    auto path = filesystem::temp_directory_path() / "atm_test_report.json";
+    REQUIRE(TestFramework::writeReport(path.string(), results, 12.5, opt.jobs));
+    ifstream in(path);
+    string json((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    REQUIRE(json.find("\"passed\": 1,\n  \"failed\": 1") != string::npos);
+    REQUIRE(json.find("{\"name\": \"keep_me\", \"status\": \"ok\"") != string::npos);
+    REQUIRE(json.find("{\"name\": \"also_me\", \"status\": \"failed\"") != string::npos);
+    filesystem::remove(path);
+END_TEST
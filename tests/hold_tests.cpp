@@ -0,0 +1,184 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    class RecordingBank : public FakeBank {
+    public:
+        int canWithdrawCalls = 0;
+        int withdrawCalls = 0;
+        int depositCalls = 0;
+        int captured = 0;
+        int released = 0;
+
+        using FakeBank::FakeBank;
+
+        Status canWithdraw(const AccountId& accountId, int money) override
+        {
+            ++canWithdrawCalls;
+            return FakeBank::canWithdraw(accountId, money);
+        }
+
+        Status withdraw(const AccountId& accountId, int money) override
+        {
+            ++withdrawCalls;
+            return FakeBank::withdraw(accountId, money);
+        }
+
+        Status deposit(const AccountId& accountId, int money) override
+        {
+            ++depositCalls;
+            return FakeBank::deposit(accountId, money);
+        }
+
+        Status captureHold(HoldId holdId) override
+        {
+            ++captured;
+            return FakeBank::captureHold(holdId);
+        }
+
+        Status releaseHold(HoldId holdId) override
+        {
+            ++released;
+            return FakeBank::releaseHold(holdId);
+        }
+    };
+}
+
+/**
+ * @brief Test withdrawal through a funds hold
+ *
+ * - Funds are reserved before the cash is dispensed
+ * - Successful dispense captures the hold
+ * - No check-then-withdraw or compensating deposit round trips
+ */
+TEST(test_withdraw_captures_hold)
+    Card card = "CARD-001";
+    Pin pin = "12345";
+    AccountId account = "ACCOUNT-001";
+
+    RecordingBank bank({{card, pin}}, {{card, {account}}}, {{account, 1000}});
+
+    class ObservingCashBin : public FakeCashBin {
+    public:
+        RecordingBank* bank = nullptr;
+        int balanceDuringDispense = -1;
+        int ledgerDuringDispense = -1;
+
+        using FakeCashBin::FakeCashBin;
+
+        Status dispense(int money) override
+        {
+            balanceDuringDispense = bank->available("ACCOUNT-001");
+            ledgerDuringDispense = bank->balanceMap["ACCOUNT-001"];
+            return FakeCashBin::dispense(money);
+        }
+    };
+
+    ObservingCashBin cashBin(10000);
+    cashBin.bank = &bank;
+    FakeCardReader cardReader(card);
+    Controller atm(cardReader, bank, cashBin);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+
+    REQUIRE(atm.withdraw(300).isOk());
+    REQUIRE_MSG(cashBin.balanceDuringDispense == 700, "Funds should be held before dispensing");
+    REQUIRE_MSG(cashBin.ledgerDuringDispense == 1000, "Held funds stay on the account until captured");
+    REQUIRE(bank.balanceMap[account] == 700);
+    REQUIRE(atm.getBalance().value() == 700);
+    REQUIRE(bank.captured == 1);
+    REQUIRE(bank.released == 0);
+    REQUIRE(bank.holds.empty());
+    REQUIRE(bank.canWithdrawCalls == 0);
+    REQUIRE(bank.withdrawCalls == 0);
+    REQUIRE(bank.depositCalls == 0);
+
+    // Hold refused: nothing is dispensed
+    REQUIRE(atm.withdraw(5000).code == Err::InsufficientBank);
+    REQUIRE(cashBin.getCurrentCapacity() == 10000 - 300);
+
+    REQUIRE(atm.ejectCard().isOk());
+END_TEST
+
+/**
+ * @brief Test hold release when the dispense fails
+ *
+ * - Failed dispense releases the hold instead of depositing back
+ * - Available balance is restored
+ */
+TEST(test_withdraw_releases_hold_on_dispense_failure)
+    Card card = "CARD-001";
+    Pin pin = "12345";
+    AccountId account = "ACCOUNT-001";
+
+    class JammedCashBin : public ICashBin {
+    public:
+        Status canDispense(int) override
+        {
+            return Status::okStatus();
+        }
+
+        Status dispense(int) override
+        {
+            return Status::error(Err::HardwareError);
+        }
+    };
+
+    RecordingBank bank({{card, pin}}, {{card, {account}}}, {{account, 1000}});
+    JammedCashBin cashBin;
+    FakeCardReader cardReader(card);
+    Controller atm(cardReader, bank, cashBin);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+
+    REQUIRE(atm.withdraw(300).code == Err::HardwareError);
+    REQUIRE(atm.getBalance().value() == 1000);
+    REQUIRE(bank.released == 1);
+    REQUIRE(bank.captured == 0);
+    REQUIRE(bank.holds.empty());
+    REQUIRE(bank.depositCalls == 0);
+
+    REQUIRE(atm.ejectCard().isOk());
+END_TEST
+
+/**
+ * @brief Test which error wins when both the cash bin and the account are short
+ *
+ * - The cash bin is checked first, so InsufficientCashBin is reported
+ * - No hold is placed for a withdrawal the terminal cannot pay out
+ */
+TEST(test_withdraw_reports_cash_bin_before_bank)
+    Card card = "CARD-001";
+    Pin pin = "12345";
+    AccountId account = "ACCOUNT-001";
+
+    RecordingBank bank({{card, pin}}, {{card, {account}}}, {{account, 100}});
+    FakeCashBin cashBin(200);
+    FakeCardReader cardReader(card);
+    Controller atm(cardReader, bank, cashBin);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+
+    REQUIRE(atm.withdraw(500).code == Err::InsufficientCashBin);
+    REQUIRE(bank.holds.empty());
+    REQUIRE(bank.released == 0);
+
+    // Only the account short: the bank decides
+    REQUIRE(atm.withdraw(150).code == Err::InsufficientBank);
+    REQUIRE(cashBin.getCurrentCapacity() == 200);
+
+    REQUIRE(atm.ejectCard().isOk());
+END_TEST
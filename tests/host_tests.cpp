@@ -0,0 +1,125 @@
+#include "test_framework.hpp"
+#include "ControllerHost.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    struct Terminal {
+        Card card;
+        FakeBank bank;
+        FakeCashBin cashBin;
+        FakeCardReader cardReader;
+
+        Terminal(const Card& id, const AccountId& account)
+         : card(id),
+           bank({{id, "1234"}}, {{id, {account}}}, {{account, 1000}}),
+           cashBin(100000),
+           cardReader(card)
+        {}
+    };
+}
+
+/**
+ * @brief Test many sessions driven through the host
+ *
+ * - Full session flows run on every terminal
+ * - Commands of one session run in submission order
+ * - Throughput counters cover every executed command
+ */
+TEST(test_host_runs_many_sessions)
+    const size_t terminalCount = 200;
+    const int withdrawals = 20;
+
+    vector<unique_ptr<Terminal>> terminals;
+    vector<vector<int>> order(terminalCount);
+    vector<int> failures(terminalCount, 0);
+
+    ControllerHost host(4);
+    bool sequentialIds = true;
+    for (size_t i = 0; i < terminalCount; ++i)
+    {
+        terminals.push_back(make_unique<Terminal>("CARD-" + to_string(i), "ACCOUNT-" + to_string(i)));
+        Terminal& t = *terminals.back();
+        sequentialIds = sequentialIds && host.addSession(t.cardReader, t.bank, t.cashBin) == i;
+    }
+    REQUIRE(sequentialIds);
+
+    for (size_t i = 0; i < terminalCount; ++i)
+    {
+        AccountId account = "ACCOUNT-" + to_string(i);
+        host.submit(i, [&failures, i](Controller& atm) {
+            if (!atm.insertCard().isOk()) ++failures[i];
+        });
+        host.submit(i, [&failures, i](Controller& atm) {
+            if (!atm.enterPin("1234").isOk()) ++failures[i];
+        });
+        host.submit(i, [&failures, i, account](Controller& atm) {
+            if (!atm.selectAccount(account).isOk()) ++failures[i];
+        });
+        for (int n = 0; n < withdrawals; ++n)
+        {
+            host.submit(i, [&failures, &order, i, n](Controller& atm) {
+                if (!atm.withdraw(10).isOk()) ++failures[i];
+                order[i].push_back(n);
+            });
+        }
+    }
+
+    host.drain();
+
+    bool allOk = true;
+    bool ordered = true;
+    for (size_t i = 0; i < terminalCount; ++i)
+    {
+        allOk = allOk && failures[i] == 0;
+        ordered = ordered && order[i].size() == (size_t)withdrawals;
+        for (int n = 0; ordered && n < withdrawals; ++n)
+        {
+            ordered = order[i][n] == n;
+        }
+    }
+    REQUIRE_MSG(allOk, "Every session step should succeed");
+    REQUIRE_MSG(ordered, "Commands of one session must run in submission order");
+
+    auto balance = host.call(0, [](Controller& atm) { return atm.getBalance(); });
+    REQUIRE(balance.get().value() == 1000 - 10 * withdrawals);
+    host.drain();
+
+    auto stats = host.stats();
+    REQUIRE(stats.sessions == terminalCount);
+    REQUIRE(stats.commands == terminalCount * (3 + withdrawals) + 1);
+END_TEST
+
+/**
+ * @brief Test sessions registered with their own Controller configuration
+ *
+ * - The configuration reaches the session's Controller
+ * - Sessions added without one keep the defaults
+ */
+TEST(test_host_session_config)
+    Terminal strict("CARD-001", "ACCOUNT-001");
+    Terminal lenient("CARD-002", "ACCOUNT-002");
+
+    Controller::Config cfg;
+    cfg.maxPinAttempts = 1;
+
+    ControllerHost host(2);
+    auto strictId = host.addSession(strict.cardReader, strict.bank, strict.cashBin, cfg);
+    auto lenientId = host.addSession(lenient.cardReader, lenient.bank, lenient.cashBin);
+
+    auto wrongPin = [](Controller& atm) {
+        (void)atm.insertCard();
+        (void)atm.enterPin("0000");
+        return atm.state();
+    };
+    auto strictState = host.call(strictId, wrongPin);
+    auto lenientState = host.call(lenientId, wrongPin);
+    REQUIRE(strictState.get() == Controller::State::Idle);
+    REQUIRE(lenientState.get() == Controller::State::CardInserted);
+END_TEST
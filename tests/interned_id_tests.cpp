@@ -0,0 +1,98 @@
+#include "test_framework.hpp"
+#include "Interfaces.hpp"
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Test interned card and account identifiers
+ *
+ * - Equal strings share one canonical copy
+ * - Conversion back to string is lossless
+ * - Concurrent interning of the same values agrees across threads
+ * - Hashes spread sequential ids over every bucket of a small table
+ */
+TEST(test_interned_ids)
+    AccountId a = "ACCOUNT-001";
+    AccountId b = string("ACCOUNT-") + "001";
+    AccountId c = "ACCOUNT-002";
+
+    REQUIRE(a == b);
+    REQUIRE(a.raw() == b.raw());
+    REQUIRE(a != c);
+    REQUIRE(a < c);
+    REQUIRE(!(c < a));
+    REQUIRE(a.str() == "ACCOUNT-001");
+    REQUIRE(hash<AccountId>()(a) == hash<AccountId>()(b));
+    REQUIRE(AccountId().empty());
+    REQUIRE(AccountId() == AccountId(""));
+
+    unordered_set<AccountId> set = {a, b, c};
+    REQUIRE(set.size() == 2);
+
+    const int threadCount = 4;
+    const int idCount = 1000;
+    vector<vector<Card>> seen(threadCount);
+    vector<thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&seen, t] {
+            for (int i = 0; i < idCount; ++i)
+            {
+                seen[t].push_back(Card("CARD-" + to_string(i)));
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    bool agree = true;
+    for (int t = 1; t < threadCount; ++t)
+    {
+        agree = agree && seen[t] == seen[0];
+    }
+    REQUIRE_MSG(agree, "All threads should get the same canonical ids");
+
+    // As ShardedBank picks a stripe: hash modulo the stripe count
+    vector<size_t> buckets(64, 0);
+    for (const Card& card : seen[0])
+    {
+        ++buckets[hash<Card>()(card) % buckets.size()];
+    }
+    size_t used = 0;
+    for (size_t count : buckets)
+    {
+        used += count > 0 ? 1 : 0;
+    }
+    REQUIRE_MSG(used == buckets.size(), "Interned id hashes should use every bucket");
+END_TEST
+
+/**
+ * @brief Test that interned strings are freed with their last handle
+ *
+ * - Copies and moves share one table entry
+ * - The entry is dropped once every handle is gone
+ * - Interning the value again gives a working handle
+ */
+TEST(test_interned_ids_released)
+    size_t before = internedStrings();
+    {
+        Card card = string("CARD-RELEASED-") + "0001";
+        Card copy = card;
+        Card moved = move(copy);
+        REQUIRE(internedStrings() == before + 1);
+        REQUIRE(moved == card);
+        REQUIRE(copy.empty());
+
+        vector<Card> cards(100, card);
+        REQUIRE(internedStrings() == before + 1);
+    }
+    REQUIRE_MSG(internedStrings() == before, "Card number should not outlive its handles");
+
+    Card again = "CARD-RELEASED-0001";
+    REQUIRE(again.str() == "CARD-RELEASED-0001");
+    REQUIRE(again == Card("CARD-RELEASED-0001"));
+    REQUIRE(internedStrings() == before + 1);
+END_TEST
@@ -0,0 +1,258 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "TransactionJournal.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/TempPath.hpp"
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Test journaled withdrawals in normal operation
+ *
+ * - Successful and failed withdrawals are fully recorded
+ * - A clean shutdown leaves nothing to recover
+ * - A small journal is reused once its transactions are finished
+ */
+TEST(test_journal_records_withdrawals)
+    Card card = "CARD-001";
+    Pin pin = "12345";
+    AccountId account = "ACCOUNT-001";
+    string path = tempPath("records", ".journal");
+
+    FakeBank bank({{card, pin}}, {{card, {account}}}, {{account, 100000}});
+    FakeCashBin cashBin(1000);
+    FakeCardReader cardReader(card);
+
+    {
+        TransactionJournal journal;
+        TransactionJournal::Config jcfg;
+        jcfg.capacity = 16;
+        jcfg.fsync = TransactionJournal::FsyncPolicy::EveryCommit;
+        REQUIRE(journal.open(path, jcfg).isOk());
+
+        Controller::Config cfg;
+        cfg.journal = &journal;
+        Controller atm(cardReader, bank, cashBin, cfg);
+
+        REQUIRE(atm.insertCard().isOk());
+        REQUIRE(atm.enterPin(pin).isOk());
+        REQUIRE(atm.selectAccount(account).isOk());
+
+        // Intent + executed for both steps, then commit
+        REQUIRE(atm.withdraw(100).isOk());
+        REQUIRE(journal.stats().records == 5);
+        REQUIRE(journal.stats().syncs == 1);
+
+        // Journal of 16 records is reused while no transaction is open
+        bool allOk = true;
+        for (int i = 0; i < 10; ++i)
+        {
+            allOk = allOk && atm.withdraw(10).isOk();
+        }
+        REQUIRE(allOk);
+        REQUIRE(journal.stats().resets >= 1);
+        REQUIRE(atm.ejectCard().isOk());
+    }
+
+    TransactionJournal reopened;
+    REQUIRE(reopened.open(path).isOk());
+    REQUIRE(Controller::recoverWithdrawals(reopened, bank) == 0);
+    REQUIRE(bank.balanceMap[account] == 100000 - 100 - 10 * 10);
+    REQUIRE(bank.holds.empty());
+END_TEST
+
+/**
+ * @brief Test recovery of withdrawals interrupted by a crash
+ *
+ * - Hold placed but cash not dispensed: hold is released
+ * - Cash dispensed but not committed: hold is captured
+ * - Recovered transactions are not compensated twice
+ */
+TEST(test_journal_recovers_interrupted_withdrawals)
+    AccountId account = "ACCOUNT-001";
+    string path = tempPath("recover", ".journal");
+
+    FakeBank bank({}, {}, {{account, 1000}});
+    HoldId notDispensed = bank.placeHold(account, 300).value();
+    HoldId dispensed = bank.placeHold(account, 200).value();
+    REQUIRE(bank.balanceMap[account] == 1000 && bank.available(account) == 500);
+
+    {
+        // Write what the Controller would have written before dying
+        TransactionJournal journal;
+        REQUIRE(journal.open(path).isOk());
+
+        JournalStep hold1{ Controller::WithdrawHold, account, 300, (int64_t)notDispensed };
+        JournalStep dispense1{ Controller::WithdrawDispense, account, 300, 0 };
+        uint64_t tx1 = journal.begin(5).value();
+        REQUIRE(journal.intent(tx1, 0, hold1).isOk());
+        REQUIRE(journal.executed(tx1, 0, hold1).isOk());
+        REQUIRE(journal.intent(tx1, 1, dispense1).isOk());
+
+        JournalStep hold2{ Controller::WithdrawHold, account, 200, (int64_t)dispensed };
+        JournalStep dispense2{ Controller::WithdrawDispense, account, 200, 0 };
+        uint64_t tx2 = journal.begin(5).value();
+        REQUIRE(journal.intent(tx2, 0, hold2).isOk());
+        REQUIRE(journal.executed(tx2, 0, hold2).isOk());
+        REQUIRE(journal.intent(tx2, 1, dispense2).isOk());
+        REQUIRE(journal.executed(tx2, 1, dispense2).isOk());
+
+        // Finished transaction must be left alone
+        uint64_t tx3 = journal.begin(5).value();
+        REQUIRE(journal.intent(tx3, 0, hold2).isOk());
+        REQUIRE(journal.commit(tx3).isOk());
+    }
+
+    {
+        TransactionJournal journal;
+        REQUIRE(journal.open(path).isOk());
+        REQUIRE(Controller::recoverWithdrawals(journal, bank) == 2);
+    }
+
+    REQUIRE_MSG(bank.balanceMap[account] == 800, "Undispensed hold should be released");
+    REQUIRE_MSG(bank.holds.empty(), "Dispensed hold should be captured");
+
+    TransactionJournal journal;
+    REQUIRE(journal.open(path).isOk());
+    REQUIRE(Controller::recoverWithdrawals(journal, bank) == 0);
+END_TEST
+
+namespace {
+    class UnsettledBank : public FakeBank {
+    public:
+        bool captureDown = true;
+
+        using FakeBank::FakeBank;
+
+        Status captureHold(HoldId holdId) override
+        {
+            if (captureDown)
+            {
+                throw runtime_error("link down");
+            }
+            return FakeBank::captureHold(holdId);
+        }
+    };
+}
+
+/**
+ * @brief Test a withdrawal whose hold capture fails after the cash is out
+ *
+ * - The withdrawal stands and its owed capture is deferred
+ * - Recovery with the bank still down keeps it, along with a crashed one
+ * - Recovery with the bank back captures both holds
+ */
+TEST(test_journal_recovers_failed_capture)
+    Card card = "CARD-001";
+    Pin pin = "12345";
+    AccountId account = "ACCOUNT-001";
+    string path = tempPath("capture", ".journal");
+
+    UnsettledBank bank({{card, pin}}, {{card, {account}}}, {{account, 1000}});
+    FakeCashBin cashBin(1000);
+    FakeCardReader cardReader(card);
+    HoldId crashed = bank.placeHold(account, 100).value();
+
+    {
+        TransactionJournal journal;
+        REQUIRE(journal.open(path).isOk());
+
+        Controller::Config cfg;
+        cfg.journal = &journal;
+        Controller atm(cardReader, bank, cashBin, cfg);
+
+        REQUIRE(atm.insertCard().isOk());
+        REQUIRE(atm.enterPin(pin).isOk());
+        REQUIRE(atm.selectAccount(account).isOk());
+        REQUIRE(atm.withdraw(300).isOk());
+        REQUIRE(cashBin.getCurrentCapacity() == 700);
+        REQUIRE(bank.holds.size() == 2);
+
+        // Intent + executed for both steps, then the deferred record
+        REQUIRE(journal.stats().records == 5);
+        REQUIRE(journal.stats().deferred == 1);
+        REQUIRE(atm.ejectCard().isOk());
+
+        // Dispensed but not committed when the process died
+        JournalStep hold{ Controller::WithdrawHold, account, 100, (int64_t)crashed };
+        JournalStep dispense{ Controller::WithdrawDispense, account, 100, 0 };
+        uint64_t tx = journal.begin(5).value();
+        REQUIRE(journal.executed(tx, 0, hold).isOk());
+        REQUIRE(journal.executed(tx, 1, dispense).isOk());
+    }
+
+    {
+        TransactionJournal journal;
+        REQUIRE(journal.open(path).isOk());
+        REQUIRE(Controller::recoverWithdrawals(journal, bank) == 0);
+        REQUIRE_MSG(bank.holds.size() == 2, "Unsettled holds must survive recovery");
+    }
+
+    bank.captureDown = false;
+    {
+        TransactionJournal journal;
+        REQUIRE(journal.open(path).isOk());
+        REQUIRE(Controller::recoverWithdrawals(journal, bank) == 2);
+    }
+    REQUIRE_MSG(bank.holds.empty(), "Dispensed holds should be captured by recovery");
+    REQUIRE(bank.balanceMap[account] == 600);
+
+    TransactionJournal journal;
+    REQUIRE(journal.open(path).isOk());
+    REQUIRE(Controller::recoverWithdrawals(journal, bank) == 0);
+END_TEST
+
+/**
+ * @brief Test that a failed capture does not stop the journal being reused
+ *
+ * - Withdrawals keep working far past the journal's capacity
+ * - The deferred capture is still settled by recovery
+ */
+TEST(test_journal_reused_after_failed_capture)
+    Card card = "CARD-001";
+    Pin pin = "12345";
+    AccountId account = "ACCOUNT-001";
+    string path = tempPath("reuse", ".journal");
+
+    UnsettledBank bank({{card, pin}}, {{card, {account}}}, {{account, 100000}});
+    FakeCashBin cashBin(100000);
+    FakeCardReader cardReader(card);
+
+    {
+        TransactionJournal journal;
+        TransactionJournal::Config jcfg;
+        jcfg.capacity = 64;
+        REQUIRE(journal.open(path, jcfg).isOk());
+
+        Controller::Config cfg;
+        cfg.journal = &journal;
+        Controller atm(cardReader, bank, cashBin, cfg);
+
+        REQUIRE(atm.insertCard().isOk());
+        REQUIRE(atm.enterPin(pin).isOk());
+        REQUIRE(atm.selectAccount(account).isOk());
+        REQUIRE(atm.withdraw(500).isOk());
+        bank.captureDown = false;
+
+        int succeeded = 0;
+        for (int i = 0; i < 200; ++i)
+        {
+            succeeded += atm.withdraw(10).isOk() ? 1 : 0;
+        }
+        REQUIRE_MSG(succeeded == 200, "Withdrawals failed after one failed capture");
+        REQUIRE(journal.stats().resets >= 10);
+        REQUIRE(bank.holds.size() == 1);
+        REQUIRE(atm.ejectCard().isOk());
+    }
+
+    TransactionJournal journal;
+    REQUIRE(journal.open(path).isOk());
+    REQUIRE(Controller::recoverWithdrawals(journal, bank) == 1);
+    REQUIRE(bank.holds.empty());
+    REQUIRE(bank.balanceMap[account] == 100000 - 500 - 200 * 10);
+END_TEST
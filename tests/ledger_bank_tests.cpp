@@ -0,0 +1,283 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "LedgerBank.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/TempPath.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    string ledgerPath(const string& name)
+    {
+        // The ledger's files are named after this prefix
+        string path = tempPath(name, ".ledger");
+        for (const char* suffix : { ".snap0", ".snap1", ".log" })
+        {
+            filesystem::remove(path + suffix);
+        }
+        return path;
+    }
+
+    uint64_t readU64(const string& path, size_t offset)
+    {
+        ifstream file(path, ios::binary);
+        file.seekg(offset);
+        uint64_t value = 0;
+        file.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    }
+
+    void flipByte(const string& path, size_t offset)
+    {
+        fstream file(path, ios::binary | ios::in | ios::out);
+        file.seekg(offset);
+        char c = 0;
+        file.read(&c, 1);
+        c = char(c ^ 0x5A);
+        file.seekp(offset);
+        file.write(&c, 1);
+    }
+}
+
+/**
+ * @brief Test ledger operations and a restart that replays the log
+ *
+ * - Accounts, deposits, withdrawals and holds behave like the other banks
+ * - Resent deposit keys are acknowledged without being applied
+ * - Hold and table limits fail with MemoryError
+ * - After a restart without a snapshot, every record is replayed, open
+ *   holds can still be settled and known keys are still recognized
+ */
+TEST(test_ledger_bank_operations)
+    string path = ledgerPath("operations");
+    LedgerBank::Config cfg;
+    cfg.capacity = 4;
+    cfg.holds = 2;
+    cfg.postingKeys = 16;
+    cfg.logRecords = 256;
+    cfg.snapshotRecords = 256;
+
+    AccountId a = "LEDGER-A";
+    AccountId b = "LEDGER-B";
+    HoldId open = 0;
+    uint64_t records = 0;
+    {
+        LedgerBank bank;
+        REQUIRE(!bank.getBalance(a).isOk());
+        REQUIRE(bank.open(path, cfg).isOk());
+        REQUIRE(bank.addAccount(a, 1000).isOk());
+        REQUIRE(bank.addAccount(b, 0).isOk());
+        REQUIRE(bank.addAccount(a, 1).code == Err::InvalidArg);
+        REQUIRE(bank.addAccount("LEDGER-C", -1).code == Err::InvalidArg);
+        REQUIRE(bank.addAccount(string(48, 'x'), 1).code == Err::InvalidArg);
+        REQUIRE(bank.getBalance("LEDGER-UNKNOWN").error() == Err::InvalidArg);
+
+        REQUIRE(bank.deposit(a, 500).isOk());
+        REQUIRE(bank.withdraw(a, 2000).code == Err::InsufficientBank);
+        REQUIRE(bank.withdraw(a, 300).isOk());
+        REQUIRE(bank.canWithdraw(a, 1200).isOk());
+        REQUIRE(!bank.canWithdraw(a, 1201).isOk());
+        REQUIRE(bank.getBalance(a).value() == 1200);
+
+        auto captured = bank.placeHold(a, 200);
+        auto released = bank.placeHold(a, 100);
+        REQUIRE(captured.isOk() && released.isOk());
+        REQUIRE(bank.placeHold(a, 1).error() == Err::MemoryError);
+        REQUIRE(bank.getBalance(a).value() == 900);
+        REQUIRE(bank.captureHold(captured.value()).isOk());
+        REQUIRE(bank.releaseHold(released.value()).isOk());
+        REQUIRE(bank.captureHold(captured.value()).code == Err::InvalidArg);
+        REQUIRE(bank.getBalance(a).value() == 1000);
+        REQUIRE(bank.placeHold(b, 1).error() == Err::InsufficientBank);
+        auto held = bank.placeHold(a, 50);
+        REQUIRE(held.isOk());
+        open = held.value();
+
+        auto statuses = bank.postDeposits({ { 1, b, 10 }, { 2, b, 20 }, { 1, b, 10 }, { 3, "LEDGER-UNKNOWN", 5 } });
+        REQUIRE(statuses.size() == 4);
+        REQUIRE(statuses[0].isOk() && statuses[1].isOk() && statuses[2].isOk());
+        REQUIRE(statuses[3].code == Err::InvalidArg);
+        REQUIRE(bank.getBalance(b).value() == 30);
+
+        REQUIRE(bank.addAccount("LEDGER-C", 0).isOk());
+        REQUIRE(bank.addAccount("LEDGER-D", 0).isOk());
+        REQUIRE(bank.addAccount("LEDGER-E", 0).code == Err::MemoryError);
+        REQUIRE(bank.size() == 4);
+
+        LedgerBank::Stats stats = bank.stats();
+        records = stats.records;
+        REQUIRE(records == 13);
+        REQUIRE(stats.snapshots == 0 && stats.syncs >= 1 && stats.syncs <= records);
+    }
+
+    LedgerBank bank;
+    REQUIRE(bank.open(path, cfg).isOk());
+    REQUIRE(bank.stats().replayed == records);
+    REQUIRE(bank.size() == 4);
+    REQUIRE(bank.getBalance(a).value() == 950);
+    REQUIRE(bank.getBalance(b).value() == 30);
+    REQUIRE(bank.releaseHold(open).isOk());
+    REQUIRE(bank.getBalance(a).value() == 1000);
+    REQUIRE(bank.postDeposits({ { 2, b, 20 }, { 4, b, 40 } }).size() == 2);
+    REQUIRE(bank.getBalance(b).value() == 70);
+
+    auto next = bank.placeHold(a, 10);
+    REQUIRE(next.isOk() && next.value() > open);
+END_TEST
+
+/**
+ * @brief Test snapshots and what a restart replays
+ *
+ * - A full log is emptied by a snapshot instead of failing writes
+ * - The background thread snapshots once the log reaches its threshold
+ * - A restart replays only the records after the newest snapshot, with
+ *   holds and deposit keys carried by the snapshot
+ * - A torn log record ends the replay; a damaged snapshot is ignored
+ */
+TEST(test_ledger_bank_snapshots)
+    string path = ledgerPath("snapshots");
+    LedgerBank::Config cfg;
+    cfg.capacity = 1000;
+    cfg.logRecords = 16;
+    cfg.snapshotRecords = 8;
+
+    HoldId hold = 0;
+    {
+        LedgerBank bank;
+        REQUIRE(bank.open(path, cfg).isOk());
+        int added = 0;
+        for (int i = 0; i < 100; ++i)
+        {
+            added += bank.addAccount("SNAP-" + to_string(i), i).isOk();
+        }
+        REQUIRE(added == 100);
+        REQUIRE(bank.stats().snapshots >= 100 / 16);
+
+        auto held = bank.placeHold("SNAP-7", 5);
+        REQUIRE(held.isOk());
+        hold = held.value();
+        REQUIRE(bank.postDeposits({ { 42, "SNAP-9", 100 } })[0].isOk());
+        REQUIRE(bank.snapshot().isOk());
+        REQUIRE(bank.snapshot().isOk());    // nothing new: no-op
+
+        REQUIRE(bank.deposit("SNAP-1", 10).isOk());
+        REQUIRE(bank.deposit("SNAP-2", 10).isOk());
+        REQUIRE(bank.withdraw("SNAP-3", 3).isOk());
+    }
+
+    {
+        LedgerBank bank;
+        REQUIRE(bank.open(path, cfg).isOk());
+        REQUIRE(bank.stats().replayed == 3);
+        REQUIRE(bank.size() == 100);
+        REQUIRE(bank.getBalance("SNAP-1").value() == 11);
+        REQUIRE(bank.getBalance("SNAP-2").value() == 12);
+        REQUIRE(bank.getBalance("SNAP-3").value() == 0);
+        REQUIRE(bank.getBalance("SNAP-7").value() == 2);
+        REQUIRE(bank.getBalance("SNAP-99").value() == 99);
+        REQUIRE(bank.postDeposits({ { 42, "SNAP-9", 100 } })[0].isOk());
+        REQUIRE(bank.getBalance("SNAP-9").value() == 109);
+        REQUIRE(bank.releaseHold(hold).isOk());
+
+        // Let the background thread pick up a log past its threshold
+        REQUIRE(bank.snapshot().isOk());
+        for (int i = 0; i < 8; ++i)
+        {
+            REQUIRE(bank.deposit("SNAP-4", 1).isOk());
+        }
+        for (int i = 0; i < 200 && bank.stats().snapshots < 2; ++i)
+        {
+            this_thread::sleep_for(chrono::milliseconds(5));
+        }
+        REQUIRE(bank.stats().snapshots == 2);
+
+        REQUIRE(bank.deposit("SNAP-5", 1).isOk());
+        REQUIRE(bank.deposit("SNAP-5", 1).isOk());
+    }
+
+    // Tear the second record of the log: the replay stops before it
+    flipByte(path + ".log", 64 + 96 + 20);
+    // Damage the older snapshot: the newer one is still used
+    string older = readU64(path + ".snap0", 8) < readU64(path + ".snap1", 8) ? path + ".snap0" : path + ".snap1";
+    flipByte(older, 8);
+
+    LedgerBank bank;
+    REQUIRE(bank.open(path, cfg).isOk());
+    REQUIRE(bank.stats().replayed == 1);
+    REQUIRE(bank.getBalance("SNAP-4").value() == 12);
+    REQUIRE(bank.getBalance("SNAP-5").value() == 6);
+    REQUIRE(bank.getBalance("SNAP-7").value() == 7);
+END_TEST
+
+/**
+ * @brief Test concurrent writers and a Controller on a ledger
+ *
+ * - Writers on many threads lose no updates and share log syncs
+ * - PINs are checked against the stored reference
+ * - A withdrawal through the Controller survives a restart
+ */
+TEST(test_ledger_bank_group_commit)
+    string path = ledgerPath("group_commit");
+    LedgerBank::Config cfg;
+    cfg.capacity = 64;
+    cfg.logRecords = 4096;
+
+    Card card = "LEDGER-CARD";
+    AccountId account = "LEDGER-CHECKING";
+    {
+        LedgerBank bank;
+        REQUIRE(bank.open(path, cfg).isOk());
+        REQUIRE(bank.addAccount(account, 1000).isOk());
+        REQUIRE(bank.addAccount("LEDGER-HOT", 0).isOk());
+
+        const int threadCount = 4;
+        const int writes = 50;
+        vector<int> failures(threadCount, 0);
+        vector<thread> writers;
+        for (int t = 0; t < threadCount; ++t)
+        {
+            writers.emplace_back([&, t] {
+                for (int i = 0; i < writes; ++i)
+                {
+                    failures[t] += !bank.deposit("LEDGER-HOT", 1).isOk();
+                }
+            });
+        }
+        for (auto& w : writers) w.join();
+
+        int failed = 0;
+        for (int f : failures) failed += f;
+        REQUIRE(failed == 0);
+        REQUIRE(bank.getBalance("LEDGER-HOT").value() == threadCount * writes);
+        LedgerBank::Stats stats = bank.stats();
+        REQUIRE(stats.records == uint64_t(2 + threadCount * writes));
+        REQUIRE(stats.syncs <= stats.records);
+
+        REQUIRE(bank.addCard(card, "1234", { account }).isOk());
+        REQUIRE(bank.verifyPin(card, "1234").isOk());
+        REQUIRE(bank.verifyPin(card, "1235").code == Err::InvalidArg);
+        REQUIRE(bank.verifyPin(card, "").code == Err::InvalidArg);
+        REQUIRE(bank.verifyPin("LEDGER-OTHER", "1234").code == Err::InvalidArg);
+        FakeCardReader cardReader(card);
+        FakeCashBin cashBin(10000);
+        Controller atm(cardReader, bank, cashBin);
+        REQUIRE(atm.insertCard().isOk());
+        REQUIRE(atm.enterPin("1234").isOk());
+        REQUIRE(atm.selectAccount(account).isOk());
+        REQUIRE(atm.withdraw(300).isOk());
+        REQUIRE(atm.ejectCard().isOk());
+    }
+
+    LedgerBank bank;
+    REQUIRE(bank.open(path, cfg).isOk());
+    REQUIRE(bank.getBalance(account).value() == 700);
+    REQUIRE(bank.getBalance("LEDGER-HOT").value() == 200);
+    REQUIRE(bank.verifyPin(card, "1234").code == Err::InvalidArg);     // cards are not persisted
+END_TEST
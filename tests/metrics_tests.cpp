@@ -0,0 +1,114 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+using Op = ControllerMetrics::Op;
+using Call = ControllerMetrics::Call;
+
+/**
+ * @brief Test per-operation and per-call latency recording
+ *
+ * - Every operation and dependency call is counted under its outcome
+ * - Exceptions from dependencies count as SystemError calls
+ * - Snapshots of several controllers merge; reset clears them
+ */
+TEST(test_controller_metrics)
+    Card card = "CARD-001";
+    Pin pin = "1234";
+    AccountId account = "ACCOUNT-001";
+
+    FakeCardReader cardReader(card);
+    FakeBank bank({ {card, pin} }, { {card, {account}} }, { {account, 1000} });
+    FakeCashBin cashBin(10000);
+
+    ControllerMetrics metrics;
+    Controller::Config cfg;
+    cfg.metrics = &metrics;
+    Controller atm(cardReader, bank, cashBin, cfg);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(!atm.enterPin("0000").isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+    REQUIRE(atm.withdraw(300).isOk());
+    REQUIRE(atm.withdraw(5000).code == Err::InsufficientBank);
+    REQUIRE(atm.ejectCard().isOk());
+
+    auto s = metrics.snapshot();
+    REQUIRE(s.op(Op::InsertCard, Err::None).count == 1);
+    REQUIRE(s.op(Op::EnterPin, Err::PinFailed).count == 1);
+    REQUIRE(s.op(Op::EnterPin, Err::None).count == 1);
+    REQUIRE(s.op(Op::Withdraw, Err::None).count == 1);
+    REQUIRE(s.op(Op::Withdraw, Err::InsufficientBank).count == 1);
+    REQUIRE(s.op(Op::Withdraw).count == 2);
+    REQUIRE(s.op(Op::EjectCard).count == 1);
+
+    REQUIRE(s.call(Call::VerifyPin, Err::InvalidArg).count == 1);
+    REQUIRE(s.call(Call::VerifyPin, Err::None).count == 1);
+    REQUIRE(s.call(Call::ListAccounts).count == 1);
+    REQUIRE(s.call(Call::PlaceHold, Err::InsufficientBank).count == 1);
+    REQUIRE(s.call(Call::Dispense).count == 1);
+    REQUIRE(s.call(Call::CaptureHold, Err::None).count == 1);
+    REQUIRE(s.call(Call::ReleaseHold).count == 0);
+    REQUIRE(s.op(Op::Withdraw).sumNs >= s.call(Call::Dispense).sumNs);
+
+    // A throwing bank: the call is a SystemError, the operation a NetworkError
+    class ThrowingBank : public FakeBank {
+    public:
+        using FakeBank::FakeBank;
+
+        Result<int> getBalance(const AccountId&) override
+        {
+            throw runtime_error("bank unreachable");
+        }
+    };
+
+    ThrowingBank throwingBank({ {card, pin} }, { {card, {account}} }, { {account, 1000} });
+    ControllerMetrics otherMetrics;
+    cfg.metrics = &otherMetrics;
+    Controller other(cardReader, throwingBank, cashBin, cfg);
+    REQUIRE(other.insertCard().isOk());
+    REQUIRE(other.enterPin(pin).isOk());
+    REQUIRE(other.selectAccount(account).isOk());
+    REQUIRE(other.getBalance().error() == Err::NetworkError);
+
+    auto o = otherMetrics.snapshot();
+    REQUIRE(o.call(Call::GetBalance, Err::SystemError).count == 1);
+    REQUIRE(o.op(Op::GetBalance, Err::NetworkError).count == 1);
+
+    s.merge(o);
+    REQUIRE(s.op(Op::InsertCard).count == 2);
+    REQUIRE(s.call(Call::VerifyPin).count == 3);
+
+    metrics.reset();
+    REQUIRE(metrics.snapshot().op(Op::Withdraw).count == 0);
+END_TEST
+
+/**
+ * @brief Test histogram bucketing and percentiles
+ */
+TEST(test_latency_histogram)
+    REQUIRE(LatencyHistogram::bucketOf(0) == 0);
+    REQUIRE(LatencyHistogram::bucketOf(1) == 1);
+    REQUIRE(LatencyHistogram::bucketOf(1023) == 10);
+    REQUIRE(LatencyHistogram::bucketOf(1024) == 11);
+    REQUIRE(LatencyHistogram::bucketOf(~0ull) == LatencyHistogram::kBuckets - 1);
+
+    LatencyHistogram h;
+    for (int i = 0; i < 99; ++i) h.record(100);
+    h.record(100000);
+
+    auto s = h.snapshot();
+    REQUIRE(s.count == 100);
+    REQUIRE(s.maxNs == 100000);
+    REQUIRE(s.percentileNs(0.5) == 127);
+    REQUIRE(s.percentileNs(1.0) == 100000);
+    REQUIRE(s.meanNs() > 100.0);
+END_TEST
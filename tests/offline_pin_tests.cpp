@@ -0,0 +1,157 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "Sha256.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include <string>
+
+using namespace std;
+
+namespace {
+    class CountingBank : public FakeBank {
+    public:
+        int verifyCalls = 0;
+
+        using FakeBank::FakeBank;
+
+        Status verifyPin(const Card& card, const Pin& pin) override
+        {
+            ++verifyCalls;
+            return FakeBank::verifyPin(card, pin);
+        }
+    };
+
+    string hex(const Sha256::Digest& digest)
+    {
+        static const char* digits = "0123456789abcdef";
+        string out;
+        for (auto b : digest)
+        {
+            out += digits[b >> 4];
+            out += digits[b & 15];
+        }
+        return out;
+    }
+}
+
+/**
+ * @brief Test SHA-256 and HMAC-SHA-256 against the FIPS 180-4 and RFC 4231 examples
+ */
+TEST(test_sha256)
+    REQUIRE(hex(Sha256::hash("", 0)) == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    REQUIRE(hex(Sha256::hash("abc", 3)) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+    string twoBlocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    REQUIRE(hex(Sha256().update(twoBlocks.substr(0, 10)).update(twoBlocks.substr(10)).finish())
+            == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+    string message = "what do ya want for nothing?";
+    REQUIRE(hex(Sha256::hmac("Jefe", 4, message.data(), message.size()))
+            == "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+    string longKey(131, char(0xaa));
+    message = "Test Using Larger Than Block-Size Key - Hash Key First";
+    REQUIRE(hex(Sha256::hmac(longKey.data(), longKey.size(), message.data(), message.size()))
+            == "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+END_TEST
+
+/**
+ * @brief Test PIN checks against references cached after online success
+ *
+ * - The first session verifies online, later sessions offline
+ * - A cached mismatch may be stale, so it is verified online and replaced
+ * - Expired references are not used
+ */
+TEST(test_offline_pin_cache)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+
+    FakeCardReader cardReader(card);
+    CountingBank bank({ {card, "1234"} }, { {card, {account}} }, { {account, 1000} });
+    FakeCashBin cashBin(1000);
+
+    OfflinePinVerifier verifier;
+    Controller::Config cfg;
+    cfg.pinVerifier = &verifier;
+    Controller atm(cardReader, bank, cashBin, cfg);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin("1234").isOk());
+    REQUIRE(bank.verifyCalls == 1);
+    REQUIRE(atm.ejectCard().isOk());
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin("1234").isOk());
+    REQUIRE(bank.verifyCalls == 1);
+    REQUIRE(atm.state() == Controller::State::Authenticated);
+    REQUIRE(atm.ejectCard().isOk());
+
+    // PIN changed at the bank: the stale reference defers to the bank and is replaced
+    bank.pinMap[card] = "5678";
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin("5678").isOk());
+    REQUIRE(bank.verifyCalls == 2);
+    REQUIRE(atm.ejectCard().isOk());
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin("0000").code == Err::PinFailed);
+    REQUIRE(bank.verifyCalls == 3);
+    REQUIRE(atm.enterPin("5678").isOk());
+    REQUIRE(bank.verifyCalls == 3);
+    REQUIRE(atm.ejectCard().isOk());
+
+    OfflinePinVerifier::Config expiring;
+    expiring.ttl = chrono::seconds(0);
+    OfflinePinVerifier shortLived(expiring);
+    cfg.pinVerifier = &shortLived;
+    Controller other(cardReader, bank, cashBin, cfg);
+    for (int i = 0; i < 2; ++i)
+    {
+        REQUIRE(other.insertCard().isOk());
+        REQUIRE(other.enterPin("5678").isOk());
+        REQUIRE(other.ejectCard().isOk());
+    }
+    REQUIRE(bank.verifyCalls == 5);
+END_TEST
+
+/**
+ * @brief Test PIN checks against an issuer reference read from the card
+ *
+ * - Correct and wrong PINs are decided without the bank
+ * - Running out of attempts still ejects the card
+ */
+TEST(test_offline_pin_issuer_reference)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+
+    FakeCardReader cardReader(card);
+    array<uint8_t, 16> salt{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+    cardReader.reference = OfflinePinVerifier::makeReference(card, "1234", salt, 16);
+    CountingBank bank({ {card, "1234"} }, { {card, {account}} }, { {account, 1000} });
+    FakeCashBin cashBin(1000);
+
+    REQUIRE(OfflinePinVerifier::matches(*cardReader.reference, card, "1234"));
+    REQUIRE(!OfflinePinVerifier::matches(*cardReader.reference, Card("CARD-002"), "1234"));
+
+    OfflinePinVerifier verifier;
+    Controller::Config cfg;
+    cfg.pinVerifier = &verifier;
+    Controller atm(cardReader, bank, cashBin, cfg);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin("0000").code == Err::PinFailed);
+    REQUIRE(atm.enterPin("1234").isOk());
+    REQUIRE(atm.ejectCard().isOk());
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin("0000").code == Err::PinFailed);
+    REQUIRE(atm.enterPin("1111").code == Err::PinFailed);
+    REQUIRE(atm.enterPin("2222").code == Err::PinFailed);
+    REQUIRE(atm.state() == Controller::State::Idle);
+    REQUIRE(cardReader.ejected);
+
+    REQUIRE(bank.verifyCalls == 0);
+    auto stats = verifier.stats();
+    REQUIRE(stats.matches == 1);
+    REQUIRE(stats.mismatches == 4);
+END_TEST
@@ -0,0 +1,324 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "ShardedBank.hpp"
+#include "ShardedBankRouter.hpp"
+#include "ThreadPool.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/LatencyBank.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    /**
+     * @brief Bank counting its calls, whose bulk read can be held at a gate
+     */
+    class GatedBank : public FakeBank {
+    private:
+        mutex _mutex;
+        condition_variable _cv;
+        bool _open = true;
+
+    public:
+        atomic<int> listCalls{ 0 };
+        atomic<int> balanceCalls{ 0 };
+        atomic<int> bulkCalls{ 0 };
+        bool brokenAccount = false;     // getBalance of "ACCOUNT-BROKEN" throws
+
+        using FakeBank::FakeBank;
+
+        void close(void)
+        {
+            lock_guard<mutex> lock(_mutex);
+            _open = false;
+        }
+
+        void open(void)
+        {
+            {
+                lock_guard<mutex> lock(_mutex);
+                _open = true;
+            }
+            _cv.notify_all();
+        }
+
+        vector<AccountId> listAccounts(const Card& card) override
+        {
+            ++listCalls;
+            return FakeBank::listAccounts(card);
+        }
+
+        Result<int> getBalance(const AccountId& accountId) override
+        {
+            ++balanceCalls;
+            if (brokenAccount && accountId == "ACCOUNT-BROKEN")
+            {
+                throw runtime_error("balance service unreachable");
+            }
+            return FakeBank::getBalance(accountId);
+        }
+
+        vector<AccountBalance> getBalances(const Card& card) override
+        {
+            ++bulkCalls;
+            {
+                unique_lock<mutex> lock(_mutex);
+                _cv.wait(lock, [&] { return _open; });
+            }
+            return FakeBank::getBalances(card);
+        }
+    };
+
+    /**
+     * @brief Partition whose link can be cut
+     */
+    class Partition : public ShardedBank {
+    public:
+        bool down = false;
+
+        vector<AccountId> listAccounts(const Card& card) override
+        {
+            if (down)
+            {
+                throw runtime_error("partition unreachable");
+            }
+            return ShardedBank::listAccounts(card);
+        }
+    };
+
+    // Runs after every task queued before it on a one-worker pool
+    void drain(ThreadPool& pool)
+    {
+        pool.submit([] {}).get();
+    }
+}
+
+/**
+ * @brief Test IBank::getBalances() and its forwarding
+ *
+ * - The default lists the accounts and reads each balance, in list order
+ * - A balance that cannot be read is reported in its entry; a list that
+ *   cannot be read throws
+ * - Decorators forward the bulk read as one call
+ * - The router merges the shards' answers in shard order
+ */
+TEST(test_bank_get_balances)
+    Card card = "CARD-001";
+    GatedBank bank({{card, "1234"}}, {{card, {"ACCOUNT-A", "ACCOUNT-BROKEN", "ACCOUNT-GONE"}}},
+                   {{"ACCOUNT-A", 100}, {"ACCOUNT-BROKEN", 200}});
+    bank.brokenAccount = true;
+
+    auto balances = bank.getBalances(card);
+    REQUIRE(balances.size() == 3);
+    REQUIRE(balances[0].accountId == "ACCOUNT-A" && balances[0].balance.value() == 100);
+    REQUIRE(balances[1].accountId == "ACCOUNT-BROKEN" && balances[1].balance.error() == Err::NetworkError);
+    REQUIRE(balances[2].accountId == "ACCOUNT-GONE" && balances[2].balance.error() == Err::InvalidArg);
+    REQUIRE(bank.listCalls == 1 && bank.balanceCalls == 3);
+    REQUIRE(bank.getBalances("CARD-UNKNOWN").empty());
+
+    LatencyBank link(bank);
+    REQUIRE(link.getBalances(card).size() == 3);
+    REQUIRE(link.calls == 1);
+    link.failNext(1);
+    bool threw = false;
+    try {
+        (void)link.getBalances(card);
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+
+    ThreadPool pool(2);
+    ShardedBankRouter router(pool);
+    Partition a;
+    Partition b;
+    REQUIRE(a.addAccount("SHARD-A1", 10).isOk());
+    REQUIRE(b.addAccount("SHARD-B1", 20).isOk());
+    REQUIRE(b.addAccount("SHARD-B2", 30).isOk());
+    REQUIRE(a.addCard(card, "1234", { "SHARD-A1" }).isOk());
+    REQUIRE(b.addCard(card, "1234", { "SHARD-B1", "SHARD-B2" }).isOk());
+    REQUIRE(router.addShard("a", a).isOk());
+    REQUIRE(router.addShard("b", b).isOk());
+
+    auto merged = router.getBalances(card);
+    REQUIRE(merged.size() == 3);
+    REQUIRE(merged[0].accountId == "SHARD-A1" && merged[0].balance.value() == 10);
+    REQUIRE(merged[1].accountId == "SHARD-B1" && merged[1].balance.value() == 20);
+    REQUIRE(merged[2].accountId == "SHARD-B2" && merged[2].balance.value() == 30);
+
+    b.down = true;
+    threw = false;
+    try {
+        (void)router.getBalances(card);
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+END_TEST
+
+/**
+ * @brief Test reads served by the prefetch started after the PIN
+ *
+ * - An accepted PIN starts one bulk read and returns without waiting for it
+ * - listAccounts, selectAccount and getBalance wait for it and make no
+ *   bank calls of their own, for any of the card's accounts
+ * - Writes keep the prefetched balance current
+ * - A rejected PIN fetches nothing
+ */
+TEST(test_prefetch_after_pin)
+    Card card = "CARD-001";
+    Pin pin = "1234";
+    AccountId checking = "ACCOUNT-CHECKING";
+    AccountId savings = "ACCOUNT-SAVINGS";
+
+    GatedBank bank({{card, pin}}, {{card, {checking, savings}}}, {{checking, 1000}, {savings, 5000}});
+    FakeCashBin cashBin(10000);
+    FakeCardReader cardReader(card);
+    ThreadPool pool(1);
+    ControllerMetrics metrics;
+
+    Controller::Config cfg;
+    cfg.prefetch = &pool;
+    cfg.metrics = &metrics;
+    Controller atm(cardReader, bank, cashBin, cfg);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin("0000").code == Err::PinFailed);
+    drain(pool);
+    REQUIRE(bank.bulkCalls == 0);
+
+    bank.close();
+    REQUIRE(atm.enterPin(pin).isOk());     // would hang if it waited for the gate
+    bank.open();
+
+    auto accounts = atm.listAccounts();
+    REQUIRE(accounts.isOk() && accounts.value().size() == 2);
+    REQUIRE(atm.selectAccount(savings).isOk());
+    REQUIRE(atm.getBalance().value() == 5000);
+    REQUIRE(atm.withdraw(500).isOk());
+    REQUIRE(atm.getBalance().value() == 4500);
+    REQUIRE(bank.bulkCalls == 1);
+    REQUIRE(bank.listCalls == 1 && bank.balanceCalls == 2);     // all inside the bulk read
+
+    auto snapshot = metrics.snapshot();
+    REQUIRE(snapshot.call(ControllerMetrics::Call::GetBalances).count == 1);
+    REQUIRE(snapshot.call(ControllerMetrics::Call::ListAccounts).count == 0);
+    REQUIRE(snapshot.call(ControllerMetrics::Call::GetBalance).count == 0);
+
+    // The next session fetches again
+    REQUIRE(atm.ejectCard().isOk());
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(checking).isOk());
+    REQUIRE(atm.getBalance().value() == 1000);
+    REQUIRE(bank.bulkCalls == 2 && bank.balanceCalls == 4);
+    REQUIRE(atm.ejectCard().isOk());
+END_TEST
+
+/**
+ * @brief Test that ejecting the card cancels the prefetch
+ *
+ * - ejectCard() does not wait for a prefetch at the bank
+ * - A prefetch still queued when the card leaves never reaches the bank
+ * - A late answer does not leak into the next session
+ */
+TEST(test_prefetch_cancelled_on_eject)
+    Card card = "CARD-001";
+    Pin pin = "1234";
+    AccountId account = "ACCOUNT-001";
+
+    GatedBank bank({{card, pin}}, {{card, {account}}}, {{account, 1000}});
+    FakeCashBin cashBin(10000);
+    FakeCardReader cardReader(card);
+    ThreadPool pool(1);
+
+    Controller::Config cfg;
+    cfg.prefetch = &pool;
+    Controller atm(cardReader, bank, cashBin, cfg);
+
+    // The first prefetch holds the only worker at the gate
+    bank.close();
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    while (bank.bulkCalls == 0)
+    {
+        this_thread::yield();
+    }
+    REQUIRE(atm.ejectCard().isOk());
+
+    // The second one queues behind it and is cancelled before it starts
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.ejectCard().isOk());
+    REQUIRE(atm.state() == Controller::State::Idle);
+
+    bank.balanceMap[account] = 700;
+    bank.open();
+    drain(pool);
+    REQUIRE(bank.bulkCalls == 1);
+    bank.balanceMap[account] = 650;
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+    REQUIRE(atm.getBalance().value() == 650);
+    REQUIRE(bank.bulkCalls == 2);
+    REQUIRE(atm.ejectCard().isOk());
+END_TEST
+
+/**
+ * @brief Test reads after a prefetch that failed
+ *
+ * - A failed bulk read is dropped and each read asks the bank itself
+ * - Balances that failed inside the bulk read are read again
+ */
+TEST(test_prefetch_failure_falls_back)
+    Card card = "CARD-001";
+    Pin pin = "1234";
+    AccountId account = "ACCOUNT-001";
+
+    GatedBank bank({{card, pin}}, {{card, {account, "ACCOUNT-BROKEN"}}},
+                   {{account, 1000}, {"ACCOUNT-BROKEN", 300}});
+    LatencyBank link(bank);
+    FakeCashBin cashBin(10000);
+    FakeCardReader cardReader(card);
+    ThreadPool pool(1);
+
+    Controller::Config cfg;
+    cfg.prefetch = &pool;
+    Controller atm(cardReader, link, cashBin, cfg);
+
+    // Hold the worker so the failure is armed after verifyPin and before the prefetch
+    promise<void> release;
+    auto busy = pool.submit([started = release.get_future().share()] { started.wait(); });
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    link.failNext(1);
+    release.set_value();
+    busy.get();
+    drain(pool);
+    REQUIRE(atm.listAccounts().value().size() == 2);
+    REQUIRE(atm.selectAccount(account).isOk());
+    REQUIRE(atm.getBalance().value() == 1000);
+    REQUIRE(bank.listCalls == 1 && bank.balanceCalls == 1);
+    REQUIRE(atm.ejectCard().isOk());
+
+    bank.brokenAccount = true;
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount("ACCOUNT-BROKEN").isOk());
+    REQUIRE(bank.listCalls == 2);
+    REQUIRE(atm.getBalance().error() == Err::NetworkError);
+    bank.brokenAccount = false;
+    REQUIRE(atm.getBalance().value() == 300);
+    REQUIRE(atm.ejectCard().isOk());
+END_TEST
@@ -0,0 +1,143 @@
+#include "test_framework.hpp"
+#include "RecordingController.hpp"
+#include "SessionReplayer.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/TempPath.hpp"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace std;
+
+namespace {
+    /**
+     * @brief Record one session covering success and failure paths
+     */
+    SessionTrace recordSession(void)
+    {
+        Card card = "CARD-001";
+        Pin pin = "1234";
+        AccountId account = "ACCOUNT-001";
+
+        FakeCardReader cardReader(card);
+        FakeBank bank({ {card, pin} }, { {card, {account}} }, { {account, 1000} });
+        FakeCashBin cashBin(10000);
+        RecordingController atm(cardReader, bank, cashBin);
+
+        (void)atm.insertCard();
+        (void)atm.enterPin("0000");
+        (void)atm.enterPin(pin);
+        (void)atm.listAccounts();
+        (void)atm.selectAccount(account);
+        (void)atm.getBalance();
+        (void)atm.deposit(500);
+        (void)atm.withdraw(200);
+        (void)atm.withdraw(5000);
+        (void)atm.ejectCard();
+        return atm.takeTrace();
+    }
+}
+
+/**
+ * @brief Test recording a session and reading it back
+ *
+ * - Operations, arguments, outcomes and device responses are captured
+ * - PINs are not part of the trace
+ * - The binary file round-trips; foreign files and impossible counts are rejected
+ * - Lengths the format cannot store are refused instead of truncated
+ */
+TEST(test_session_recording)
+    SessionTrace trace = recordSession();
+    REQUIRE(trace.ops.size() == 10);
+    REQUIRE(trace.ops[1].op == ControllerMetrics::Op::EnterPin);
+    REQUIRE(trace.ops[1].outcome == Err::PinFailed);
+    REQUIRE(trace.ops[4].account == "ACCOUNT-001");
+    REQUIRE(trace.ops[7].money == 200);
+    REQUIRE(trace.ops[8].outcome == Err::InsufficientBank);
+
+    const auto& balanceCall = trace.ops[5].calls.at(0);
+    REQUIRE(balanceCall.call == ControllerMetrics::Call::GetBalance);
+    REQUIRE(balanceCall.value == 1000);
+    REQUIRE(trace.ops[3].calls.at(0).list == vector<string>{ "ACCOUNT-001" });
+    REQUIRE(trace.ops[7].calls.size() == 4);   // canDispense, placeHold, dispense, captureHold
+
+    auto path = tempPath("replay_test", ".trace");
+    REQUIRE(trace.save(path).isOk());
+
+    auto loaded = SessionTrace::load(path);
+    REQUIRE(loaded.isOk());
+    REQUIRE(loaded.value().ops.size() == trace.ops.size());
+    REQUIRE(loaded.value().ops[7].calls.size() == 4);
+    REQUIRE(loaded.value().ops[3].calls[0].list == trace.ops[3].calls[0].list);
+
+    ifstream in(path, ios::binary);
+    string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    REQUIRE(bytes.find("1234") == string::npos);
+    in.close();
+
+    {
+        ofstream out(path, ios::binary | ios::trunc);
+        out << "not a trace";
+    }
+    REQUIRE(SessionTrace::load(path).error() == Err::InvalidArg);
+
+    // Operation count far beyond what the file holds
+    {
+        ofstream out(path, ios::binary | ios::trunc);
+        uint32_t opCount = 0xFFFFFFFFu;
+        out.write("ATMSREC1", 8);
+        out.write(reinterpret_cast<const char*>(&opCount), sizeof(opCount));
+    }
+    REQUIRE(SessionTrace::load(path).error() == Err::InvalidArg);
+
+    SessionTrace tooLong = trace;
+    tooLong.ops[3].calls[0].list.assign(70000, "ACCOUNT-001");
+    REQUIRE(tooLong.save(path).code == Err::InvalidArg);
+    tooLong = trace;
+    tooLong.ops[2].account.assign(70000, 'A');
+    REQUIRE(tooLong.save(path).code == Err::InvalidArg);
+    REQUIRE(SessionTrace::load(path).error() == Err::InvalidArg);
+    filesystem::remove(path);
+END_TEST
+
+/**
+ * @brief Test replaying a recorded session
+ *
+ * - A faithful replay reproduces every result
+ * - Parallel replay runs every thread's loops
+ * - A changed result is reported as a mismatch
+ * - Fixed device latency is applied to every device call
+ */
+TEST(test_session_replay)
+    SessionTrace trace = recordSession();
+    size_t deviceCalls = 0;
+    for (const auto& op : trace.ops) deviceCalls += op.calls.size();
+
+    SessionReplayer replayer(trace);
+    SessionReplayer::Options options;
+    auto report = replayer.run(options);
+    REQUIRE(report.operations == trace.ops.size());
+    REQUIRE(report.mismatches == 0);
+    REQUIRE(report.divergedCalls == 0);
+    REQUIRE(report.metrics.op(ControllerMetrics::Op::Withdraw).count == 2);
+
+    options.threads = 2;
+    options.loops = 3;
+    report = replayer.run(options);
+    REQUIRE(report.operations == 6 * trace.ops.size());
+    REQUIRE(report.mismatches == 0);
+
+    SessionTrace changed = trace;
+    changed.ops[8].outcome = Err::None;
+    report = SessionReplayer(changed).run(SessionReplayer::Options());
+    REQUIRE(report.mismatches == 1);
+
+    options = SessionReplayer::Options();
+    options.timing = SessionReplayer::Timing::Fixed;
+    options.fixedLatency = chrono::microseconds(200);
+    report = replayer.run(options);
+    REQUIRE(report.mismatches == 0);
+    REQUIRE(report.seconds >= double(deviceCalls) * 200e-6);
+END_TEST
@@ -0,0 +1,266 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "ResilientBank.hpp"
+#include "ShardedBank.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/LatencyBank.hpp"
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+namespace {
+    using Clock = chrono::steady_clock;
+    using ms = chrono::milliseconds;
+
+    double elapsedMs(Clock::time_point start)
+    {
+        return chrono::duration<double, milli>(Clock::now() - start).count();
+    }
+
+    /**
+     * @brief Thread-safe backend: abandoned attempts keep running on the pool
+     */
+    void open(ShardedBank& bank, const Card& card, const AccountId& account)
+    {
+        (void)bank.addAccount(account, 1000);
+        (void)bank.addCard(card, "1234", { account });
+    }
+}
+
+/**
+ * @brief Test per-call deadlines
+ *
+ * - A stalled bank fails the call with NetworkError at the deadline
+ * - listAccounts, without an error channel, throws instead
+ * - The controller surfaces the deadline as NetworkError
+ */
+TEST(test_resilient_deadline)
+    Card card = "CARD-001";
+    Pin pin = "1234";
+    AccountId account = "ACCOUNT-001";
+
+    ShardedBank backend;
+    open(backend, card, account);
+    LatencyBank slow(backend);
+    ThreadPool pool(4);
+    FakeCardReader cardReader(card);
+    FakeCashBin cashBin(1000);
+
+    ResilientBank::Config cfg;
+    cfg.deadline = ms(100);
+    cfg.attemptTimeout = ms(100);
+    ResilientBank bank(slow, pool, cfg);
+    Controller atm(cardReader, bank, cashBin);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+
+    slow.setLatency(ms(600));
+    auto start = Clock::now();
+    REQUIRE(bank.getBalance(account).error() == Err::NetworkError);
+    REQUIRE(elapsedMs(start) < 400);
+
+    bool threw = false;
+    try {
+        (void)bank.listAccounts(card);
+    }
+    catch (const runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+
+    start = Clock::now();
+    REQUIRE(atm.getBalance().error() == Err::NetworkError);
+    REQUIRE(elapsedMs(start) < 400);
+    REQUIRE(bank.stats().timeouts >= 3);
+    slow.setLatency(ms(0));
+END_TEST
+
+/**
+ * @brief Test bounded retries
+ *
+ * - Transport failures and attempt timeouts of reads are retried
+ * - Retries stop after maxAttempts and rethrow the last failure
+ * - verifyPin is not resent after a transport failure
+ * - Business errors and calls that move money are not retried
+ */
+TEST(test_resilient_retries)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+
+    ShardedBank backend;
+    open(backend, card, account);
+    LatencyBank flaky(backend);
+    ThreadPool pool(4);
+
+    ResilientBank::Config cfg;
+    cfg.deadline = ms(3000);
+    cfg.attemptTimeout = ms(100);
+    cfg.backoff = ms(1);
+    ResilientBank bank(flaky, pool, cfg);
+
+    flaky.failNext(2);
+    auto balance = bank.getBalance(account);
+    REQUIRE(balance.isOk() && balance.value() == 1000);
+    REQUIRE(flaky.calls == 3);
+    REQUIRE(bank.stats().retries == 2);
+
+    flaky.failNext(3);
+    bool threw = false;
+    try {
+        (void)bank.getBalance(account);
+    }
+    catch (const runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+    REQUIRE(flaky.calls == 6);
+    REQUIRE(bank.stats().retries == 4);
+
+    flaky.failNext(1);
+    threw = false;
+    try {
+        (void)bank.verifyPin(card, "1234");
+    }
+    catch (const runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+    REQUIRE(flaky.calls == 7);
+
+    flaky.script({ chrono::microseconds(ms(600)), chrono::microseconds(0) });
+    REQUIRE(bank.canWithdraw(account, 100).isOk());
+    REQUIRE(bank.stats().timeouts == 1);
+    REQUIRE(flaky.calls == 9);
+
+    REQUIRE(bank.getBalance(AccountId("ACCOUNT-404")).error() == Err::InvalidArg);
+    REQUIRE(flaky.calls == 10);
+
+    flaky.failNext(1);
+    threw = false;
+    try {
+        (void)bank.deposit(account, 100);
+    }
+    catch (const runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+    REQUIRE(flaky.calls == 11);
+    REQUIRE(backend.getBalance(account).value() == 1000);
+END_TEST
+
+/**
+ * @brief Test calls that must not be sent twice
+ *
+ * - A hold placed after its attempt timed out is released by the attempt
+ * - A timed-out verifyPin is not resent
+ * - postDeposits is resent only to a bank with keyed deposits
+ */
+TEST(test_resilient_unsafe_resends)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+
+    ShardedBank backend;
+    open(backend, card, account);
+    LatencyBank slow(backend);
+    ThreadPool pool(4);
+
+    ResilientBank::Config cfg;
+    cfg.deadline = ms(3000);
+    cfg.attemptTimeout = ms(100);
+    cfg.backoff = ms(1);
+    ResilientBank bank(slow, pool, cfg);
+
+    slow.script({ chrono::microseconds(ms(300)) });
+    REQUIRE(bank.placeHold(account, 300).error() == Err::NetworkError);
+    REQUIRE(slow.calls == 1);
+    auto start = Clock::now();
+    while (!(slow.calls == 2 && backend.getBalance(account).value() == 1000) && elapsedMs(start) < 2000)
+    {
+        this_thread::sleep_for(ms(5));
+    }
+    REQUIRE_MSG(slow.calls == 2, "the late hold was not released");
+    REQUIRE(backend.getBalance(account).value() == 1000);
+
+    slow.script({ chrono::microseconds(ms(300)) });
+    REQUIRE(bank.verifyPin(card, "0000").code == Err::NetworkError);
+    REQUIRE(bank.stats().retries == 0);
+    this_thread::sleep_for(ms(400));
+    REQUIRE(slow.calls == 3);
+
+    vector<DepositPosting> batch = { { 1, account, 100 } };
+    slow.failNext(1);
+    auto statuses = bank.postDeposits(batch);
+    REQUIRE(statuses.size() == 1 && statuses[0].isOk());
+    REQUIRE(slow.calls == 5);
+
+    FakeBank unkeyed({}, {}, { { account, 1000 } });
+    LatencyBank link(unkeyed);
+    ResilientBank direct(link, pool, cfg);
+    link.failNext(1);
+    bool threw = false;
+    try {
+        (void)direct.postDeposits(batch);
+    }
+    catch (const runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+    REQUIRE(link.calls == 1);
+    REQUIRE(unkeyed.balanceMap[account] == 1000);
+END_TEST
+
+/**
+ * @brief Test hedged reads
+ *
+ * - A read slower than the hedge delay is duplicated and the first answer wins
+ * - Fast reads are not hedged
+ * - The hedge delay follows the observed p95 once enough answers were seen
+ */
+TEST(test_resilient_hedging)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+
+    ShardedBank backend;
+    open(backend, card, account);
+    LatencyBank tail(backend);
+    ThreadPool pool(4);
+
+    ResilientBank::Config cfg;
+    cfg.hedgeReads = true;
+    cfg.hedgeDelay = ms(20);
+    cfg.hedgeMinSamples = 8;
+    ResilientBank bank(tail, pool, cfg);
+
+    REQUIRE(bank.hedgeDelay(ResilientBank::Read::GetBalance) == ms(20));
+
+    tail.script({ chrono::microseconds(ms(600)), chrono::microseconds(0) });
+    auto start = Clock::now();
+    auto balance = bank.getBalance(account);
+    REQUIRE(balance.isOk() && balance.value() == 1000);
+    REQUIRE(elapsedMs(start) < 400);
+    REQUIRE(bank.stats().hedges == 1);
+    REQUIRE(bank.stats().hedgeWins == 1);
+
+    tail.script({ chrono::microseconds(ms(600)), chrono::microseconds(0) });
+    REQUIRE(bank.listAccounts(card).size() == 1);
+    REQUIRE(bank.stats().hedgeWins == 2);
+
+    // Deposits are never hedged
+    tail.setLatency(ms(40));
+    REQUIRE(bank.deposit(account, 100).isOk());
+    REQUIRE(bank.stats().hedges == 2);
+
+    tail.setLatency(ms(1));
+    for (int i = 0; i < 8; ++i)
+    {
+        REQUIRE(bank.getBalance(account).isOk());
+    }
+    REQUIRE(bank.stats().hedges == 2);
+    REQUIRE(bank.hedgeDelay(ResilientBank::Read::GetBalance) < chrono::nanoseconds(ms(20)));
+END_TEST
@@ -0,0 +1,121 @@
+#include "test_framework.hpp"
+#include "Interfaces.hpp"
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+static_assert(sizeof(Result<int>) == 2 * sizeof(int), "Result<int> should be int plus a tag");
+static_assert(is_trivially_copyable<Result<int>>::value, "Result<int> should be trivially copyable");
+static_assert(is_trivially_copyable<Result<HoldId>>::value, "Result<HoldId> should be trivially copyable");
+static_assert(!is_trivially_copyable<Result<vector<AccountId>>>::value, "vector results need real copies");
+
+namespace {
+    /**
+     * @brief Value type that counts how often it is copied
+     */
+    struct Counted {
+        static int copies;
+        int value = 0;
+
+        explicit Counted(int v) : value(v)
+        {}
+
+        Counted(const Counted& other) : value(other.value)
+        {
+            ++copies;
+        }
+
+        Counted(Counted&& other) noexcept : value(other.value)
+        {}
+
+        Counted& operator=(const Counted& other)
+        {
+            value = other.value;
+            ++copies;
+            return *this;
+        }
+
+        Counted& operator=(Counted&& other) noexcept
+        {
+            value = other.value;
+            return *this;
+        }
+    };
+
+    int Counted::copies = 0;
+}
+
+/**
+ * @brief Test moving values out of Result
+ *
+ * - take() and value() on a temporary move instead of copying
+ * - Copies and assignments between ok and error states
+ * - Err::None does not make an ok Result without a value
+ */
+TEST(test_result_move_out)
+    Counted::copies = 0;
+
+    Result<Counted> r = Counted(1);
+    Counted taken = r.take();
+    REQUIRE(taken.value == 1);
+
+    Counted moved = Result<Counted>(Counted(2)).value();
+    REQUIRE(moved.value == 2);
+    REQUIRE(Counted::copies == 0);
+
+    Result<Counted> copy = Result<Counted>(Counted(3));
+    Result<Counted> failed = Err::NetworkError;
+    copy = failed;
+    REQUIRE(!copy.isOk());
+    REQUIRE(copy.error() == Err::NetworkError);
+
+    // An error Result never reads as ok, even when built from Err::None
+    Result<Counted> none = Err::None;
+    REQUIRE(!none.isOk());
+    REQUIRE(none.error() == Err::SystemError);
+    REQUIRE(!Result<int>(Err::None).isOk());
+
+    failed = Result<Counted>(Counted(4));
+    REQUIRE(failed.isOk());
+    REQUIRE(failed.value().value == 4);
+    REQUIRE(Counted::copies == 0);
+
+    Result<vector<string>> list = vector<string>{ "a", "b" };
+    vector<string> values = move(list).value();
+    REQUIRE(values.size() == 2);
+END_TEST
+
+/**
+ * @brief Test and_then / map / or_else chaining
+ *
+ * - Errors short-circuit and pass through unchanged
+ * - Chaining an rvalue moves the value through every step
+ */
+TEST(test_result_chaining)
+    Counted::copies = 0;
+
+    auto doubled = Result<Counted>(Counted(21))
+        .map([](Counted&& c) { c.value *= 2; return move(c); })
+        .and_then([](Counted&& c) -> Result<int> { return c.value; });
+    REQUIRE(doubled.isOk());
+    REQUIRE(doubled.value() == 42);
+    REQUIRE(Counted::copies == 0);
+
+    bool called = false;
+    auto failed = Result<int>(Err::InsufficientBank)
+        .map([&](int v) { called = true; return v + 1; })
+        .and_then([&](int v) -> Result<string> { called = true; return to_string(v); });
+    REQUIRE(!called);
+    REQUIRE(failed.error() == Err::InsufficientBank);
+
+    auto recovered = Result<int>(Err::NetworkError)
+        .or_else([](Err e) -> Result<int> { return e == Err::NetworkError ? 0 : -1; });
+    REQUIRE(recovered.isOk());
+    REQUIRE(recovered.value() == 0);
+
+    const Result<int> ok = 5;
+    REQUIRE(ok.map([](int v) { return v * 3; }).value() == 15);
+    REQUIRE(ok.or_else([](Err) -> Result<int> { return -1; }).value() == 5);
+END_TEST
@@ -0,0 +1,233 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "ShardedBank.hpp"
+#include "ShardedBankRouter.hpp"
+#include "ThreadPool.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    /**
+     * @brief Partition whose link can be cut
+     */
+    class Partition : public ShardedBank {
+    public:
+        bool down = false;
+
+        vector<AccountId> listAccounts(const Card& card) override
+        {
+            if (down)
+            {
+                throw runtime_error("partition unreachable");
+            }
+            return ShardedBank::listAccounts(card);
+        }
+
+        vector<Status> postDeposits(const vector<DepositPosting>& batch) override
+        {
+            if (down)
+            {
+                throw runtime_error("partition unreachable");
+            }
+            return ShardedBank::postDeposits(batch);
+        }
+    };
+
+    AccountId accountNo(size_t i)
+    {
+        return AccountId("ACCOUNT-" + to_string(i));
+    }
+}
+
+/**
+ * @brief Test routing and key movement on the hash ring
+ *
+ * - Every account goes to one shard, and about evenly so
+ * - Adding a shard only moves keys onto it, about 1/N of them
+ * - Removing it moves exactly those keys back
+ * - BIN routes override the ring for cards
+ */
+TEST(test_router_ring)
+    const size_t keys = 20000;
+    ThreadPool pool(2);
+    ShardedBankRouter router(pool);
+    Partition a, b, c, d;
+
+    REQUIRE(router.shardOf(accountNo(0)).error() == Err::InvalidState);
+    REQUIRE(router.getBalance(accountNo(0)).error() == Err::NetworkError);
+    REQUIRE(router.addShard("a", a).isOk());
+    REQUIRE(router.addShard("b", b).isOk());
+    REQUIRE(router.addShard("c", c).isOk());
+    REQUIRE(router.addShard("c", d).code == Err::InvalidArg);
+    REQUIRE(router.addShard("", d).code == Err::InvalidArg);
+    REQUIRE(router.size() == 3);
+
+    vector<string> before(keys);
+    unordered_map<string, size_t> load;
+    for (size_t i = 0; i < keys; ++i)
+    {
+        before[i] = router.shardOf(accountNo(i)).value();
+        ++load[before[i]];
+    }
+    for (const auto& shard : load)
+    {
+        REQUIRE(shard.second > keys / 3 * 7 / 10 && shard.second < keys / 3 * 13 / 10);
+    }
+
+    REQUIRE(router.addShard("d", d).isOk());
+    size_t moved = 0;
+    size_t strayed = 0;
+    for (size_t i = 0; i < keys; ++i)
+    {
+        string now = router.shardOf(accountNo(i)).value();
+        moved += now != before[i];
+        strayed += now != before[i] && now != "d";
+    }
+    REQUIRE(strayed == 0);
+    REQUIRE(moved > keys / 4 * 7 / 10 && moved < keys / 4 * 13 / 10);
+
+    REQUIRE(router.removeShard("d").isOk());
+    REQUIRE(router.removeShard("d").code == Err::InvalidArg);
+    moved = 0;
+    for (size_t i = 0; i < keys; ++i)
+    {
+        moved += router.shardOf(accountNo(i)).value() != before[i];
+    }
+    REQUIRE(moved == 0);
+
+    REQUIRE(router.routeBin("4111", "x").code == Err::InvalidArg);
+    REQUIRE(router.routeBin("4111", "a").isOk());
+    REQUIRE(router.routeBin("41119", "b").isOk());
+    REQUIRE(router.shardOf(Card("4111000000000001")).value() == "a");
+    REQUIRE(router.shardOf(Card("4111900000000001")).value() == "b");
+    REQUIRE(router.removeShard("b").isOk());
+    REQUIRE(router.shardOf(Card("4111900000000001")).value() == "a");
+END_TEST
+
+/**
+ * @brief Test a card with accounts in several partitions
+ *
+ * - listAccounts merges the answers of every shard
+ * - Money operations and holds reach the account's own shard
+ * - A controller works over the router as over one bank
+ */
+TEST(test_router_fan_out)
+    ThreadPool pool(4);
+    ShardedBankRouter router(pool);
+    vector<unique_ptr<Partition>> partitions;
+    for (int i = 0; i < 3; ++i)
+    {
+        partitions.push_back(make_unique<Partition>());
+        REQUIRE(router.addShard("p" + to_string(i), *partitions.back()).isOk());
+    }
+
+    Card card = "CARD-001";
+    Pin pin = "1234";
+    // Four accounts on every partition
+    unordered_map<string, vector<AccountId>> owned;
+    for (size_t i = 0, placed = 0; placed < 12; ++i)
+    {
+        auto& accounts = owned[router.shardOf(accountNo(i)).value()];
+        if (accounts.size() < 4)
+        {
+            accounts.push_back(accountNo(i));
+            ++placed;
+        }
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        Partition& partition = *partitions[i];
+        const vector<AccountId>& accounts = owned["p" + to_string(i)];
+        for (const AccountId& accountId : accounts)
+        {
+            REQUIRE(partition.addAccount(accountId, 1000).isOk());
+        }
+        REQUIRE(partition.addCard(card, pin, accounts).isOk());
+    }
+
+    auto accounts = router.listAccounts(card);
+    REQUIRE(accounts.size() == 12);
+    REQUIRE(accounts[0] == owned["p0"][0]);
+
+    AccountId target = owned["p2"][0];
+    REQUIRE(router.withdraw(target, 300).isOk());
+    REQUIRE(partitions[2]->getBalance(target).value() == 700);
+    auto hold = router.placeHold(target, 200);
+    REQUIRE(hold.isOk() && (hold.value() >> 56) == 3);
+    REQUIRE(router.getBalance(target).value() == 500);
+    REQUIRE(router.captureHold(hold.value()).isOk());
+    REQUIRE(router.captureHold(hold.value()).code != Err::None);
+    REQUIRE(router.releaseHold(HoldId(200) << 56).code == Err::InvalidArg);
+
+    partitions[1]->down = true;
+    bool threw = false;
+    try {
+        (void)router.listAccounts(card);
+    }
+    catch (const runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+    partitions[1]->down = false;
+
+    FakeCardReader cardReader(card);
+    FakeCashBin cashBin(10000);
+    Controller atm(cardReader, router, cashBin);
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.listAccounts().value().size() == 12);
+    REQUIRE(atm.selectAccount(owned["p1"][0]).isOk());
+    REQUIRE(atm.withdraw(100).isOk());
+    REQUIRE(partitions[1]->getBalance(owned["p1"][0]).value() == 900);
+END_TEST
+
+/**
+ * @brief Test batched deposits split over partitions
+ *
+ * - Statuses come back in batch order
+ * - A partition that is down fails only its own deposits, as NetworkError
+ */
+TEST(test_router_post_deposits)
+    ThreadPool pool(2);
+    ShardedBankRouter router(pool);
+    Partition a, b;
+    REQUIRE(router.addShard("a", a).isOk());
+    REQUIRE(router.addShard("b", b).isOk());
+    REQUIRE(router.postDeposits({}).empty());
+
+    vector<DepositPosting> batch;
+    for (size_t i = 0; i < 16; ++i)
+    {
+        AccountId accountId = accountNo(i);
+        Partition& home = router.shardOf(accountId).value() == "a" ? a : b;
+        REQUIRE(home.addAccount(accountId, 0).isOk());
+        batch.push_back({ i + 1, accountId, int(i + 1) });
+    }
+    batch.push_back({ 99, AccountId("ACCOUNT-404"), 10 });
+
+    b.down = true;
+    auto statuses = router.postDeposits(batch);
+    REQUIRE(statuses.size() == batch.size());
+    for (size_t i = 0; i < 16; ++i)
+    {
+        bool onA = router.shardOf(batch[i].accountId).value() == "a";
+        REQUIRE(statuses[i].code == (onA ? Err::None : Err::NetworkError));
+    }
+
+    b.down = false;
+    statuses = router.postDeposits(batch);
+    for (size_t i = 0; i < 16; ++i)
+    {
+        REQUIRE(statuses[i].isOk());
+        REQUIRE(router.getBalance(batch[i].accountId).value() == int(i + 1));
+    }
+    REQUIRE(!statuses[16].isOk() && statuses[16].code != Err::NetworkError);
+END_TEST
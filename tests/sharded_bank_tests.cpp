@@ -0,0 +1,92 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "ShardedBank.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Test ShardedBank withdrawals under contention
+ *
+ * - Concurrent withdrawals and holds on one account never overdraw
+ * - Exactly the available funds are handed out
+ * - Concurrent readers see values in range
+ */
+TEST(test_sharded_bank_never_overdraws)
+    ShardedBank bank(8);
+    AccountId hot = "HOT-ACCOUNT";
+    const int initial = 10000;
+    REQUIRE(bank.addAccount(hot, initial).isOk());
+    REQUIRE(!bank.addAccount(hot, 1).isOk());
+
+    const int threadCount = 8;
+    const int attempts = 2000;
+    atomic<int> granted{ 0 };
+    atomic<bool> sawNegative{ false };
+    atomic<bool> done{ false };
+
+    thread reader([&] {
+        while (!done.load())
+        {
+            int balance = bank.getBalance(hot).value();
+            if (balance < 0) sawNegative = true;
+        }
+    });
+
+    vector<thread> workers;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < attempts; ++i)
+            {
+                if (t % 2 == 0)
+                {
+                    if (bank.withdraw(hot, 1).isOk()) ++granted;
+                }
+                else
+                {
+                    auto hold = bank.placeHold(hot, 1);
+                    if (hold.isOk() && bank.captureHold(hold.value()).isOk()) ++granted;
+                }
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    done = true;
+    reader.join();
+
+    REQUIRE(granted.load() == initial);
+    REQUIRE(bank.getBalance(hot).value() == 0);
+    REQUIRE(!sawNegative.load());
+END_TEST
+
+/**
+ * @brief Test a Controller session against ShardedBank
+ */
+TEST(test_sharded_bank_controller_session)
+    Card card = "CARD-001";
+    Pin pin = "12345";
+    AccountId account = "ACCOUNT-001";
+
+    ShardedBank bank;
+    REQUIRE(bank.addAccount(account, 1000).isOk());
+    REQUIRE(bank.addCard(card, pin, {account}).isOk());
+
+    FakeCashBin cashBin(10000);
+    FakeCardReader cardReader(card);
+    Controller atm(cardReader, bank, cashBin);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(!atm.enterPin("0000").isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+    REQUIRE(atm.withdraw(300).isOk());
+    REQUIRE(atm.deposit(50).isOk());
+    REQUIRE(atm.getBalance().value() == 750);
+    REQUIRE(atm.withdraw(5000).code == Err::InsufficientBank);
+    REQUIRE(atm.ejectCard().isOk());
+END_TEST
@@ -0,0 +1,234 @@
+#include "test_framework.hpp"
+#include "ControllerHost.hpp"
+#include "OfflinePinVerifier.hpp"
+#include "SessionSnapshot.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/TempPath.hpp"
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    const chrono::seconds kMaxAge{ 300 };
+
+    SessionKey hostKey(uint8_t seed)
+    {
+        SessionKey key;
+        for (size_t i = 0; i < key.size(); ++i)
+        {
+            key[i] = uint8_t(seed + 31 * i);
+        }
+        return key;
+    }
+
+    const SessionKey kKey = hostKey(7);
+
+    struct Terminal {
+        Card card;
+        FakeBank bank;
+        FakeCashBin cashBin;
+        FakeCardReader cardReader;
+
+        Terminal(const Card& id, const AccountId& account)
+         : card(id),
+           bank({{id, "1234"}}, {{id, {account}}}, {{account, 1000}}),
+           cashBin(100000),
+           cardReader(card)
+        {}
+    };
+}
+
+/**
+ * @brief Test capturing and restoring a single controller
+ *
+ * - A selected account resumes without asking for the PIN again
+ * - Failed PIN attempts carry over
+ * - Busy controllers, damaged, forged, expired and idle records are refused
+ * - A record is refused unless the reader holds the recorded card
+ * - The card's issuer PIN reference is read again, not taken from the record
+ */
+TEST(test_snapshot_controller)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+    Terminal before(card, account);
+    Controller atm(before.cardReader, before.bank, before.cashBin);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin("0000").code == Err::PinFailed);
+    auto pinPending = atm.snapshot(kKey);
+    REQUIRE(pinPending.isOk());
+    REQUIRE(atm.enterPin("1234").isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+    auto selected = atm.snapshot(kKey);
+    REQUIRE(selected.isOk());
+
+    Terminal after(card, account);
+    Controller restored(after.cardReader, after.bank, after.cashBin);
+    REQUIRE(restored.restore(selected.value(), kKey, kMaxAge).isOk());
+    REQUIRE(after.cardReader.inserted);
+    REQUIRE(restored.state() == Controller::State::AccountSelected);
+    REQUIRE(restored.getBalance().value() == 1000);
+    REQUIRE(restored.withdraw(100).isOk());
+    REQUIRE(restored.restore(selected.value(), kKey, kMaxAge).code == Err::InvalidState);
+    REQUIRE(restored.ejectCard().isOk());
+
+    // Two more wrong PINs use up the three attempts
+    REQUIRE(restored.restore(pinPending.value(), kKey, kMaxAge).isOk());
+    REQUIRE(restored.state() == Controller::State::CardInserted);
+    REQUIRE(restored.enterPin("0000").code == Err::PinFailed);
+    REQUIRE(restored.state() == Controller::State::CardInserted);
+    REQUIRE(restored.enterPin("0000").code == Err::PinFailed);
+    REQUIRE(restored.state() == Controller::State::Idle);
+
+    SessionRecord damaged = selected.value();
+    damaged.account[0] = 'X';
+    REQUIRE(restored.restore(damaged, kKey, kMaxAge).code == Err::InvalidArg);
+
+    // Whoever can write the file cannot seal a record without the host's key
+    SessionRecord forged = selected.value();
+    forged.seal(hostKey(8));
+    REQUIRE(restored.restore(forged, kKey, kMaxAge).code == Err::InvalidArg);
+    REQUIRE(restored.restore(selected.value(), hostKey(8), kMaxAge).code == Err::InvalidArg);
+
+    SessionRecord expired = selected.value();
+    expired.savedAtMs -= 3600 * 1000;
+    expired.seal(kKey);
+    REQUIRE(restored.restore(expired, kKey, kMaxAge).code == Err::InvalidArg);
+
+    auto idle = restored.snapshot(kKey);
+    REQUIRE(idle.isOk());
+    REQUIRE(restored.restore(idle.value(), kKey, kMaxAge).code == Err::InvalidArg);
+    REQUIRE(restored.state() == Controller::State::Idle);
+
+    // Another card in the reader, or none, does not inherit the session
+    after.cardReader.card = Card("CARD-002");
+    REQUIRE(restored.restore(selected.value(), kKey, kMaxAge).code == Err::InvalidArg);
+    REQUIRE(restored.state() == Controller::State::Idle);
+    after.cardReader.card = Err::HardwareError;
+    REQUIRE(restored.restore(selected.value(), kKey, kMaxAge).code == Err::HardwareError);
+    REQUIRE(restored.state() == Controller::State::Idle);
+
+    // The reference on the card decides the PIN, without asking the bank
+    Terminal issued(card, account);
+    issued.cardReader.reference = OfflinePinVerifier::makeReference(card, "4321", {}, 1);
+    OfflinePinVerifier verifier;
+    Controller::Config cfg;
+    cfg.pinVerifier = &verifier;
+    Controller offline(issued.cardReader, issued.bank, issued.cashBin, cfg);
+    REQUIRE(offline.restore(pinPending.value(), kKey, kMaxAge).isOk());
+    REQUIRE(offline.enterPin("1234").code == Err::PinFailed);
+    REQUIRE(offline.enterPin("4321").isOk());
+END_TEST
+
+/**
+ * @brief Test the snapshot file
+ *
+ * - Records survive closing and reopening, also with a new capacity
+ * - A save replaces the previous snapshot
+ * - Damaged records and records sealed with another key are dropped
+ * - Oversized snapshots are refused
+ */
+TEST(test_snapshot_file)
+    string path = tempPath("file", ".snapshot");
+    vector<SessionRecord> records(3);
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        records[i].state = 1;
+        records[i].sessionId = i;
+        records[i].card[0] = char('A' + i);
+        records[i].seal(kKey);
+    }
+
+    {
+        SessionSnapshotFile file;
+        REQUIRE(file.open(path, 4).isOk());
+        REQUIRE(file.load(kKey).empty());
+        REQUIRE(file.save(records).isOk());
+        REQUIRE(file.save(vector<SessionRecord>(5)).code == Err::MemoryError);
+    }
+
+    SessionSnapshotFile file;
+    REQUIRE(file.open(path, 4).isOk());
+    auto loaded = file.load(kKey);
+    REQUIRE(loaded.size() == 3);
+    REQUIRE(loaded[2].sessionId == 2 && loaded[2].card[0] == 'C');
+    REQUIRE(file.load(hostKey(8)).empty());
+
+    records[1].card[0] = 'Z';
+    records[2].seal(hostKey(8));
+    REQUIRE(file.save(records).isOk());
+    loaded = file.load(kKey);
+    REQUIRE(loaded.size() == 1);
+    REQUIRE(loaded[0].sessionId == 0);
+
+    file.close();
+    REQUIRE(file.open(path, 16).isOk());
+    REQUIRE(file.capacity() == 16);
+    REQUIRE(file.load(kKey).size() == 1);
+    REQUIRE(file.save({}).isOk());
+    REQUIRE(file.load(kKey).empty());
+END_TEST
+
+/**
+ * @brief Test saving and restoring every session of a host
+ *
+ * - Only sessions holding a card are saved
+ * - A new host with the same sessions resumes them where they were
+ */
+TEST(test_snapshot_host)
+    const size_t terminalCount = 8;
+    string path = tempPath("host", ".snapshot");
+    SessionSnapshotFile file;
+    REQUIRE(file.open(path, 64).isOk());
+
+    {
+        vector<unique_ptr<Terminal>> terminals;
+        ControllerHost host(2);
+        for (size_t i = 0; i < terminalCount; ++i)
+        {
+            terminals.push_back(make_unique<Terminal>("CARD-" + to_string(i), "ACCOUNT-" + to_string(i)));
+            (void)host.addSession(terminals[i]->cardReader, terminals[i]->bank, terminals[i]->cashBin);
+        }
+
+        // Even sessions select their account, odd ones stay idle
+        for (size_t i = 0; i < terminalCount; i += 2)
+        {
+            AccountId account = "ACCOUNT-" + to_string(i);
+            host.submit(i, [account](Controller& atm) {
+                (void)atm.insertCard();
+                (void)atm.enterPin("1234");
+                (void)atm.selectAccount(account);
+            });
+        }
+
+        auto saved = host.saveSessions(file, kKey);
+        REQUIRE(saved.isOk() && saved.value() == terminalCount / 2);
+    }
+
+    vector<unique_ptr<Terminal>> terminals;
+    ControllerHost host(2);
+    for (size_t i = 0; i < terminalCount; ++i)
+    {
+        terminals.push_back(make_unique<Terminal>("CARD-" + to_string(i), "ACCOUNT-" + to_string(i)));
+        (void)host.addSession(terminals[i]->cardReader, terminals[i]->bank, terminals[i]->cashBin);
+    }
+
+    REQUIRE(host.restoreSessions(file, hostKey(8), kMaxAge) == 0);
+    REQUIRE(host.restoreSessions(file, kKey, kMaxAge) == terminalCount / 2);
+    for (size_t i = 0; i < terminalCount; ++i)
+    {
+        auto state = host.call(i, [](Controller& atm) { return atm.state(); }).get();
+        auto expected = i % 2 ? Controller::State::Idle : Controller::State::AccountSelected;
+        REQUIRE(state == expected);
+    }
+
+    auto balance = host.call(2, [](Controller& atm) { return atm.getBalance(); }).get();
+    REQUIRE(balance.isOk() && balance.value() == 1000);
+
+    // Restoring over live sessions does nothing
+    REQUIRE(host.restoreSessions(file, kKey, kMaxAge) == 0);
+END_TEST
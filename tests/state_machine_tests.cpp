@@ -0,0 +1,140 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+    using State = Controller::State;
+    using Event = Controller::Event;
+
+    uint64_t taken(const Controller& atm, State state, Event event)
+    {
+        return atm.transitionCounts()[size_t(state)][size_t(event)];
+    }
+}
+
+/**
+ * @brief Test the per-transition counters
+ *
+ * - Every successful operation counts once against the state it started in
+ * - Failed operations and rejected PINs are told apart
+ */
+TEST(test_state_machine_counters)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+    FakeBank bank({{card, "1234"}}, {{card, {account}}}, {{account, 1000}});
+    FakeCashBin cashBin(10000);
+    FakeCardReader cardReader(card);
+    Controller atm(cardReader, bank, cashBin);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin("0000").code == Err::PinFailed);
+    REQUIRE(atm.enterPin("1234").isOk());
+    REQUIRE(atm.listAccounts().isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+    REQUIRE(atm.getBalance().isOk());
+    REQUIRE(atm.deposit(100).isOk());
+    REQUIRE(atm.withdraw(200).isOk());
+    REQUIRE(atm.withdraw(5000).code == Err::InsufficientBank);
+    REQUIRE(atm.ejectCard().isOk());
+
+    REQUIRE(taken(atm, State::Idle, Event::CardRead) == 1);
+    REQUIRE(taken(atm, State::CardInserted, Event::PinRejected) == 1);
+    REQUIRE(taken(atm, State::CardInserted, Event::PinAccepted) == 1);
+    REQUIRE(taken(atm, State::Authenticated, Event::AccountsListed) == 1);
+    REQUIRE(taken(atm, State::Authenticated, Event::AccountChosen) == 1);
+    REQUIRE(taken(atm, State::AccountSelected, Event::BalanceRead) == 1);
+    REQUIRE(taken(atm, State::AccountSelected, Event::Deposited) == 1);
+    REQUIRE(taken(atm, State::AccountSelected, Event::Withdrawn) == 1);
+    REQUIRE(taken(atm, State::AccountSelected, Event::CardEjected) == 1);
+    REQUIRE(string(Controller::eventName(Event::Withdrawn)) == "Withdrawn");
+END_TEST
+
+/**
+ * @brief Test events the current state does not accept
+ *
+ * - Each is refused with InvalidState and leaves the state alone
+ * - Refused events are not counted
+ */
+TEST(test_state_machine_rejects)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+    FakeBank bank({{card, "1234"}}, {{card, {account}}}, {{account, 1000}});
+    FakeCashBin cashBin(10000);
+    FakeCardReader cardReader(card);
+    Controller atm(cardReader, bank, cashBin);
+
+    REQUIRE(atm.enterPin("1234").code == Err::InvalidState);
+    REQUIRE(atm.ejectCard().code == Err::InvalidState);
+    REQUIRE(atm.listAccounts().error() == Err::InvalidState);
+    REQUIRE(atm.state() == State::Idle);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.insertCard().code == Err::InvalidState);
+    REQUIRE(atm.selectAccount(account).code == Err::InvalidState);
+    REQUIRE(atm.deposit(100).code == Err::InvalidState);
+    REQUIRE(atm.state() == State::CardInserted);
+
+    REQUIRE(atm.enterPin("1234").isOk());
+    REQUIRE(atm.enterPin("1234").code == Err::InvalidState);
+    REQUIRE(atm.getBalance().error() == Err::InvalidState);
+    REQUIRE(atm.withdraw(100).code == Err::InvalidState);
+    REQUIRE(atm.state() == State::Authenticated);
+
+    uint64_t total = 0;
+    for (const auto& row : atm.transitionCounts())
+    {
+        for (uint64_t count : row)
+        {
+            total += count;
+        }
+    }
+    REQUIRE(total == 2);
+END_TEST
+
+/**
+ * @brief Test that a failing eject still ends the session
+ *
+ * - The controller returns to Idle with the card and account dropped
+ * - A new session can start afterwards
+ */
+TEST(test_state_machine_eject_failure)
+    Card card = "CARD-001";
+    AccountId account = "ACCOUNT-001";
+    FakeBank bank({{card, "1234"}}, {{card, {account}}}, {{account, 1000}});
+    FakeCashBin cashBin(10000);
+
+    class JammedCardReader : public FakeCardReader {
+    public:
+        bool jammed = true;
+
+        JammedCardReader(Card& card) : FakeCardReader(card) {}
+
+        Status eject(void) override {
+            if (jammed) {
+                throw runtime_error("card jammed");
+            }
+            return FakeCardReader::eject();
+        }
+    };
+
+    JammedCardReader cardReader(card);
+    Controller atm(cardReader, bank, cashBin);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin("1234").isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+    REQUIRE(!atm.ejectCard().isOk());
+    REQUIRE(atm.state() == State::Idle);
+    REQUIRE(taken(atm, State::AccountSelected, Event::CardEjected) == 1);
+
+    cardReader.jammed = false;
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.getBalance().error() == Err::InvalidState);
+    REQUIRE(atm.enterPin("1234").isOk());
+    REQUIRE(atm.listAccounts().isOk());
+END_TEST
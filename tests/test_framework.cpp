@@ -1,4 +1,10 @@
 #include "test_framework.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <mutex>
 
 extern void test_card_insert_and_eject();
 extern void test_invalid_card_operations();
@@ -11,15 +17,114 @@ extern void test_transaction_rollback_on_cash_failure();
 extern void test_atomic_transaction_rollback();
 extern void test_atomic_transaction_success();
 extern void test_multiple_atomic_transactions();
+extern void test_inline_transaction_semantics();
+extern void test_async_withdraw_through_adapters();
+extern void test_async_prechecks_overlap();
+extern void test_host_runs_many_sessions();
+extern void test_host_session_config();
+extern void test_session_cache_saves_round_trips();
+extern void test_session_cache_invalidated_on_failed_withdraw();
+extern void test_withdraw_captures_hold();
+extern void test_withdraw_releases_hold_on_dispense_failure();
+extern void test_withdraw_reports_cash_bin_before_bank();
+extern void test_journal_records_withdrawals();
+extern void test_journal_recovers_interrupted_withdrawals();
+extern void test_journal_recovers_failed_capture();
+extern void test_journal_reused_after_failed_capture();
+extern void test_sharded_bank_never_overdraws();
+extern void test_sharded_bank_controller_session();
+extern void test_interned_ids();
+extern void test_interned_ids_released();
+extern void test_result_move_out();
+extern void test_result_chaining();
+extern void test_controller_metrics();
+extern void test_latency_histogram();
+extern void test_event_tracer_rings();
+extern void test_controller_tracing();
+extern void test_session_recording();
+extern void test_session_replay();
+extern void test_sha256();
+extern void test_offline_pin_cache();
+extern void test_offline_pin_issuer_reference();
+extern void test_cassette_plans();
+extern void test_cassette_dispense();
+extern void test_cassette_controller_withdraw();
+extern void test_resilient_deadline();
+extern void test_resilient_retries();
+extern void test_resilient_hedging();
+extern void test_resilient_unsafe_resends();
+extern void test_breaker_cycle();
+extern void test_breaker_passes_settlement();
+extern void test_breaker_slow_calls();
+extern void test_breaker_degraded_controller();
+extern void test_deposit_queue_batches();
+extern void test_deposit_queue_backpressure();
+extern void test_deposit_queue_controller();
+extern void test_snapshot_controller();
+extern void test_snapshot_file();
+extern void test_snapshot_host();
+extern void test_state_machine_counters();
+extern void test_state_machine_rejects();
+extern void test_state_machine_eject_failure();
+extern void test_router_ring();
+extern void test_router_fan_out();
+extern void test_router_post_deposits();
+extern void test_runner_parallel();
+extern void test_runner_filter_and_report();
+extern void test_fault_latency_models();
+extern void test_fault_injection();
+extern void test_fault_outages_and_withdraw();
+extern void test_ledger_bank_operations();
+extern void test_ledger_bank_snapshots();
+extern void test_ledger_bank_group_commit();
+extern void test_bank_get_balances();
+extern void test_prefetch_after_pin();
+extern void test_prefetch_cancelled_on_eject();
+extern void test_prefetch_failure_falls_back();
 
 namespace TestFramework {
-    int passed = 0;
-    int failed = 0;
-    
+    atomic<int> passed{ 0 };
+    atomic<int> failed{ 0 };
+
     vector<TestCase> testCases;
-    
-    void registerTest(const string& name, function<void()> testFunc) {
-        testCases.push_back({name, testFunc});
+
+    namespace {
+        thread_local Context* t_context = nullptr;
+        mutex s_stray;      // serializes REQUIRE failures outside of tests
+
+        TestResult runOne(const TestCase& testCase)
+        {
+            Context context;
+            Context* outer = t_context;
+            t_context = &context;
+
+            TestResult result;
+            result.name = testCase.name;
+            auto start = chrono::steady_clock::now();
+            try {
+                testCase.testFunction();
+            } catch (const exception& e) {
+                context.out << "Test " << testCase.name << " threw exception: " << e.what() << '\n';
+                result.threw = true;
+            } catch (...) {
+                context.out << "Test " << testCase.name << " threw exception" << '\n';
+                result.threw = true;
+            }
+            result.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            t_context = outer;
+
+            result.passed = context.passed;
+            result.failed = context.failed + (result.threw ? 1 : 0);
+            char status[64];
+            snprintf(status, sizeof(status), " (%.1f ms)\n\n", result.ms);
+            context.out << (result.failed ? "[FAIL ] " : "[ OK  ] ") << testCase.name << status;
+            result.output = context.out.str();
+            return result;
+        }
+    }
+
+    void registerTest(const string& name, function<void()> testFunc, Run run) {
+        testCases.push_back({name, testFunc, run});
     }
     
     void registerAllTests() {
@@ -43,28 +148,270 @@ namespace TestFramework {
         registerTest("test_atomic_transaction_rollback", test_atomic_transaction_rollback);
         registerTest("test_atomic_transaction_success", test_atomic_transaction_success);
         registerTest("test_multiple_atomic_transactions", test_multiple_atomic_transactions);
+        registerTest("test_inline_transaction_semantics", test_inline_transaction_semantics);
+        
+        // Async interface tests
+        registerTest("test_async_withdraw_through_adapters", test_async_withdraw_through_adapters);
+        registerTest("test_async_prechecks_overlap", test_async_prechecks_overlap);
+        
+        // Multi-session host tests
+        registerTest("test_host_runs_many_sessions", test_host_runs_many_sessions);
+        registerTest("test_host_session_config", test_host_session_config);
+        
+        // Session cache tests
+        registerTest("test_session_cache_saves_round_trips", test_session_cache_saves_round_trips);
+        registerTest("test_session_cache_invalidated_on_failed_withdraw", test_session_cache_invalidated_on_failed_withdraw);
+        
+        // Hold/capture tests
+        registerTest("test_withdraw_captures_hold", test_withdraw_captures_hold);
+        registerTest("test_withdraw_releases_hold_on_dispense_failure", test_withdraw_releases_hold_on_dispense_failure);
+        registerTest("test_withdraw_reports_cash_bin_before_bank", test_withdraw_reports_cash_bin_before_bank);
+        
+        // Journal tests
+        registerTest("test_journal_records_withdrawals", test_journal_records_withdrawals);
+        registerTest("test_journal_recovers_interrupted_withdrawals", test_journal_recovers_interrupted_withdrawals);
+        registerTest("test_journal_recovers_failed_capture", test_journal_recovers_failed_capture);
+        registerTest("test_journal_reused_after_failed_capture", test_journal_reused_after_failed_capture);
+        
+        // Sharded bank tests
+        registerTest("test_sharded_bank_never_overdraws", test_sharded_bank_never_overdraws);
+        registerTest("test_sharded_bank_controller_session", test_sharded_bank_controller_session);
+        
+        // Interned id tests
+        registerTest("test_interned_ids", test_interned_ids);
+        registerTest("test_interned_ids_released", test_interned_ids_released, Run::Alone);  // counts the global table
+        
+        // Result tests
+        registerTest("test_result_move_out", test_result_move_out);
+        registerTest("test_result_chaining", test_result_chaining);
+        
+        // Metrics tests
+        registerTest("test_controller_metrics", test_controller_metrics);
+        registerTest("test_latency_histogram", test_latency_histogram);
+        
+        // Trace tests (the tracer is global)
+        registerTest("test_event_tracer_rings", test_event_tracer_rings, Run::Alone);
+        registerTest("test_controller_tracing", test_controller_tracing, Run::Alone);
+        
+        // Replay tests
+        registerTest("test_session_recording", test_session_recording);
+        registerTest("test_session_replay", test_session_replay);
+        
+        // Offline PIN tests
+        registerTest("test_sha256", test_sha256);
+        registerTest("test_offline_pin_cache", test_offline_pin_cache);
+        registerTest("test_offline_pin_issuer_reference", test_offline_pin_issuer_reference);
+        
+        // Cassette cash bin tests
+        registerTest("test_cassette_plans", test_cassette_plans);
+        registerTest("test_cassette_dispense", test_cassette_dispense);
+        registerTest("test_cassette_controller_withdraw", test_cassette_controller_withdraw);
+        
+        // Resilient bank tests (deadlines and hedge delays are wall-clock)
+        registerTest("test_resilient_deadline", test_resilient_deadline, Run::Alone);
+        registerTest("test_resilient_retries", test_resilient_retries, Run::Alone);
+        registerTest("test_resilient_hedging", test_resilient_hedging, Run::Alone);
+        registerTest("test_resilient_unsafe_resends", test_resilient_unsafe_resends, Run::Alone);
+        
+        // Circuit breaker tests (open periods and slow calls are wall-clock)
+        registerTest("test_breaker_cycle", test_breaker_cycle, Run::Alone);
+        registerTest("test_breaker_passes_settlement", test_breaker_passes_settlement);
+        registerTest("test_breaker_slow_calls", test_breaker_slow_calls, Run::Alone);
+        registerTest("test_breaker_degraded_controller", test_breaker_degraded_controller, Run::Alone);
+        
+        // Deposit queue tests
+        registerTest("test_deposit_queue_batches", test_deposit_queue_batches);
+        registerTest("test_deposit_queue_backpressure", test_deposit_queue_backpressure, Run::Alone);  // bounded wait for room
+        registerTest("test_deposit_queue_controller", test_deposit_queue_controller);
+        
+        // Session snapshot tests
+        registerTest("test_snapshot_controller", test_snapshot_controller);
+        registerTest("test_snapshot_file", test_snapshot_file);
+        registerTest("test_snapshot_host", test_snapshot_host);
+        
+        // State machine tests
+        registerTest("test_state_machine_counters", test_state_machine_counters);
+        registerTest("test_state_machine_rejects", test_state_machine_rejects);
+        registerTest("test_state_machine_eject_failure", test_state_machine_eject_failure);
+        
+        // Router tests
+        registerTest("test_router_ring", test_router_ring);
+        registerTest("test_router_fan_out", test_router_fan_out);
+        registerTest("test_router_post_deposits", test_router_post_deposits);
+        
+        // Test framework tests
+        registerTest("test_runner_parallel", test_runner_parallel);
+        registerTest("test_runner_filter_and_report", test_runner_filter_and_report);
+        
+        // Fault model tests
+        registerTest("test_fault_latency_models", test_fault_latency_models);
+        registerTest("test_fault_injection", test_fault_injection, Run::Alone);  // real-clock sleep
+        registerTest("test_fault_outages_and_withdraw", test_fault_outages_and_withdraw);
+        
+        // Ledger bank tests
+        registerTest("test_ledger_bank_operations", test_ledger_bank_operations);
+        registerTest("test_ledger_bank_snapshots", test_ledger_bank_snapshots, Run::Alone);  // waits on the background snapshot
+        registerTest("test_ledger_bank_group_commit", test_ledger_bank_group_commit);
+        
+        // Prefetch tests
+        registerTest("test_bank_get_balances", test_bank_get_balances);
+        registerTest("test_prefetch_after_pin", test_prefetch_after_pin);
+        registerTest("test_prefetch_cancelled_on_eject", test_prefetch_cancelled_on_eject);
+        registerTest("test_prefetch_failure_falls_back", test_prefetch_failure_falls_back);
     }
-    
-    void runAllTests() {
+
+    bool parseArgs(int argc, char** argv, Options& opt) {
+        for (int i = 1; i < argc; ++i) {
+            bool hasValue = i + 1 < argc;
+            if (!strcmp(argv[i], "--jobs") && hasValue) {
+                opt.jobs = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+            } else if (!strcmp(argv[i], "--filter") && hasValue) {
+                opt.filters.push_back(argv[++i]);
+            } else if (!strcmp(argv[i], "--report") && hasValue) {
+                opt.reportPath = argv[++i];
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool selected(const string& name, const Options& opt) {
+        if (opt.filters.empty()) {
+            return true;
+        }
+        return any_of(opt.filters.begin(), opt.filters.end(), [&](const string& filter) {
+            return name.find(filter) != string::npos;
+        });
+    }
+
+    vector<TestResult> runTests(const vector<TestCase>& tests, const Options& opt, ostream& log) {
+        vector<size_t> parallel;
+        vector<size_t> alone;
+        for (size_t i = 0; i < tests.size(); ++i) {
+            if (selected(tests[i].name, opt)) {
+                (tests[i].run == Run::Alone ? alone : parallel).push_back(i);
+            }
+        }
+
+        vector<TestResult> results(tests.size());
+        vector<bool> ran(tests.size(), false);
+        mutex logMutex;
+        auto finish = [&](size_t index, TestResult result) {
+            lock_guard<mutex> lock(logMutex);
+            log << result.output << flush;
+            results[index] = move(result);
+            ran[index] = true;
+        };
+
+        // Workers pull the next parallel test until none are left
+        atomic<size_t> next{ 0 };
+        auto work = [&] {
+            for (size_t n = next++; n < parallel.size(); n = next++) {
+                finish(parallel[n], runOne(tests[parallel[n]]));
+            }
+        };
+        size_t jobs = min(max<size_t>(opt.jobs, 1), max<size_t>(parallel.size(), 1));
+        vector<thread> workers;
+        for (size_t i = 1; i < jobs; ++i) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        for (size_t index : alone) {
+            finish(index, runOne(tests[index]));
+        }
+
+        vector<TestResult> ordered;
+        for (size_t i = 0; i < tests.size(); ++i) {
+            if (ran[i]) {
+                ordered.push_back(move(results[i]));
+            }
+        }
+        return ordered;
+    }
+
+    bool writeReport(const string& path, const vector<TestResult>& results, double wallMs, size_t jobs) {
+        FILE* out = fopen(path.c_str(), "w");
+        if (!out) {
+            return false;
+        }
+
+        int passedTotal = 0;
+        int failedTotal = 0;
+        for (const auto& r : results) {
+            passedTotal += r.passed;
+            failedTotal += r.failed;
+        }
+
+        fprintf(out, "{\n  \"suite\": \"atm\",\n");
+        fprintf(out, "  \"jobs\": %zu,\n  \"wall_ms\": %.1f,\n", jobs, wallMs);
+        fprintf(out, "  \"passed\": %d,\n  \"failed\": %d,\n", passedTotal, failedTotal);
+        fprintf(out, "  \"tests\": [\n");
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            fprintf(out,
+                    "    {\"name\": \"%s\", \"status\": \"%s\", \"passed\": %d, \"failed\": %d, "
+                    "\"threw\": %s, \"ms\": %.3f}%s\n",
+                    r.name.c_str(), r.failed ? "failed" : "ok", r.passed, r.failed,
+                    r.threw ? "true" : "false", r.ms, i + 1 < results.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+        return fclose(out) == 0;
+    }
+
+    void runAllTests(const Options& opt) {
         resetStats();
-        cout << "Running " << testCases.size() << " test(s)..." << endl;
-        cout << "===========================================" << endl;
-        
-        for (const auto& testCase : testCases) {
-            try {
-                testCase.testFunction();
-            } catch (...) {
-                cerr << "Test " << testCase.name << " threw exception" << endl;
+        size_t count = count_if(testCases.begin(), testCases.end(), [&](const TestCase& t) {
+            return selected(t.name, opt);
+        });
+        cout << "Running " << count << " test(s) on " << max<size_t>(opt.jobs, 1) << " worker(s)...\n";
+        cout << "===========================================\n";
+
+        auto start = chrono::steady_clock::now();
+        vector<TestResult> results = runTests(testCases, opt, cout);
+        double wallMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        for (const auto& r : results) {
+            passed += r.passed;
+            failed += r.failed;
+        }
+
+        // Slowest tests first, to see where the suite's time goes
+        vector<const TestResult*> slowest;
+        for (const auto& r : results) {
+            slowest.push_back(&r);
+        }
+        sort(slowest.begin(), slowest.end(), [](const TestResult* a, const TestResult* b) {
+            return a->ms > b->ms;
+        });
+        slowest.resize(min<size_t>(slowest.size(), 5));
+
+        cout << "===========================================\n";
+        char line[160];
+        snprintf(line, sizeof(line), "Wall time %.1f ms; slowest:\n", wallMs);
+        cout << line;
+        for (const TestResult* r : slowest) {
+            snprintf(line, sizeof(line), "  %9.1f ms  %s\n", r->ms, r->name.c_str());
+            cout << line;
+        }
+
+        if (!opt.reportPath.empty()) {
+            if (writeReport(opt.reportPath, results, wallMs, opt.jobs)) {
+                cout << "Report written to " << opt.reportPath << '\n';
+            } else {
+                cerr << "cannot write " << opt.reportPath << endl;
                 ++failed;
             }
         }
-        
-        cout << "===========================================" << endl;
         printResults();
     }
     
     void printResults() {
-        cout << "Tests passed: " << passed << ", failed: " << failed << endl;
+        cout << "Tests passed: " << passed << ", failed: " << failed << '\n';
         
         if (failed == 0) {
             cout << "All tests PASSED!" << endl;
@@ -77,4 +424,36 @@ namespace TestFramework {
         passed = 0;
         failed = 0;
     }
+
+    ostream& out(void) {
+        return t_context ? t_context->out : cout;
+    }
+
+    void pass(void) {
+        if (t_context) {
+            ++t_context->passed;
+        } else {
+            ++passed;
+        }
+    }
+
+    void fail(const char* cond, const string& message, const char* file, int line) {
+        if (t_context) {
+            ++t_context->failed;
+            t_context->out << "REQUIRE failed: " << cond;
+            if (!message.empty()) {
+                t_context->out << " - " << message;
+            }
+            t_context->out << " at " << file << ":" << line << '\n';
+            return;
+        }
+
+        lock_guard<mutex> lock(s_stray);
+        ++failed;
+        cerr << "REQUIRE failed: " << cond;
+        if (!message.empty()) {
+            cerr << " - " << message;
+        }
+        cerr << " at " << file << ":" << line << endl;
+    }
 }
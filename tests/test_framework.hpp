@@ -1,5 +1,11 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 #include <functional>
 
@@ -7,34 +13,113 @@ using namespace std;
 
 /**
  * @brief Test framework for ATM Controller tests
- * 
- * Provides macros and utilities for writing and running tests
+ *
+ * Provides macros and utilities for writing and running tests. Tests run
+ * in parallel on a set of workers; each test counts its own REQUIREs and
+ * buffers its output, which is printed in one piece once the test ends.
  */
 namespace TestFramework {
-    extern int passed;
-    extern int failed;
-    
+    // Totals of the last run, plus REQUIREs made outside of any test
+    extern atomic<int> passed;
+    extern atomic<int> failed;
+
+    /**
+     * @brief How a test may be scheduled
+     */
+    enum class Run {
+        Parallel,   ///< Alongside other tests
+        Alone,      ///< After the parallel tests, with nothing else running (global state, timing)
+    };
+
     struct TestCase {
         string name;
         function<void()> testFunction;
+        Run run = Run::Parallel;
+    };
+
+    /**
+     * @brief Runner settings, usually from the command line
+     *
+     * Many tests mostly wait on simulated bank latency, so even a single
+     * core runs the suite faster with a few workers.
+     */
+    struct Options {
+        size_t jobs = max(4u, thread::hardware_concurrency());  ///< Workers for parallel tests; 1 runs serially
+        vector<string> filters;                                 ///< Run tests whose name contains any of these
+        string reportPath;                                      ///< JSON report to write, if set
+    };
+
+    /**
+     * @brief Outcome of one test
+     */
+    struct TestResult {
+        string name;
+        int passed = 0;
+        int failed = 0;
+        bool threw = false;
+        double ms = 0;      ///< Wall time
+        string output;
     };
-    
+
+    /**
+     * @brief Counters and output buffer of the test running on this thread
+     */
+    struct Context {
+        int passed = 0;
+        int failed = 0;
+        ostringstream out;
+    };
+
     extern vector<TestCase> testCases;
-    
+
     // Register a test case
-    void registerTest(const string& name, function<void()> testFunc);
-    
+    void registerTest(const string& name, function<void()> testFunc, Run run = Run::Parallel);
+
     // Register all tests from modules
     void registerAllTests();
-    
+
+    /**
+     * @brief Read --jobs N, --filter TEXT (repeatable) and --report FILE
+     *
+     * @return False on an unknown or incomplete option
+     */
+    bool parseArgs(int argc, char** argv, Options& opt);
+
+    /**
+     * @brief True if the options select a test of this name
+     */
+    bool selected(const string& name, const Options& opt);
+
+    /**
+     * @brief Run the selected tests and collect their results
+     *
+     * Each test's output goes to log in one piece when it ends. Results come
+     * back in the order of tests. Leaves passed and failed alone.
+     */
+    vector<TestResult> runTests(const vector<TestCase>& tests, const Options& opt, ostream& log);
+
+    /**
+     * @brief Write results as JSON
+     */
+    bool writeReport(const string& path, const vector<TestResult>& results, double wallMs, size_t jobs);
+
     // Run all registered tests
-    void runAllTests();
-    
+    void runAllTests(const Options& opt = Options());
+
     // Print test results
     void printResults();
-    
+
     // Reset test statistics
     void resetStats();
+
+    // Output stream of the current test, or cout outside of tests
+    ostream& out(void);
+
+    // Count a passed REQUIRE
+    void pass(void);
+
+    // Count and report a failed REQUIRE
+    void fail(const char* cond, const string& message, const char* file, int line);
 }
 
 #if defined(_MSC_VER)
@@ -45,19 +130,19 @@ namespace TestFramework {
 
 /**
  * @brief Define a test function
- * 
+ *
  * Usage: TEST(test_name) { ... test code ... } END_TEST
  */
 #define TEST(name) \
     void name() { \
-        cout << "[ RUN ] " << FUNC_NAME << endl;
+        TestFramework::out() << "[ RUN ] " << FUNC_NAME << '\n';
 
 /**
  * @brief End test function definition
+ *
+ * The runner reports the outcome and wall time of the test.
  */
 #define END_TEST \
-        cout << "[ OK  ] " << FUNC_NAME << endl; \
-        cout << endl; \
     }
 
 /**
@@ -66,10 +151,9 @@ namespace TestFramework {
 #define REQUIRE(cond) \
     do { \
         if(!(cond)) { \
-            cerr << "REQUIRE failed: " #cond << " at " << __FILE__ << ":" << __LINE__ << endl; \
-            ++TestFramework::failed; \
+            TestFramework::fail(#cond, string(), __FILE__, __LINE__); \
         } else { \
-            ++TestFramework::passed; \
+            TestFramework::pass(); \
         } \
     } while(0)
 
@@ -79,9 +163,32 @@ namespace TestFramework {
 #define REQUIRE_MSG(cond, msg) \
     do { \
         if(!(cond)) { \
-            cerr << "REQUIRE failed: " #cond << " - " << msg << " at " << __FILE__ << ":" << __LINE__ << endl; \
-            ++TestFramework::failed; \
+            ostringstream requireMessage_; \
+            requireMessage_ << msg; \
+            TestFramework::fail(#cond, requireMessage_.str(), __FILE__, __LINE__); \
+        } else { \
+            TestFramework::pass(); \
+        } \
+    } while(0)
+
+/**
+ * @brief Require condition to be true and evaluated within a time budget
+ *
+ * Usage: REQUIRE_WITHIN(chrono::milliseconds(50), queue.drain(timeout))
+ */
+#define REQUIRE_WITHIN(budget, cond) \
+    do { \
+        auto requireStart_ = chrono::steady_clock::now(); \
+        bool requireOk_ = bool(cond); \
+        auto requireTook_ = chrono::steady_clock::now() - requireStart_; \
+        if(!requireOk_) { \
+            TestFramework::fail(#cond, string(), __FILE__, __LINE__); \
+        } else if(requireTook_ > (budget)) { \
+            ostringstream requireMessage_; \
+            requireMessage_ << "took " << chrono::duration_cast<chrono::microseconds>(requireTook_).count() \
+                            << " us, budget " << chrono::duration_cast<chrono::microseconds>(budget).count() << " us"; \
+            TestFramework::fail(#cond, requireMessage_.str(), __FILE__, __LINE__); \
         } else { \
-            ++TestFramework::passed; \
+            TestFramework::pass(); \
         } \
     } while(0)
@@ -2,9 +2,17 @@
 
 /**
  * @brief Main test runner for ATM Controller
+ *
+ * Usage: atm [--jobs N] [--filter TEXT]... [--report FILE]
  */
 
-int main() {
+int main(int argc, char** argv) {
+    TestFramework::Options opt;
+    if (!TestFramework::parseArgs(argc, argv, opt)) {
+        cerr << "usage: " << argv[0] << " [--jobs N] [--filter TEXT]... [--report FILE]" << endl;
+        return 2;
+    }
+
     cout << "ATM Controller Test Suite" << endl;
     cout << "=========================" << endl;
     
@@ -12,7 +20,7 @@ int main() {
     TestFramework::registerAllTests();
     
     // Run all registered tests
-    TestFramework::runAllTests();
+    TestFramework::runAllTests(opt);
     
     return (TestFramework::failed > 0) ? 1 : 0;
 }
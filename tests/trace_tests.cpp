@@ -0,0 +1,131 @@
+#include "test_framework.hpp"
+#include "Controller.hpp"
+#include "fakes/FakeCardReader.hpp"
+#include "fakes/FakeBank.hpp"
+#include "fakes/FakeCashBin.hpp"
+#include "fakes/TempPath.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Test the per-thread rings and Chrome trace export
+ *
+ * - Events from several threads come back in time order with thread ids
+ * - A full ring keeps only the newest events
+ * - The export is a Chrome trace document with every event
+ */
+TEST(test_event_tracer_rings)
+    EventTracer& tracer = EventTracer::instance();
+    tracer.clear();
+
+    tracer.record(TraceKind::Instant, "main", "mark", 7);
+    thread other([&] {
+        tracer.record(TraceKind::Begin, "other");
+        tracer.record(TraceKind::End, "other");
+    });
+    other.join();
+
+    auto events = tracer.collect();
+    REQUIRE(events.size() == 3);
+    REQUIRE(events[0].arg == 7);
+    REQUIRE(strcmp(events[1].name, "other") == 0);
+    REQUIRE(events[1].kind == TraceKind::Begin);
+    REQUIRE(events[0].thread != events[1].thread);
+
+    tracer.clear();
+    for (size_t i = 0; i < EventTracer::kRingEvents + 10; ++i)
+    {
+        tracer.record(TraceKind::Instant, "spin", nullptr, int64_t(i));
+    }
+    events = tracer.collect();
+    REQUIRE(events.size() == EventTracer::kRingEvents);
+    REQUIRE(events.front().arg == 10);
+    REQUIRE(events.back().arg == int64_t(EventTracer::kRingEvents + 9));
+
+    auto path = tempPath("trace_test", ".json");
+    REQUIRE(tracer.writeChromeTrace(path).isOk());
+    ifstream in(path);
+    stringstream text;
+    text << in.rdbuf();
+    string json = text.str();
+    REQUIRE(json.find("\"traceEvents\"") != string::npos);
+    REQUIRE(json.find("\"name\":\"spin\"") != string::npos);
+    filesystem::remove(path);
+
+    tracer.clear();
+    REQUIRE(tracer.collect().empty());
+END_TEST
+
+/**
+ * @brief Test that Controller traces transitions, device calls and errors
+ */
+TEST(test_controller_tracing)
+#if ATM_TRACING
+    Card card = "CARD-001";
+    Pin pin = "1234";
+    AccountId account = "ACCOUNT-001";
+
+    class FlakyBank : public FakeBank {
+    public:
+        using FakeBank::FakeBank;
+
+        Result<int> getBalance(const AccountId&) override
+        {
+            throw runtime_error("bank unreachable");
+        }
+    };
+
+    FakeCardReader cardReader(card);
+    FlakyBank bank({ {card, pin} }, { {card, {account}} }, { {account, 1000} });
+    FakeCashBin cashBin(10000);
+    Controller atm(cardReader, bank, cashBin);
+
+    EventTracer& tracer = EventTracer::instance();
+    tracer.clear();
+    EventTracer::enable(true);
+
+    REQUIRE(atm.insertCard().isOk());
+    REQUIRE(atm.enterPin(pin).isOk());
+    REQUIRE(atm.selectAccount(account).isOk());
+    REQUIRE(atm.getBalance().error() == Err::NetworkError);
+    REQUIRE(atm.ejectCard().isOk());
+
+    EventTracer::enable(false);
+    auto events = tracer.collect();
+    tracer.clear();
+
+    vector<string> transitions;
+    int pinCalls = 0;
+    bool translated = false;
+    for (const auto& e : events)
+    {
+        if (e.kind == TraceKind::State)
+        {
+            transitions.push_back(string(e.name) + ">" + e.detail);
+        }
+        else if (e.kind == TraceKind::Begin && strcmp(e.name, "bank.verifyPin") == 0)
+        {
+            ++pinCalls;
+        }
+        else if (e.kind == TraceKind::Error)
+        {
+            translated = strcmp(e.name, "getBalance") == 0 && strcmp(e.detail, "runtime_error") == 0
+                && e.arg == int64_t(Err::NetworkError);
+        }
+    }
+
+    REQUIRE((transitions == vector<string>{ "Idle>CardInserted", "CardInserted>Authenticated",
+                                            "Authenticated>AccountSelected", "AccountSelected>Idle" }));
+    REQUIRE(pinCalls == 1);
+    REQUIRE(translated);
+#endif
+END_TEST
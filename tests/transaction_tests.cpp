@@ -1,5 +1,6 @@
 #include "test_framework.hpp"
 #include "Controller.hpp"
+#include "InlineTransactionManager.hpp"
 #include "fakes/FakeCardReader.hpp"
 #include "fakes/FakeBank.hpp"
 #include "fakes/FakeCashBin.hpp"
@@ -144,3 +145,45 @@ TEST(test_multiple_atomic_transactions)
     
     REQUIRE(atm.ejectCard().isOk());
 END_TEST
+
+/**
+ * @brief Test inline transaction manager semantics
+ *
+ * - Execution stops at the first failing operation
+ * - Executed operations roll back in reverse order on destruction
+ * - Committed transactions are not rolled back
+ * - Operations beyond the inline capacity are refused
+ */
+TEST(test_inline_transaction_semantics)
+    vector<int> log;
+
+    {
+        InlineTransactionManager<3> transaction;
+        REQUIRE(transaction.addOperation(
+            [&]() -> Status { log.push_back(1); return Status::okStatus(); },
+            [&]() { log.push_back(-1); }).isOk());
+        REQUIRE(transaction.addOperation(
+            [&]() -> Status { log.push_back(2); return Status::okStatus(); },
+            [&]() { log.push_back(-2); }).isOk());
+        REQUIRE(transaction.addOperation(
+            [&]() -> Status { log.push_back(3); return Status::error(Err::HardwareError); },
+            [&]() { log.push_back(-3); }).isOk());
+        REQUIRE(!transaction.addOperation(
+            [&]() -> Status { return Status::okStatus(); },
+            [&]() {}).isOk());
+
+        REQUIRE(transaction.execute().code == Err::HardwareError);
+    }
+    REQUIRE((log == vector<int>{1, 2, 3, -2, -1}));
+
+    log.clear();
+    {
+        InlineTransactionManager<2> transaction;
+        (void)transaction.addOperation(
+            [&]() -> Status { log.push_back(1); return Status::okStatus(); },
+            [&]() { log.push_back(-1); });
+        REQUIRE(transaction.execute().isOk());
+        transaction.commit();
+    }
+    REQUIRE((log == vector<int>{1}));
+END_TEST